@@ -0,0 +1,207 @@
+#include <string.h>
+
+#include "alert_rules.h"
+
+static bool rate_metric(alr_state* state, uint32_t time_s, int32_t value, int32_t* rate);
+static void emit(alr_event* events, size_t max, size_t* count, uint32_t time_s, int32_t value, size_t rule,
+    bool raised);
+
+/**
+ * Initialize an engine over caller provided rules and state, which must have a larger lifetime than the engine. The
+ * rules are read on every evaluation, so they can be changed in place; call alr_reset after changing them.
+*/
+int alr_init(alr_engine* engine, const alr_rule* rules, alr_state* states, size_t count)
+{
+    if (!engine || (count > 0 && (!rules || !states)) || count > UINT8_MAX)
+    {
+        return ALR_FAIL;
+    }
+
+    engine->rules = rules;
+    engine->states = states;
+    engine->count = count;
+
+    if (count > 0)
+    {
+        memset(states, 0, count * sizeof(alr_state));
+    }
+
+    return ALR_OK;
+}
+
+/**
+ * Evaluate every enabled rule against a reading. Raised and cleared events are written to events, at most one per
+ * rule, so max should be the rule count. Returns the number of events written.
+ *
+ * Readings must be passed in time order.
+*/
+size_t alr_evaluate(alr_engine* engine, uint32_t time_s, int32_t value, alr_event* events, size_t max)
+{
+    size_t count = 0;
+
+    if (!engine)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < engine->count; ++i)
+    {
+        const alr_rule* rule = &engine->rules[i];
+        alr_state* state = &engine->states[i];
+
+        if (!rule->enabled)
+        {
+            continue;
+        }
+
+        int32_t metric = value;
+        bool trigger;
+        bool release;
+
+        switch (rule->kind)
+        {
+        case ALR_ABOVE:
+            trigger = value >= rule->threshold;
+            release = value < rule->threshold - rule->hysteresis;
+            break;
+        case ALR_BELOW:
+            trigger = value <= rule->threshold;
+            release = value > rule->threshold + rule->hysteresis;
+            break;
+        case ALR_RATE:
+            // Between window ends there is no new rate, so the rule keeps its state.
+            if (!rate_metric(state, time_s, value, &metric))
+            {
+                continue;
+            }
+
+            trigger = (metric < 0 ? -metric : metric) >= rule->threshold;
+            release = (metric < 0 ? -metric : metric) < rule->threshold - rule->hysteresis;
+            break;
+        default:
+            continue;
+        }
+
+        if (state->active)
+        {
+            if (release)
+            {
+                state->active = false;
+                emit(events, max, &count, time_s, metric, i, false);
+            }
+        }
+        else if (trigger)
+        {
+            if (!state->pending)
+            {
+                state->pending = true;
+                state->pending_since = time_s;
+            }
+
+            if (time_s - state->pending_since >= rule->min_duration_s)
+            {
+                state->pending = false;
+                state->active = true;
+                emit(events, max, &count, time_s, metric, i, true);
+            }
+        }
+        else
+        {
+            // The condition must hold continuously for the minimum duration.
+            state->pending = false;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Forget all rule state, for example after the rules were changed. A cleared event is written for each rule that was
+ * active. Returns the number of events written.
+*/
+size_t alr_reset(alr_engine* engine, uint32_t time_s, alr_event* events, size_t max)
+{
+    size_t count = 0;
+
+    if (!engine)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < engine->count; ++i)
+    {
+        if (engine->states[i].active)
+        {
+            emit(events, max, &count, time_s, 0, i, false);
+        }
+    }
+
+    if (engine->count > 0)
+    {
+        memset(engine->states, 0, engine->count * sizeof(alr_state));
+    }
+
+    return count;
+}
+
+bool alr_is_active(const alr_engine* engine, size_t rule)
+{
+    return engine && rule < engine->count && engine->states[rule].active;
+}
+
+bool alr_any_active(const alr_engine* engine)
+{
+    for (size_t i = 0; engine && i < engine->count; ++i)
+    {
+        if (engine->states[i].active)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Advance a rate rule's window. Returns true with the rate per minute when a window of at least ALR_RATE_WINDOW_S
+ * ended at this reading; the next window starts here.
+*/
+static bool rate_metric(alr_state* state, uint32_t time_s, int32_t value, int32_t* rate)
+{
+    if (!state->has_anchor)
+    {
+        state->has_anchor = true;
+        state->anchor_time = time_s;
+        state->anchor_value = value;
+        return false;
+    }
+
+    uint32_t elapsed = time_s - state->anchor_time;
+    if (elapsed < ALR_RATE_WINDOW_S)
+    {
+        return false;
+    }
+
+    *rate = (int32_t)(((int64_t)value - state->anchor_value) * 60 / (int64_t)elapsed);
+
+    state->anchor_time = time_s;
+    state->anchor_value = value;
+
+    return true;
+}
+
+static void emit(alr_event* events, size_t max, size_t* count, uint32_t time_s, int32_t value, size_t rule,
+    bool raised)
+{
+    if (events == NULL || *count >= max)
+    {
+        return;
+    }
+
+    alr_event* e = &events[*count];
+    e->time_s = time_s;
+    e->value = value;
+    e->rule = (uint8_t)rule;
+    e->raised = raised;
+    ++(*count);
+}
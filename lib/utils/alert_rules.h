@@ -0,0 +1,91 @@
+/**
+ * Threshold alert rules evaluated incrementally, one reading at a time, in O(rules) time and without keeping history.
+ *
+ * A rule fires once its condition has held for min_duration_s, and clears only when the value is back past the
+ * threshold by the hysteresis, so a reading hovering on the threshold does not toggle the alert. Rate rules measure
+ * the change over windows of at least ALR_RATE_WINDOW_S, which keeps fast poll rates from amplifying sensor noise.
+*/
+#ifndef _WA_ALERT_RULES_H_INCLUDE_GUARD
+#define _WA_ALERT_RULES_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define ALR_OK 0
+#define ALR_FAIL 1
+
+// Shortest time a rate is measured over (seconds). Rates are reported per minute.
+#define ALR_RATE_WINDOW_S 60
+
+typedef enum alr_kind
+{
+    // Value at or above the threshold. Clears below threshold - hysteresis.
+    ALR_ABOVE,
+    // Value at or below the threshold. Clears above threshold + hysteresis.
+    ALR_BELOW,
+    // Change per minute, either direction, at or above the threshold. Clears below threshold - hysteresis.
+    ALR_RATE
+} alr_kind;
+
+typedef struct alr_rule
+{
+    alr_kind kind;
+    bool enabled;
+    int32_t threshold;
+    int32_t hysteresis;
+    uint32_t min_duration_s;
+} alr_rule;
+
+/**
+ * Per rule state. Owned by the engine; the caller only provides the storage.
+*/
+typedef struct alr_state
+{
+    bool active;
+    bool pending;
+    uint32_t pending_since;
+
+    // Rate rules: start of the current measuring window.
+    bool has_anchor;
+    uint32_t anchor_time;
+    int32_t anchor_value;
+} alr_state;
+
+/**
+ * A rule raised or cleared. value is what the rule compared: the reading, or the rate per minute for rate rules.
+*/
+typedef struct alr_event
+{
+    uint32_t time_s;
+    int32_t value;
+    uint8_t rule;
+    bool raised;
+} alr_event;
+
+typedef struct alr_engine
+{
+    const alr_rule* rules;
+    alr_state* states;
+    size_t count;
+} alr_engine;
+
+int alr_init(alr_engine* engine, const alr_rule* rules, alr_state* states, size_t count);
+
+size_t alr_evaluate(alr_engine* engine, uint32_t time_s, int32_t value, alr_event* events, size_t max);
+
+size_t alr_reset(alr_engine* engine, uint32_t time_s, alr_event* events, size_t max);
+
+bool alr_is_active(const alr_engine* engine, size_t rule);
+
+bool alr_any_active(const alr_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_ALERT_RULES_H_INCLUDE_GUARD
@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "downsample.h"
+
+static size_t take_bucket(dsm_minmax* dsm, dsm_point out[DSM_MAX_OUT]);
+
+/**
+ * Start downsampling the points from from to to (inclusive) to at most max_points, which must be at least 2. Points
+ * outside the range are ignored.
+*/
+void dsm_init(dsm_minmax* dsm, uint32_t from, uint32_t to, size_t max_points)
+{
+    memset(dsm, 0, sizeof(dsm_minmax));
+    dsm->from = from;
+    dsm->to = to;
+
+    // Round the span up so the last bucket ends at or after to. 64 bits because the whole range is 2^32 seconds.
+    uint64_t buckets = max_points >= DSM_MAX_OUT ? max_points / DSM_MAX_OUT : 1;
+    uint64_t range = to >= from ? (uint64_t)to - from + 1 : 1;
+    dsm->bucket_span = (uint32_t)((range + buckets - 1) / buckets);
+}
+
+/**
+ * Add the next point; times must not go backward. Returns the number of points written to out (0 to DSM_MAX_OUT),
+ * which are the previous bucket's if this point starts a new one.
+*/
+size_t dsm_add(dsm_minmax* dsm, uint32_t time, int32_t value, dsm_point out[DSM_MAX_OUT])
+{
+    if (time < dsm->from || time > dsm->to)
+    {
+        return 0;
+    }
+
+    uint32_t bucket = (time - dsm->from) / dsm->bucket_span;
+    size_t count = 0;
+
+    if (dsm->has_points && bucket != dsm->bucket)
+    {
+        count = take_bucket(dsm, out);
+    }
+
+    dsm_point point = { .time = time, .value = value };
+
+    if (!dsm->has_points)
+    {
+        dsm->bucket = bucket;
+        dsm->low = point;
+        dsm->high = point;
+        dsm->has_points = true;
+    }
+    else if (value < dsm->low.value)
+    {
+        dsm->low = point;
+    }
+    else if (value > dsm->high.value)
+    {
+        dsm->high = point;
+    }
+
+    return count;
+}
+
+/**
+ * Hand back the last bucket's points. Returns the number written to out.
+*/
+size_t dsm_finish(dsm_minmax* dsm, dsm_point out[DSM_MAX_OUT])
+{
+    return dsm->has_points ? take_bucket(dsm, out) : 0;
+}
+
+/**
+ * Write the current bucket's low and high in time order, and empty it.
+*/
+static size_t take_bucket(dsm_minmax* dsm, dsm_point out[DSM_MAX_OUT])
+{
+    dsm->has_points = false;
+
+    if (dsm->low.time == dsm->high.time)
+    {
+        out[0] = dsm->low;
+        return 1;
+    }
+
+    bool low_first = dsm->low.time < dsm->high.time;
+    out[0] = low_first ? dsm->low : dsm->high;
+    out[1] = low_first ? dsm->high : dsm->low;
+    return 2;
+}
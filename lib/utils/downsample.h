@@ -0,0 +1,50 @@
+/**
+ * Shape-preserving downsampling of a time series in one streaming pass, with no buffer.
+ *
+ * The time range is split into equal buckets and each bucket is reduced to its lowest and highest point, in time
+ * order (one point if they are the same). Unlike averaging or picking every Nth point, spikes and dips survive, so a
+ * chart of the result looks like a chart of the full series. Points are fed in time order and each finished bucket is
+ * handed back as soon as a point past it arrives, so the state is a few words whatever the series length.
+*/
+#ifndef _WA_DOWNSAMPLE_H_INCLUDE_GUARD
+#define _WA_DOWNSAMPLE_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/** Most points dsm_add or dsm_finish hand back at once: one bucket's low and high. */
+#define DSM_MAX_OUT 2
+
+typedef struct dsm_point
+{
+    uint32_t time;
+    int32_t value;
+} dsm_point;
+
+typedef struct dsm_minmax
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t bucket_span;
+    uint32_t bucket;
+    bool has_points;
+    dsm_point low;
+    dsm_point high;
+} dsm_minmax;
+
+void dsm_init(dsm_minmax* dsm, uint32_t from, uint32_t to, size_t max_points);
+
+size_t dsm_add(dsm_minmax* dsm, uint32_t time, int32_t value, dsm_point out[DSM_MAX_OUT]);
+
+size_t dsm_finish(dsm_minmax* dsm, dsm_point out[DSM_MAX_OUT]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_DOWNSAMPLE_H_INCLUDE_GUARD
@@ -0,0 +1,326 @@
+#include <string.h>
+
+#include "gzip_stream.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define END_OF_BLOCK 256
+
+_Static_assert((GZS_WINDOW_SIZE & (GZS_WINDOW_SIZE - 1)) == 0 && GZS_WINDOW_SIZE >= 512 && GZS_WINDOW_SIZE <= 16384,
+    "GZS_WINDOW_SIZE must be a power of two from 512 to 16384");
+
+// Deflate length codes 257 to 285 and distance codes 0 to 29: the first value of each and its extra bits.
+static const uint16_t s_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t s_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// CRC-32 (the gzip polynomial, reflected) a nibble at a time.
+static const uint32_t s_crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static void compress(gzs_t* gz, size_t end, size_t lookahead_end);
+static void slide(gzs_t* gz);
+static uint32_t hash3(const uint8_t* p);
+static void put_literal(gzs_t* gz, unsigned symbol);
+static void put_match(gzs_t* gz, size_t length, size_t distance);
+static void put_huffman(gzs_t* gz, unsigned code, unsigned len);
+static void put_bits(gzs_t* gz, uint32_t value, unsigned count);
+static void put_byte(gzs_t* gz, uint8_t value);
+static void flush_out(gzs_t* gz);
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, size_t len);
+
+/**
+ * Start a gzip stream. The header is written through the sink with the first output.
+*/
+int gzs_init(gzs_t* gz, gzs_sink_fn sink, void* ctx)
+{
+    if (!gz || !sink)
+    {
+        return GZS_FAIL;
+    }
+
+    gz->sink = sink;
+    gz->ctx = ctx;
+    memset(gz->head, 0xFF, sizeof(gz->head));
+    gz->filled = 0;
+    gz->pos = 0;
+    gz->bits = 0;
+    gz->bit_count = 0;
+    gz->out_len = 0;
+    gz->crc = 0xFFFFFFFF;
+    gz->total_in = 0;
+    gz->total_out = 0;
+    gz->status = GZS_OK;
+
+    // Magic, deflate, no flags, no time, no extra flags, unknown OS.
+    static const uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+    for (size_t i = 0; i < sizeof(header); ++i)
+    {
+        put_byte(gz, header[i]);
+    }
+
+    // The one block: final, fixed Huffman codes.
+    put_bits(gz, 1, 1);
+    put_bits(gz, 1, 2);
+
+    return GZS_OK;
+}
+
+/**
+ * Add input. Compression runs each time the window fills, so output reaches the sink as input arrives. Returns
+ * GZS_FAIL if the sink failed, now or before.
+*/
+int gzs_write(gzs_t* gz, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+
+    while (len > 0 && gz->status == GZS_OK)
+    {
+        size_t space = sizeof(gz->window) - gz->filled;
+        size_t n = len < space ? len : space;
+
+        memcpy(gz->window + gz->filled, p, n);
+        gz->crc = crc_update(gz->crc, p, n);
+        gz->total_in += (uint32_t)n;
+        gz->filled += n;
+        p += n;
+        len -= n;
+
+        if (gz->filled == sizeof(gz->window))
+        {
+            // Keep a whole match of lookahead, so no match is cut short at the end of the buffered input.
+            compress(gz, gz->filled - MAX_MATCH, gz->filled);
+            slide(gz);
+        }
+    }
+
+    return gz->status;
+}
+
+/**
+ * Compress the rest of the input and write the end of the stream. Returns GZS_FAIL if the sink failed at any point.
+*/
+int gzs_finish(gzs_t* gz)
+{
+    compress(gz, gz->filled, gz->filled);
+    put_literal(gz, END_OF_BLOCK);
+
+    // Pad to a byte.
+    if (gz->bit_count > 0)
+    {
+        put_bits(gz, 0, 8 - gz->bit_count);
+    }
+
+    uint32_t crc = ~gz->crc;
+    for (int i = 0; i < 4; ++i)
+    {
+        put_byte(gz, (uint8_t)(crc >> (8 * i)));
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        put_byte(gz, (uint8_t)(gz->total_in >> (8 * i)));
+    }
+
+    flush_out(gz);
+    return gz->status;
+}
+
+/**
+ * Encode the window from pos up to end. Matches may run on to lookahead_end.
+*/
+static void compress(gzs_t* gz, size_t end, size_t lookahead_end)
+{
+    while (gz->pos < end)
+    {
+        size_t pos = gz->pos;
+        size_t best_len = 0;
+        size_t best_dist = 0;
+
+        if (pos + MIN_MATCH <= lookahead_end)
+        {
+            uint32_t h = hash3(gz->window + pos);
+            int candidate = gz->head[h];
+            gz->head[h] = (int16_t)pos;
+
+            if (candidate >= 0 && pos - (size_t)candidate <= GZS_WINDOW_SIZE)
+            {
+                const uint8_t* a = gz->window + candidate;
+                const uint8_t* b = gz->window + pos;
+                size_t max = lookahead_end - pos < MAX_MATCH ? lookahead_end - pos : MAX_MATCH;
+                size_t len = 0;
+
+                while (len < max && a[len] == b[len])
+                {
+                    ++len;
+                }
+
+                if (len >= MIN_MATCH)
+                {
+                    best_len = len;
+                    best_dist = pos - (size_t)candidate;
+                }
+            }
+        }
+
+        if (best_len == 0)
+        {
+            put_literal(gz, gz->window[pos]);
+            gz->pos = pos + 1;
+            continue;
+        }
+
+        put_match(gz, best_len, best_dist);
+
+        // Hash the positions inside the match too, so later text can refer back to them.
+        for (size_t i = pos + 1; i < pos + best_len && i + MIN_MATCH <= lookahead_end; ++i)
+        {
+            gz->head[hash3(gz->window + i)] = (int16_t)i;
+        }
+
+        gz->pos = pos + best_len;
+    }
+}
+
+/**
+ * Drop the older half of the window. The newer half stays as history for matches.
+*/
+static void slide(gzs_t* gz)
+{
+    memmove(gz->window, gz->window + GZS_WINDOW_SIZE, gz->filled - GZS_WINDOW_SIZE);
+    gz->filled -= GZS_WINDOW_SIZE;
+    gz->pos -= GZS_WINDOW_SIZE;
+
+    for (size_t i = 0; i < sizeof(gz->head) / sizeof(gz->head[0]); ++i)
+    {
+        gz->head[i] = gz->head[i] >= GZS_WINDOW_SIZE ? (int16_t)(gz->head[i] - GZS_WINDOW_SIZE) : -1;
+    }
+}
+
+static uint32_t hash3(const uint8_t* p)
+{
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (v * 2654435761u) >> (32 - GZS_HASH_BITS);
+}
+
+/**
+ * Write a literal byte or the end of block with the fixed literal/length code.
+*/
+static void put_literal(gzs_t* gz, unsigned symbol)
+{
+    if (symbol < 144)
+    {
+        put_huffman(gz, 0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        put_huffman(gz, 0x190 + symbol - 144, 9);
+    }
+    else
+    {
+        put_huffman(gz, symbol - 256, 7);
+    }
+}
+
+static void put_match(gzs_t* gz, size_t length, size_t distance)
+{
+    unsigned code = 28;
+    while (s_length_base[code] > length)
+    {
+        --code;
+    }
+
+    // Length symbols 257 to 279 have 7 bit codes, 280 to 285 8 bit codes.
+    unsigned symbol = 257 + code;
+    if (symbol < 280)
+    {
+        put_huffman(gz, symbol - 256, 7);
+    }
+    else
+    {
+        put_huffman(gz, 0xC0 + symbol - 280, 8);
+    }
+    put_bits(gz, (uint32_t)(length - s_length_base[code]), s_length_extra[code]);
+
+    code = 29;
+    while (s_dist_base[code] > distance)
+    {
+        --code;
+    }
+
+    put_huffman(gz, code, 5);
+    put_bits(gz, (uint32_t)(distance - s_dist_base[code]), s_dist_extra[code]);
+}
+
+/**
+ * Huffman codes are packed starting from their most significant bit, unlike everything else in deflate.
+*/
+static void put_huffman(gzs_t* gz, unsigned code, unsigned len)
+{
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < len; ++i)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+
+    put_bits(gz, reversed, len);
+}
+
+static void put_bits(gzs_t* gz, uint32_t value, unsigned count)
+{
+    gz->bits |= value << gz->bit_count;
+    gz->bit_count += count;
+
+    while (gz->bit_count >= 8)
+    {
+        put_byte(gz, (uint8_t)gz->bits);
+        gz->bits >>= 8;
+        gz->bit_count -= 8;
+    }
+}
+
+static void put_byte(gzs_t* gz, uint8_t value)
+{
+    gz->out[gz->out_len++] = (char)value;
+    if (gz->out_len == sizeof(gz->out))
+    {
+        flush_out(gz);
+    }
+}
+
+/**
+ * Hand the output to the sink. After a failure, output is dropped.
+*/
+static void flush_out(gzs_t* gz)
+{
+    if (gz->out_len > 0 && gz->status == GZS_OK)
+    {
+        gz->status = gz->sink(gz->ctx, gz->out, gz->out_len) == GZS_OK ? GZS_OK : GZS_FAIL;
+        gz->total_out += (uint32_t)gz->out_len;
+    }
+
+    gz->out_len = 0;
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ s_crc_nibble[crc & 0xF];
+        crc = (crc >> 4) ^ s_crc_nibble[crc & 0xF];
+    }
+
+    return crc;
+}
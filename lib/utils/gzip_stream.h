@@ -0,0 +1,76 @@
+/**
+ * Streaming gzip compression in fixed memory, for compressing responses as they are sent.
+ *
+ * Input is buffered in a window of 2 * GZS_WINDOW_SIZE bytes and compressed with LZ77 (one hash candidate per
+ * position, no chains) and the fixed Huffman codes of deflate, in a single block. There are no code tables to build or
+ * send, which suits output of a few KB: markup and JSON come out at about two thirds of their size. The compressed
+ * stream is written out through a sink in pieces of GZS_OUT_SIZE bytes, with the gzip header and trailer, so it can
+ * go straight out as HTTP chunks.
+*/
+#ifndef _WA_GZIP_STREAM_H_INCLUDE_GUARD
+#define _WA_GZIP_STREAM_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define GZS_OK 0
+#define GZS_FAIL 1
+
+/** How far back matches are looked for. A power of two from 512 to 16384. */
+#ifndef GZS_WINDOW_SIZE
+#define GZS_WINDOW_SIZE 1024
+#endif
+
+/** Hash table entries, as a power of two. */
+#ifndef GZS_HASH_BITS
+#define GZS_HASH_BITS 9
+#endif
+
+/** Compressed output is handed to the sink in pieces of this size. */
+#ifndef GZS_OUT_SIZE
+#define GZS_OUT_SIZE 256
+#endif
+
+/**
+ * Writes len bytes of compressed output. Returns GZS_OK, or GZS_FAIL to stop. Same as sgb_sink_fn, so a builder sink
+ * can be used.
+*/
+typedef int (*gzs_sink_fn)(void* ctx, const char* data, size_t len);
+
+typedef struct gzs_t
+{
+    gzs_sink_fn sink;
+    void* ctx;
+
+    uint8_t window[2 * GZS_WINDOW_SIZE];
+    // Window position of the last position with each hash, or -1.
+    int16_t head[1 << GZS_HASH_BITS];
+    size_t filled;
+    size_t pos;
+
+    uint32_t bits;
+    unsigned bit_count;
+    char out[GZS_OUT_SIZE];
+    size_t out_len;
+
+    uint32_t crc;
+    uint32_t total_in;
+    uint32_t total_out;
+    int status;
+} gzs_t;
+
+int gzs_init(gzs_t* gz, gzs_sink_fn sink, void* ctx);
+
+int gzs_write(gzs_t* gz, const void* data, size_t len);
+
+int gzs_finish(gzs_t* gz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_GZIP_STREAM_H_INCLUDE_GUARD
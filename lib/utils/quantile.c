@@ -0,0 +1,300 @@
+#include <string.h>
+
+#include "quantile.h"
+
+static int64_t desired_position_x1000(const qnt_p2* est, int marker);
+static int32_t parabolic(const qnt_p2* est, int i, int32_t d);
+static int32_t linear(const qnt_p2* est, int i, int32_t d);
+static void set_restart(qnt_set* set, size_t quantile_count, uint32_t time_s);
+static const qnt_set* oldest_set(const qnt_window* win);
+
+/**
+ * Initialize an estimator for a quantile in thousandths (0 to 1000).
+*/
+int qnt_p2_init(qnt_p2* est, uint16_t permille)
+{
+    if (!est || permille > 1000)
+    {
+        return QNT_FAIL;
+    }
+
+    memset(est, 0, sizeof(qnt_p2));
+    est->permille = permille;
+
+    return QNT_OK;
+}
+
+/**
+ * Add a value. Constant time.
+*/
+void qnt_p2_add(qnt_p2* est, int32_t value)
+{
+    int32_t* q = est->heights;
+    int32_t* n = est->positions;
+
+    // The first five values are kept sorted; they become the markers.
+    if (est->count < 5)
+    {
+        int i = (int)est->count;
+        while (i > 0 && q[i - 1] > value)
+        {
+            q[i] = q[i - 1];
+            --i;
+        }
+        q[i] = value;
+
+        ++est->count;
+        if (est->count == 5)
+        {
+            for (int m = 0; m < 5; ++m)
+            {
+                n[m] = m + 1;
+            }
+        }
+        return;
+    }
+
+    // Find the cell the value falls in, extending the ends if it is a new minimum or maximum.
+    int k;
+    if (value < q[0])
+    {
+        q[0] = value;
+        k = 0;
+    }
+    else if (value >= q[4])
+    {
+        q[4] = value;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (k < 3 && value >= q[k + 1])
+        {
+            ++k;
+        }
+    }
+
+    for (int m = k + 1; m < 5; ++m)
+    {
+        ++n[m];
+    }
+    ++est->count;
+
+    // Move the middle markers that are a whole position or more from where they should be.
+    for (int i = 1; i <= 3; ++i)
+    {
+        int64_t d_x1000 = desired_position_x1000(est, i) - (int64_t)n[i] * 1000;
+
+        if ((d_x1000 >= 1000 && n[i + 1] - n[i] > 1) || (d_x1000 <= -1000 && n[i - 1] - n[i] < -1))
+        {
+            int32_t d = d_x1000 > 0 ? 1 : -1;
+
+            int32_t height = parabolic(est, i, d);
+            if (height <= q[i - 1] || height >= q[i + 1])
+            {
+                height = linear(est, i, d);
+            }
+
+            q[i] = height;
+            n[i] += d;
+        }
+    }
+}
+
+/**
+ * Get the estimate. Returns false if no values were added. With fewer than five values it is the nearest of them.
+*/
+bool qnt_p2_get(const qnt_p2* est, int32_t* value)
+{
+    if (est->count == 0)
+    {
+        return false;
+    }
+
+    if (est->count < 5)
+    {
+        uint32_t idx = ((est->count - 1) * est->permille + 500) / 1000;
+        *value = est->heights[idx];
+    }
+    else
+    {
+        *value = est->heights[2];
+    }
+
+    return true;
+}
+
+/**
+ * Initialize a window of length_s seconds tracking up to QNT_MAX_QUANTILES quantiles (in thousandths).
+*/
+int qnt_window_init(qnt_window* win, uint32_t length_s, const uint16_t* permilles, size_t count)
+{
+    if (!win || !permilles || count == 0 || count > QNT_MAX_QUANTILES || length_s < 2)
+    {
+        return QNT_FAIL;
+    }
+
+    memset(win, 0, sizeof(qnt_window));
+    win->length_s = length_s;
+    win->quantile_count = count;
+
+    for (int s = 0; s < 2; ++s)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (qnt_p2_init(&win->sets[s].est[i], permilles[i]) != QNT_OK)
+            {
+                return QNT_FAIL;
+            }
+        }
+    }
+
+    return QNT_OK;
+}
+
+/**
+ * Add a value taken at time_s. Times must not go backwards.
+*/
+void qnt_window_add(qnt_window* win, uint32_t time_s, int32_t value)
+{
+    qnt_set* first = &win->sets[0];
+    qnt_set* second = &win->sets[1];
+
+    if (!first->active)
+    {
+        set_restart(first, win->quantile_count, time_s);
+    }
+    else if (!second->active && time_s - first->start_s >= win->length_s / 2)
+    {
+        set_restart(second, win->quantile_count, time_s);
+    }
+
+    for (int s = 0; s < 2; ++s)
+    {
+        qnt_set* set = &win->sets[s];
+        if (!set->active)
+        {
+            continue;
+        }
+
+        if (time_s - set->start_s >= win->length_s)
+        {
+            set_restart(set, win->quantile_count, time_s);
+        }
+
+        for (size_t i = 0; i < win->quantile_count; ++i)
+        {
+            qnt_p2_add(&set->est[i], value);
+        }
+    }
+}
+
+/**
+ * Get the estimates, in the order the quantiles were given to qnt_window_init. span_s is set to how far back they
+ * reach. Returns the count of values they are based on; 0 if there are none (values are unchanged).
+*/
+uint32_t qnt_window_get(const qnt_window* win, uint32_t time_s, int32_t* values, uint32_t* span_s)
+{
+    const qnt_set* set = oldest_set(win);
+    if (set == NULL)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < win->quantile_count; ++i)
+    {
+        if (!qnt_p2_get(&set->est[i], &values[i]))
+        {
+            return 0;
+        }
+    }
+
+    if (span_s != NULL)
+    {
+        *span_s = time_s - set->start_s;
+    }
+
+    return set->est[0].count;
+}
+
+/**
+ * Where marker i should be after count values, in thousandths of a position.
+*/
+static int64_t desired_position_x1000(const qnt_p2* est, int marker)
+{
+    int64_t last = (int64_t)est->count - 1;
+    int64_t p = est->permille;
+
+    switch (marker)
+    {
+    case 1:
+        return 1000 + last * p / 2;
+    case 2:
+        return 1000 + last * p;
+    case 3:
+        return 1000 + last * (1000 + p) / 2;
+    default:
+        return marker == 0 ? 1000 : (last + 1) * 1000;
+    }
+}
+
+/**
+ * Piecewise parabolic prediction of marker i moved by d (+1 or -1). Kept in 64 bit over one common denominator so no
+ * precision is lost to intermediate divisions.
+*/
+static int32_t parabolic(const qnt_p2* est, int i, int32_t d)
+{
+    const int32_t* q = est->heights;
+    const int32_t* n = est->positions;
+
+    int64_t left = n[i] - n[i - 1];
+    int64_t right = n[i + 1] - n[i];
+    int64_t span = n[i + 1] - n[i - 1];
+
+    int64_t num = (left + d) * (int64_t)(q[i + 1] - q[i]) * left + (right - d) * (int64_t)(q[i] - q[i - 1]) * right;
+    int64_t den = span * right * left;
+
+    return q[i] + (int32_t)(d * num / den);
+}
+
+static int32_t linear(const qnt_p2* est, int i, int32_t d)
+{
+    const int32_t* q = est->heights;
+    const int32_t* n = est->positions;
+
+    return q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i]);
+}
+
+static void set_restart(qnt_set* set, size_t quantile_count, uint32_t time_s)
+{
+    set->active = true;
+    set->start_s = time_s;
+
+    for (size_t i = 0; i < quantile_count; ++i)
+    {
+        qnt_p2_init(&set->est[i], set->est[i].permille);
+    }
+}
+
+/**
+ * The active set that has been running longest, or NULL if no values were added.
+*/
+static const qnt_set* oldest_set(const qnt_window* win)
+{
+    const qnt_set* first = &win->sets[0];
+    const qnt_set* second = &win->sets[1];
+
+    if (!first->active)
+    {
+        return NULL;
+    }
+
+    if (!second->active)
+    {
+        return first;
+    }
+
+    // Unsigned differences so the comparison holds across time wrap.
+    return (uint32_t)(first->start_s - second->start_s) > UINT32_MAX / 2 ? first : second;
+}
@@ -0,0 +1,66 @@
+/**
+ * Streaming quantile estimates in constant memory, using the P-square algorithm (Jain and Chlamtac): five markers per
+ * quantile track the minimum, the quantile, the maximum and two points between, and are moved toward their ideal
+ * positions with a parabolic fit as values arrive. No values are stored. Integer math only.
+ *
+ * qnt_window estimates over a time window without storing it: two estimator sets are restarted in turn, half a window
+ * apart, and the older one is read, so an estimate always covers between half and all of the window.
+*/
+#ifndef _WA_QUANTILE_H_INCLUDE_GUARD
+#define _WA_QUANTILE_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define QNT_OK 0
+#define QNT_FAIL 1
+
+// Most quantiles a window tracks.
+#define QNT_MAX_QUANTILES 3
+
+typedef struct qnt_p2
+{
+    // Quantile in thousandths (500 is the median).
+    uint16_t permille;
+    uint32_t count;
+    // Marker heights and positions (1 based). Until there are five values, heights are the values so far, sorted.
+    int32_t heights[5];
+    int32_t positions[5];
+} qnt_p2;
+
+typedef struct qnt_set
+{
+    bool active;
+    uint32_t start_s;
+    qnt_p2 est[QNT_MAX_QUANTILES];
+} qnt_set;
+
+typedef struct qnt_window
+{
+    uint32_t length_s;
+    size_t quantile_count;
+    qnt_set sets[2];
+} qnt_window;
+
+int qnt_p2_init(qnt_p2* est, uint16_t permille);
+
+void qnt_p2_add(qnt_p2* est, int32_t value);
+
+bool qnt_p2_get(const qnt_p2* est, int32_t* value);
+
+int qnt_window_init(qnt_window* win, uint32_t length_s, const uint16_t* permilles, size_t count);
+
+void qnt_window_add(qnt_window* win, uint32_t time_s, int32_t value);
+
+uint32_t qnt_window_get(const qnt_window* win, uint32_t time_s, int32_t* values, uint32_t* span_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_QUANTILE_H_INCLUDE_GUARD
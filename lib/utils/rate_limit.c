@@ -0,0 +1,101 @@
+#include "rate_limit.h"
+
+static void refill(rlm_bucket* bucket, const rlm_rate* rate, uint32_t now_ms);
+
+/**
+ * Start a bucket full.
+*/
+void rlm_bucket_init(rlm_bucket* bucket, const rlm_rate* rate, uint32_t now_ms)
+{
+    bucket->milli_tokens = rate->burst * 1000;
+    bucket->last_ms = now_ms;
+}
+
+/**
+ * Take cost tokens if the bucket has them. Otherwise nothing is taken, and retry_ms (if not NULL) is set to how long
+ * until it will. A cost above the burst can never be taken.
+*/
+bool rlm_bucket_take(rlm_bucket* bucket, const rlm_rate* rate, uint32_t cost, uint32_t now_ms, uint32_t* retry_ms)
+{
+    refill(bucket, rate, now_ms);
+
+    uint64_t need = (uint64_t)cost * 1000;
+    if (need <= bucket->milli_tokens)
+    {
+        bucket->milli_tokens -= (uint32_t)need;
+        return true;
+    }
+
+    if (retry_ms != NULL)
+    {
+        uint64_t missing = need - bucket->milli_tokens;
+        uint64_t wait = rate->per_s > 0 && cost <= rate->burst ?
+            (missing + rate->per_s - 1) / rate->per_s : UINT32_MAX;
+        *retry_ms = wait < UINT32_MAX ? (uint32_t)wait : UINT32_MAX;
+    }
+
+    return false;
+}
+
+/**
+ * Initialize a table over a caller provided bucket array, which must have a larger lifetime than the table.
+*/
+int rlm_table_init(rlm_table* table, rlm_bucket* buckets, size_t capacity, const rlm_rate* rate)
+{
+    if (!table || !buckets || capacity == 0 || !rate)
+    {
+        return RLM_FAIL;
+    }
+
+    table->buckets = buckets;
+    table->capacity = capacity;
+    table->count = 0;
+    table->rate = *rate;
+
+    return RLM_OK;
+}
+
+/**
+ * Take cost tokens from the key's bucket, as rlm_bucket_take. A key without a bucket gets a full one.
+*/
+bool rlm_table_take(rlm_table* table, uint32_t key, uint32_t cost, uint32_t now_ms, uint32_t* retry_ms)
+{
+    rlm_bucket* bucket = NULL;
+    rlm_bucket* oldest = NULL;
+
+    for (size_t i = 0; i < table->count && bucket == NULL; ++i)
+    {
+        rlm_bucket* b = &table->buckets[i];
+        if (b->key == key)
+        {
+            bucket = b;
+        }
+        // Age, not last_ms, so the comparison survives the clock wrapping.
+        else if (oldest == NULL || now_ms - b->last_ms > now_ms - oldest->last_ms)
+        {
+            oldest = b;
+        }
+    }
+
+    if (bucket == NULL)
+    {
+        bucket = table->count < table->capacity ? &table->buckets[table->count++] : oldest;
+        bucket->key = key;
+        rlm_bucket_init(bucket, &table->rate, now_ms);
+    }
+
+    return rlm_bucket_take(bucket, &table->rate, cost, now_ms, retry_ms);
+}
+
+/**
+ * Add the tokens earned since the last refill, up to the burst.
+*/
+static void refill(rlm_bucket* bucket, const rlm_rate* rate, uint32_t now_ms)
+{
+    uint32_t elapsed_ms = now_ms - bucket->last_ms;
+    bucket->last_ms = now_ms;
+
+    uint64_t full = (uint64_t)rate->burst * 1000;
+    uint64_t tokens = bucket->milli_tokens + (uint64_t)elapsed_ms * rate->per_s;
+    bucket->milli_tokens = (uint32_t)(tokens < full ? tokens : full);
+}
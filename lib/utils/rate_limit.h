@@ -0,0 +1,59 @@
+/**
+ * Token bucket rate limiting, in integer math.
+ *
+ * A bucket holds up to burst tokens and refills at per_s tokens a second; a request takes cost tokens or is refused.
+ * Tokens are kept in thousandths so slow rates still refill smoothly at millisecond resolution. Times are
+ * milliseconds from any wrapping 32 bit clock.
+ *
+ * rlm_table keeps one bucket per key (for example a client address) in a fixed array. When it is full, a new key
+ * takes over the bucket that was used longest ago; that bucket has had the most time to refill, so its owner loses
+ * the least.
+*/
+#ifndef _WA_RATE_LIMIT_H_INCLUDE_GUARD
+#define _WA_RATE_LIMIT_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define RLM_OK 0
+#define RLM_FAIL 1
+
+typedef struct rlm_rate
+{
+    uint32_t per_s;
+    uint32_t burst;
+} rlm_rate;
+
+typedef struct rlm_bucket
+{
+    uint32_t key;
+    uint32_t milli_tokens;
+    uint32_t last_ms;
+} rlm_bucket;
+
+typedef struct rlm_table
+{
+    rlm_bucket* buckets;
+    size_t capacity;
+    size_t count;
+    rlm_rate rate;
+} rlm_table;
+
+void rlm_bucket_init(rlm_bucket* bucket, const rlm_rate* rate, uint32_t now_ms);
+
+bool rlm_bucket_take(rlm_bucket* bucket, const rlm_rate* rate, uint32_t cost, uint32_t now_ms, uint32_t* retry_ms);
+
+int rlm_table_init(rlm_table* table, rlm_bucket* buckets, size_t capacity, const rlm_rate* rate);
+
+bool rlm_table_take(rlm_table* table, uint32_t key, uint32_t cost, uint32_t now_ms, uint32_t* retry_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_RATE_LIMIT_H_INCLUDE_GUARD
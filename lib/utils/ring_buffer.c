@@ -0,0 +1,362 @@
+#include <string.h>
+
+#include "ring_buffer.h"
+
+static bool is_power_of_two(size_t value);
+static void copy_out(const uint8_t* data, size_t mask, size_t elem_size, size_t pos, uint8_t* out, size_t count);
+static void copy_in(uint8_t* data, size_t mask, size_t elem_size, size_t pos, const uint8_t* in, size_t count);
+static void reverse_elems(uint8_t* elems, size_t elem_size, size_t count);
+
+/**
+ * Initialize a ring buffer over storage for capacity elements. The storage must have a larger lifetime than the ring.
+ * The limit starts at the capacity.
+ *
+ * RBUF_FAIL will be returned if the capacity is not a power of two.
+*/
+int rbuf_init(rbuf* rb, void* storage, size_t elem_size, size_t capacity)
+{
+    if (!rb || !storage || elem_size == 0 || !is_power_of_two(capacity))
+    {
+        return RBUF_FAIL;
+    }
+
+    rb->data = (uint8_t*)storage;
+    rb->elem_size = elem_size;
+    rb->mask = capacity - 1;
+    rb->limit = capacity;
+    rbuf_clear(rb);
+
+    return RBUF_OK;
+}
+
+void rbuf_clear(rbuf* rb)
+{
+    rb->head = 0;
+    rb->count = 0;
+}
+
+size_t rbuf_count(const rbuf* rb)
+{
+    return rb->count;
+}
+
+size_t rbuf_capacity(const rbuf* rb)
+{
+    return rb->mask + 1;
+}
+
+size_t rbuf_limit(const rbuf* rb)
+{
+    return rb->limit;
+}
+
+/**
+ * Keep at most limit elements. If more are stored, the oldest are dropped.
+ *
+ * RBUF_FAIL will be returned if the limit is zero or larger than the capacity.
+*/
+int rbuf_set_limit(rbuf* rb, size_t limit)
+{
+    if (limit == 0 || limit > rbuf_capacity(rb))
+    {
+        return RBUF_FAIL;
+    }
+
+    rb->limit = limit;
+    if (rb->count > limit)
+    {
+        rb->count = limit;
+    }
+
+    return RBUF_OK;
+}
+
+/**
+ * Add an element as the newest. When the ring holds its limit, the oldest element is dropped.
+*/
+void rbuf_push(rbuf* rb, const void* elem)
+{
+    memcpy(rb->data + (rb->head & rb->mask) * rb->elem_size, elem, rb->elem_size);
+    ++rb->head;
+
+    if (rb->count < rb->limit)
+    {
+        ++rb->count;
+    }
+}
+
+/**
+ * Get an element by index, where 0 is the oldest. Returns NULL if the index is past the newest.
+*/
+void* rbuf_at(const rbuf* rb, size_t idx)
+{
+    if (idx >= rb->count)
+    {
+        return NULL;
+    }
+
+    size_t pos = rb->head - rb->count + idx;
+    return rb->data + (pos & rb->mask) * rb->elem_size;
+}
+
+/**
+ * Copy up to max elements, oldest first, starting at index start (0 is the oldest). Returns the count copied.
+*/
+size_t rbuf_copy_oldest_first(const rbuf* rb, size_t start, void* out, size_t max)
+{
+    if (start >= rb->count)
+    {
+        return 0;
+    }
+
+    size_t count = rb->count - start < max ? rb->count - start : max;
+    copy_out(rb->data, rb->mask, rb->elem_size, rb->head - rb->count + start, (uint8_t*)out, count);
+
+    return count;
+}
+
+/**
+ * Copy up to max of the newest elements, newest first. Returns the count copied.
+*/
+size_t rbuf_copy_newest_first(const rbuf* rb, void* out, size_t max)
+{
+    size_t count = rb->count < max ? rb->count : max;
+
+    // Copy the segments in storage order, then flip them. Cheaper than copying one element at a time backward.
+    copy_out(rb->data, rb->mask, rb->elem_size, rb->head - count, (uint8_t*)out, count);
+    reverse_elems((uint8_t*)out, rb->elem_size, count);
+
+    return count;
+}
+
+/**
+ * Initialize a single producer, single consumer queue over storage for capacity elements.
+ *
+ * RBUF_FAIL will be returned if the capacity is not a power of two.
+*/
+int rbuf_spsc_init(rbuf_spsc* q, void* storage, size_t elem_size, size_t capacity)
+{
+    if (!q || !storage || elem_size == 0 || !is_power_of_two(capacity))
+    {
+        return RBUF_FAIL;
+    }
+
+    q->data = (uint8_t*)storage;
+    q->elem_size = elem_size;
+    q->mask = capacity - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+
+    return RBUF_OK;
+}
+
+/**
+ * Get the number of queued elements. Exact only when called from the producer or consumer.
+*/
+size_t rbuf_spsc_count(const rbuf_spsc* q)
+{
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    return head - tail;
+}
+
+/**
+ * Queue an element. Producer only. Returns false if the queue is full.
+*/
+bool rbuf_spsc_push(rbuf_spsc* q, const void* elem)
+{
+    return rbuf_spsc_push_n(q, elem, 1) == 1;
+}
+
+/**
+ * Queue as many of the elements as fit. Producer only. Returns the count queued.
+*/
+size_t rbuf_spsc_push_n(rbuf_spsc* q, const void* elems, size_t count)
+{
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    size_t space = q->mask + 1 - (head - tail);
+
+    if (count > space)
+    {
+        count = space;
+    }
+
+    copy_in(q->data, q->mask, q->elem_size, head, (const uint8_t*)elems, count);
+
+    // Release so the consumer sees the elements before the new head.
+    atomic_store_explicit(&q->head, head + count, memory_order_release);
+
+    return count;
+}
+
+/**
+ * Take the oldest element. Consumer only. Returns false if the queue is empty.
+*/
+bool rbuf_spsc_pop(rbuf_spsc* q, void* elem)
+{
+    return rbuf_spsc_pop_n(q, elem, 1) == 1;
+}
+
+/**
+ * Take up to max elements, oldest first. Consumer only. Returns the count taken.
+*/
+size_t rbuf_spsc_pop_n(rbuf_spsc* q, void* elems, size_t max)
+{
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t count = head - tail < max ? head - tail : max;
+
+    copy_out(q->data, q->mask, q->elem_size, tail, (uint8_t*)elems, count);
+
+    // Release so the producer doesn't reuse the slots before they are copied out.
+    atomic_store_explicit(&q->tail, tail + count, memory_order_release);
+
+    return count;
+}
+
+/**
+ * Initialize a multi-producer queue over storage for capacity elements, with one sequence number per element in seqs.
+ * RBUF_FAIL will be returned if the capacity is not a power of two.
+*/
+int rbuf_mpsc_init(rbuf_mpsc* q, void* storage, atomic_size_t* seqs, size_t elem_size, size_t capacity)
+{
+    if (!q || !storage || !seqs || elem_size == 0 || !is_power_of_two(capacity))
+    {
+        return RBUF_FAIL;
+    }
+
+    q->data = (uint8_t*)storage;
+    q->seqs = seqs;
+    q->elem_size = elem_size;
+    q->mask = capacity - 1;
+    atomic_init(&q->head, 0);
+    q->tail = 0;
+
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        atomic_init(&q->seqs[i], i);
+    }
+
+    return RBUF_OK;
+}
+
+/**
+ * Queue an element. Any producer. Returns false if the queue is full.
+*/
+bool rbuf_mpsc_push(rbuf_mpsc* q, const void* elem)
+{
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_size_t* seq;
+
+    for (;;)
+    {
+        seq = &q->seqs[pos & q->mask];
+        size_t slot_seq = atomic_load_explicit(seq, memory_order_acquire);
+
+        if (slot_seq == pos)
+        {
+            // Free for this position. A failed claim reloads pos with the new head.
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1, memory_order_relaxed,
+                memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if ((ptrdiff_t)(slot_seq - pos) < 0)
+        {
+            // Still holding the element from a lap ago.
+            return false;
+        }
+        else
+        {
+            // Another producer took this position.
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+
+    memcpy(q->data + (pos & q->mask) * q->elem_size, elem, q->elem_size);
+
+    // Release so the consumer sees the element before the sequence number says it is there.
+    atomic_store_explicit(seq, pos + 1, memory_order_release);
+
+    return true;
+}
+
+/**
+ * Take the oldest element. Consumer only. Returns false if the queue is empty, or the oldest element's producer has
+ * not finished writing it.
+*/
+bool rbuf_mpsc_pop(rbuf_mpsc* q, void* elem)
+{
+    size_t pos = q->tail;
+    atomic_size_t* seq = &q->seqs[pos & q->mask];
+
+    if (atomic_load_explicit(seq, memory_order_acquire) != pos + 1)
+    {
+        return false;
+    }
+
+    memcpy(elem, q->data + (pos & q->mask) * q->elem_size, q->elem_size);
+
+    // Free the slot for the position one lap ahead.
+    atomic_store_explicit(seq, pos + q->mask + 1, memory_order_release);
+    q->tail = pos + 1;
+
+    return true;
+}
+
+static bool is_power_of_two(size_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/**
+ * Copy count elements starting at a free running position. At most two memcpy calls: up to the end of the storage,
+ * then from the front.
+*/
+static void copy_out(const uint8_t* data, size_t mask, size_t elem_size, size_t pos, uint8_t* out, size_t count)
+{
+    size_t idx = pos & mask;
+    size_t first = mask + 1 - idx;
+    if (first > count)
+    {
+        first = count;
+    }
+
+    memcpy(out, data + idx * elem_size, first * elem_size);
+    memcpy(out + first * elem_size, data, (count - first) * elem_size);
+}
+
+static void copy_in(uint8_t* data, size_t mask, size_t elem_size, size_t pos, const uint8_t* in, size_t count)
+{
+    size_t idx = pos & mask;
+    size_t first = mask + 1 - idx;
+    if (first > count)
+    {
+        first = count;
+    }
+
+    memcpy(data + idx * elem_size, in, first * elem_size);
+    memcpy(data, in + first * elem_size, (count - first) * elem_size);
+}
+
+static void reverse_elems(uint8_t* elems, size_t elem_size, size_t count)
+{
+    if (count < 2)
+    {
+        return;
+    }
+
+    for (size_t i = 0, j = count - 1; i < j; ++i, --j)
+    {
+        uint8_t* a = elems + i * elem_size;
+        uint8_t* b = elems + j * elem_size;
+        for (size_t k = 0; k < elem_size; ++k)
+        {
+            uint8_t tmp = a[k];
+            a[k] = b[k];
+            b[k] = tmp;
+        }
+    }
+}
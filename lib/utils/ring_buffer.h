@@ -0,0 +1,106 @@
+/**
+ * Ring buffers of fixed-size elements over caller provided storage. The capacity must be a power of two so positions
+ * wrap with a mask instead of a divide.
+ *
+ * rbuf is for a single owner (or callers that hold a lock). Positions are free running counters and the element count
+ * is explicit, so there are no sentinel values. A limit below the capacity keeps only that many of the newest
+ * elements. Pushing to a full ring overwrites the oldest element. Bulk reads copy at most two contiguous segments.
+ *
+ * rbuf_spsc is a lock-free queue for one producer task and one consumer task. Pushing to a full queue fails instead of
+ * overwriting.
+ *
+ * rbuf_mpsc is a lock-free queue for any number of producers (tasks, or an ISR) and one consumer. Producers claim a
+ * slot with a compare-and-swap and publish it with a per-slot sequence number, so a producer preempted mid-copy only
+ * holds back the consumer, never the other producers. Pushing to a full queue fails.
+*/
+#ifndef _WA_RING_BUFFER_H_INCLUDE_GUARD
+#define _WA_RING_BUFFER_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#define RBUF_OK 0
+#define RBUF_FAIL 1
+
+typedef struct rbuf
+{
+    uint8_t* data;
+    size_t elem_size;
+    size_t mask;
+    size_t limit;
+    // Free running position of the next write. The oldest element is count before it.
+    size_t head;
+    size_t count;
+} rbuf;
+
+typedef struct rbuf_spsc
+{
+    uint8_t* data;
+    size_t elem_size;
+    size_t mask;
+    // Free running positions. Only the producer writes head and only the consumer writes tail.
+    atomic_size_t head;
+    atomic_size_t tail;
+} rbuf_spsc;
+
+typedef struct rbuf_mpsc
+{
+    uint8_t* data;
+    // One per slot: equal to a position when the slot is free for it, one past it once that position is written.
+    atomic_size_t* seqs;
+    size_t elem_size;
+    size_t mask;
+    // Free running positions. Producers claim head; only the consumer writes tail.
+    atomic_size_t head;
+    size_t tail;
+} rbuf_mpsc;
+
+int rbuf_init(rbuf* rb, void* storage, size_t elem_size, size_t capacity);
+
+void rbuf_clear(rbuf* rb);
+
+size_t rbuf_count(const rbuf* rb);
+
+size_t rbuf_capacity(const rbuf* rb);
+
+size_t rbuf_limit(const rbuf* rb);
+
+int rbuf_set_limit(rbuf* rb, size_t limit);
+
+void rbuf_push(rbuf* rb, const void* elem);
+
+void* rbuf_at(const rbuf* rb, size_t idx);
+
+size_t rbuf_copy_oldest_first(const rbuf* rb, size_t start, void* out, size_t max);
+
+size_t rbuf_copy_newest_first(const rbuf* rb, void* out, size_t max);
+
+int rbuf_spsc_init(rbuf_spsc* q, void* storage, size_t elem_size, size_t capacity);
+
+size_t rbuf_spsc_count(const rbuf_spsc* q);
+
+bool rbuf_spsc_push(rbuf_spsc* q, const void* elem);
+
+size_t rbuf_spsc_push_n(rbuf_spsc* q, const void* elems, size_t count);
+
+bool rbuf_spsc_pop(rbuf_spsc* q, void* elem);
+
+size_t rbuf_spsc_pop_n(rbuf_spsc* q, void* elems, size_t max);
+
+int rbuf_mpsc_init(rbuf_mpsc* q, void* storage, atomic_size_t* seqs, size_t elem_size, size_t capacity);
+
+bool rbuf_mpsc_push(rbuf_mpsc* q, const void* elem);
+
+bool rbuf_mpsc_pop(rbuf_mpsc* q, void* elem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_RING_BUFFER_H_INCLUDE_GUARD
@@ -0,0 +1,258 @@
+#include <string.h>
+
+#include "seg_builder.h"
+
+static int add_segment(sgb_t* sgb, const char* ptr, size_t len);
+
+/**
+ * Initialize a builder over caller provided segment and scratch arrays, which must have a larger lifetime than the
+ * builder.
+ */
+int sgb_init(sgb_t* sgb, sgb_segment* segs, size_t seg_capacity, char* scratch, size_t scratch_capacity)
+{
+    if (!sgb || !segs || seg_capacity == 0 || (!scratch && scratch_capacity > 0))
+    {
+        return SGB_FAIL;
+    }
+
+    sgb->segs = segs;
+    sgb->seg_capacity = seg_capacity;
+    sgb->scratch = scratch;
+    sgb->scratch_capacity = scratch_capacity;
+    sgb_clear(sgb);
+
+    return SGB_OK;
+}
+
+/**
+ * Remove all output, keeping the arrays.
+ */
+void sgb_clear(sgb_t* sgb)
+{
+    sgb->seg_count = 0;
+    sgb->scratch_used = 0;
+    sgb->total_len = 0;
+    sgb->status = SGB_OK;
+}
+
+/**
+ * Add a reference to constant data. Nothing is copied, so the data must outlive the flush (string literals do).
+ *
+ * SGB_TRUNCATED will be returned if there are no segments left.
+ */
+int sgb_add_static(sgb_t* sgb, const char* ptr, size_t len)
+{
+    if (!sgb || (!ptr && len > 0))
+    {
+        return SGB_FAIL;
+    }
+
+    return add_segment(sgb, ptr, len);
+}
+
+/**
+ * Add a copy of data that will not outlive the flush. The copy goes into the scratch area.
+ *
+ * SGB_TRUNCATED will be returned if it does not fit; nothing is added in that case.
+ */
+int sgb_add_copy(sgb_t* sgb, const char* ptr, size_t len)
+{
+    if (!sgb || (!ptr && len > 0))
+    {
+        return SGB_FAIL;
+    }
+
+    char* p = sgb_reserve(sgb, len);
+    if (p == NULL)
+    {
+        return SGB_TRUNCATED;
+    }
+
+    memcpy(p, ptr, len);
+    return sgb_commit(sgb, len);
+}
+
+/**
+ * Add a copy of a null terminated string.
+ */
+int sgb_add_str(sgb_t* sgb, const char* value)
+{
+    if (!value)
+    {
+        return SGB_FAIL;
+    }
+
+    return sgb_add_copy(sgb, value, strlen(value));
+}
+
+/**
+ * Get a pointer to write up to len bytes of scratch, for values formatted in place. Finish with sgb_commit.
+ *
+ * NULL will be returned if there is not enough scratch left; the builder is marked truncated in that case.
+ */
+char* sgb_reserve(sgb_t* sgb, size_t len)
+{
+    if (!sgb)
+    {
+        return NULL;
+    }
+
+    if (len > sgb->scratch_capacity - sgb->scratch_used)
+    {
+        sgb->status = SGB_TRUNCATED;
+        return NULL;
+    }
+
+    return sgb->scratch + sgb->scratch_used;
+}
+
+/**
+ * Add len bytes written after sgb_reserve to the output. Consecutive scratch writes share one segment.
+ *
+ * SGB_FAIL will be returned if len is more than the scratch left.
+ */
+int sgb_commit(sgb_t* sgb, size_t len)
+{
+    if (!sgb || len > sgb->scratch_capacity - sgb->scratch_used)
+    {
+        return SGB_FAIL;
+    }
+
+    int rc = add_segment(sgb, sgb->scratch + sgb->scratch_used, len);
+    if (rc == SGB_OK)
+    {
+        sgb->scratch_used += len;
+    }
+
+    return rc;
+}
+
+size_t sgb_total_len(const sgb_t* sgb)
+{
+    return sgb->total_len;
+}
+
+/**
+ * Get SGB_OK, or SGB_TRUNCATED if anything added since the last clear did not fit.
+ */
+int sgb_status(const sgb_t* sgb)
+{
+    return sgb->status;
+}
+
+/**
+ * Write the output through the sink. Segments shorter than the stage are gathered in it and written together; longer
+ * segments are written directly from where they are. The stage can be NULL to write every segment directly.
+ *
+ * SGB_FAIL will be returned if the sink failed.
+ */
+int sgb_flush(const sgb_t* sgb, char* stage, size_t stage_size, sgb_sink_fn sink, void* ctx)
+{
+    if (!sgb || !sink)
+    {
+        return SGB_FAIL;
+    }
+
+    if (!stage)
+    {
+        stage_size = 0;
+    }
+
+    size_t staged = 0;
+
+    for (size_t i = 0; i < sgb->seg_count; ++i)
+    {
+        const sgb_segment* seg = &sgb->segs[i];
+
+        if (staged + seg->len > stage_size && staged > 0)
+        {
+            if (sink(ctx, stage, staged) != SGB_OK)
+            {
+                return SGB_FAIL;
+            }
+            staged = 0;
+        }
+
+        if (seg->len >= stage_size)
+        {
+            if (sink(ctx, seg->ptr, seg->len) != SGB_OK)
+            {
+                return SGB_FAIL;
+            }
+        }
+        else
+        {
+            memcpy(stage + staged, seg->ptr, seg->len);
+            staged += seg->len;
+        }
+    }
+
+    if (staged > 0 && sink(ctx, stage, staged) != SGB_OK)
+    {
+        return SGB_FAIL;
+    }
+
+    return SGB_OK;
+}
+
+/**
+ * Copy the output into a flat, null terminated buffer. Returns the length copied.
+ */
+size_t sgb_copy_to(const sgb_t* sgb, char* buffer, size_t size)
+{
+    if (!sgb || !buffer || size == 0)
+    {
+        return 0;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < sgb->seg_count && len < size - 1; ++i)
+    {
+        size_t n = sgb->segs[i].len;
+        if (n > size - 1 - len)
+        {
+            n = size - 1 - len;
+        }
+
+        memcpy(buffer + len, sgb->segs[i].ptr, n);
+        len += n;
+    }
+
+    buffer[len] = 0;
+    return len;
+}
+
+/**
+ * Add a segment, extending the last one instead if the data directly follows it.
+ */
+static int add_segment(sgb_t* sgb, const char* ptr, size_t len)
+{
+    if (len == 0)
+    {
+        return SGB_OK;
+    }
+
+    if (sgb->seg_count > 0)
+    {
+        sgb_segment* last = &sgb->segs[sgb->seg_count - 1];
+        if (last->ptr + last->len == ptr)
+        {
+            last->len += len;
+            sgb->total_len += len;
+            return SGB_OK;
+        }
+    }
+
+    if (sgb->seg_count == sgb->seg_capacity)
+    {
+        sgb->status = SGB_TRUNCATED;
+        return SGB_TRUNCATED;
+    }
+
+    sgb->segs[sgb->seg_count].ptr = ptr;
+    sgb->segs[sgb->seg_count].len = len;
+    ++sgb->seg_count;
+    sgb->total_len += len;
+
+    return SGB_OK;
+}
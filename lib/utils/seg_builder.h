@@ -0,0 +1,77 @@
+/**
+ * Scatter-gather output builder. Output is a list of {ptr, len} segments: constant text is referenced where it already
+ * is (rodata/flash) and only dynamic values are copied, into a small scratch area. The list is then written out through
+ * a sink, with small segments gathered into a staging buffer so the sink sees few, reasonably sized writes.
+ *
+ * Referenced data must stay valid until the builder is flushed.
+*/
+#ifndef _WA_SEG_BUILDER_H_INCLUDE_GUARD
+#define _WA_SEG_BUILDER_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define SGB_OK 0
+#define SGB_FAIL 1
+#define SGB_TRUNCATED 2
+
+/** Expands a string literal to the pointer and length arguments of sgb_add_static. */
+#define SGB_LIT(literal) (literal), (sizeof(literal) - 1)
+
+typedef struct sgb_segment
+{
+    const char* ptr;
+    size_t len;
+} sgb_segment;
+
+/**
+ * Writes len bytes of output. Returns SGB_OK, or SGB_FAIL to stop the flush.
+*/
+typedef int (*sgb_sink_fn)(void* ctx, const char* data, size_t len);
+
+typedef struct sgb_t
+{
+    sgb_segment* segs;
+    size_t seg_capacity;
+    size_t seg_count;
+
+    char* scratch;
+    size_t scratch_capacity;
+    size_t scratch_used;
+
+    size_t total_len;
+    // SGB_TRUNCATED once anything did not fit.
+    int status;
+} sgb_t;
+
+int sgb_init(sgb_t* sgb, sgb_segment* segs, size_t seg_capacity, char* scratch, size_t scratch_capacity);
+
+void sgb_clear(sgb_t* sgb);
+
+int sgb_add_static(sgb_t* sgb, const char* ptr, size_t len);
+
+int sgb_add_copy(sgb_t* sgb, const char* ptr, size_t len);
+
+int sgb_add_str(sgb_t* sgb, const char* value);
+
+char* sgb_reserve(sgb_t* sgb, size_t len);
+
+int sgb_commit(sgb_t* sgb, size_t len);
+
+size_t sgb_total_len(const sgb_t* sgb);
+
+int sgb_status(const sgb_t* sgb);
+
+int sgb_flush(const sgb_t* sgb, char* stage, size_t stage_size, sgb_sink_fn sink, void* ctx);
+
+size_t sgb_copy_to(const sgb_t* sgb, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_SEG_BUILDER_H_INCLUDE_GUARD
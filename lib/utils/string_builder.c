@@ -1,6 +1,17 @@
+#include <string.h>
+
 #include "string_builder.h"
 
+// Word loads may alias the char data and may read past the terminator (within the aligned word), so they are exempt
+// from strict aliasing and address sanitizing, like the C library's own string functions.
+typedef size_t __attribute__((may_alias)) strbld_word_t;
+
+#define WORD_ONES ((strbld_word_t)-1 / 0xff)
+#define WORD_HIGHS (WORD_ONES * 0x80)
+
 static void make_null_terminated(strbld_t* sb);
+static size_t free_space(const strbld_t* sb);
+static size_t bounded_strlen(const char* value, size_t limit);
 
 /**
  * Initialize a string builder. The builder will use the given buffer, so the buffer must have a larger lifetime than
@@ -36,29 +47,41 @@ int strbld_append(strbld_t* sb, const char* value)
         return STRBLD_FAIL;
     }
 
-    int retcode = STRBLD_OK;
-    const char* pv = value;
-
-    // Start writing at the end of the string builder buffer.
-    char* pbuff = sb->buffer + sb->size;
+    // Find the length a word at a time, but never look further than one past what fits. Then copy in one go.
+    size_t space = free_space(sb);
+    size_t len = bounded_strlen(value, space + 1);
 
-    // Use one less to account for requiring a null terminator in the string builder.
-    char* buff_end = sb->buffer + sb->capacity - 1;
+    return strbld_append_n(sb, value, len);
+}
 
-    while (*pv != 0 && pbuff < buff_end)
+/**
+ * Append len bytes of value to the string builder. The value does not need to be null terminated. Use this when the
+ * length is known, e.g. with STRBLD_LIT for string literals.
+ *
+ * STRBLD_OK will be returned if the string was completely written.
+ * STRBLD_TRUNCATED will be returned if the string was truncated.
+ */
+int strbld_append_n(strbld_t* sb, const char* value, size_t len)
+{
+    if (!sb || (!value && len > 0))
     {
-        *(pbuff++) = *(pv++);
+        return STRBLD_FAIL;
     }
 
-    // If the last byte read was not a null terminated, then the input was truncated.
-    if (*pv != 0)
+    int retcode = STRBLD_OK;
+    size_t space = free_space(sb);
+
+    if (len > space)
     {
+        len = space;
         retcode = STRBLD_TRUNCATED;
     }
 
-    // Update the size on the string builder. More efficient to do in one go rather than incrementing size for each
-    // character written.
-    sb->size = pbuff - sb->buffer;
+    if (len > 0)
+    {
+        memcpy(sb->buffer + sb->size, value, len);
+        sb->size += len;
+    }
 
     // Always null terminate the buffer, but do not increase the size. If size is increased then a null value will be
     // in the middle of the string.
@@ -67,6 +90,40 @@ int strbld_append(strbld_t* sb, const char* value)
     return retcode;
 }
 
+/**
+ * Get a pointer to write up to len bytes at the end of the string, for callers that format in place (e.g. snprintf).
+ * There is always room for a null terminator after the len bytes. Finish with strbld_commit.
+ *
+ * NULL will be returned if there is not enough space; nothing is written in that case.
+ */
+char* strbld_reserve(strbld_t* sb, size_t len)
+{
+    if (!sb || len > free_space(sb))
+    {
+        return NULL;
+    }
+
+    return sb->buffer + sb->size;
+}
+
+/**
+ * Add len bytes written after strbld_reserve to the string.
+ *
+ * STRBLD_FAIL will be returned if len is more than the space left.
+ */
+int strbld_commit(strbld_t* sb, size_t len)
+{
+    if (!sb || len > free_space(sb))
+    {
+        return STRBLD_FAIL;
+    }
+
+    sb->size += len;
+    make_null_terminated(sb);
+
+    return STRBLD_OK;
+}
+
 /**
  * Append a single character to the string builder. More efficient than strbld_append for single characters.
 */
@@ -115,6 +172,35 @@ int strbld_append_line(strbld_t* sb, const char* value)
 */
 int strbld_append_html(strbld_t* sb, const char* value, const char* html_tag)
 {
+    if (!sb || !value || !html_tag)
+    {
+        return STRBLD_FAIL;
+    }
+
+    // Usually it all fits, so it is written with one bounds check. Otherwise fall back to appending the pieces, which
+    // writes as much as fits.
+    size_t tag_len = strlen(html_tag);
+    size_t value_len = strlen(value);
+    size_t total = value_len + 2 * tag_len + 5;
+
+    char* p = strbld_reserve(sb, total);
+    if (p != NULL)
+    {
+        *(p++) = '<';
+        memcpy(p, html_tag, tag_len);
+        p += tag_len;
+        *(p++) = '>';
+        memcpy(p, value, value_len);
+        p += value_len;
+        *(p++) = '<';
+        *(p++) = '/';
+        memcpy(p, html_tag, tag_len);
+        p += tag_len;
+        *p = '>';
+
+        return strbld_commit(sb, total);
+    }
+
     int rc = STRBLD_OK;
 
     rc = strbld_append_char(sb, '<');
@@ -192,6 +278,53 @@ const char* strbld_get(strbld_t* sb, size_t* strlen)
     return sb->buffer;
 }
 
+/**
+ * Get the number of bytes that can still be appended, leaving room for the null terminator.
+*/
+static size_t free_space(const strbld_t* sb)
+{
+    return sb->capacity - 1 - sb->size;
+}
+
+/**
+ * Get the length of a null terminated string, but stop counting at limit. Reads a word at a time once the pointer is
+ * aligned. An aligned word never crosses into another page, so reading past the terminator within it is safe.
+*/
+__attribute__((no_sanitize_address))
+static size_t bounded_strlen(const char* value, size_t limit)
+{
+    const char* p = value;
+    const char* end = value + limit;
+
+    while (p < end && ((uintptr_t)p % sizeof(strbld_word_t)) != 0)
+    {
+        if (*p == 0)
+        {
+            return p - value;
+        }
+        ++p;
+    }
+
+    while (end - p >= (ptrdiff_t)sizeof(strbld_word_t))
+    {
+        strbld_word_t word = *(const strbld_word_t*)p;
+
+        // Nonzero if any byte in the word is zero.
+        if ((word - WORD_ONES) & ~word & WORD_HIGHS)
+        {
+            break;
+        }
+        p += sizeof(strbld_word_t);
+    }
+
+    while (p < end && *p != 0)
+    {
+        ++p;
+    }
+
+    return p - value;
+}
+
 /**
  * Makes the string builder null terminated. Does not update the size! This will allow subsequent appends to overwrite
  * null terminators (unless the buffer is full).
@@ -14,6 +14,9 @@ extern "C" {
 
 #define STRBLD_NPOS SIZE_MAX
 
+/** Expands a string literal to the pointer and length arguments of strbld_append_n. */
+#define STRBLD_LIT(literal) (literal), (sizeof(literal) - 1)
+
 /** Newline character(s) to use when building strings. */
 #ifndef STRBLD_NEWLINE
 #define STRBLD_NEWLINE "\n"
@@ -30,6 +33,12 @@ int strbld_init(strbld_t* sb, char* buffer, size_t size);
 
 int strbld_append(strbld_t* sb, const char* value);
 
+int strbld_append_n(strbld_t* sb, const char* value, size_t len);
+
+char* strbld_reserve(strbld_t* sb, size_t len);
+
+int strbld_commit(strbld_t* sb, size_t len);
+
 int strbld_append_char(strbld_t* sb, char value);
 
 int strbld_append_line(strbld_t* sb, const char* value);
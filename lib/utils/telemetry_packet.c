@@ -0,0 +1,52 @@
+#include "telemetry_packet.h"
+
+static void put_u32(uint8_t* out, uint32_t value);
+static uint32_t get_u32(const uint8_t* data);
+
+/**
+ * Encode a packet into TLP_SIZE bytes.
+*/
+void tlp_encode(const tlp_packet* packet, uint8_t* out)
+{
+    out[0] = (uint8_t)(TLP_MAGIC >> 8);
+    out[1] = (uint8_t)(TLP_MAGIC & 0xFF);
+    out[2] = TLP_VERSION;
+    out[3] = packet->error;
+    put_u32(out + 4, packet->seq);
+    put_u32(out + 8, packet->time_s);
+    put_u32(out + 12, packet->sensor_id);
+    put_u32(out + 16, (uint32_t)packet->value);
+}
+
+/**
+ * Decode a received datagram. Returns TLP_FAIL (packet unchanged) if it is not a telemetry datagram of this version.
+*/
+int tlp_decode(const uint8_t* data, size_t len, tlp_packet* packet)
+{
+    if (len != TLP_SIZE || data[0] != (uint8_t)(TLP_MAGIC >> 8) || data[1] != (uint8_t)(TLP_MAGIC & 0xFF) ||
+        data[2] != TLP_VERSION)
+    {
+        return TLP_FAIL;
+    }
+
+    packet->error = data[3];
+    packet->seq = get_u32(data + 4);
+    packet->time_s = get_u32(data + 8);
+    packet->sensor_id = get_u32(data + 12);
+    packet->value = (int32_t)get_u32(data + 16);
+
+    return TLP_OK;
+}
+
+static void put_u32(uint8_t* out, uint32_t value)
+{
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+static uint32_t get_u32(const uint8_t* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
@@ -0,0 +1,49 @@
+/**
+ * Telemetry datagram: one reading in a fixed 20 byte layout, for listeners that only receive. All fields are in
+ * network byte order (big endian):
+ *
+ *   0  2  magic, "WT"
+ *   2  1  version, TLP_VERSION
+ *   3  1  error, 0 for a good reading
+ *   4  4  sequence number of the reading; a gap means readings were missed
+ *   8  4  time the reading was taken, in seconds of the sender's uptime
+ *  12  4  sensor id, the same for every datagram from one device
+ *  16  4  temperature in hundredths of degrees fahrenheit (signed), INT32_MIN if the read failed
+ *
+ * Decoding checks the size, magic and version, so stray datagrams on the port are rejected.
+*/
+#ifndef _WA_TELEMETRY_PACKET_H_INCLUDE_GUARD
+#define _WA_TELEMETRY_PACKET_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define TLP_OK 0
+#define TLP_FAIL 1
+
+#define TLP_SIZE 20
+#define TLP_MAGIC 0x5754
+#define TLP_VERSION 1
+
+typedef struct tlp_packet
+{
+    uint32_t seq;
+    uint32_t time_s;
+    uint32_t sensor_id;
+    int32_t value;
+    uint8_t error;
+} tlp_packet;
+
+void tlp_encode(const tlp_packet* packet, uint8_t* out);
+
+int tlp_decode(const uint8_t* data, size_t len, tlp_packet* packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_TELEMETRY_PACKET_H_INCLUDE_GUARD
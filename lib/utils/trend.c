@@ -0,0 +1,176 @@
+#include <string.h>
+
+#include "trend.h"
+
+#define SECONDS_PER_HOUR 3600
+
+/**
+ * Remove all samples. base_s must not be after the first sample added.
+*/
+void trd_fit_clear(trd_fit* fit, uint32_t base_s)
+{
+    memset(fit, 0, sizeof(trd_fit));
+    fit->base_s = base_s;
+}
+
+void trd_fit_add(trd_fit* fit, uint32_t time_s, int32_t value)
+{
+    int64_t t = (int64_t)(time_s - fit->base_s);
+
+    fit->n += 1;
+    fit->st += t;
+    fit->sv += value;
+    fit->stt += t * t;
+    fit->stv += t * value;
+    fit->svv += (int64_t)value * value;
+}
+
+/**
+ * Remove a sample that was added before. The sums are exact, so removing never drifts.
+*/
+void trd_fit_remove(trd_fit* fit, uint32_t time_s, int32_t value)
+{
+    int64_t t = (int64_t)(time_s - fit->base_s);
+
+    fit->n -= 1;
+    fit->st -= t;
+    fit->sv -= value;
+    fit->stt -= t * t;
+    fit->stv -= t * value;
+    fit->svv -= (int64_t)value * value;
+}
+
+/**
+ * Move the time base forward to base_s, which must not be after the oldest sample. Constant time: the sums are
+ * shifted, not rebuilt.
+*/
+void trd_fit_rebase(trd_fit* fit, uint32_t base_s)
+{
+    int64_t d = (int64_t)(base_s - fit->base_s);
+
+    // With t' = t - d: sum(t'^2) = sum(t^2) - 2d sum(t) + n d^2, using the old sum(t).
+    fit->stt += -2 * d * fit->st + fit->n * d * d;
+    fit->stv -= d * fit->sv;
+    fit->st -= fit->n * d;
+    fit->base_s = base_s;
+}
+
+/**
+ * Get the slope of the least-squares line in units per hour, and how well the line fits (r squared, in thousandths).
+ * Returns false if there are fewer than two samples or they all have the same time.
+*/
+bool trd_fit_slope(const trd_fit* fit, int32_t* per_hour, uint16_t* r2_permille)
+{
+    if (fit->n < 2)
+    {
+        return false;
+    }
+
+    // Both are n^2 times a (co)variance, so they are small even when the sums are not.
+    int64_t num = fit->n * fit->stv - fit->st * fit->sv;
+    int64_t den_t = fit->n * fit->stt - fit->st * fit->st;
+    int64_t den_v = fit->n * fit->svv - fit->sv * fit->sv;
+
+    if (den_t <= 0)
+    {
+        return false;
+    }
+
+    *per_hour = (int32_t)(num * SECONDS_PER_HOUR / den_t);
+
+    if (r2_permille != NULL)
+    {
+        if (den_v <= 0)
+        {
+            // All values equal: a flat line fits exactly.
+            *r2_permille = 1000;
+        }
+        else
+        {
+            // r^2 = num^2 / (den_t * den_v). Scale all three down alike until the products fit in 64 bits.
+            uint64_t a = (uint64_t)(num < 0 ? -num : num);
+            uint64_t b = (uint64_t)den_t;
+            uint64_t c = (uint64_t)den_v;
+            while (a >= (1ull << 31) || b >= (1ull << 31) || c >= (1ull << 31))
+            {
+                a >>= 1;
+                b >>= 1;
+                c >>= 1;
+            }
+
+            uint64_t x = a * a;
+            uint64_t y = b * c;
+            if (y == 0)
+            {
+                *r2_permille = 0;
+            }
+            else
+            {
+                // x <= y, so x * 1000 only overflows when y is large, and then y / 1000 loses nothing that matters.
+                uint64_t r2 = y < (1ull << 53) ? x * 1000 / y : x / (y / 1000);
+                *r2_permille = (uint16_t)(r2 > 1000 ? 1000 : r2);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Initialize with smoothing factors in thousandths. Higher alpha follows the level faster, higher beta the trend.
+*/
+void trd_holt_init(trd_holt* holt, uint16_t alpha_permille, uint16_t beta_permille)
+{
+    memset(holt, 0, sizeof(trd_holt));
+    holt->alpha = alpha_permille > 1000 ? 1000 : alpha_permille;
+    holt->beta = beta_permille > 1000 ? 1000 : beta_permille;
+}
+
+/**
+ * Add a sample. Samples may be unevenly spaced: the trend is per hour and the level is projected over the gap before
+ * it is smoothed.
+*/
+void trd_holt_add(trd_holt* holt, uint32_t time_s, int32_t value)
+{
+    int64_t x = (int64_t)value * 256;
+
+    if (!holt->started)
+    {
+        holt->started = true;
+        holt->last_s = time_s;
+        holt->level_q8 = x;
+        holt->trend_q8 = 0;
+        return;
+    }
+
+    int64_t dt = (int64_t)(time_s - holt->last_s);
+    int64_t predicted = holt->level_q8 + holt->trend_q8 * dt / SECONDS_PER_HOUR;
+    int64_t level = (holt->alpha * x + (1000 - holt->alpha) * predicted) / 1000;
+
+    // Samples in the same second only move the level; there is no time to measure a trend over.
+    if (dt > 0)
+    {
+        int64_t observed_trend = (level - holt->level_q8) * SECONDS_PER_HOUR / dt;
+        holt->trend_q8 = (holt->beta * observed_trend + (1000 - holt->beta) * holt->trend_q8) / 1000;
+        holt->last_s = time_s;
+    }
+
+    holt->level_q8 = level;
+}
+
+/**
+ * Get the forecast ahead_s seconds after the last sample. Returns false before the first sample.
+*/
+bool trd_holt_forecast(const trd_holt* holt, uint32_t ahead_s, int32_t* value)
+{
+    if (!holt->started)
+    {
+        return false;
+    }
+
+    int64_t forecast = holt->level_q8 + holt->trend_q8 * (int64_t)ahead_s / SECONDS_PER_HOUR;
+
+    // Round to the nearest unit.
+    *value = (int32_t)((forecast + (forecast >= 0 ? 128 : -128)) / 256);
+    return true;
+}
@@ -0,0 +1,66 @@
+/**
+ * Constant time trend estimates, in integer math.
+ *
+ * trd_fit is a least-squares line over a set of samples, kept as running sums so samples can be added and removed
+ * one at a time (for example as they enter and leave a ring buffer). Times are stored relative to a base that the
+ * owner moves forward with trd_fit_rebase, which keeps the sums small and exact.
+ *
+ * trd_holt is Holt's double exponential smoothing (level and trend), for a short forecast. It weights recent samples
+ * more than the least-squares line does, so it reacts faster to a change of direction.
+*/
+#ifndef _WA_TREND_H_INCLUDE_GUARD
+#define _WA_TREND_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef struct trd_fit
+{
+    uint32_t base_s;
+    // Sums over the samples of 1, t, v, t*t, t*v and v*v, with t in seconds after base_s.
+    int64_t n;
+    int64_t st;
+    int64_t sv;
+    int64_t stt;
+    int64_t stv;
+    int64_t svv;
+} trd_fit;
+
+typedef struct trd_holt
+{
+    bool started;
+    uint32_t last_s;
+    // Level in units and trend in units per hour, both with 8 fraction bits.
+    int64_t level_q8;
+    int64_t trend_q8;
+    // Smoothing factors in thousandths.
+    uint16_t alpha;
+    uint16_t beta;
+} trd_holt;
+
+void trd_fit_clear(trd_fit* fit, uint32_t base_s);
+
+void trd_fit_add(trd_fit* fit, uint32_t time_s, int32_t value);
+
+void trd_fit_remove(trd_fit* fit, uint32_t time_s, int32_t value);
+
+void trd_fit_rebase(trd_fit* fit, uint32_t base_s);
+
+bool trd_fit_slope(const trd_fit* fit, int32_t* per_hour, uint16_t* r2_permille);
+
+void trd_holt_init(trd_holt* holt, uint16_t alpha_permille, uint16_t beta_permille);
+
+void trd_holt_add(trd_holt* holt, uint32_t time_s, int32_t value);
+
+bool trd_holt_forecast(const trd_holt* holt, uint32_t ahead_s, int32_t* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_TREND_H_INCLUDE_GUARD
@@ -0,0 +1,382 @@
+#include <string.h>
+
+#include "tseries.h"
+
+// A point is at most two varints of 34 bits each.
+#define MAX_POINT_SIZE 10
+
+static tsr_block* block_at(const tsr_series* series, size_t logical_idx);
+static size_t encode_point(const tsr_block* block, uint32_t time, int32_t value, uint8_t* out);
+static void start_block(tsr_series* series, uint32_t time, int32_t value);
+static void iter_block_first(tsr_iter* it, size_t block);
+static void iter_block_last(tsr_iter* it, size_t block);
+static size_t put_varint(uint64_t value, uint8_t* out);
+static uint64_t get_varint(const uint8_t* data, uint16_t* pos);
+static uint16_t varint_start(const uint8_t* data, uint16_t end);
+static uint64_t zigzag(int64_t value);
+static int64_t unzigzag(uint64_t value);
+
+/**
+ * Initialize a series over the given blocks. The blocks must have a larger lifetime than the series.
+*/
+int tsr_init(tsr_series* series, tsr_block* blocks, size_t block_count)
+{
+    if (!series || !blocks || block_count == 0)
+    {
+        return TSR_FAIL;
+    }
+
+    series->blocks = blocks;
+    series->block_count = block_count;
+    tsr_clear(series);
+
+    return TSR_OK;
+}
+
+/**
+ * Remove all points.
+*/
+void tsr_clear(tsr_series* series)
+{
+    series->head = 0;
+    series->used_blocks = 0;
+    series->point_count = 0;
+}
+
+/**
+ * Append a point. Times must not go backward. If there is no room, the oldest block of points is dropped.
+ *
+ * TSR_OK will be returned if the point was added.
+ * TSR_FAIL will be returned if the time is older than the last point.
+*/
+int tsr_append(tsr_series* series, uint32_t time, int32_t value)
+{
+    if (series->used_blocks == 0)
+    {
+        start_block(series, time, value);
+        return TSR_OK;
+    }
+
+    tsr_block* block = block_at(series, series->used_blocks - 1);
+    if (time < block->last.time)
+    {
+        return TSR_FAIL;
+    }
+
+    uint8_t encoded[MAX_POINT_SIZE];
+    size_t len = encode_point(block, time, value, encoded);
+
+    if (block->used + len > TSR_BLOCK_DATA_SIZE || block->count == UINT16_MAX)
+    {
+        start_block(series, time, value);
+        return TSR_OK;
+    }
+
+    memcpy(block->data + block->used, encoded, len);
+    block->used += len;
+    block->last_delta = time - block->last.time;
+    block->last.time = time;
+    block->last.value = value;
+    ++block->count;
+    ++series->point_count;
+
+    return TSR_OK;
+}
+
+size_t tsr_count(const tsr_series* series)
+{
+    return series->point_count;
+}
+
+/**
+ * Get the bytes of blocks in use, including block headers.
+*/
+size_t tsr_bytes_used(const tsr_series* series)
+{
+    return series->used_blocks * sizeof(tsr_block);
+}
+
+/**
+ * Point the iterator at the oldest point. Returns false if the series is empty.
+*/
+bool tsr_first(const tsr_series* series, tsr_iter* it)
+{
+    if (series->used_blocks == 0)
+    {
+        return false;
+    }
+
+    it->series = series;
+    iter_block_first(it, 0);
+    return true;
+}
+
+/**
+ * Point the iterator at the newest point. Returns false if the series is empty.
+*/
+bool tsr_last(const tsr_series* series, tsr_iter* it)
+{
+    if (series->used_blocks == 0)
+    {
+        return false;
+    }
+
+    it->series = series;
+    iter_block_last(it, series->used_blocks - 1);
+    return true;
+}
+
+/**
+ * Point the iterator at the first point at or after the given time. Returns false if there is none.
+ *
+ * Blocks are found with a binary search on their first time, so only one block is decoded.
+*/
+bool tsr_seek(const tsr_series* series, uint32_t time, tsr_iter* it)
+{
+    if (series->used_blocks == 0)
+    {
+        return false;
+    }
+
+    // Find the last block starting at or before the time.
+    size_t low = 0;
+    size_t high = series->used_blocks;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (block_at(series, mid)->first.time <= time)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    it->series = series;
+    size_t block = low > 0 ? low - 1 : 0;
+
+    // Skip a block that ends before the time; the point is then the first of the next block.
+    if (block_at(series, block)->last.time < time)
+    {
+        if (block + 1 == series->used_blocks)
+        {
+            return false;
+        }
+        ++block;
+    }
+
+    iter_block_first(it, block);
+    while (it->point.time < time)
+    {
+        if (!tsr_next(it))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Move to the next (newer) point. Returns false, leaving the iterator unchanged, if at the newest point.
+*/
+bool tsr_next(tsr_iter* it)
+{
+    const tsr_block* block = block_at(it->series, it->block);
+
+    if (it->index + 1 >= block->count)
+    {
+        if (it->block + 1 >= it->series->used_blocks)
+        {
+            return false;
+        }
+
+        iter_block_first(it, it->block + 1);
+        return true;
+    }
+
+    // The low bit of the first varint says if a time delta of delta comes before the value delta.
+    uint64_t head = get_varint(block->data, &it->pos);
+    int64_t dod = 0;
+    if (head & 1)
+    {
+        dod = unzigzag(head >> 1);
+        head = get_varint(block->data, &it->pos);
+    }
+    int64_t dv = unzigzag(head >> 1);
+
+    it->delta = (uint32_t)((int64_t)it->delta + dod);
+    it->point.time += it->delta;
+    it->point.value = (int32_t)((int64_t)it->point.value + dv);
+    ++it->index;
+
+    return true;
+}
+
+/**
+ * Move to the previous (older) point. Returns false, leaving the iterator unchanged, if at the oldest point.
+ *
+ * Varint bytes have the high bit set on all but the last byte, so they can be found from their end.
+*/
+bool tsr_prev(tsr_iter* it)
+{
+    if (it->index == 0)
+    {
+        if (it->block == 0)
+        {
+            return false;
+        }
+
+        iter_block_last(it, it->block - 1);
+        return true;
+    }
+
+    const tsr_block* block = block_at(it->series, it->block);
+
+    // The value delta is always last and has a clear low bit. A varint before it with the low bit set is this point's
+    // time delta of delta; otherwise it belongs to the point before.
+    uint16_t start = varint_start(block->data, it->pos);
+    uint16_t pos = start;
+    int64_t dv = unzigzag(get_varint(block->data, &pos) >> 1);
+
+    int64_t dod = 0;
+    if (start > 0)
+    {
+        uint16_t dod_start = varint_start(block->data, start);
+        pos = dod_start;
+        uint64_t head = get_varint(block->data, &pos);
+        if (head & 1)
+        {
+            dod = unzigzag(head >> 1);
+            start = dod_start;
+        }
+    }
+
+    it->point.time -= it->delta;
+    it->point.value = (int32_t)((int64_t)it->point.value - dv);
+    it->delta = (uint32_t)((int64_t)it->delta - dod);
+    it->pos = start;
+    --it->index;
+
+    return true;
+}
+
+static tsr_block* block_at(const tsr_series* series, size_t logical_idx)
+{
+    return &series->blocks[(series->head + logical_idx) % series->block_count];
+}
+
+/**
+ * Encode a point as the change from the block's last point. Returns the encoded size.
+*/
+static size_t encode_point(const tsr_block* block, uint32_t time, int32_t value, uint8_t* out)
+{
+    int64_t dod = (int64_t)(time - block->last.time) - (int64_t)block->last_delta;
+    int64_t dv = (int64_t)value - (int64_t)block->last.value;
+
+    size_t len = 0;
+    if (dod != 0)
+    {
+        len += put_varint((zigzag(dod) << 1) | 1, out);
+    }
+    len += put_varint(zigzag(dv) << 1, out + len);
+
+    return len;
+}
+
+/**
+ * Start a new block with the given point, dropping the oldest block if all are in use.
+*/
+static void start_block(tsr_series* series, uint32_t time, int32_t value)
+{
+    if (series->used_blocks == series->block_count)
+    {
+        series->point_count -= series->blocks[series->head].count;
+        series->head = (series->head + 1) % series->block_count;
+        --series->used_blocks;
+    }
+
+    tsr_block* block = block_at(series, series->used_blocks);
+    block->first.time = time;
+    block->first.value = value;
+    block->last = block->first;
+    block->last_delta = 0;
+    block->count = 1;
+    block->used = 0;
+
+    ++series->used_blocks;
+    ++series->point_count;
+}
+
+static void iter_block_first(tsr_iter* it, size_t block)
+{
+    const tsr_block* b = block_at(it->series, block);
+    it->block = block;
+    it->index = 0;
+    it->pos = 0;
+    it->point = b->first;
+    it->delta = 0;
+}
+
+static void iter_block_last(tsr_iter* it, size_t block)
+{
+    const tsr_block* b = block_at(it->series, block);
+    it->block = block;
+    it->index = b->count - 1;
+    it->pos = b->used;
+    it->point = b->last;
+    it->delta = b->last_delta;
+}
+
+static size_t put_varint(uint64_t value, uint8_t* out)
+{
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+static uint64_t get_varint(const uint8_t* data, uint16_t* pos)
+{
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    do
+    {
+        byte = data[(*pos)++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return value;
+}
+
+/**
+ * Find the start of the varint that ends just before the given offset.
+*/
+static uint16_t varint_start(const uint8_t* data, uint16_t end)
+{
+    uint16_t start = end - 1;
+    while (start > 0 && (data[start - 1] & 0x80))
+    {
+        --start;
+    }
+    return start;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
@@ -0,0 +1,98 @@
+/**
+ * Compressed time series of (time, value) points, stored in a ring of fixed-size blocks.
+ *
+ * Each block holds its first point in full. Every later point is stored as the change from the point before it: the
+ * delta of delta of the time (zero at a steady sample rate) and the delta of the value, both zigzag varints. A steady
+ * series of slowly changing readings takes one byte per point. When the block ring is full, the oldest block is
+ * dropped.
+ *
+ * Points are read with an iterator that walks forward or backward from any point, decoding one point per step.
+*/
+#ifndef _WA_TSERIES_H_INCLUDE_GUARD
+#define _WA_TSERIES_H_INCLUDE_GUARD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define TSR_OK 0
+#define TSR_FAIL 1
+
+/** Bytes of encoded points in each block. The whole block is this plus a 24 byte header. */
+#ifndef TSR_BLOCK_DATA_SIZE
+#define TSR_BLOCK_DATA_SIZE 104
+#endif
+
+typedef struct tsr_point
+{
+    uint32_t time;
+    int32_t value;
+} tsr_point;
+
+typedef struct tsr_block
+{
+    tsr_point first;
+    tsr_point last;
+    // Time between the last point and the one before it. Needed to append, and to walk backward from the last point.
+    uint32_t last_delta;
+    uint16_t count;
+    uint16_t used;
+    uint8_t data[TSR_BLOCK_DATA_SIZE];
+} tsr_block;
+
+typedef struct tsr_series
+{
+    tsr_block* blocks;
+    size_t block_count;
+    // Ring position of the oldest block and the number of blocks in use.
+    size_t head;
+    size_t used_blocks;
+    size_t point_count;
+} tsr_series;
+
+/**
+ * Position of a point in a series. Only valid until the next append.
+*/
+typedef struct tsr_iter
+{
+    const tsr_series* series;
+    // Logical block index, 0 is the oldest block.
+    size_t block;
+    // Index of the point in its block.
+    uint16_t index;
+    // Offset of the end of the point's encoding in the block data (0 for the first point).
+    uint16_t pos;
+    tsr_point point;
+    // Time between this point and the one before it in the block (0 for the first point).
+    uint32_t delta;
+} tsr_iter;
+
+int tsr_init(tsr_series* series, tsr_block* blocks, size_t block_count);
+
+void tsr_clear(tsr_series* series);
+
+int tsr_append(tsr_series* series, uint32_t time, int32_t value);
+
+size_t tsr_count(const tsr_series* series);
+
+size_t tsr_bytes_used(const tsr_series* series);
+
+bool tsr_first(const tsr_series* series, tsr_iter* it);
+
+bool tsr_last(const tsr_series* series, tsr_iter* it);
+
+bool tsr_seek(const tsr_series* series, uint32_t time, tsr_iter* it);
+
+bool tsr_next(tsr_iter* it);
+
+bool tsr_prev(tsr_iter* it);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _WA_TSERIES_H_INCLUDE_GUARD
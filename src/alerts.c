@@ -0,0 +1,273 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+
+#include <ring_buffer.h>
+
+#include "alerts.h"
+#include "prj_config.h"
+#include "config_store.h"
+#include "hardware_ui.h"
+#include "temp_sensor.h"
+#include "deferred_log.h"
+
+#define SEMI_WAIT_TIME (100 / portTICK_PERIOD_MS)
+
+#define LOG_TAG "alt"
+#define DLG_LEVEL DLG_LEVEL_ALERTS
+
+static SemaphoreHandle_t s_alert_mutex = NULL;
+#if PRJ_STATIC_ALLOC
+static StaticSemaphore_t s_alert_mutex_buffer;
+#endif
+
+// Rules are rebuilt from the settings, indexed by alt_rule_id.
+static alr_rule s_rules[ALT_RULE_COUNT];
+static alr_state s_rule_states[ALT_RULE_COUNT];
+static alr_engine s_engine;
+
+// Newest events. When full, the oldest event is dropped.
+static_assert((ALT_EVENT_QUEUE_SIZE & (ALT_EVENT_QUEUE_SIZE - 1)) == 0, "Alert queue size must be a power of two");
+static alt_event s_event_arena[ALT_EVENT_QUEUE_SIZE];
+static rbuf s_events;
+static uint32_t s_last_seq = 0;
+
+static uint32_t s_applied_cfg_generation = 0;
+static alt_listener_fn s_listener = NULL;
+
+static void load_rules();
+static void push_events(const alr_event* events, size_t count);
+static void on_reading(const tps_reading* reading, void* ctx);
+
+/**
+ * Initialize alerts from the settings. The config store must already be initialized.
+*/
+int alt_init()
+{
+#if PRJ_STATIC_ALLOC
+    s_alert_mutex = xSemaphoreCreateMutexStatic(&s_alert_mutex_buffer);
+#else
+    s_alert_mutex = xSemaphoreCreateMutex();
+#endif
+    if (s_alert_mutex == NULL)
+    {
+        ESP_LOGI(LOG_TAG, "Failed to create alert mutex");
+        return ALT_FAIL;
+    }
+
+    rbuf_init(&s_events, s_event_arena, sizeof(alt_event), ALT_EVENT_QUEUE_SIZE);
+    alr_init(&s_engine, s_rules, s_rule_states, ALT_RULE_COUNT);
+
+    s_applied_cfg_generation = cfg_get_generation();
+    load_rules();
+
+    if (tps_subscribe("alerts", on_reading, NULL) != TPS_OK)
+    {
+        return ALT_FAIL;
+    }
+
+    return ALT_OK;
+}
+
+/**
+ * Get the number of bytes of RAM this module reserves statically.
+*/
+size_t alt_static_size()
+{
+    size_t size = sizeof(s_event_arena) + sizeof(s_rules) + sizeof(s_rule_states);
+#if PRJ_STATIC_ALLOC
+    size += sizeof(s_alert_mutex_buffer);
+#endif
+    return size;
+}
+
+/**
+ * Set the function called when events are queued. Set once at startup, before the sensor task runs.
+*/
+void alt_set_listener(alt_listener_fn listener)
+{
+    s_listener = listener;
+}
+
+/**
+ * Check a reading against the alert rules. Fed from the reading bus with each good reading, so never waits: if the
+ * lock is held (a client copying events), the reading is skipped and the rules catch up on the next one. Thread safe.
+*/
+void alt_evaluate(uint32_t time_s, temper_t value)
+{
+    alr_event events[ALT_RULE_COUNT];
+    size_t count = 0;
+
+    BaseType_t take_success = xSemaphoreTake(s_alert_mutex, 0);
+    if (take_success == pdFALSE)
+    {
+        DLG_LOGD(LOG_TAG, "Alert lock busy, reading at %" PRIu32 " s skipped", time_s);
+        return;
+    }
+
+    // Changed settings start the rules over. Active alerts are cleared first so clients see them end.
+    bool cfg_changed = cfg_get_generation() != s_applied_cfg_generation;
+    if (cfg_changed)
+    {
+        s_applied_cfg_generation = cfg_get_generation();
+
+        count = alr_reset(&s_engine, time_s, events, ALT_RULE_COUNT);
+        push_events(events, count);
+        load_rules();
+    }
+
+    size_t new_count = alr_evaluate(&s_engine, time_s, value, events, ALT_RULE_COUNT);
+    push_events(events, new_count);
+    count += new_count;
+
+    bool any_active = alr_any_active(&s_engine);
+
+    // Must free lock!
+    xSemaphoreGive(s_alert_mutex);
+
+    hui_set_pattern(HUI_PATTERN_ALERT, any_active);
+
+    if (count > 0 && s_listener != NULL)
+    {
+        s_listener();
+    }
+}
+
+/**
+ * Get the sequence number of the newest event, or 0 if there has been none. Thread safe.
+*/
+uint32_t alt_last_seq()
+{
+    BaseType_t take_success = xSemaphoreTake(s_alert_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return 0;
+    }
+
+    uint32_t seq = s_last_seq;
+
+    // Must free lock!
+    xSemaphoreGive(s_alert_mutex);
+
+    return seq;
+}
+
+/**
+ * Copy the queued events newer than after_seq, oldest first. last_seq is set to the newest sequence number at the time
+ * of the copy, so a caller that got no events knows where to continue from. Returns the count copied. Thread safe.
+ *
+ * If after_seq is ahead of the newest event (the device restarted since the client last polled), all queued events
+ * are copied.
+*/
+size_t alt_get_events(uint32_t after_seq, alt_event* events, size_t max, uint32_t* last_seq)
+{
+    *last_seq = after_seq;
+
+    if (events == NULL || max == 0)
+    {
+        return 0;
+    }
+
+    BaseType_t take_success = xSemaphoreTake(s_alert_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return 0;
+    }
+
+    size_t queued = rbuf_count(&s_events);
+    uint32_t oldest_seq = s_last_seq - (uint32_t)queued + 1;
+
+    // Sequence numbers are consecutive, so the first event wanted is found by subtraction.
+    size_t start = 0;
+    if (after_seq <= s_last_seq && after_seq >= oldest_seq)
+    {
+        start = after_seq - oldest_seq + 1;
+    }
+
+    size_t count = rbuf_copy_oldest_first(&s_events, start, events, max);
+    *last_seq = s_last_seq;
+
+    // Must free lock!
+    xSemaphoreGive(s_alert_mutex);
+
+    return count;
+}
+
+const char* alt_rule_name(uint8_t rule)
+{
+    switch (rule)
+    {
+    case ALT_RULE_HIGH:
+        return "high";
+    case ALT_RULE_LOW:
+        return "low";
+    case ALT_RULE_RATE:
+        return "rate";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * Build the rules from the settings. The high and low rules are turned on by their own settings; a rate of 0 turns
+ * the rate rule off. Must hold the lock.
+*/
+static void load_rules()
+{
+    int32_t hysteresis = (int32_t)cfg_get_u32(CFG_ALERT_HYST);
+    uint32_t min_duration_s = cfg_get_u32(CFG_ALERT_MIN_S);
+
+    s_rules[ALT_RULE_HIGH] = (alr_rule) {
+        .kind = ALR_ABOVE,
+        .enabled = cfg_get_u32(CFG_ALERT_HIGH_ON) != 0,
+        .threshold = cfg_get_i32(CFG_ALERT_HIGH),
+        .hysteresis = hysteresis,
+        .min_duration_s = min_duration_s
+    };
+
+    s_rules[ALT_RULE_LOW] = (alr_rule) {
+        .kind = ALR_BELOW,
+        .enabled = cfg_get_u32(CFG_ALERT_LOW_ON) != 0,
+        .threshold = cfg_get_i32(CFG_ALERT_LOW),
+        .hysteresis = hysteresis,
+        .min_duration_s = min_duration_s
+    };
+
+    // The hysteresis setting is in degrees, so the rate rule clears at three quarters of its threshold instead.
+    int32_t rate = (int32_t)cfg_get_u32(CFG_ALERT_RATE);
+    s_rules[ALT_RULE_RATE] = (alr_rule) {
+        .kind = ALR_RATE,
+        .enabled = rate != 0,
+        .threshold = rate,
+        .hysteresis = rate / 4,
+        .min_duration_s = min_duration_s
+    };
+}
+
+/**
+ * Number and queue new events. Must hold the lock.
+*/
+static void push_events(const alr_event* events, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        alt_event queued = { .seq = ++s_last_seq, .event = events[i] };
+        rbuf_push(&s_events, &queued);
+
+        DLG_LOGI(LOG_TAG, "Alert %s %s, value %" PRId32, DLG_STR(alt_rule_name(events[i].rule)),
+            DLG_STR(events[i].raised ? "raised" : "cleared"), events[i].value);
+    }
+}
+
+/**
+ * Evaluate each good reading as the sensor task publishes it.
+*/
+static void on_reading(const tps_reading* reading, void* ctx)
+{
+    (void)ctx;
+
+    if (reading->value != TPS_NO_VALUE)
+    {
+        alt_evaluate(reading->time_s, reading->value);
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * Temperature alerts. Readings from the sensor task are checked against the alert settings; raised and cleared alerts
+ * are kept in a bounded queue of numbered events for clients to poll, and shown on the status LED.
+*/
+#ifndef _WA_ALERTS_H_INCLUDE_GUARD
+#define _WA_ALERTS_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include <alert_rules.h>
+
+#include "tempr_sensor_types.h"
+
+#define ALT_OK 0
+#define ALT_FAIL 1
+
+typedef enum alt_rule_id
+{
+    ALT_RULE_HIGH,
+    ALT_RULE_LOW,
+    ALT_RULE_RATE,
+    ALT_RULE_COUNT
+} alt_rule_id;
+
+/**
+ * An alert event. Sequence numbers start at 1 and increase by one per event, so a client can tell if it missed events
+ * that were dropped from the queue.
+*/
+typedef struct alt_event
+{
+    uint32_t seq;
+    alr_event event;
+} alt_event;
+
+// Called after new events are queued, from the sensor task. Must not block.
+typedef void (*alt_listener_fn)();
+
+int alt_init();
+
+size_t alt_static_size();
+
+void alt_set_listener(alt_listener_fn listener);
+
+void alt_evaluate(uint32_t time_s, temper_t value);
+
+uint32_t alt_last_seq();
+
+size_t alt_get_events(uint32_t after_seq, alt_event* events, size_t max, uint32_t* last_seq);
+
+const char* alt_rule_name(uint8_t rule);
+
+#endif // _WA_ALERTS_H_INCLUDE_GUARD
@@ -0,0 +1,280 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <esp_http_client.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "prj_config.h"
+#include "task_layout.h"
+
+#define LOG_TAG "bench"
+
+#if PRJ_BENCHMARK_MODE
+
+// Survives esp_restart so each boot can run the next preset.
+#define BENCH_MAGIC 0x42454E43
+
+#define BENCH_CLIENT_STACK 4096
+#define BENCH_CLIENT_PRIORITY 1
+#define BENCH_REPORT_STACK 4096
+#define BENCH_REPORT_PRIORITY 1
+
+typedef struct bench_preset
+{
+    const char* name;
+
+    // Indexed by tl_task_id.
+    UBaseType_t priority[TL_TASK_COUNT];
+    BaseType_t core[TL_TASK_COUNT];
+} bench_preset;
+
+typedef struct bench_latency
+{
+    const char* uri;
+    uint32_t samples_us[BENCH_MAX_SAMPLES];
+    size_t count;
+    uint32_t errors;
+} bench_latency;
+
+static const bench_preset s_presets[] = {
+    {
+        "table",
+        { TASK_TPS_PRIORITY, TASK_HTTPD_PRIORITY, TASK_ALERTS_PRIORITY, TASK_LOG_PRIORITY, TASK_RLOG_PRIORITY,
+            TASK_TLM_PRIORITY },
+        { TASK_TPS_CORE, TASK_HTTPD_CORE, TASK_ALERTS_CORE, TASK_LOG_CORE, TASK_RLOG_CORE, TASK_TLM_CORE }
+    },
+    { "all-cpu0", { 2, 5, 4, 1, 1, 3 }, { 0, 0, 0, 0, 0, 0 } },
+    { "all-cpu1", { 2, 5, 4, 1, 1, 3 }, { 1, 1, 1, 1, 1, 1 } },
+    { "sensor-cpu1-httpd-cpu0", { 2, 5, 4, 1, 1, 3 }, { 1, 0, 0, tskNO_AFFINITY, tskNO_AFFINITY, 0 } },
+    { "sensor-cpu0-httpd-cpu1", { 2, 5, 4, 1, 1, 3 }, { 0, 1, 1, tskNO_AFFINITY, tskNO_AFFINITY, 1 } },
+    { "sensor-above-httpd", { 6, 5, 4, 1, 1, 3 },
+        { 1, tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY } },
+    { "unpinned", { 2, 5, 4, 1, 1, 3 },
+        { tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY } },
+};
+
+#define BENCH_PRESET_COUNT (sizeof(s_presets) / sizeof(s_presets[0]))
+
+static RTC_NOINIT_ATTR uint32_t s_bench_magic;
+static RTC_NOINIT_ATTR uint32_t s_bench_preset_idx;
+
+static portMUX_TYPE s_bench_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_bench_end_us = 0;
+
+// Poll jitter. Only written by the sensor task.
+static int64_t s_last_poll_us = 0;
+static uint32_t s_poll_count = 0;
+static int64_t s_poll_jitter_sum_us = 0;
+static int64_t s_poll_jitter_max_us = 0;
+
+static bench_latency s_home_latency = { .uri = "/" };
+static bench_latency s_info_latency = { .uri = "/info" };
+
+static void bench_client_task(void* params);
+static void bench_report_task(void* params);
+static void record_latency(bench_latency* lat, uint32_t elapsed_us, bool ok);
+static void report_latency(bench_latency* lat);
+static int compare_u32(const void* a, const void* b);
+
+/**
+ * Select the task placement preset for this boot. Must be called before any project task is created.
+*/
+void bench_init()
+{
+    // A power on leaves garbage in RTC memory, so only trust the index after a software restart.
+    if (esp_reset_reason() != ESP_RST_SW || s_bench_magic != BENCH_MAGIC || s_bench_preset_idx > BENCH_PRESET_COUNT)
+    {
+        s_bench_magic = BENCH_MAGIC;
+        s_bench_preset_idx = 0;
+    }
+
+    if (s_bench_preset_idx == BENCH_PRESET_COUNT)
+    {
+        ESP_LOGI(LOG_TAG, "All %u presets done, running with the task table", BENCH_PRESET_COUNT);
+        return;
+    }
+
+    const bench_preset* preset = &s_presets[s_bench_preset_idx];
+    ESP_LOGI(LOG_TAG, "Preset %u/%u: %s", s_bench_preset_idx + 1, BENCH_PRESET_COUNT, preset->name);
+
+    for (int i = 0; i < TL_TASK_COUNT; ++i)
+    {
+        tl_override((tl_task_id)i, preset->priority[i], preset->core[i]);
+    }
+}
+
+/**
+ * Start the synthetic HTTP load and the report task. Must be called after the web server is started.
+*/
+void bench_start()
+{
+    if (s_bench_preset_idx >= BENCH_PRESET_COUNT)
+    {
+        return;
+    }
+
+    s_bench_end_us = esp_timer_get_time() + (int64_t)BENCH_DURATION_MS * 1000;
+
+    for (int i = 0; i < BENCH_HTTP_CLIENTS; ++i)
+    {
+        TaskHandle_t h_client;
+        xTaskCreate(bench_client_task, "bench_client", BENCH_CLIENT_STACK, NULL, BENCH_CLIENT_PRIORITY, &h_client);
+    }
+
+    TaskHandle_t h_report;
+    xTaskCreate(bench_report_task, "bench_report", BENCH_REPORT_STACK, NULL, BENCH_REPORT_PRIORITY, &h_report);
+}
+
+/**
+ * Called by the sensor task at the start of each poll. Measures how far each poll period is from the poll rate, which
+ * benchmark mode fixes whatever the saved setting.
+*/
+void bench_poll_mark()
+{
+    int64_t now = esp_timer_get_time();
+
+    if (s_last_poll_us != 0 && now < s_bench_end_us)
+    {
+        int64_t jitter = llabs((now - s_last_poll_us) - (int64_t)BENCH_POLL_RATE_MS * 1000);
+
+        portENTER_CRITICAL(&s_bench_mux);
+        ++s_poll_count;
+        s_poll_jitter_sum_us += jitter;
+        if (jitter > s_poll_jitter_max_us)
+        {
+            s_poll_jitter_max_us = jitter;
+        }
+        portEXIT_CRITICAL(&s_bench_mux);
+    }
+
+    s_last_poll_us = now;
+}
+
+/**
+ * Requests the home and info pages over loopback in a loop until the benchmark ends.
+*/
+static void bench_client_task(void* params)
+{
+    esp_http_client_config_t config = {
+        .url = "http://127.0.0.1/",
+        .timeout_ms = 5000,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    bool home = true;
+
+    while (esp_timer_get_time() < s_bench_end_us)
+    {
+        bench_latency* lat = home ? &s_home_latency : &s_info_latency;
+        esp_http_client_set_url(client, home ? "http://127.0.0.1/" : "http://127.0.0.1/info");
+
+        int64_t start = esp_timer_get_time();
+        esp_err_t rc = esp_http_client_perform(client);
+        int64_t elapsed = esp_timer_get_time() - start;
+
+        record_latency(lat, (uint32_t)elapsed, rc == ESP_OK && esp_http_client_get_status_code(client) == 200);
+        home = !home;
+    }
+
+    esp_http_client_cleanup(client);
+    vTaskDelete(NULL);
+}
+
+/**
+ * Waits for the benchmark to end, logs the results and restarts into the next preset.
+*/
+static void bench_report_task(void* params)
+{
+    // Give the clients time to finish their last request.
+    vTaskDelay((BENCH_DURATION_MS + 2000) / portTICK_PERIOD_MS);
+
+    const bench_preset* preset = &s_presets[s_bench_preset_idx];
+    ESP_LOGI(LOG_TAG, "=== Results for preset '%s' ===", preset->name);
+    tl_log_layout();
+
+    portENTER_CRITICAL(&s_bench_mux);
+    uint32_t poll_count = s_poll_count;
+    int64_t jitter_sum = s_poll_jitter_sum_us;
+    int64_t jitter_max = s_poll_jitter_max_us;
+    portEXIT_CRITICAL(&s_bench_mux);
+
+    if (poll_count > 0)
+    {
+        ESP_LOGI(LOG_TAG, "poll jitter: %u polls, avg %lld us, max %lld us", poll_count, jitter_sum / poll_count,
+            jitter_max);
+    }
+
+    report_latency(&s_home_latency);
+    report_latency(&s_info_latency);
+
+    ++s_bench_preset_idx;
+    ESP_LOGI(LOG_TAG, "Restarting for the next preset");
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    esp_restart();
+}
+
+static void record_latency(bench_latency* lat, uint32_t elapsed_us, bool ok)
+{
+    portENTER_CRITICAL(&s_bench_mux);
+    if (!ok)
+    {
+        ++lat->errors;
+    }
+    else if (lat->count < BENCH_MAX_SAMPLES)
+    {
+        lat->samples_us[lat->count] = elapsed_us;
+        ++lat->count;
+    }
+    portEXIT_CRITICAL(&s_bench_mux);
+}
+
+/**
+ * Log latency percentiles. Only called after the clients are done, so the samples can be sorted in place.
+*/
+static void report_latency(bench_latency* lat)
+{
+    if (lat->count == 0)
+    {
+        ESP_LOGI(LOG_TAG, "%s: no samples, %u errors", lat->uri, lat->errors);
+        return;
+    }
+
+    uint32_t* samples = lat->samples_us;
+    qsort(samples, lat->count, sizeof(uint32_t), compare_u32);
+
+    ESP_LOGI(LOG_TAG, "%s: %u requests, %u errors, p50 %u us, p95 %u us, p99 %u us, max %u us",
+        lat->uri,
+        lat->count,
+        lat->errors,
+        samples[lat->count * 50 / 100],
+        samples[lat->count * 95 / 100],
+        samples[lat->count * 99 / 100],
+        samples[lat->count - 1]);
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t va = *(const uint32_t*)a;
+    uint32_t vb = *(const uint32_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+#else
+
+void bench_init()
+{
+}
+
+void bench_start()
+{
+}
+
+void bench_poll_mark()
+{
+}
+
+#endif // PRJ_BENCHMARK_MODE
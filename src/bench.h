@@ -0,0 +1,13 @@
+/**
+ * Task placement benchmark. Only does work when PRJ_BENCHMARK_MODE is enabled.
+*/
+#ifndef _WA_BENCH_H_INCLUDE_GUARD
+#define _WA_BENCH_H_INCLUDE_GUARD
+
+void bench_init();
+
+void bench_start();
+
+void bench_poll_mark();
+
+#endif // _WA_BENCH_H_INCLUDE_GUARD
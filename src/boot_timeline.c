@@ -0,0 +1,146 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "boot_timeline.h"
+
+#define LOG_TAG "btl"
+
+typedef struct btl_entry
+{
+    btl_span span;
+    bool begun;
+} btl_entry;
+
+// Phases are timed from different tasks (milestones from the sensor and httpd tasks), and 64 bit stores are not
+// atomic on the ESP32.
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static btl_entry s_entries[BTL_COUNT];
+
+// Indexed by btl_phase.
+static const char* const s_names[BTL_COUNT] = {
+    "Startup",
+    "NVS and settings",
+    "Status LED",
+    "Network stack",
+    "Wi-Fi SoftAP",
+    "I2C bus",
+    "Sensor and alerts",
+    "HTTP server",
+    "First reading",
+    "First response",
+};
+
+/**
+ * Record the start of a phase. A phase is only timed once; later calls are ignored.
+*/
+void btl_begin(btl_phase phase)
+{
+    if (phase < 0 || phase >= BTL_COUNT)
+    {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_mux);
+    btl_entry* entry = &s_entries[phase];
+    if (!entry->begun)
+    {
+        entry->span.begin_us = now;
+        entry->begun = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+/**
+ * Record the end of a phase. Ignored if the phase did not begin or already ended.
+*/
+void btl_end(btl_phase phase)
+{
+    if (phase < 0 || phase >= BTL_COUNT)
+    {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_mux);
+    btl_entry* entry = &s_entries[phase];
+    if (entry->begun && !entry->span.ended)
+    {
+        entry->span.end_us = now;
+        entry->span.ended = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+/**
+ * Record a milestone the first time it happens. Cheap enough to call on every occurrence.
+*/
+void btl_mark(btl_phase phase)
+{
+    if (phase < 0 || phase >= BTL_COUNT || s_entries[phase].span.ended)
+    {
+        return;
+    }
+
+    btl_begin(phase);
+    btl_end(phase);
+}
+
+/**
+ * Get the times of a phase. Returns false if it has not begun.
+*/
+bool btl_get(btl_phase phase, btl_span* span)
+{
+    if (phase < 0 || phase >= BTL_COUNT)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    bool begun = s_entries[phase].begun;
+    *span = s_entries[phase].span;
+    portEXIT_CRITICAL(&s_mux);
+
+    return begun;
+}
+
+const char* btl_name(btl_phase phase)
+{
+    if (phase < 0 || phase >= BTL_COUNT)
+    {
+        return "unknown";
+    }
+
+    return s_names[phase];
+}
+
+/**
+ * Log the phases recorded so far, in milliseconds.
+*/
+void btl_log()
+{
+    for (int i = 0; i < BTL_COUNT; ++i)
+    {
+        btl_span span;
+        if (!btl_get((btl_phase)i, &span))
+        {
+            ESP_LOGI(LOG_TAG, "%s: not reached", s_names[i]);
+        }
+        else if (!span.ended)
+        {
+            ESP_LOGI(LOG_TAG, "%s: at %" PRId64 " ms, running", s_names[i], span.begin_us / 1000);
+        }
+        else if (i >= BTL_FIRST_READING)
+        {
+            ESP_LOGI(LOG_TAG, "%s: at %" PRId64 " ms", s_names[i], span.begin_us / 1000);
+        }
+        else
+        {
+            ESP_LOGI(LOG_TAG, "%s: at %" PRId64 " ms, took %" PRId64 " us", s_names[i], span.begin_us / 1000,
+                span.end_us - span.begin_us);
+        }
+    }
+}
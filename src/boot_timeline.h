@@ -0,0 +1,47 @@
+/**
+ * Boot timeline. Startup phases record when they began and ended, and milestones record when they first happened, in
+ * microseconds of esp_timer time (which starts shortly before app_main).
+*/
+#ifndef _WA_BOOT_TIMELINE_H_INCLUDE_GUARD
+#define _WA_BOOT_TIMELINE_H_INCLUDE_GUARD
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef enum btl_phase
+{
+    BTL_STARTUP,
+    BTL_NVS,
+    BTL_HUI,
+    BTL_NETIF,
+    BTL_WIFI,
+    BTL_I2C,
+    BTL_SENSOR,
+    BTL_HTTPD,
+    // Milestones: begin and end are the same.
+    BTL_FIRST_READING,
+    BTL_FIRST_RESPONSE,
+    BTL_COUNT
+} btl_phase;
+
+typedef struct btl_span
+{
+    int64_t begin_us;
+    // Only valid if ended.
+    int64_t end_us;
+    bool ended;
+} btl_span;
+
+void btl_begin(btl_phase phase);
+
+void btl_end(btl_phase phase);
+
+void btl_mark(btl_phase phase);
+
+bool btl_get(btl_phase phase, btl_span* span);
+
+const char* btl_name(btl_phase phase);
+
+void btl_log();
+
+#endif // _WA_BOOT_TIMELINE_H_INCLUDE_GUARD
@@ -0,0 +1,405 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <nvs.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_store.h"
+#include "prj_config.h"
+
+#define LOG_TAG "cfg"
+
+#define CFG_NVS_NAMESPACE "webtemp"
+
+/**
+ * Registry entry. For numbers min and max limit the value, for strings they limit the length. The name is also the
+ * NVS key, so it must be 15 characters or less.
+*/
+typedef struct cfg_entry
+{
+    const char* name;
+    cfg_type type;
+    int64_t min;
+    int64_t max;
+    int64_t default_num;
+    const char* default_str;
+    bool secret;
+} cfg_entry;
+
+typedef union cfg_value
+{
+    uint32_t u32;
+    int32_t i32;
+    char str[CFG_STR_MAX_SIZE];
+} cfg_value;
+
+// Indexed by cfg_key.
+static const cfg_entry s_entries[CFG_KEY_COUNT] = {
+    { "poll_ms", CFG_TYPE_U32, TPS_POLL_RATE_MIN_MS, TPS_POLL_RATE_MAX_MS, TPS_POLL_RATE_MS, NULL, false },
+    { "hist_size", CFG_TYPE_U32, 1, TPS_HIST_ARENA_SIZE, TPS_HIST_DEFAULT_SIZE, NULL, false },
+    { "i2c_hz", CFG_TYPE_U32, I2C_MASTER_FREQ_MIN_HZ, I2C_MASTER_FREQ_MAX_HZ, I2C_MASTER_FREQ_HZ, NULL, false },
+    { "ap_ssid", CFG_TYPE_STR, 1, 32, 0, WEBS_AP_SSID, false },
+    { "ap_pwd", CFG_TYPE_STR, 8, 63, 0, WEBS_AP_PWD, true },
+    { "alert_high", CFG_TYPE_I32, ALT_TEMP_MIN, ALT_TEMP_MAX, 0, NULL, false },
+    { "alert_high_on", CFG_TYPE_U32, 0, 1, 0, NULL, false },
+    { "alert_low", CFG_TYPE_I32, ALT_TEMP_MIN, ALT_TEMP_MAX, 0, NULL, false },
+    { "alert_low_on", CFG_TYPE_U32, 0, 1, 0, NULL, false },
+    { "alert_hyst", CFG_TYPE_U32, 0, ALT_HYST_MAX, ALT_HYST_DEFAULT, NULL, false },
+    { "alert_min_s", CFG_TYPE_U32, 0, ALT_MIN_DURATION_MAX_S, 0, NULL, false },
+    { "alert_rate", CFG_TYPE_U32, 0, ALT_TEMP_MAX, 0, NULL, false },
+    { "tlm_mode", CFG_TYPE_U32, TLM_MODE_OFF, TLM_MODE_MULTICAST, TLM_MODE_OFF, NULL, false },
+    { "tlm_port", CFG_TYPE_U32, TLM_PORT_MIN, 65535, TLM_DEFAULT_PORT, NULL, false },
+};
+
+static portMUX_TYPE s_cfg_mux = portMUX_INITIALIZER_UNLOCKED;
+static cfg_value s_values[CFG_KEY_COUNT];
+static volatile uint32_t s_generation = 0;
+
+static bool is_valid_key(cfg_key key);
+static void load_from_nvs();
+static void save_to_nvs(cfg_key key);
+
+/**
+ * Initialize the store with defaults, then apply values saved in NVS. NVS must already be initialized.
+*/
+int cfg_init()
+{
+    for (int i = 0; i < CFG_KEY_COUNT; ++i)
+    {
+        if (s_entries[i].type == CFG_TYPE_U32)
+        {
+            s_values[i].u32 = (uint32_t)s_entries[i].default_num;
+        }
+        else if (s_entries[i].type == CFG_TYPE_I32)
+        {
+            s_values[i].i32 = (int32_t)s_entries[i].default_num;
+        }
+        else
+        {
+            strlcpy(s_values[i].str, s_entries[i].default_str, CFG_STR_MAX_SIZE);
+        }
+    }
+
+#if PRJ_BENCHMARK_MODE
+    // Benchmarks always run with the compiled in settings.
+    ESP_LOGI(LOG_TAG, "Benchmark mode, ignoring saved settings");
+#else
+    load_from_nvs();
+#endif
+
+    return CFG_OK;
+}
+
+const char* cfg_name(cfg_key key)
+{
+    return is_valid_key(key) ? s_entries[key].name : NULL;
+}
+
+cfg_type cfg_get_type(cfg_key key)
+{
+    return is_valid_key(key) ? s_entries[key].type : CFG_TYPE_U32;
+}
+
+/**
+ * Secret settings (passwords) can be set but should not be displayed.
+*/
+bool cfg_is_secret(cfg_key key)
+{
+    return is_valid_key(key) && s_entries[key].secret;
+}
+
+/**
+ * Get a number setting. Thread safe.
+*/
+uint32_t cfg_get_u32(cfg_key key)
+{
+    if (!is_valid_key(key) || s_entries[key].type != CFG_TYPE_U32)
+    {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&s_cfg_mux);
+    uint32_t value = s_values[key].u32;
+    portEXIT_CRITICAL(&s_cfg_mux);
+
+    return value;
+}
+
+/**
+ * Get a signed number setting. Thread safe.
+*/
+int32_t cfg_get_i32(cfg_key key)
+{
+    if (!is_valid_key(key) || s_entries[key].type != CFG_TYPE_I32)
+    {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&s_cfg_mux);
+    int32_t value = s_values[key].i32;
+    portEXIT_CRITICAL(&s_cfg_mux);
+
+    return value;
+}
+
+/**
+ * Copy a string setting into the buffer. Thread safe.
+*/
+void cfg_get_str(cfg_key key, char* buffer, size_t size)
+{
+    if (buffer == NULL || size == 0)
+    {
+        return;
+    }
+
+    buffer[0] = 0;
+    if (!is_valid_key(key) || s_entries[key].type != CFG_TYPE_STR)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_cfg_mux);
+    strlcpy(buffer, s_values[key].str, size);
+    portEXIT_CRITICAL(&s_cfg_mux);
+}
+
+/**
+ * Set and persist a number setting. Returns CFG_INVALID if the value is out of range.
+*/
+int cfg_set_u32(cfg_key key, uint32_t value)
+{
+    if (!is_valid_key(key) || s_entries[key].type != CFG_TYPE_U32)
+    {
+        return CFG_FAIL;
+    }
+
+    const cfg_entry* entry = &s_entries[key];
+    if (value < entry->min || value > entry->max)
+    {
+        return CFG_INVALID;
+    }
+
+    // Unchanged values don't wear the flash or wake up tasks.
+    portENTER_CRITICAL(&s_cfg_mux);
+    bool changed = s_values[key].u32 != value;
+    if (changed)
+    {
+        s_values[key].u32 = value;
+        ++s_generation;
+    }
+    portEXIT_CRITICAL(&s_cfg_mux);
+
+    if (changed)
+    {
+        save_to_nvs(key);
+    }
+
+    return CFG_OK;
+}
+
+/**
+ * Set and persist a signed number setting. Returns CFG_INVALID if the value is out of range.
+*/
+int cfg_set_i32(cfg_key key, int32_t value)
+{
+    if (!is_valid_key(key) || s_entries[key].type != CFG_TYPE_I32)
+    {
+        return CFG_FAIL;
+    }
+
+    const cfg_entry* entry = &s_entries[key];
+    if (value < entry->min || value > entry->max)
+    {
+        return CFG_INVALID;
+    }
+
+    // Unchanged values don't wear the flash or wake up tasks.
+    portENTER_CRITICAL(&s_cfg_mux);
+    bool changed = s_values[key].i32 != value;
+    if (changed)
+    {
+        s_values[key].i32 = value;
+        ++s_generation;
+    }
+    portEXIT_CRITICAL(&s_cfg_mux);
+
+    if (changed)
+    {
+        save_to_nvs(key);
+    }
+
+    return CFG_OK;
+}
+
+/**
+ * Set and persist a string setting. Returns CFG_INVALID if the length is out of range.
+*/
+int cfg_set_str(cfg_key key, const char* value)
+{
+    if (!is_valid_key(key) || s_entries[key].type != CFG_TYPE_STR || value == NULL)
+    {
+        return CFG_FAIL;
+    }
+
+    const cfg_entry* entry = &s_entries[key];
+    int64_t len = (int64_t)strlen(value);
+    if (len < entry->min || len > entry->max)
+    {
+        return CFG_INVALID;
+    }
+
+    // Unchanged values don't wear the flash or wake up tasks.
+    portENTER_CRITICAL(&s_cfg_mux);
+    bool changed = strcmp(s_values[key].str, value) != 0;
+    if (changed)
+    {
+        strlcpy(s_values[key].str, value, CFG_STR_MAX_SIZE);
+        ++s_generation;
+    }
+    portEXIT_CRITICAL(&s_cfg_mux);
+
+    if (changed)
+    {
+        save_to_nvs(key);
+    }
+
+    return CFG_OK;
+}
+
+/**
+ * Parse a value from text (e.g. a form field) and set it.
+*/
+int cfg_set_from_string(cfg_key key, const char* value)
+{
+    if (!is_valid_key(key) || value == NULL)
+    {
+        return CFG_FAIL;
+    }
+
+    if (s_entries[key].type == CFG_TYPE_STR)
+    {
+        return cfg_set_str(key, value);
+    }
+
+    char* end = NULL;
+    if (s_entries[key].type == CFG_TYPE_I32)
+    {
+        long parsed = strtol(value, &end, 10);
+        if (end == value || *end != 0 || parsed < INT32_MIN || parsed > INT32_MAX)
+        {
+            return CFG_INVALID;
+        }
+
+        return cfg_set_i32(key, (int32_t)parsed);
+    }
+
+    // strtoul would take "-1" as a large number.
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (end == value || *end != 0 || value[0] == '-' || parsed > UINT32_MAX)
+    {
+        return CFG_INVALID;
+    }
+
+    return cfg_set_u32(key, (uint32_t)parsed);
+}
+
+/**
+ * Get the configuration generation. Changes every time a setting is changed, so tasks can cheaply check if they
+ * need to apply new settings.
+*/
+uint32_t cfg_get_generation()
+{
+    return s_generation;
+}
+
+static bool is_valid_key(cfg_key key)
+{
+    return key >= 0 && key < CFG_KEY_COUNT;
+}
+
+/**
+ * Replace defaults with values saved in NVS. Saved values that are no longer valid are ignored.
+*/
+static void load_from_nvs()
+{
+    nvs_handle_t handle;
+    esp_err_t rc = nvs_open(CFG_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (rc != ESP_OK)
+    {
+        // Nothing has been saved yet.
+        return;
+    }
+
+    for (int i = 0; i < CFG_KEY_COUNT; ++i)
+    {
+        const cfg_entry* entry = &s_entries[i];
+
+        if (entry->type == CFG_TYPE_U32)
+        {
+            uint32_t value;
+            if (nvs_get_u32(handle, entry->name, &value) == ESP_OK && value >= entry->min && value <= entry->max)
+            {
+                s_values[i].u32 = value;
+            }
+        }
+        else if (entry->type == CFG_TYPE_I32)
+        {
+            int32_t value;
+            if (nvs_get_i32(handle, entry->name, &value) == ESP_OK && value >= entry->min && value <= entry->max)
+            {
+                s_values[i].i32 = value;
+            }
+        }
+        else
+        {
+            char value[CFG_STR_MAX_SIZE];
+            size_t size = sizeof(value);
+            if (nvs_get_str(handle, entry->name, value, &size) == ESP_OK
+                && (int64_t)strlen(value) >= entry->min && (int64_t)strlen(value) <= entry->max)
+            {
+                strlcpy(s_values[i].str, value, CFG_STR_MAX_SIZE);
+            }
+        }
+    }
+
+    nvs_close(handle);
+}
+
+static void save_to_nvs(cfg_key key)
+{
+    nvs_handle_t handle;
+    esp_err_t rc = nvs_open(CFG_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (rc != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to open NVS: %s", esp_err_to_name(rc));
+        return;
+    }
+
+    const cfg_entry* entry = &s_entries[key];
+    if (entry->type == CFG_TYPE_U32)
+    {
+        rc = nvs_set_u32(handle, entry->name, cfg_get_u32(key));
+    }
+    else if (entry->type == CFG_TYPE_I32)
+    {
+        rc = nvs_set_i32(handle, entry->name, cfg_get_i32(key));
+    }
+    else
+    {
+        char value[CFG_STR_MAX_SIZE];
+        cfg_get_str(key, value, sizeof(value));
+        rc = nvs_set_str(handle, entry->name, value);
+    }
+
+    if (rc == ESP_OK)
+    {
+        rc = nvs_commit(handle);
+    }
+
+    if (rc != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to save '%s': %s", entry->name, esp_err_to_name(rc));
+    }
+
+    nvs_close(handle);
+}
@@ -0,0 +1,68 @@
+/**
+ * Runtime configuration store. Typed settings with defaults and limits, persisted in NVS.
+*/
+#ifndef _WA_CONFIG_STORE_H_INCLUDE_GUARD
+#define _WA_CONFIG_STORE_H_INCLUDE_GUARD
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CFG_OK 0
+#define CFG_FAIL 1
+#define CFG_INVALID 2
+
+// Largest string setting, including the null terminator.
+#define CFG_STR_MAX_SIZE 65
+
+typedef enum cfg_key
+{
+    CFG_POLL_RATE_MS,
+    CFG_HIST_SIZE,
+    CFG_I2C_FREQ_HZ,
+    CFG_AP_SSID,
+    CFG_AP_PWD,
+    CFG_ALERT_HIGH,
+    CFG_ALERT_HIGH_ON,
+    CFG_ALERT_LOW,
+    CFG_ALERT_LOW_ON,
+    CFG_ALERT_HYST,
+    CFG_ALERT_MIN_S,
+    CFG_ALERT_RATE,
+    CFG_TLM_MODE,
+    CFG_TLM_PORT,
+    CFG_KEY_COUNT
+} cfg_key;
+
+typedef enum cfg_type
+{
+    CFG_TYPE_U32,
+    CFG_TYPE_I32,
+    CFG_TYPE_STR
+} cfg_type;
+
+int cfg_init();
+
+const char* cfg_name(cfg_key key);
+
+cfg_type cfg_get_type(cfg_key key);
+
+bool cfg_is_secret(cfg_key key);
+
+uint32_t cfg_get_u32(cfg_key key);
+
+int32_t cfg_get_i32(cfg_key key);
+
+void cfg_get_str(cfg_key key, char* buffer, size_t size);
+
+int cfg_set_u32(cfg_key key, uint32_t value);
+
+int cfg_set_i32(cfg_key key, int32_t value);
+
+int cfg_set_str(cfg_key key, const char* value);
+
+int cfg_set_from_string(cfg_key key, const char* value);
+
+uint32_t cfg_get_generation();
+
+#endif // _WA_CONFIG_STORE_H_INCLUDE_GUARD
@@ -0,0 +1,151 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+#include <ring_buffer.h>
+
+#include "deferred_log.h"
+#include "prj_config.h"
+#include "task_layout.h"
+
+#define LOG_TAG "dlg"
+
+static_assert((DLG_QUEUE_SIZE & (DLG_QUEUE_SIZE - 1)) == 0, "Deferred log queue size must be a power of two");
+static dlg_record s_records[DLG_QUEUE_SIZE];
+static atomic_size_t s_record_seqs[DLG_QUEUE_SIZE];
+static rbuf_mpsc s_queue;
+static volatile bool s_ready = false;
+
+// Records that didn't fit, since the drain task last said so.
+static atomic_uint s_dropped = 0;
+
+// Set by the first record after the drain task cleared it, which then wakes the task.
+static atomic_flag s_pending = ATOMIC_FLAG_INIT;
+
+static TaskHandle_t s_task = NULL;
+#if PRJ_STATIC_ALLOC
+static StackType_t s_task_stack[TASK_LOG_STACK];
+static StaticTask_t s_task_tcb;
+#endif
+
+static void drain_task(void* params);
+static void print_record(const dlg_record* record);
+
+/**
+ * Initialize the queue. Must be the first thing at startup; records written before are lost.
+*/
+void dlg_init()
+{
+    rbuf_mpsc_init(&s_queue, s_records, s_record_seqs, sizeof(dlg_record), DLG_QUEUE_SIZE);
+    s_ready = true;
+}
+
+/**
+ * Start the task that prints the records. Until it runs, records wait in the queue.
+*/
+int dlg_start()
+{
+    const tl_placement* p = tl_get(TL_TASK_LOG);
+
+#if PRJ_STATIC_ALLOC
+    s_task = xTaskCreateStaticPinnedToCore(drain_task, p->name, p->stack_size, NULL, p->priority, s_task_stack,
+        &s_task_tcb, p->core);
+#else
+    xTaskCreatePinnedToCore(drain_task, p->name, p->stack_size, NULL, p->priority, &s_task, p->core);
+#endif
+
+    return s_task != NULL ? DLG_OK : DLG_FAIL;
+}
+
+/**
+ * Queue a record. Use the DLG_LOG macros rather than calling this. Safe from any task; never blocks. If the queue is
+ * full the record is dropped and counted.
+*/
+void dlg_write(esp_log_level_t level, const char* tag, const char* format, const uintptr_t* args, size_t argc)
+{
+    if (!s_ready)
+    {
+        return;
+    }
+
+    dlg_record record = {
+        .time_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .level = (uint8_t)level,
+        .argc = (uint8_t)argc,
+        .tag = tag,
+        .format = format
+    };
+
+    for (size_t i = 0; i < argc && i < DLG_MAX_ARGS; ++i)
+    {
+        record.args[i] = args[i];
+    }
+
+    if (!rbuf_mpsc_push(&s_queue, &record))
+    {
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+    }
+
+    if (s_task != NULL && !atomic_flag_test_and_set(&s_pending))
+    {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+/**
+ * Print everything queued so far. Only called from the drain task, or before it is started.
+*/
+void dlg_flush()
+{
+    dlg_record record;
+    while (rbuf_mpsc_pop(&s_queue, &record))
+    {
+        print_record(&record);
+    }
+
+    unsigned dropped = atomic_exchange_explicit(&s_dropped, 0, memory_order_relaxed);
+    if (dropped > 0)
+    {
+        ESP_LOGW(LOG_TAG, "%u records dropped, raise DLG_QUEUE_SIZE", dropped);
+    }
+}
+
+size_t dlg_static_size()
+{
+    size_t size = sizeof(s_records) + sizeof(s_record_seqs);
+#if PRJ_STATIC_ALLOC
+    size += sizeof(s_task_stack) + sizeof(s_task_tcb);
+#endif
+    return size;
+}
+
+static void drain_task(void* params)
+{
+    // Records queued before the task started.
+    dlg_flush();
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vTaskDelay(DLG_DRAIN_MS / portTICK_PERIOD_MS);
+
+        // Cleared first, so a record written during the flush wakes the task again.
+        atomic_flag_clear(&s_pending);
+        dlg_flush();
+    }
+}
+
+/**
+ * Format a record and print it at its level. Unused arguments are passed as 0, which printf ignores.
+*/
+static void print_record(const dlg_record* record)
+{
+    char text[DLG_LINE_SIZE];
+    const uintptr_t* a = record->args;
+
+    snprintf(text, sizeof(text), record->format, a[0], a[1], a[2], a[3]);
+
+    ESP_LOG_LEVEL((esp_log_level_t)record->level, record->tag, "(%" PRIu32 ") %s", record->time_ms, text);
+}
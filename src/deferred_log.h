@@ -0,0 +1,64 @@
+/**
+ * Deferred logging, for logs on hot paths. A record is the format string's address (its id), the tag and up to
+ * DLG_MAX_ARGS raw arguments, queued without locks or formatting. A low priority task formats and prints the records
+ * later through the ESP log, stamped with the time they were logged. The first record after a print wakes the task,
+ * which waits DLG_DRAIN_MS to print the records in a batch; with nothing logged it doesn't run.
+ *
+ * Arguments are stored as uintptr_t, so only integers up to 32 bits and pointers fit; no 64 bit integers or floats.
+ * Strings are printed later, so %s may only take static strings (literals, names from a table), wrapped in DLG_STR.
+ *
+ * Each module picks its level at compile time: define DLG_LEVEL before the macros are used, from its DLG_LEVEL_
+ * setting in prj_config.h. Records above the level compile to nothing, arguments included.
+*/
+#ifndef _WA_DEFERRED_LOG_H_INCLUDE_GUARD
+#define _WA_DEFERRED_LOG_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_log.h>
+
+#define DLG_OK 0
+#define DLG_FAIL 1
+
+#define DLG_MAX_ARGS 4
+
+typedef struct dlg_record
+{
+    uint32_t time_ms;
+    uint8_t level;
+    uint8_t argc;
+    const char* tag;
+    const char* format;
+    uintptr_t args[DLG_MAX_ARGS];
+} dlg_record;
+
+#define DLG_STR(s) ((uintptr_t)(const char*)(s))
+
+#define DLG_LOG(level, tag, format, ...) do                                                 \
+    {                                                                                       \
+        if ((level) <= DLG_LEVEL)                                                           \
+        {                                                                                   \
+            const uintptr_t dlg_args_[] = { 0, ##__VA_ARGS__ };                             \
+            _Static_assert(sizeof(dlg_args_) / sizeof(uintptr_t) - 1 <= DLG_MAX_ARGS,       \
+                "Too many deferred log arguments");                                         \
+            dlg_write((level), (tag), (format), dlg_args_ + 1,                              \
+                sizeof(dlg_args_) / sizeof(uintptr_t) - 1);                                 \
+        }                                                                                   \
+    } while (0)
+
+#define DLG_LOGE(tag, format, ...) DLG_LOG(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define DLG_LOGW(tag, format, ...) DLG_LOG(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define DLG_LOGI(tag, format, ...) DLG_LOG(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLG_LOGD(tag, format, ...) DLG_LOG(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+void dlg_init();
+
+int dlg_start();
+
+void dlg_write(esp_log_level_t level, const char* tag, const char* format, const uintptr_t* args, size_t argc);
+
+void dlg_flush();
+
+size_t dlg_static_size();
+
+#endif // _WA_DEFERRED_LOG_H_INCLUDE_GUARD
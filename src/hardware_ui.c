@@ -1,6 +1,6 @@
 #include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
 #include <driver/gpio.h>
+#include <esp_timer.h>
 #include <esp_log.h>
 
 #include "hardware_ui.h"
@@ -8,9 +8,65 @@
 
 #define LOG_TAG "hui"
 
-// Need to convert milliseconds to RTOS ticks.
-#define IRL_BLINK_PERIOD_SHORT (HUI_BLINK_PERIOD_SHORT_MS / portTICK_PERIOD_MS)
-#define IRL_BLINK_PERIOD_LONG (HUI_BLINK_PERIOD_LONG_MS / portTICK_PERIOD_MS)
+// A pattern is a list of step durations that alternate LED on, LED off, starting with on. A pattern with one step
+// keeps the LED on.
+typedef struct hui_pattern_def
+{
+    const uint16_t* steps_ms;
+    int step_count;
+} hui_pattern_def;
+
+// Two quick blinks, then one long pause.
+static const uint16_t s_idle_steps[] = {
+    HUI_BLINK_PERIOD_SHORT_MS,
+    HUI_BLINK_PERIOD_SHORT_MS,
+    HUI_BLINK_PERIOD_SHORT_MS,
+    HUI_BLINK_PERIOD_SHORT_MS + HUI_BLINK_PERIOD_LONG_MS
+};
+
+// One short blink per second.
+static const uint16_t s_client_steps[] = {
+    HUI_BLINK_PERIOD_SHORT_MS,
+    HUI_BLINK_PERIOD_LONG_MS - HUI_BLINK_PERIOD_SHORT_MS
+};
+
+// Three fast blinks, then one long pause.
+static const uint16_t s_alert_steps[] = {
+    HUI_BLINK_PERIOD_FAST_MS,
+    HUI_BLINK_PERIOD_FAST_MS,
+    HUI_BLINK_PERIOD_FAST_MS,
+    HUI_BLINK_PERIOD_FAST_MS,
+    HUI_BLINK_PERIOD_FAST_MS,
+    HUI_BLINK_PERIOD_LONG_MS
+};
+
+// Fast, even blinking.
+static const uint16_t s_sensor_fail_steps[] = { HUI_BLINK_PERIOD_FAST_MS, HUI_BLINK_PERIOD_FAST_MS };
+
+// Solid on.
+static const uint16_t s_overload_steps[] = { HUI_BLINK_PERIOD_LONG_MS };
+
+// Indexed by hui_pattern.
+static const hui_pattern_def s_patterns[HUI_PATTERN_COUNT] = {
+    { s_idle_steps, sizeof(s_idle_steps) / sizeof(s_idle_steps[0]) },
+    { s_client_steps, sizeof(s_client_steps) / sizeof(s_client_steps[0]) },
+    { s_alert_steps, sizeof(s_alert_steps) / sizeof(s_alert_steps[0]) },
+    { s_sensor_fail_steps, sizeof(s_sensor_fail_steps) / sizeof(s_sensor_fail_steps[0]) },
+    { s_overload_steps, sizeof(s_overload_steps) / sizeof(s_overload_steps[0]) },
+};
+
+static portMUX_TYPE s_pattern_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Bit mask of active patterns. Idle is always active so there is always something to show.
+static uint32_t s_active_patterns = 1 << HUI_PATTERN_IDLE;
+
+// Only touched by the timer callback.
+static esp_timer_handle_t s_step_timer = NULL;
+static hui_pattern s_shown_pattern = HUI_PATTERN_IDLE;
+static int s_step = 0;
+
+static void step_timer_callback(void* arg);
+static hui_pattern highest_active_pattern();
 
 /**
  * Initialize the hardware interface.
@@ -23,11 +79,34 @@ int hui_init()
 
     io_config.intr_type = GPIO_INTR_DISABLE;
     io_config.mode = GPIO_MODE_OUTPUT;
-    io_config.pin_bit_mask = (1 << HW_PIN_BLINKY);
+    io_config.pin_bit_mask = (1ULL << HW_PIN_BLINKY);
     io_config.pull_down_en = GPIO_PULLDOWN_DISABLE;
     io_config.pull_up_en = GPIO_PULLUP_DISABLE;
 
     esp_err_t rc = gpio_config(&io_config);
+    if (rc != ESP_OK)
+    {
+        return HUI_FAIL;
+    }
+
+    // The pattern is stepped by a one shot timer instead of a task. Each step arms the timer for the next one.
+    esp_timer_create_args_t timer_args = {
+        .callback = step_timer_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "hui_step",
+        .skip_unhandled_events = true
+    };
+
+    rc = esp_timer_create(&timer_args, &s_step_timer);
+    if (rc != ESP_OK)
+    {
+        return HUI_FAIL;
+    }
+
+    // Run the first step right away.
+    s_step = -1;
+    rc = esp_timer_start_once(s_step_timer, 0);
 
     if (rc == ESP_OK)
     {
@@ -40,24 +119,64 @@ int hui_init()
 }
 
 /**
- * Task for updating the hardware user interface.
+ * Turn a status pattern on or off. Thread safe. A new pattern starts on the next step of the current one.
+*/
+void hui_set_pattern(hui_pattern pattern, bool active)
+{
+    // Idle can't be turned off.
+    if (pattern <= HUI_PATTERN_IDLE || pattern >= HUI_PATTERN_COUNT)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_pattern_mux);
+    if (active)
+    {
+        s_active_patterns |= (1 << pattern);
+    }
+    else
+    {
+        s_active_patterns &= ~(1 << pattern);
+    }
+    portEXIT_CRITICAL(&s_pattern_mux);
+}
+
+/**
+ * Set the LED for the next step of the pattern and arm the timer for the step after that.
 */
-void hui_main_task(void* params)
+static void step_timer_callback(void* arg)
 {
-    // Infinite blink loop.
-    for(;;)
-    {
-        // Two quick blinks.
-        gpio_set_level(GPIO_NUM_13, 1);
-        vTaskDelay(IRL_BLINK_PERIOD_SHORT);
-        gpio_set_level(GPIO_NUM_13, 0);
-        vTaskDelay(IRL_BLINK_PERIOD_SHORT);
-        gpio_set_level(GPIO_NUM_13, 1);
-        vTaskDelay(IRL_BLINK_PERIOD_SHORT);
-        gpio_set_level(GPIO_NUM_13, 0);
-        vTaskDelay(IRL_BLINK_PERIOD_SHORT); // This line makes it consistent interval.
-
-        // One long pause period between.
-        vTaskDelay(IRL_BLINK_PERIOD_LONG);
-    }   
+    hui_pattern pattern = highest_active_pattern();
+
+    // Restart at the first step when the pattern changes so new patterns are not shown out of phase.
+    if (pattern != s_shown_pattern)
+    {
+        s_shown_pattern = pattern;
+        s_step = -1;
+    }
+
+    const hui_pattern_def* def = &s_patterns[s_shown_pattern];
+    s_step = (s_step + 1) % def->step_count;
+
+    // Even steps are on, odd steps are off. A single step pattern is always on.
+    gpio_set_level(HW_PIN_BLINKY, (s_step % 2) == 0 ? 1 : 0);
+
+    esp_timer_start_once(s_step_timer, (uint64_t)def->steps_ms[s_step] * 1000);
+}
+
+static hui_pattern highest_active_pattern()
+{
+    portENTER_CRITICAL(&s_pattern_mux);
+    uint32_t active = s_active_patterns;
+    portEXIT_CRITICAL(&s_pattern_mux);
+
+    for (int i = HUI_PATTERN_COUNT - 1; i > HUI_PATTERN_IDLE; --i)
+    {
+        if (active & (1 << i))
+        {
+            return (hui_pattern)i;
+        }
+    }
+
+    return HUI_PATTERN_IDLE;
 }
@@ -4,11 +4,26 @@
 #ifndef _WA_HARDWARE_UI_H_INCLUDE_GUARD
 #define _WA_HARDWARE_UI_H_INCLUDE_GUARD
 
+#include <stdbool.h>
+
 #define HUI_OK 0
 #define HUI_FAIL 1
 
+/**
+ * Status LED patterns. When more than one is active, the highest one is shown.
+*/
+typedef enum hui_pattern
+{
+    HUI_PATTERN_IDLE,
+    HUI_PATTERN_CLIENT_CONNECTED,
+    HUI_PATTERN_ALERT,
+    HUI_PATTERN_SENSOR_FAIL,
+    HUI_PATTERN_OVERLOAD,
+    HUI_PATTERN_COUNT
+} hui_pattern;
+
 int hui_init();
 
-void hui_main_task(void* params);
+void hui_set_pattern(hui_pattern pattern, bool active);
 
 #endif // _WA_HARDWARE_UI_H_INCLUDE_GUARD
@@ -1,65 +1,216 @@
 #include "hw_mcp9808.h"
 
-#include <freertos/portmacro.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <driver/i2c.h>
+#include <driver/gpio.h>
+#include <esp_rom_sys.h>
 #include <esp_log.h>
 
 #include "prj_config.h"
+#include "deferred_log.h"
 
 #define LOG_TAG "mcp9808"
+#define DLG_LEVEL DLG_LEVEL_MCP9808
 
-#define MCP9808_I2C_TIMEOUT (100 / portTICK_PERIOD_MS)
+// The longest transfer, four bytes at the slowest clock rate, takes about 4 ms.
+#define MCP9808_I2C_TIMEOUT (20 / portTICK_PERIOD_MS)
+#define MCP9808_BUS_WAIT    (1000 / portTICK_PERIOD_MS)
 #define MCP9808_SLAVE_ADDR  0x18
 #define MCP9808_TEMPR_CMD   0x05
 
+#define MCP9808_CONFIG_CMD  0x01
+#define MCP9808_UPPER_CMD   0x02
+#define MCP9808_LOWER_CMD   0x03
+#define MCP9808_CRIT_CMD    0x04
+
+// Config register: alert output enabled, comparator mode, active low, both limits.
+#define MCP9808_CONFIG_ALERT_ON     0x0008
+#define MCP9808_CONFIG_HYST_SHIFT   9
+
+// Limit registers hold 0.25 C steps in bits 12..2. The widest limits turn a side off.
+#define MCP9808_LIMIT_MAX   0x0FFC
+#define MCP9808_LIMIT_MIN   0x1000
+
 #define MCP9808_MANU_CMD    0x06
 #define MCP9808_ID_CMD      0x07
 
+#define I2C_MASTER_TX_BUF_DISABLE   0
+#define I2C_MASTER_RX_BUF_DISABLE   0
+
+// Bus recovery: a sensor stuck mid-byte lets go of SDA within nine clocks. Half a clock period at 100 kHz.
+#define RECOVERY_CLOCKS     9
+#define RECOVERY_HALF_US    5
+
+// Serializes bus access between the sensor task and web handlers, and keeps transfers out while the driver is being
+// reinstalled.
+static SemaphoreHandle_t s_bus_mutex = NULL;
+#if PRJ_STATIC_ALLOC
+static StaticSemaphore_t s_bus_mutex_buffer;
+#endif
+
+static bool s_driver_installed = false;
+static uint32_t s_freq_hz = I2C_MASTER_FREQ_HZ;
+
+// Set when a transfer times out. Until bus recovery clears it, transfers fail at once instead of each holding the bus
+// lock for a timeout, so the sensor task gets the lock in time to recover.
+static bool s_bus_hung = false;
+
 static int16_t mcp9808_convert(uint8_t msb, uint8_t lsb);
+static esp_err_t install_driver(uint32_t freq_hz);
+static int bus_write_read(uint8_t cmd, uint8_t* read_buffer, size_t read_size, TickType_t budget);
+static esp_err_t bus_write_u16(uint8_t cmd, uint16_t value);
+static uint16_t mcp9808_limit(int32_t faren);
+static uint16_t mcp9808_hyst_bits(int32_t faren_delta);
+
+/**
+ * Install the I2C driver at the given clock rate. If the driver is already installed it is reinstalled, which is how
+ * a new clock rate is applied at runtime.
+*/
+int hw_mcp9808_bus_init(uint32_t freq_hz)
+{
+    if (s_bus_mutex == NULL)
+    {
+#if PRJ_STATIC_ALLOC
+        s_bus_mutex = xSemaphoreCreateMutexStatic(&s_bus_mutex_buffer);
+#else
+        s_bus_mutex = xSemaphoreCreateMutex();
+#endif
+        if (s_bus_mutex == NULL)
+        {
+            return HW_MCP9808_FAIL;
+        }
+    }
+
+    if (xSemaphoreTake(s_bus_mutex, MCP9808_BUS_WAIT) == pdFALSE)
+    {
+        return HW_MCP9808_FAIL;
+    }
+
+    if (s_driver_installed)
+    {
+        i2c_driver_delete(I2C_MASTER_NUM);
+        s_driver_installed = false;
+    }
+
+    s_freq_hz = freq_hz;
+    esp_err_t rc = install_driver(freq_hz);
+
+    // Must give back lock!
+    xSemaphoreGive(s_bus_mutex);
+
+    ESP_LOGI(LOG_TAG, "I2C bus at %u Hz, rc: %d", freq_hz, rc);
+
+    return rc == ESP_OK ? HW_MCP9808_OK : HW_MCP9808_FAIL;
+}
 
 /**
  * Read the temperature from the MCP9808 sensor. Returns temperature in hundredths of degrees (xxx.xx).
+ *
+ * Waiting for the bus and the transfer together take at most budget_ms (at least a tick). Returns why on failure: busy,
+ * timeout, NACK or no driver.
  * 
  * This assumes i2c drivers were initialized.
 */
-int hw_mcp9808_read_temp(int16_t* tempr)
+int hw_mcp9808_read_temp(int16_t* tempr, uint32_t budget_ms)
 {
     if (!tempr)
     {
         return HW_MCP9808_FAIL;
     }
 
-    int retval = HW_MCP9808_OK;
     *tempr = HW_MCP9808_NO_VALUE;
 
-    uint8_t write_buffer[1] = {MCP9808_TEMPR_CMD};
     uint8_t read_buffer[2] = {0, 0};
+    TickType_t budget = budget_ms / portTICK_PERIOD_MS;
 
-    esp_err_t i2c_rc = i2c_master_write_read_device(
-        I2C_MASTER_NUM,
-        MCP9808_SLAVE_ADDR,
-        write_buffer,
-        sizeof(write_buffer),
-        read_buffer,
-        sizeof(read_buffer),
-        MCP9808_I2C_TIMEOUT);
+    int retval = bus_write_read(MCP9808_TEMPR_CMD, read_buffer, sizeof(read_buffer), budget > 0 ? budget : 1);
 
-    ESP_LOGI(LOG_TAG, "rc read/write rc: %u (%u, %u)", i2c_rc, read_buffer[0], read_buffer[1]);
+    DLG_LOGD(LOG_TAG, "rc read/write rc: %d (%u, %u)", retval, read_buffer[0], read_buffer[1]);
 
-    if (i2c_rc == ESP_OK)
+    if (retval == HW_MCP9808_OK)
     {
         *tempr = mcp9808_convert(read_buffer[0], read_buffer[1]);
-        ESP_LOGI(LOG_TAG, "Temp read: %d", *tempr);
+        DLG_LOGD(LOG_TAG, "Temp read: %d", *tempr);
     }
     else
     {
-        retval = HW_MCP9808_FAIL;
-        ESP_LOGI(LOG_TAG, "Temp reading failed");
+        DLG_LOGD(LOG_TAG, "Temp reading failed");
     }
 
     return retval;
 }
 
+/**
+ * Free a bus a sensor is holding. A reset or glitch in the middle of a read can leave the sensor driving SDA low,
+ * waiting for clocks to finish its byte, and then every transfer times out. The driver is removed, SCL clocked by
+ * hand until SDA is released (at most nine times), a STOP sent, and the driver installed again at the same rate.
+ * Takes about 0.1 ms. Returns HW_MCP9808_STUCK if SDA is still low.
+*/
+int hw_mcp9808_recover_bus()
+{
+    if (s_bus_mutex == NULL || xSemaphoreTake(s_bus_mutex, MCP9808_BUS_WAIT) == pdFALSE)
+    {
+        return HW_MCP9808_BUSY;
+    }
+
+    if (s_driver_installed)
+    {
+        i2c_driver_delete(I2C_MASTER_NUM);
+        s_driver_installed = false;
+    }
+
+    // Both open drain, so reading a pin gives the bus level.
+    gpio_config_t pins = {
+        .pin_bit_mask = (1ULL << I2C_MASTER_SCL_IO) | (1ULL << I2C_MASTER_SDA_IO),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    gpio_config(&pins);
+    gpio_set_level(I2C_MASTER_SDA_IO, 1);
+    gpio_set_level(I2C_MASTER_SCL_IO, 1);
+    esp_rom_delay_us(RECOVERY_HALF_US);
+
+    int clocks = 0;
+    for (; clocks < RECOVERY_CLOCKS && gpio_get_level(I2C_MASTER_SDA_IO) == 0; ++clocks)
+    {
+        gpio_set_level(I2C_MASTER_SCL_IO, 0);
+        esp_rom_delay_us(RECOVERY_HALF_US);
+        gpio_set_level(I2C_MASTER_SCL_IO, 1);
+        esp_rom_delay_us(RECOVERY_HALF_US);
+    }
+
+    // STOP: SDA rises while SCL is high.
+    gpio_set_level(I2C_MASTER_SCL_IO, 0);
+    gpio_set_level(I2C_MASTER_SDA_IO, 0);
+    esp_rom_delay_us(RECOVERY_HALF_US);
+    gpio_set_level(I2C_MASTER_SCL_IO, 1);
+    esp_rom_delay_us(RECOVERY_HALF_US);
+    gpio_set_level(I2C_MASTER_SDA_IO, 1);
+    esp_rom_delay_us(RECOVERY_HALF_US);
+
+    bool released = gpio_get_level(I2C_MASTER_SDA_IO) != 0;
+    s_bus_hung = !released;
+
+    // Installing the driver routes the pins back to the I2C peripheral.
+    esp_err_t rc = install_driver(s_freq_hz);
+
+    // Must give back lock!
+    xSemaphoreGive(s_bus_mutex);
+
+    DLG_LOGW(LOG_TAG, "Bus recovery: %d clocks, SDA %s, rc: %d", clocks, DLG_STR(released ? "released" : "stuck"),
+        rc);
+
+    if (rc != ESP_OK)
+    {
+        return HW_MCP9808_NO_DRIVER;
+    }
+
+    return released ? HW_MCP9808_OK : HW_MCP9808_STUCK;
+}
+
 /**
  * Read device information from the MCP9808 sensor.
  * 
@@ -77,37 +228,20 @@ int hw_mcp9808_read_device_info(hw_mcp9808_dinfo* info)
     info->device_revision = 0;
 
     // Manufacturer ID.
-    uint8_t write_buffer[1] = {MCP9808_MANU_CMD};
     uint8_t read_buffer[2] = {0, 0};
 
-    esp_err_t rc = i2c_master_write_read_device(
-        I2C_MASTER_NUM,
-        MCP9808_SLAVE_ADDR,
-        write_buffer,
-        sizeof(write_buffer),
-        read_buffer,
-        sizeof(read_buffer),
-        MCP9808_I2C_TIMEOUT);
+    int rc = bus_write_read(MCP9808_MANU_CMD, read_buffer, sizeof(read_buffer), MCP9808_BUS_WAIT);
 
-    if (rc == ESP_OK)
+    if (rc == HW_MCP9808_OK)
     {
         // Big endian.
         info->manufacturer_id = (read_buffer[0] << 8) | read_buffer[1];
     }
 
     // Device ID and Revision.
-    write_buffer[0] = MCP9808_ID_CMD;
-
-    rc = i2c_master_write_read_device(
-        I2C_MASTER_NUM,
-        MCP9808_SLAVE_ADDR,
-        write_buffer,
-        sizeof(write_buffer),
-        read_buffer,
-        sizeof(read_buffer),
-        MCP9808_I2C_TIMEOUT);
+    rc = bus_write_read(MCP9808_ID_CMD, read_buffer, sizeof(read_buffer), MCP9808_BUS_WAIT);
 
-    if (rc == ESP_OK)
+    if (rc == HW_MCP9808_OK)
     {
         info->device_id = read_buffer[0];
         info->device_revision = read_buffer[1];
@@ -116,6 +250,219 @@ int hw_mcp9808_read_device_info(hw_mcp9808_dinfo* info)
     return HW_MCP9808_OK;
 }
 
+/**
+ * Set the sensor's alert limits and enable its alert pin (comparator mode, active low). The sensor applies its
+ * hysteresis only when leaving the upper limit, in steps of 0, 1.5, 3 or 6 C; the nearest step below is used.
+ *
+ * This assumes i2c drivers were initialized.
+*/
+int hw_mcp9808_set_alert(const hw_mcp9808_alert* alert)
+{
+    if (!alert)
+    {
+        return HW_MCP9808_FAIL;
+    }
+
+    uint16_t config = 0;
+    if (alert->upper_on || alert->lower_on)
+    {
+        config = MCP9808_CONFIG_ALERT_ON | mcp9808_hyst_bits(alert->hysteresis);
+    }
+
+    uint16_t upper = alert->upper_on ? mcp9808_limit(alert->upper) : MCP9808_LIMIT_MAX;
+    uint16_t lower = alert->lower_on ? mcp9808_limit(alert->lower) : MCP9808_LIMIT_MIN;
+
+    // Limits are written with the alert pin off so it can't trip on a half written pair.
+    esp_err_t rc = bus_write_u16(MCP9808_CONFIG_CMD, 0);
+    if (rc == ESP_OK)
+    {
+        rc = bus_write_u16(MCP9808_UPPER_CMD, upper);
+    }
+    if (rc == ESP_OK)
+    {
+        rc = bus_write_u16(MCP9808_LOWER_CMD, lower);
+    }
+    // The pin also asserts at or above the critical limit whatever the others say, and it powers up at 0 C.
+    if (rc == ESP_OK)
+    {
+        rc = bus_write_u16(MCP9808_CRIT_CMD, MCP9808_LIMIT_MAX);
+    }
+    if (rc == ESP_OK)
+    {
+        rc = bus_write_u16(MCP9808_CONFIG_CMD, config);
+    }
+
+    ESP_LOGI(LOG_TAG, "Alert limits 0x%04x/0x%04x, config 0x%04x, rc: %d", upper, lower, config, rc);
+
+    return rc == ESP_OK ? HW_MCP9808_OK : HW_MCP9808_FAIL;
+}
+
+/**
+ * Configure the pins and install the driver. The caller holds the bus lock.
+*/
+static esp_err_t install_driver(uint32_t freq_hz)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_MASTER_SDA_IO,
+        .scl_io_num = I2C_MASTER_SCL_IO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = freq_hz
+    };
+
+    esp_err_t rc = i2c_param_config(I2C_MASTER_NUM, &conf);
+    if (rc == ESP_OK)
+    {
+        rc = i2c_driver_install(I2C_MASTER_NUM, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 0);
+    }
+
+    s_driver_installed = rc == ESP_OK;
+
+    return rc;
+}
+
+/**
+ * Write a register pointer and read the register back, holding the bus lock. Waiting for the lock and the transfer
+ * share the budget; the transfer gets at least a tick and at most MCP9808_I2C_TIMEOUT.
+*/
+static int bus_write_read(uint8_t cmd, uint8_t* read_buffer, size_t read_size, TickType_t budget)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    if (s_bus_mutex == NULL || xSemaphoreTake(s_bus_mutex, budget) == pdFALSE)
+    {
+        return HW_MCP9808_BUSY;
+    }
+
+    TickType_t waited = xTaskGetTickCount() - start;
+    TickType_t timeout = waited < budget ? budget - waited : 1;
+    if (timeout > MCP9808_I2C_TIMEOUT)
+    {
+        timeout = MCP9808_I2C_TIMEOUT;
+    }
+
+    esp_err_t rc = ESP_ERR_INVALID_STATE;
+    if (s_bus_hung)
+    {
+        rc = ESP_ERR_TIMEOUT;
+    }
+    else if (s_driver_installed)
+    {
+        uint8_t write_buffer[1] = {cmd};
+
+        rc = i2c_master_write_read_device(
+            I2C_MASTER_NUM,
+            MCP9808_SLAVE_ADDR,
+            write_buffer,
+            sizeof(write_buffer),
+            read_buffer,
+            read_size,
+            timeout);
+
+        s_bus_hung = rc == ESP_ERR_TIMEOUT;
+    }
+
+    // Must give back lock!
+    xSemaphoreGive(s_bus_mutex);
+
+    // The legacy driver reports a missing ACK as ESP_FAIL.
+    switch (rc)
+    {
+    case ESP_OK:
+        return HW_MCP9808_OK;
+    case ESP_ERR_TIMEOUT:
+        return HW_MCP9808_TIMEOUT;
+    case ESP_FAIL:
+        return HW_MCP9808_NACK;
+    case ESP_ERR_INVALID_STATE:
+        return HW_MCP9808_NO_DRIVER;
+    default:
+        return HW_MCP9808_FAIL;
+    }
+}
+
+/**
+ * Write a 16 bit register (big endian), holding the bus lock.
+*/
+static esp_err_t bus_write_u16(uint8_t cmd, uint16_t value)
+{
+    if (s_bus_mutex == NULL || xSemaphoreTake(s_bus_mutex, MCP9808_BUS_WAIT) == pdFALSE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t rc = ESP_ERR_INVALID_STATE;
+    if (s_bus_hung)
+    {
+        rc = ESP_ERR_TIMEOUT;
+    }
+    else if (s_driver_installed)
+    {
+        uint8_t write_buffer[3] = {cmd, (uint8_t)(value >> 8), (uint8_t)value};
+
+        rc = i2c_master_write_to_device(
+            I2C_MASTER_NUM,
+            MCP9808_SLAVE_ADDR,
+            write_buffer,
+            sizeof(write_buffer),
+            MCP9808_I2C_TIMEOUT);
+
+        s_bus_hung = rc == ESP_ERR_TIMEOUT;
+    }
+
+    // Must give back lock!
+    xSemaphoreGive(s_bus_mutex);
+
+    return rc;
+}
+
+/**
+ * Convert hundredths of degrees fahrenheit to a limit register value: 0.25 C steps, 13 bit two's complement in bits
+ * 12..2.
+*/
+static uint16_t mcp9808_limit(int32_t faren)
+{
+    // (F - 32) * 5 / 9 * 4 quarter degrees, with F in hundredths.
+    int32_t quarters = (faren - 3200) / 45;
+
+    if (quarters > 1023)
+    {
+        quarters = 1023;
+    }
+    else if (quarters < -1024)
+    {
+        quarters = -1024;
+    }
+
+    return (uint16_t)(quarters * 4) & 0x1FFC;
+}
+
+/**
+ * Convert a hysteresis in hundredths of degrees fahrenheit to the config register's hysteresis bits.
+*/
+static uint16_t mcp9808_hyst_bits(int32_t faren_delta)
+{
+    // In tenths of a degree C.
+    int32_t tenths_c = faren_delta / 18;
+
+    uint16_t code = 0;
+    if (tenths_c >= 60)
+    {
+        code = 3;
+    }
+    else if (tenths_c >= 30)
+    {
+        code = 2;
+    }
+    else if (tenths_c >= 15)
+    {
+        code = 1;
+    }
+
+    return code << MCP9808_CONFIG_HYST_SHIFT;
+}
+
 /**
     This method doesn't require floating point instructions, which helps with the ESP32 floating point restrictions.
 */
@@ -140,10 +487,10 @@ static int16_t mcp9808_convert(uint8_t msb, uint8_t lsb)
 
     int16_t result = whole + frac;
 
-    // Handle 2s complement conversion.
+    // Handle 2s complement conversion: the 12 bits read as unsigned are 256 C too high.
     if (sign)
     {
-        result = (256 * DEC_MULTI) - result;
+        result = result - (256 * DEC_MULTI);
     }
 
     // Convert Celsius to Fahrenheit.
@@ -5,10 +5,22 @@
 #define _WA_HW_MCP9808_H_INCLUDE_GUARD
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 #define HW_MCP9808_OK 0
 #define HW_MCP9808_FAIL 1
-#define HW_MCP9808_NO_VALUE INT16_MIN;
+// The bus lock wasn't free within the budget.
+#define HW_MCP9808_BUSY 2
+// The transfer ran out of time, e.g. SDA held low by a confused sensor.
+#define HW_MCP9808_TIMEOUT 3
+// The sensor didn't acknowledge.
+#define HW_MCP9808_NACK 4
+// The driver isn't installed (a failed init or reinstall).
+#define HW_MCP9808_NO_DRIVER 5
+// Bus recovery clocked SCL and SDA is still held low.
+#define HW_MCP9808_STUCK 6
+
+#define HW_MCP9808_NO_VALUE INT16_MIN
 
 typedef struct hw_mcp9808_dinfo
 {
@@ -18,8 +30,27 @@ typedef struct hw_mcp9808_dinfo
     
 } hw_mcp9808_dinfo;
 
-int hw_mcp9808_read_temp(int16_t* tempr);
+/**
+ * Alert limits in hundredths of degrees fahrenheit. A limit that is not on is no limit; with neither limit on the
+ * alert pin is turned off.
+*/
+typedef struct hw_mcp9808_alert
+{
+    int32_t upper;
+    int32_t lower;
+    bool upper_on;
+    bool lower_on;
+    int32_t hysteresis;
+} hw_mcp9808_alert;
+
+int hw_mcp9808_bus_init(uint32_t freq_hz);
+
+int hw_mcp9808_read_temp(int16_t* tempr, uint32_t budget_ms);
+
+int hw_mcp9808_recover_bus();
 
 int hw_mcp9808_read_device_info(hw_mcp9808_dinfo* info);
 
+int hw_mcp9808_set_alert(const hw_mcp9808_alert* alert);
+
 #endif // _WA_HW_MCP9808_H_INCLUDE_GUARD
@@ -1,41 +1,68 @@
 // Free RTOS includes
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 
 // ESP32 headers
 #include <esp_log.h>
 #include <esp_system.h>
 #include <nvs_flash.h>
-#include <driver/i2c.h>
 #include <esp_event.h>
 #include <esp_netif.h>
+#include <esp_heap_caps.h>
 
 // Project includes
 #include "hardware_ui.h"
 #include "prj_config.h"
 #include "temp_sensor.h"
 #include "webserver.h"
+#include "task_layout.h"
+#include "bench.h"
+#include "config_store.h"
+#include "hw_mcp9808.h"
+#include "alerts.h"
+#include "boot_timeline.h"
+#include "deferred_log.h"
+#include "reading_log.h"
+#include "telemetry.h"
 
 #define LOG_TAG "main"
 
-#define TASK_PIN_CPU0 0
-#define TASK_PIN_CPU1 1
+#if PRJ_STATIC_ALLOC
+// Task stacks and control blocks. ESP-IDF stack sizes are in bytes, so StackType_t is a byte.
+static StackType_t s_tps_task_stack[TASK_TPS_STACK];
+static StaticTask_t s_tps_task_tcb;
 
-// For I2C initialization. ESP32 specific & RTOS specific.
-#define I2C_MASTER_TIMEOUT_TICKS    (I2C_MASTER_TIMEOUT_MS / portTICK_PERIOD_MS)
-#define I2C_MASTER_TX_BUF_DISABLE   0
-#define I2C_MASTER_RX_BUF_DISABLE   0
+static StaticSemaphore_t s_net_boot_done_buffer;
+#endif
+
+// Given by the network boot task once the SoftAP is up.
+static SemaphoreHandle_t s_net_boot_done = NULL;
 
 static void panic_state();
-static esp_err_t init_esp32_i2c();
+static void start_task(TaskFunction_t task_fn, tl_task_id id, StackType_t* stack, StaticTask_t* tcb);
+static void start_net_boot();
+static void net_boot_task(void* params);
+static void net_boot();
+static void log_static_budget();
 
+/**
+ * Startup. The sensor and the network come up in parallel: Wi-Fi is brought up on a boot task while this task
+ * initializes the sensor and starts sampling, so the first reading does not wait for the radio. The HTTP server is
+ * started once the sensor data it serves is initialized.
+*/
 void app_main()
 {
     int init_rc;
 
+    // Other modules log from their init, so must happen first.
+    dlg_init();
+
+    btl_begin(BTL_STARTUP);
     ESP_LOGI(LOG_TAG, "Project startup");
 
     //Initialize NVS
+    btl_begin(BTL_NVS);
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
     {
@@ -44,15 +71,22 @@ void app_main()
     }
     ESP_ERROR_CHECK(ret);
 
-    // I2C initialization.
-    ESP_ERROR_CHECK(init_esp32_i2c());
+    // Runtime settings are loaded from NVS, so must happen after NVS init and before anything uses them.
+    cfg_init();
+    btl_end(BTL_NVS);
 
-    // Must initialize these once in startup. Must do before other Wifi code!
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    // Benchmark mode picks the task placement for this boot, so must happen before any task is created.
+    bench_init();
 
-    // Project initialization.
+    if (dlg_start() != DLG_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to start the log task, deferred logs will not be printed");
+    }
+
+    // The Wi-Fi event handler sets LED patterns, so must happen before Wi-Fi starts.
+    btl_begin(BTL_HUI);
     init_rc = hui_init();
+    btl_end(BTL_HUI);
     if (init_rc != HUI_OK)
     {
         ESP_LOGI(LOG_TAG, "HUI failed");
@@ -60,7 +94,28 @@ void app_main()
         return;
     }
 
+    // Must initialize these once in startup. Must do before other Wifi code!
+    btl_begin(BTL_NETIF);
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    btl_end(BTL_NETIF);
+
+    // Initialize SoftAP, in parallel with the rest.
+    start_net_boot();
+
+    // I2C initialization.
+    btl_begin(BTL_I2C);
+    init_rc = hw_mcp9808_bus_init(cfg_get_u32(CFG_I2C_FREQ_HZ));
+    btl_end(BTL_I2C);
+    if (init_rc != HW_MCP9808_OK)
+    {
+        ESP_LOGI(LOG_TAG, "I2C init failed");
+        panic_state();
+        return;
+    }
+
     // I2C/temperature initialization
+    btl_begin(BTL_SENSOR);
     init_rc = tps_init();
     if (init_rc != TPS_OK)
     {
@@ -69,46 +124,135 @@ void app_main()
         return;
     }
 
-    // Initialize SoftAP
+    // Alerts subscribe to the sensor's readings and are served by the web server, so must happen before both start.
+    init_rc = alt_init();
+    btl_end(BTL_SENSOR);
+    if (init_rc != ALT_OK)
+    {
+        ESP_LOGI(LOG_TAG, "Alerts failed");
+        panic_state();
+        return;
+    }
+
+    // The reading log subscribes to the readings too. The device works without it, /api/export is just empty.
+    if (rlg_init() != RLG_OK || rlg_start() != RLG_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Reading log failed, readings will not be kept over restarts");
+    }
+
+    // Telemetry is optional too, and off until the settings turn it on.
+    if (tlm_start() != TLM_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Telemetry failed, readings will not be broadcast");
+    }
+
+    // Task kickoff. Sampling starts now, whether or not Wi-Fi is up yet.
+#if PRJ_STATIC_ALLOC
+    start_task(tps_task, TL_TASK_TPS, s_tps_task_stack, &s_tps_task_tcb);
+#else
+    start_task(tps_task, TL_TASK_TPS, NULL, NULL);
+#endif
+
+    // The server only needs the network stack, not the SoftAP; clients can't reach it before the SoftAP is up anyway.
+    btl_begin(BTL_HTTPD);
     wbs_init();
+    btl_end(BTL_HTTPD);
+
+    // Without the semaphore, Wi-Fi was brought up inline in start_net_boot.
+    if (s_net_boot_done != NULL)
+    {
+        xSemaphoreTake(s_net_boot_done, portMAX_DELAY);
+    }
 
-    // Task kickoff
-    TaskHandle_t h_blink_task;
-    xTaskCreatePinnedToCore(hui_main_task, "hui_main_task", HWUI_TASK_STACK, NULL, HWUI_TASK_PRIORITY, &h_blink_task, TASK_PIN_CPU1);
+    tl_log_layout();
+    log_static_budget();
 
-    TaskHandle_t h_tps_task;
-    xTaskCreatePinnedToCore(tps_task, "tps_main_task", 4098, NULL, 2, &h_tps_task, TASK_PIN_CPU1);
+    bench_start();
+
+    btl_end(BTL_STARTUP);
+    btl_log();
 
     ESP_LOGI(LOG_TAG, "Initialization Complete.");
 }
 
 /**
- * Initialize the I2C driver.
+ * Create a task with the placement from the task layout. The stack and TCB are only used for static allocation.
+*/
+static void start_task(TaskFunction_t task_fn, tl_task_id id, StackType_t* stack, StaticTask_t* tcb)
+{
+    const tl_placement* p = tl_get(id);
+
+#if PRJ_STATIC_ALLOC
+    xTaskCreateStaticPinnedToCore(task_fn, p->name, p->stack_size, NULL, p->priority, stack, tcb, p->core);
+#else
+    TaskHandle_t h_task;
+    xTaskCreatePinnedToCore(task_fn, p->name, p->stack_size, NULL, p->priority, &h_task, p->core);
+#endif
+}
+
+/**
+ * Start the task that brings up the SoftAP. It runs once and deletes itself, so its stack comes from the heap even
+ * with static allocation, and is given back before startup finishes.
 */
-static esp_err_t init_esp32_i2c()
+static void start_net_boot()
 {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ
-    };
-
-    esp_err_t rc = i2c_param_config(I2C_MASTER_NUM, &conf);
-    if (rc != ESP_OK)
+#if PRJ_STATIC_ALLOC
+    s_net_boot_done = xSemaphoreCreateBinaryStatic(&s_net_boot_done_buffer);
+#else
+    s_net_boot_done = xSemaphoreCreateBinary();
+#endif
+
+    TaskHandle_t h_task;
+    if (s_net_boot_done == NULL || xTaskCreatePinnedToCore(net_boot_task, "net_boot", TASK_NET_BOOT_STACK, NULL,
+        TASK_NET_BOOT_PRIORITY, &h_task, TASK_NET_BOOT_CORE) != pdPASS)
     {
-        return rc;
+        // Startup must not wait on a task that doesn't exist. Bringing Wi-Fi up here is slower, but startup finishes.
+        ESP_LOGW(LOG_TAG, "Failed to start the net boot task, starting Wi-Fi inline");
+        net_boot();
     }
+}
+
+static void net_boot_task(void* params)
+{
+    net_boot();
+    vTaskDelete(NULL);
+}
+
+/**
+ * Bring up the SoftAP and signal app_main, if it is waiting.
+*/
+static void net_boot()
+{
+    btl_begin(BTL_WIFI);
+    wbs_start_wifi();
+    btl_end(BTL_WIFI);
 
-    rc = i2c_driver_install(I2C_MASTER_NUM, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 0);
-    if (rc != ESP_OK)
+    if (s_net_boot_done != NULL)
     {
-        return rc;
+        xSemaphoreGive(s_net_boot_done);
     }
+}
+
+/**
+ * Log how much RAM the project reserved statically, and how much heap is left after startup.
+*/
+static void log_static_budget()
+{
+    size_t task_size = 0;
+#if PRJ_STATIC_ALLOC
+    task_size = sizeof(s_tps_task_stack) + sizeof(s_tps_task_tcb) + sizeof(s_net_boot_done_buffer);
+#endif
+    size_t tps_size = tps_static_size();
+    size_t wbs_size = wbs_static_size();
+    size_t alt_size = alt_static_size();
+    size_t dlg_size = dlg_static_size();
+    size_t rlg_size = rlg_static_size();
+    size_t tlm_size = tlm_static_size();
 
-    return rc;
+    ESP_LOGI(LOG_TAG, "Static RAM budget: tasks %u, tps %u, wbs %u, alt %u, dlg %u, rlg %u, tlm %u, total %u bytes",
+        task_size, tps_size, wbs_size, alt_size, dlg_size, rlg_size, tlm_size,
+        task_size + tps_size + wbs_size + alt_size + dlg_size + rlg_size + tlm_size);
+    ESP_LOGI(LOG_TAG, "Heap free after startup: %u bytes", heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
 }
 
 static void panic_state()
@@ -4,26 +4,231 @@
 #ifndef _WA_PRJ_CONFIG_H_INCLUDE_GUARD
 #define _WA_PRJ_CONFIG_H_INCLUDE_GUARD
 
+// Create all tasks, mutexes and page buffers from static memory instead of the heap. Set to 0 with a build flag
+// (-DPRJ_STATIC_ALLOC=0) to go back to dynamic allocation.
+#ifndef PRJ_STATIC_ALLOC
+#define PRJ_STATIC_ALLOC 1
+#endif
+
+// Benchmark mode: boots once per task placement preset in bench.c, measuring sensor poll jitter and HTTP latency under
+// a synthetic request load. Enable with a build flag (-DPRJ_BENCHMARK_MODE=1).
+#ifndef PRJ_BENCHMARK_MODE
+#define PRJ_BENCHMARK_MODE 0
+#endif
+
 // Hardware I2C configuration.
 #define I2C_MASTER_SCL_IO           22
 #define I2C_MASTER_SDA_IO           23
 #define I2C_MASTER_NUM              0
 #define I2C_MASTER_FREQ_HZ          400000
+#define I2C_MASTER_FREQ_MIN_HZ      10000
+#define I2C_MASTER_FREQ_MAX_HZ      400000
 #define I2C_MASTER_TIMEOUT_MS       1000
 
+// Sensor reads: each attempt gets TPS_READ_ATTEMPT_MS for the bus lock and the transfer together, and failed attempts
+// are retried after a backoff that doubles. A timeout frees the bus (SCL clocked by hand) before the next attempt. The
+// worst case, about 90 ms, stays under the fastest poll rate so a stuck bus doesn't stretch the polling.
+#define TPS_READ_ATTEMPT_MS 20
+#define TPS_READ_ATTEMPTS 3
+#define TPS_READ_BACKOFF_MS 10
+
+// Deferred logging: records queued for the log task (must be a power of two, 32 bytes each), how long it gathers
+// records before printing them (ms), and the longest line it formats.
+#define DLG_QUEUE_SIZE 64
+#define DLG_DRAIN_MS 250
+#define DLG_LINE_SIZE 128
+
+// Deferred log level of each module (ESP_LOG_NONE to ESP_LOG_DEBUG). Records above it are compiled out. The sensor's
+// per-read logs are debug, so only bus recovery is kept.
+#define DLG_LEVEL_MCP9808 ESP_LOG_WARN
+#define DLG_LEVEL_WEBS ESP_LOG_INFO
+#define DLG_LEVEL_ALERTS ESP_LOG_INFO
+
 // Hardware User Interface
 #define HUI_BLINK_PERIOD_LONG_MS 1000
 #define HUI_BLINK_PERIOD_SHORT_MS 250
+#define HUI_BLINK_PERIOD_FAST_MS 100
 
 #define HW_PIN_BLINKY 13
-#define HWUI_TASK_STACK 1024
-#define HWUI_TASK_PRIORITY 1
 
 // Interval for polling temperature sensor (milliseconds).
 #define TPS_POLL_RATE_MS 60000
 
-// Default WiFi SoftAP name and password
+// Limits for the poll rate setting (milliseconds). Samples are timestamped in whole seconds, so no faster than one a
+// second.
+#define TPS_POLL_RATE_MIN_MS 1000
+#define TPS_POLL_RATE_MAX_MS 3600000
+
+// History is kept in a fixed arena of readings. The history size setting picks how much of it is used.
+#define TPS_HIST_ARENA_SIZE 256
+#define TPS_HIST_DEFAULT_SIZE 10
+
+// Long term history, compressed in blocks of TSR_BLOCK_DATA_SIZE + 24 bytes. Readings one minute apart take about 1.5
+// bytes each, so 16 blocks (2 KB) hold about a day.
+#define TPS_DEEP_HIST_BLOCKS 16
+
+// Percentile windows (seconds). Percentiles are estimated as readings arrive, in about 250 bytes per window.
+#define TPS_QNT_HOUR_S 3600
+#define TPS_QNT_DAY_S 86400
+
+// Trend: Holt smoothing factors (thousandths) and how far ahead the forecast is (seconds). The least-squares slope is
+// over the history ring.
+#define TPS_HOLT_ALPHA 200
+#define TPS_HOLT_BETA 50
+#define TPS_FORECAST_S 3600
+
+// Reading bus: how many consumers can subscribe to readings as they are taken.
+#define TPS_BUS_SUBSCRIBERS 6
+
+// Reading log: good readings are kept in the "readings" flash partition (partitions.csv), which holds about 65000
+// readings (45 days at one a minute) before the oldest are erased. RLG_QUEUE_SIZE readings can wait on the bus while
+// the log task erases a sector (about 50 ms).
+#define RLG_PARTITION_LABEL "readings"
+#define RLG_QUEUE_SIZE 8
+
+// Telemetry: each reading is also sent as one UDP datagram (layout in lib/utils/telemetry_packet.h) to every listener
+// on the SoftAP network, so passive monitors cost a packet per reading instead of HTTP connections. The tlm_mode
+// setting turns it off (0, the default), sends to the broadcast address (1) or to TLM_MULTICAST_GROUP (2); tlm_port
+// sets the port.
+#define TLM_MODE_OFF 0
+#define TLM_MODE_BROADCAST 1
+#define TLM_MODE_MULTICAST 2
+#define TLM_DEFAULT_PORT 47800
+#define TLM_PORT_MIN 1024
+#define TLM_MULTICAST_GROUP "239.255.78.84"
+#define TLM_QUEUE_SIZE 4
+
+// Alerts. Thresholds are set on the config page in hundredths of degrees fahrenheit (rate in hundredths per minute).
+// The high and low rules have their own on settings, so any temperature the sensor reads can be a threshold; a rate
+// of 0 turns the rate rule off. ALT_TEMP_MIN is the MCP9808's lowest reading, -40 F (-40 C).
+#define ALT_TEMP_MIN -4000
+#define ALT_TEMP_MAX 50000
+#define ALT_HYST_MAX 2000
+#define ALT_HYST_DEFAULT 100
+#define ALT_MIN_DURATION_MAX_S 86400
+
+// Alert events kept for /alerts clients. Must be a power of two.
+#define ALT_EVENT_QUEUE_SIZE 16
+
+// Also program the high and low thresholds into the MCP9808 alert registers, so its alert pin can drive external
+// hardware.
+#ifndef ALT_HW_ALERT_MIRROR
+#define ALT_HW_ALERT_MIRROR 1
+#endif
+
+// Task placement table. Stack sizes are in bytes. Core is 0 (PRO_CPU), 1 (APP_CPU) or tskNO_AFFINITY.
+// The Wi-Fi and lwIP tasks are placed by sdkconfig (CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_x and
+// CONFIG_LWIP_TCPIP_TASK_AFFINITY).
+//                                  stack / priority / core
+#define TASK_TPS_STACK              4096
+#define TASK_TPS_PRIORITY           2
+#define TASK_TPS_CORE               1
+
+#define TASK_HTTPD_STACK            4096
+#define TASK_HTTPD_PRIORITY         5
+#define TASK_HTTPD_CORE             tskNO_AFFINITY
+
+#define TASK_ALERTS_STACK           3072
+#define TASK_ALERTS_PRIORITY        4
+#define TASK_ALERTS_CORE            tskNO_AFFINITY
+
+// Prints deferred log records. Lowest priority, so logging never delays the work being logged.
+#define TASK_LOG_STACK              3072
+#define TASK_LOG_PRIORITY           1
+#define TASK_LOG_CORE               tskNO_AFFINITY
+
+// Writes readings to the reading log. Lowest priority: it only has to keep up with the polling.
+#define TASK_RLOG_STACK             3072
+#define TASK_RLOG_PRIORITY          1
+#define TASK_RLOG_CORE              tskNO_AFFINITY
+
+// Sends telemetry datagrams. Above the sensor task, so a reading goes out as soon as it is taken.
+#define TASK_TLM_STACK              3072
+#define TASK_TLM_PRIORITY           3
+#define TASK_TLM_CORE               tskNO_AFFINITY
+
+// Brings up the SoftAP during startup, then deletes itself.
+#define TASK_NET_BOOT_STACK         4096
+#define TASK_NET_BOOT_PRIORITY      1
+#define TASK_NET_BOOT_CORE          tskNO_AFFINITY
+
+// Benchmark mode settings. The sensor polls fast, whatever the poll rate setting, for about 200 jitter samples per
+// preset. The history still keeps at most one reading a second.
+#define BENCH_DURATION_MS           20000
+#define BENCH_POLL_RATE_MS          100
+#define BENCH_HTTP_CLIENTS          3
+#define BENCH_MAX_SAMPLES           512
+
+// Default WiFi SoftAP name and password. Can be changed at runtime on the /config page.
 #define WEBS_AP_SSID "TEST AP"
 #define WEBS_AP_PWD "test1234"
 
+// Size of the buffer pages are built in.
+#define WEBS_PAGE_BUFFER_SIZE 2048
+
+// Segment list and scratch for pages built as segments (home, info). Markup is referenced in place, so the scratch only
+// holds formatted values.
+#define WEBS_PAGE_SEGMENTS 80
+#define WEBS_PAGE_SCRATCH_SIZE 512
+
+// The home page charts the newest WEBS_CHART_POINTS readings, so the chart's size doesn't grow with the history. Each
+// point takes up to 8 bytes of WEBS_PAGE_SCRATCH_SIZE. Width and height are in pixels.
+#define WEBS_CHART_POINTS 48
+#define WEBS_CHART_WIDTH 240
+#define WEBS_CHART_HEIGHT 60
+
+// Segments and scratch for the info page, which is built on the httpd task's stack. The boot timeline takes most.
+#define WEBS_INFO_SEGMENTS 72
+#define WEBS_INFO_SCRATCH_SIZE 320
+
+// Small segments are gathered into a stage of this size (on the httpd task stack) and sent as one chunk.
+#define WEBS_SEND_STAGE_SIZE 512
+
+// Responses of at least this many bytes are sent gzip compressed to clients that accept it. Below it, the gzip header
+// and trailer and the CPU time aren't worth the few bytes saved.
+#define WEBS_GZIP_MIN_BYTES 512
+// Longest Accept-Encoding value read. Longer values are cut, which only loses the encodings at the end.
+#define WEBS_ACCEPT_ENCODING_MAX 64
+
+// /api/export sends the reading log straight from mapped flash, in chunks of at most this many bytes. CSV lines are
+// formatted in a stage of this size on the httpd task's stack.
+#define WEBS_EXPORT_CHUNK_SIZE 1024
+
+// How long a request waits for another request's render of the same page before giving up (milliseconds).
+#define WEBS_RENDER_WAIT_MS 1000
+
+// Largest accepted /config form body (bytes).
+#define WEBS_CONFIG_BODY_MAX 512
+
+// Most samples returned by one /api/history request. Must fit WEBS_PAGE_BUFFER_SIZE at about 24 bytes each.
+#define WEBS_API_MAX_SAMPLES 64
+
+// /api/stats is built on the httpd task's stack. web_pages.c checks it holds the longest response.
+#define WEBS_STATS_JSON_SIZE 896
+
+// /alerts long polls: how many can wait at once, how long they wait, and how many events one response carries.
+#define WEBS_ALERT_WAITERS 3
+#define WEBS_ALERT_WAIT_MS 25000
+#define WEBS_ALERT_MAX_EVENTS 8
+
+// Free heap below which the status LED shows the overload pattern.
+#define WEBS_LOW_HEAP_BYTES 16384
+
+// Stations the SoftAP accepts, and sockets the server keeps open (the least recently used is closed for a new one).
+#define WEBS_AP_MAX_STATIONS 4
+#define WEBS_MAX_OPEN_SOCKETS 7
+
+// Admission control, checked before any handler runs. Each client address has a token bucket (requests per second
+// and burst) and all clients share a global one. Over its own budget a client gets 429; over the global budget, or
+// below the heap floor, 503. Pages that read the sensor over I2C cost more than one token.
+#define WEBS_CLIENT_RATE_PER_S 4
+#define WEBS_CLIENT_BURST 16
+#define WEBS_CLIENT_BUCKETS (WEBS_AP_MAX_STATIONS * 2)
+#define WEBS_GLOBAL_RATE_PER_S 12
+#define WEBS_GLOBAL_BURST 32
+#define WEBS_COST_DEFAULT 1
+#define WEBS_COST_I2C 4
+#define WEBS_COST_EXPORT 8
+#define WEBS_ADMIT_MIN_HEAP_BYTES 8192
+
 #endif // _WA_PRJ_CONFIG_H_INCLUDE_GUARD
@@ -0,0 +1,360 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+
+#include "reading_log.h"
+#include "prj_config.h"
+#include "task_layout.h"
+#include "temp_sensor.h"
+
+#define LOG_TAG "rlg"
+
+// Records are written as they come, so the first unwritten one (all ones) ends a sector.
+#define RLG_UNWRITTEN UINT32_MAX
+
+static_assert(sizeof(rlg_sector_header) == 16 && sizeof(rlg_record) == 8, "Reading log layout changed");
+
+static const esp_partition_t* s_partition = NULL;
+static const uint8_t* s_map = NULL;
+static esp_partition_mmap_handle_t s_map_handle;
+static uint32_t s_sector_total = 0;
+
+// The used sectors. Written by the log task, read by anyone through rlg_get_view.
+static portMUX_TYPE s_ring_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_first_sector = 0;
+static uint32_t s_sector_count = 0;
+static uint32_t s_first_seq = 1;
+static uint32_t s_newest_count = 0;
+
+// This boot's id, 0 until its first sector is started. Only touched by the log task.
+static uint32_t s_boot = 0;
+
+static QueueHandle_t s_queue = NULL;
+static TaskHandle_t s_task = NULL;
+#if PRJ_STATIC_ALLOC
+static uint8_t s_queue_storage[RLG_QUEUE_SIZE * sizeof(tps_reading)];
+static StaticQueue_t s_queue_buffer;
+static StackType_t s_task_stack[TASK_RLOG_STACK];
+static StaticTask_t s_task_tcb;
+#endif
+
+static void log_task(void* params);
+static void append(const tps_reading* reading);
+static int start_sector();
+static void scan();
+static const rlg_sector_header* sector_header(uint32_t sector);
+static uint32_t count_records(uint32_t sector);
+
+/**
+ * Find and map the partition and pick up the log where the last boot left it. Without the partition, readings are
+ * not logged and the log reads as empty.
+*/
+int rlg_init()
+{
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, RLG_PARTITION_LABEL);
+    if (s_partition == NULL)
+    {
+        ESP_LOGE(LOG_TAG, "No %s partition, readings will not be logged", RLG_PARTITION_LABEL);
+        return RLG_FAIL;
+    }
+
+    s_sector_total = s_partition->size / RLG_SECTOR_SIZE;
+    if (s_sector_total < 2)
+    {
+        ESP_LOGE(LOG_TAG, "Partition too small for a ring of sectors");
+        return RLG_FAIL;
+    }
+
+    const void* map;
+    esp_err_t rc = esp_partition_mmap(s_partition, 0, s_sector_total * RLG_SECTOR_SIZE, ESP_PARTITION_MMAP_DATA,
+        &map, &s_map_handle);
+    if (rc != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to map the partition, rc: %d", rc);
+        return RLG_FAIL;
+    }
+    s_map = (const uint8_t*)map;
+
+    scan();
+    ESP_LOGI(LOG_TAG, "%u of %u sectors used, from sequence %u", s_sector_count, s_sector_total, s_first_seq);
+
+    return RLG_OK;
+}
+
+/**
+ * Subscribe to the readings and start the log task. rlg_init and tps_init must have succeeded.
+*/
+int rlg_start()
+{
+    if (s_map == NULL)
+    {
+        return RLG_FAIL;
+    }
+
+#if PRJ_STATIC_ALLOC
+    s_queue = xQueueCreateStatic(RLG_QUEUE_SIZE, sizeof(tps_reading), s_queue_storage, &s_queue_buffer);
+#else
+    s_queue = xQueueCreate(RLG_QUEUE_SIZE, sizeof(tps_reading));
+#endif
+
+    // Newer readings matter more than a reading that waited through an erase.
+    if (s_queue == NULL || tps_subscribe_queue("rlog", s_queue, TPS_DROP_OLDEST) != TPS_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to subscribe to readings");
+        return RLG_FAIL;
+    }
+
+    const tl_placement* p = tl_get(TL_TASK_RLOG);
+
+#if PRJ_STATIC_ALLOC
+    s_task = xTaskCreateStaticPinnedToCore(log_task, p->name, p->stack_size, NULL, p->priority, s_task_stack,
+        &s_task_tcb, p->core);
+#else
+    xTaskCreatePinnedToCore(log_task, p->name, p->stack_size, NULL, p->priority, &s_task, p->core);
+#endif
+
+    return s_task != NULL ? RLG_OK : RLG_FAIL;
+}
+
+/**
+ * Get the number of bytes of RAM this module reserves statically.
+*/
+size_t rlg_static_size()
+{
+    size_t size = 0;
+#if PRJ_STATIC_ALLOC
+    size += sizeof(s_queue_storage) + sizeof(s_queue_buffer) + sizeof(s_task_stack) + sizeof(s_task_tcb);
+#endif
+    return size;
+}
+
+/**
+ * Get a view of the used sectors. Returns false if the log isn't mapped. Thread safe.
+*/
+bool rlg_get_view(rlg_view* view)
+{
+    if (s_map == NULL)
+    {
+        return false;
+    }
+
+    view->base = s_map;
+    view->sector_total = s_sector_total;
+
+    portENTER_CRITICAL(&s_ring_mux);
+    view->first_sector = s_first_sector;
+    view->sector_count = s_sector_count;
+    view->first_seq = s_first_seq;
+    view->newest_count = s_newest_count;
+    portEXIT_CRITICAL(&s_ring_mux);
+
+    return true;
+}
+
+/**
+ * Get the header of a view's sector, by its place in the view (0 is the oldest). The records follow it. Returns NULL
+ * past the end of the view.
+*/
+const rlg_sector_header* rlg_view_sector(const rlg_view* view, uint32_t index)
+{
+    if (index >= view->sector_count)
+    {
+        return NULL;
+    }
+
+    uint32_t sector = (view->first_sector + index) % view->sector_total;
+    return (const rlg_sector_header*)(view->base + (size_t)sector * RLG_SECTOR_SIZE);
+}
+
+/**
+ * Get the number of records in a view's sector.
+*/
+uint32_t rlg_view_records(const rlg_view* view, uint32_t index)
+{
+    if (index >= view->sector_count)
+    {
+        return 0;
+    }
+
+    if (index == view->sector_count - 1)
+    {
+        return view->newest_count;
+    }
+
+    return count_records((view->first_sector + index) % view->sector_total);
+}
+
+/**
+ * Whether a view's sector still holds what it did when the view was taken, i.e. it hasn't been erased for new
+ * readings since. Check after reading from the sector: if it is still current, what was read is good.
+*/
+bool rlg_view_current(const rlg_view* view, uint32_t index)
+{
+    const rlg_sector_header* header = rlg_view_sector(view, index);
+    return header != NULL && header->magic == RLG_SECTOR_MAGIC && header->seq == view->first_seq + index;
+}
+
+static void log_task(void* params)
+{
+    tps_reading reading;
+
+    for (;;)
+    {
+        if (xQueueReceive(s_queue, &reading, portMAX_DELAY) == pdTRUE && reading.value != TPS_NO_VALUE)
+        {
+            append(&reading);
+        }
+    }
+}
+
+static void append(const tps_reading* reading)
+{
+    if (s_boot == 0 || s_newest_count == RLG_RECORDS_PER_SECTOR)
+    {
+        if (start_sector() != RLG_OK)
+        {
+            return;
+        }
+    }
+
+    uint32_t sector = (s_first_sector + s_sector_count - 1) % s_sector_total;
+    size_t offset = (size_t)sector * RLG_SECTOR_SIZE + sizeof(rlg_sector_header) + s_newest_count * sizeof(rlg_record);
+    rlg_record record = { .time_s = reading->time_s, .value = reading->value };
+
+    esp_err_t rc = esp_partition_write(s_partition, offset, &record, sizeof(record));
+    if (rc != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to write a reading, rc: %d", rc);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_ring_mux);
+    ++s_newest_count;
+    portEXIT_CRITICAL(&s_ring_mux);
+}
+
+/**
+ * Erase the next sector of the ring and write its header. If the ring is full, the oldest sector is dropped from the
+ * view before it is erased, so readers that start now don't use it.
+*/
+static int start_sector()
+{
+    if (s_sector_count == s_sector_total)
+    {
+        portENTER_CRITICAL(&s_ring_mux);
+        s_first_sector = (s_first_sector + 1) % s_sector_total;
+        ++s_first_seq;
+        --s_sector_count;
+        portEXIT_CRITICAL(&s_ring_mux);
+    }
+
+    uint32_t sector = (s_first_sector + s_sector_count) % s_sector_total;
+    uint32_t seq = s_first_seq + s_sector_count;
+    rlg_sector_header header = {
+        .magic = RLG_SECTOR_MAGIC,
+        .seq = seq,
+        .boot = s_boot != 0 ? s_boot : seq,
+        .reserved = UINT32_MAX
+    };
+
+    size_t offset = (size_t)sector * RLG_SECTOR_SIZE;
+    esp_err_t rc = esp_partition_erase_range(s_partition, offset, RLG_SECTOR_SIZE);
+    if (rc == ESP_OK)
+    {
+        rc = esp_partition_write(s_partition, offset, &header, sizeof(header));
+    }
+    if (rc != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to start sector %u, rc: %d", sector, rc);
+        return RLG_FAIL;
+    }
+
+    portENTER_CRITICAL(&s_ring_mux);
+    if (s_sector_count == 0)
+    {
+        s_first_sector = sector;
+        s_first_seq = seq;
+    }
+    ++s_sector_count;
+    s_newest_count = 0;
+    portEXIT_CRITICAL(&s_ring_mux);
+
+    s_boot = header.boot;
+    return RLG_OK;
+}
+
+/**
+ * Find the used sectors: the newest sector with a good header, and the run of consecutive sequence numbers before it
+ * in the ring. Anything else is stale (cut off by an interrupted erase) and is reused as the ring comes around. Only
+ * called before the log task starts.
+*/
+static void scan()
+{
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t newest_seq = 0;
+
+    for (uint32_t i = 0; i < s_sector_total; ++i)
+    {
+        const rlg_sector_header* header = sector_header(i);
+        if (header->magic == RLG_SECTOR_MAGIC && (!found || (int32_t)(header->seq - newest_seq) > 0))
+        {
+            found = true;
+            newest = i;
+            newest_seq = header->seq;
+        }
+    }
+
+    if (!found)
+    {
+        return;
+    }
+
+    uint32_t count = 1;
+    while (count < s_sector_total)
+    {
+        const rlg_sector_header* header = sector_header((newest + s_sector_total - count) % s_sector_total);
+        if (header->magic != RLG_SECTOR_MAGIC || header->seq != newest_seq - count)
+        {
+            break;
+        }
+        ++count;
+    }
+
+    s_first_sector = (newest + s_sector_total - (count - 1)) % s_sector_total;
+    s_sector_count = count;
+    s_first_seq = newest_seq - (count - 1);
+    s_newest_count = count_records(newest);
+}
+
+static const rlg_sector_header* sector_header(uint32_t sector)
+{
+    return (const rlg_sector_header*)(s_map + (size_t)sector * RLG_SECTOR_SIZE);
+}
+
+/**
+ * Count a sector's records by binary search for the first unwritten one.
+*/
+static uint32_t count_records(uint32_t sector)
+{
+    const rlg_record* records = (const rlg_record*)(sector_header(sector) + 1);
+    uint32_t low = 0;
+    uint32_t high = RLG_RECORDS_PER_SECTOR;
+
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        if (records[mid].time_s != RLG_UNWRITTEN)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
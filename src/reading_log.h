@@ -0,0 +1,74 @@
+/**
+ * Persistent log of readings, in the flash partition named RLG_PARTITION_LABEL. The partition is a ring of 4 KB
+ * sectors, each a header followed by records in the order they were taken; when the ring is full the oldest sector is
+ * erased to make room. Every boot starts a new sector, so the uptimes in a sector are all from the same boot.
+ *
+ * The log task takes readings from the reading bus and writes them, so the sensor task never waits for an erase. The
+ * partition is memory mapped at startup and stays mapped: readers take a view of the used sectors and read records in
+ * place, without copying them out of flash.
+ *
+ * Layout (little endian): a sector header is RLG_SECTOR_MAGIC, the sector's sequence number (consecutive around the
+ * ring), the boot's id (the sequence number of its first sector) and a reserved word. A record is the uptime in
+ * seconds and the temperature in hundredths of degrees fahrenheit. Unwritten records are all ones. Failed reads are
+ * not logged.
+*/
+#ifndef _WA_READING_LOG_H_INCLUDE_GUARD
+#define _WA_READING_LOG_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RLG_OK 0
+#define RLG_FAIL 1
+
+#define RLG_SECTOR_SIZE 4096
+// "RLG1"
+#define RLG_SECTOR_MAGIC 0x31474C52
+
+typedef struct rlg_sector_header
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t boot;
+    uint32_t reserved;
+} rlg_sector_header;
+
+typedef struct rlg_record
+{
+    uint32_t time_s;
+    int32_t value;
+} rlg_record;
+
+#define RLG_RECORDS_PER_SECTOR ((RLG_SECTOR_SIZE - sizeof(rlg_sector_header)) / sizeof(rlg_record))
+
+/**
+ * The used sectors as of rlg_get_view, oldest first. While the oldest sector is still first_seq, nothing in the view
+ * moves or changes: sectors before the newest are never written again, and the newest only gains records after
+ * newest_count. So first_seq identifies the view's contents, and offsets into it stay valid between views.
+*/
+typedef struct rlg_view
+{
+    const uint8_t* base;
+    uint32_t sector_total;
+    uint32_t first_sector;
+    uint32_t sector_count;
+    uint32_t first_seq;
+    uint32_t newest_count;
+} rlg_view;
+
+int rlg_init();
+
+int rlg_start();
+
+size_t rlg_static_size();
+
+bool rlg_get_view(rlg_view* view);
+
+const rlg_sector_header* rlg_view_sector(const rlg_view* view, uint32_t index);
+
+uint32_t rlg_view_records(const rlg_view* view, uint32_t index);
+
+bool rlg_view_current(const rlg_view* view, uint32_t index);
+
+#endif // _WA_READING_LOG_H_INCLUDE_GUARD
@@ -0,0 +1,59 @@
+#include <esp_log.h>
+
+#include "task_layout.h"
+#include "prj_config.h"
+
+#define LOG_TAG "tl"
+
+// Indexed by tl_task_id.
+static tl_placement s_layout[TL_TASK_COUNT] = {
+    { "tps_main_task", TASK_TPS_STACK, TASK_TPS_PRIORITY, TASK_TPS_CORE },
+    { "httpd", TASK_HTTPD_STACK, TASK_HTTPD_PRIORITY, TASK_HTTPD_CORE },
+    { "alerts", TASK_ALERTS_STACK, TASK_ALERTS_PRIORITY, TASK_ALERTS_CORE },
+    { "dlog", TASK_LOG_STACK, TASK_LOG_PRIORITY, TASK_LOG_CORE },
+    { "rlog", TASK_RLOG_STACK, TASK_RLOG_PRIORITY, TASK_RLOG_CORE },
+    { "tlm", TASK_TLM_STACK, TASK_TLM_PRIORITY, TASK_TLM_CORE },
+};
+
+/**
+ * Get the placement of a task.
+*/
+const tl_placement* tl_get(tl_task_id id)
+{
+    if (id < 0 || id >= TL_TASK_COUNT)
+    {
+        return NULL;
+    }
+
+    return &s_layout[id];
+}
+
+/**
+ * Change the priority and core of a task. Must be called before the task is created. Stack sizes cannot be changed
+ * because static stacks are sized at compile time.
+*/
+void tl_override(tl_task_id id, UBaseType_t priority, BaseType_t core)
+{
+    if (id < 0 || id >= TL_TASK_COUNT)
+    {
+        return;
+    }
+
+    s_layout[id].priority = priority;
+    s_layout[id].core = core;
+}
+
+/**
+ * Log the current task placement.
+*/
+void tl_log_layout()
+{
+    for (int i = 0; i < TL_TASK_COUNT; ++i)
+    {
+        const tl_placement* p = &s_layout[i];
+
+        // tskNO_AFFINITY is printed as -1 to keep the log readable.
+        int core = p->core == tskNO_AFFINITY ? -1 : (int)p->core;
+        ESP_LOGI(LOG_TAG, "%s: stack %u, priority %u, core %d", p->name, p->stack_size, p->priority, core);
+    }
+}
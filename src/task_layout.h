@@ -0,0 +1,34 @@
+/**
+ * Placement (stack, priority and core) of the project's tasks. Defaults come from the task table in prj_config.h.
+*/
+#ifndef _WA_TASK_LAYOUT_H_INCLUDE_GUARD
+#define _WA_TASK_LAYOUT_H_INCLUDE_GUARD
+
+#include <freertos/FreeRTOS.h>
+
+typedef enum tl_task_id
+{
+    TL_TASK_TPS,
+    TL_TASK_HTTPD,
+    TL_TASK_ALERTS,
+    TL_TASK_LOG,
+    TL_TASK_RLOG,
+    TL_TASK_TLM,
+    TL_TASK_COUNT
+} tl_task_id;
+
+typedef struct tl_placement
+{
+    const char* name;
+    uint32_t stack_size;
+    UBaseType_t priority;
+    BaseType_t core;
+} tl_placement;
+
+const tl_placement* tl_get(tl_task_id id);
+
+void tl_override(tl_task_id id, UBaseType_t priority, BaseType_t core);
+
+void tl_log_layout();
+
+#endif // _WA_TASK_LAYOUT_H_INCLUDE_GUARD
@@ -0,0 +1,201 @@
+#include <errno.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_log.h>
+#include <esp_mac.h>
+#include <lwip/sockets.h>
+
+#include <telemetry_packet.h>
+
+#include "telemetry.h"
+#include "prj_config.h"
+#include "config_store.h"
+#include "task_layout.h"
+#include "temp_sensor.h"
+
+#define LOG_TAG "tlm"
+
+static uint32_t s_sensor_id = 0;
+
+// Only touched by the telemetry task.
+static int s_socket = -1;
+static bool s_failing = false;
+
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_sent = 0;
+static uint32_t s_failed = 0;
+
+static QueueHandle_t s_queue = NULL;
+static TaskHandle_t s_task = NULL;
+#if PRJ_STATIC_ALLOC
+static uint8_t s_queue_storage[TLM_QUEUE_SIZE * sizeof(tps_reading)];
+static StaticQueue_t s_queue_buffer;
+static StackType_t s_task_stack[TASK_TLM_STACK];
+static StaticTask_t s_task_tcb;
+#endif
+
+static void tlm_task(void* params);
+static void send_reading(const tps_reading* reading, uint32_t mode, uint32_t port);
+static int open_socket();
+
+/**
+ * Subscribe to the readings and start the telemetry task. tps_init must have succeeded. The task runs even while
+ * telemetry is off, so turning it on in the settings takes effect from the next reading.
+*/
+int tlm_start()
+{
+    // The low bytes of the SoftAP's MAC tell devices apart; the high bytes are the vendor's.
+    uint8_t mac[6] = { 0 };
+    if (esp_read_mac(mac, ESP_MAC_WIFI_SOFTAP) != ESP_OK)
+    {
+        ESP_LOGW(LOG_TAG, "Failed to read the MAC, sensor id will be 0");
+    }
+    s_sensor_id = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+
+#if PRJ_STATIC_ALLOC
+    s_queue = xQueueCreateStatic(TLM_QUEUE_SIZE, sizeof(tps_reading), s_queue_storage, &s_queue_buffer);
+#else
+    s_queue = xQueueCreate(TLM_QUEUE_SIZE, sizeof(tps_reading));
+#endif
+
+    // Listeners want the newest reading, not one that waited.
+    if (s_queue == NULL || tps_subscribe_queue("tlm", s_queue, TPS_DROP_OLDEST) != TPS_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to subscribe to readings");
+        return TLM_FAIL;
+    }
+
+    const tl_placement* p = tl_get(TL_TASK_TLM);
+
+#if PRJ_STATIC_ALLOC
+    s_task = xTaskCreateStaticPinnedToCore(tlm_task, p->name, p->stack_size, NULL, p->priority, s_task_stack,
+        &s_task_tcb, p->core);
+#else
+    xTaskCreatePinnedToCore(tlm_task, p->name, p->stack_size, NULL, p->priority, &s_task, p->core);
+#endif
+
+    return s_task != NULL ? TLM_OK : TLM_FAIL;
+}
+
+/**
+ * Get the number of bytes of RAM this module reserves statically.
+*/
+size_t tlm_static_size()
+{
+    size_t size = 0;
+#if PRJ_STATIC_ALLOC
+    size += sizeof(s_queue_storage) + sizeof(s_queue_buffer) + sizeof(s_task_stack) + sizeof(s_task_tcb);
+#endif
+    return size;
+}
+
+/**
+ * Get the datagram counts since startup. Thread safe.
+*/
+void tlm_get_stats(tlm_stats* stats)
+{
+    stats->sensor_id = s_sensor_id;
+
+    portENTER_CRITICAL(&s_stats_mux);
+    stats->sent = s_sent;
+    stats->failed = s_failed;
+    portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void tlm_task(void* params)
+{
+    tps_reading reading;
+
+    for (;;)
+    {
+        if (xQueueReceive(s_queue, &reading, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        // Read per reading, so a change on the config page applies without a restart.
+        uint32_t mode = cfg_get_u32(CFG_TLM_MODE);
+        if (mode != TLM_MODE_OFF)
+        {
+            send_reading(&reading, mode, cfg_get_u32(CFG_TLM_PORT));
+        }
+    }
+}
+
+static void send_reading(const tps_reading* reading, uint32_t mode, uint32_t port)
+{
+    tlp_packet packet = {
+        .seq = reading->seq,
+        .time_s = reading->time_s,
+        .sensor_id = s_sensor_id,
+        .value = reading->value,
+        .error = reading->error
+    };
+    uint8_t datagram[TLP_SIZE];
+    tlp_encode(&packet, datagram);
+
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons((uint16_t)port);
+    dest.sin_addr.s_addr = mode == TLM_MODE_MULTICAST ? inet_addr(TLM_MULTICAST_GROUP) : htonl(INADDR_BROADCAST);
+
+    bool sent = (s_socket >= 0 || open_socket() == TLM_OK) &&
+        sendto(s_socket, datagram, sizeof(datagram), 0, (struct sockaddr*)&dest, sizeof(dest)) ==
+            (ssize_t)sizeof(datagram);
+
+    portENTER_CRITICAL(&s_stats_mux);
+    if (sent)
+    {
+        ++s_sent;
+    }
+    else
+    {
+        ++s_failed;
+    }
+    portEXIT_CRITICAL(&s_stats_mux);
+
+    // Log once when sends start failing, not per reading. Sends fail until the SoftAP is up, so that is no warning.
+    if (!sent && !s_failing)
+    {
+        if (s_sent > 0)
+        {
+            ESP_LOGW(LOG_TAG, "Telemetry sends failing, errno: %d", errno);
+        }
+        else
+        {
+            ESP_LOGI(LOG_TAG, "Telemetry not sent yet, errno: %d", errno);
+        }
+    }
+    s_failing = !sent;
+}
+
+/**
+ * Open the one socket used for both modes. A multicast TTL of 1 keeps datagrams on the SoftAP network. On failure,
+ * errno says why.
+*/
+static int open_socket()
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        return TLM_FAIL;
+    }
+
+    int broadcast = 1;
+    uint8_t ttl = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast)) != 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0)
+    {
+        int err = errno;
+        closesocket(sock);
+        errno = err;
+        return TLM_FAIL;
+    }
+
+    s_socket = sock;
+    return TLM_OK;
+}
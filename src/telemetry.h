@@ -0,0 +1,31 @@
+/**
+ * Telemetry: every reading from the reading bus is sent as one UDP datagram (lib/utils/telemetry_packet.h) to the
+ * broadcast address or the multicast group of the SoftAP network, per the tlm_mode and tlm_port settings. Any number
+ * of listeners can receive them without connecting, and the device's cost doesn't grow with the number of listeners.
+ *
+ * Delivery is best effort: a datagram that is lost is not sent again, and listeners find gaps by sequence number.
+*/
+#ifndef _WA_TELEMETRY_H_INCLUDE_GUARD
+#define _WA_TELEMETRY_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TLM_OK 0
+#define TLM_FAIL 1
+
+typedef struct tlm_stats
+{
+    uint32_t sensor_id;
+    uint32_t sent;
+    // Sends that failed, e.g. before the SoftAP is up.
+    uint32_t failed;
+} tlm_stats;
+
+int tlm_start();
+
+size_t tlm_static_size();
+
+void tlm_get_stats(tlm_stats* stats);
+
+#endif // _WA_TELEMETRY_H_INCLUDE_GUARD
@@ -1,25 +1,111 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+
+#include <ring_buffer.h>
+#include <tseries.h>
+#include <quantile.h>
+#include <trend.h>
+#include <downsample.h>
 
 #include "temp_sensor.h"
 #include "prj_config.h"
-#include "circular_array.h"
 #include "hw_mcp9808.h"
+#include "bench.h"
+#include "hardware_ui.h"
+#include "config_store.h"
+#include "boot_timeline.h"
 
 #define SEMI_WAIT_TIME (100 / portTICK_PERIOD_MS)
 
 #define LOG_TAG "i2c"
 
 static SemaphoreHandle_t s_value_mutex = NULL;
+#if PRJ_STATIC_ALLOC
+static StaticSemaphore_t s_value_mutex_buffer;
+#endif
 
 int32_t s_last_value = TPS_NO_VALUE;
 uint8_t s_last_error = 0x00;
 
-size_t s_on_deck_hist_idx = 0;
-int32_t s_history_values[TPS_HIST_READ_SIZE];
+// History is a ring over the arena. Its limit is the history size setting, so only that many of the newest samples
+// are kept.
+static_assert((TPS_HIST_ARENA_SIZE & (TPS_HIST_ARENA_SIZE - 1)) == 0, "History arena must be a power of two");
+static tps_sample s_history_arena[TPS_HIST_ARENA_SIZE];
+static rbuf s_history;
+
+// Every reading is also appended to the compressed long term history, which reaches much further back than the ring.
+static tsr_block s_deep_blocks[TPS_DEEP_HIST_BLOCKS];
+static tsr_series s_deep_history;
+
+// p5, p50 and p95 over each tps_window, estimated from every reading without storing them.
+static const uint16_t s_quantile_permilles[3] = { 50, 500, 950 };
+static qnt_window s_quantiles[TPS_WINDOW_COUNT];
+
+// Least-squares line over exactly the samples in the history ring, and a Holt forecast over all readings.
+static trd_fit s_trend_fit;
+static trd_holt s_holt;
+
+// Samples are kept at most one per second of uptime, so a time identifies a sample. Earliest time the next may have.
+static uint32_t s_next_sample_s = 0;
+
+// Wall clock time minus uptime, set by a client. Only valid if s_wall_offset_set.
+static int64_t s_wall_offset_s = 0;
+static bool s_wall_offset_set = false;
+
+// Settings last applied by the sensor task.
+static uint32_t s_applied_cfg_generation = 0;
+static uint32_t s_applied_i2c_freq_hz = 0;
+// The alert settings still need writing to the sensor's registers.
+static bool s_alert_limits_pending = false;
+
+// Incremented on every update so readers can tell if their copy of the values is stale.
+static volatile uint32_t s_generation = 0;
+
+// Only written by the sensor task; readers copy it without a lock and may see a count or two behind.
+static tps_i2c_stats s_i2c_stats = { 0 };
+
+/**
+ * A reading bus subscriber: a function called on the sensor task, or a queue readings are copied to.
+*/
+typedef struct bus_subscriber
+{
+    const char* name;
+    tps_reading_fn fn;
+    void* ctx;
+    QueueHandle_t queue;
+    tps_drop_policy policy;
+
+    // Only written by the sensor task.
+    uint32_t delivered;
+    uint32_t dropped;
+} bus_subscriber;
+
+// Subscribers are only ever added, and each is filled in before the count covers it, so publishing takes no lock.
+static portMUX_TYPE s_bus_mux = portMUX_INITIALIZER_UNLOCKED;
+static bus_subscriber s_bus[TPS_BUS_SUBSCRIBERS];
+static volatile size_t s_bus_count = 0;
+static uint32_t s_bus_published = 0;
 
 static void update_values(int32_t faren_temp, uint8_t error);
+static uint8_t read_sensor(int16_t* value);
+static uint8_t temp_error(int hw_rc);
+static void apply_config();
+static int mirror_alert_limits();
+static void resize_history(size_t new_size);
+static const tps_sample* hist_at(size_t idx);
+static size_t hist_lower_bound(uint32_t time_s);
+static size_t deep_get_range(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size, bool* more);
+static size_t hist_downsample(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size);
+static size_t deep_downsample(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size);
+static size_t store_points(tps_sample* samples, size_t size, size_t count, const dsm_point* points,
+    size_t point_count);
+static void history_push(const tps_sample* sample);
+static void refit_trend();
+static int bus_add(const bus_subscriber* subscriber);
+static void bus_publish(uint32_t time_s, temper_t value, uint8_t error);
+static void bus_deliver_queue(bus_subscriber* subscriber, const tps_reading* reading);
 
 /**
  * Initialize the temperature sensor.
@@ -27,22 +113,44 @@ static void update_values(int32_t faren_temp, uint8_t error);
 int tps_init()
 {
     // Create a Mutex to lock the "value" section of this module.
+#if PRJ_STATIC_ALLOC
+    s_value_mutex = xSemaphoreCreateMutexStatic(&s_value_mutex_buffer);
+#else
     s_value_mutex = xSemaphoreCreateMutex();
+#endif
     if (s_value_mutex == NULL)
     {
         ESP_LOGI(LOG_TAG, "Failed to create temp sensor mutex");
         return 1;
     }
 
-    // Initialize last readings to "invalid" values.
-    for(int i = 0; i <  TPS_HIST_READ_SIZE; ++i)
-    {
-        s_history_values[i] = TPS_NO_VALUE;
-    }
+    rbuf_init(&s_history, s_history_arena, sizeof(tps_sample), TPS_HIST_ARENA_SIZE);
+    rbuf_set_limit(&s_history, cfg_get_u32(CFG_HIST_SIZE));
+    tsr_init(&s_deep_history, s_deep_blocks, TPS_DEEP_HIST_BLOCKS);
+    qnt_window_init(&s_quantiles[TPS_WINDOW_HOUR], TPS_QNT_HOUR_S, s_quantile_permilles, 3);
+    qnt_window_init(&s_quantiles[TPS_WINDOW_DAY], TPS_QNT_DAY_S, s_quantile_permilles, 3);
+    trd_fit_clear(&s_trend_fit, 0);
+    trd_holt_init(&s_holt, TPS_HOLT_ALPHA, TPS_HOLT_BETA);
+    s_applied_i2c_freq_hz = cfg_get_u32(CFG_I2C_FREQ_HZ);
+    s_applied_cfg_generation = cfg_get_generation();
+    s_alert_limits_pending = true;
 
     return TPS_OK;
 }
 
+/**
+ * Get the number of bytes of RAM this module reserves statically.
+*/
+size_t tps_static_size()
+{
+    size_t size = sizeof(s_history_arena) + sizeof(s_deep_blocks) + sizeof(s_quantiles) + sizeof(s_trend_fit) +
+        sizeof(s_holt) + sizeof(s_bus);
+#if PRJ_STATIC_ALLOC
+    size += sizeof(s_value_mutex_buffer);
+#endif
+    return size;
+}
+
 /**
  * Task loop for polling the temperature sensor.
 */
@@ -53,25 +161,51 @@ void tps_task(void* params)
     {
         TickType_t loop_start = xTaskGetTickCount();
 
+        // Settings changed on the config page are applied at the start of the next poll.
+        if (cfg_get_generation() != s_applied_cfg_generation)
+        {
+            apply_config();
+        }
+
+#if PRJ_BENCHMARK_MODE
+        bench_poll_mark();
+#endif
+
         // Read the sensor.
         int16_t sensor_value = 0;
-        int mcp_rc = hw_mcp9808_read_temp(&sensor_value);
+        uint8_t error = read_sensor(&sensor_value);
 
-        if (mcp_rc == HW_MCP9808_OK)
+        if (error == TPS_TEMP_OK)
         {
             update_values(sensor_value, TPS_TEMP_OK);
+            btl_mark(BTL_FIRST_READING);
         }
         else
         {
             // Sensor fail mode.
-            update_values(TPS_NO_VALUE, TPS_TEMP_OK);
+            ++s_i2c_stats.failed_polls;
+            update_values(TPS_NO_VALUE, error);
+        }
+
+        hui_set_pattern(HUI_PATTERN_SENSOR_FAIL, error != TPS_TEMP_OK);
+
+        // After the read, which recovers a hung bus. A failed write is tried again on the next poll.
+        if (s_alert_limits_pending)
+        {
+            s_alert_limits_pending = mirror_alert_limits() != TPS_OK;
         }
 
         // Figure out how much time has passed to change how long to delay between readings.
         TickType_t loop_end = xTaskGetTickCount();
         TickType_t elapsed = loop_end - loop_start;
         // Need to be mindful that the ticks are in RTOS's tick rate, not milliseconds.
-        TickType_t delay_amt = (TPS_POLL_RATE_MS / portTICK_PERIOD_MS) - elapsed;
+#if PRJ_BENCHMARK_MODE
+        // Jitter is measured against a known period, so a saved poll rate is ignored.
+        TickType_t period = BENCH_POLL_RATE_MS / portTICK_PERIOD_MS;
+#else
+        TickType_t period = cfg_get_u32(CFG_POLL_RATE_MS) / portTICK_PERIOD_MS;
+#endif
+        TickType_t delay_amt = elapsed < period ? period - elapsed : 0;
         vTaskDelay(delay_amt);
     }
 }
@@ -86,7 +220,7 @@ int tps_get_last(int32_t* last_value, uint8_t* last_error)
     if (take_success == pdFALSE)
     {
         *last_value = TPS_NO_VALUE;
-        *last_error = 10; // TODO - meaningful value!.
+        *last_error = TPS_TEMP_LOCKED;
         return TPS_FAIL;
     }
 
@@ -99,10 +233,13 @@ int tps_get_last(int32_t* last_value, uint8_t* last_error)
     return TPS_OK;
 }
 
-int tps_get_hist_values(int32_t* hist_array, ssize_t size)
+/**
+ * Get the most recent history samples, newest first. Returns the count of samples copied. Thread safe.
+*/
+int tps_get_hist_values(tps_sample* hist_array, ssize_t size)
 {
     // History size must be smaller than integer for this code to work!
-    static_assert(TPS_HIST_READ_SIZE < INT_MAX);
+    static_assert(TPS_HIST_ARENA_SIZE < INT_MAX);
 
     if (hist_array == NULL || size <= 0)
     {
@@ -116,37 +253,450 @@ int tps_get_hist_values(int32_t* hist_array, ssize_t size)
         return 0;
     }
 
-    // Reading from a circular buffer. Want to give values from most recent to oldest. Note that the "current index" is
-    // pointing to the oldest value at this moment.
-    int start_idx = CA_PREV_IDX(s_on_deck_hist_idx, TPS_HIST_READ_SIZE);
-    int idx = start_idx;
-    const int32_t* pend = hist_array + size;
-    int32_t* p = hist_array;
+    size_t count = rbuf_copy_newest_first(&s_history, hist_array, (size_t)size);
 
-    do
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
+
+    return (int)count;
+}
+
+/**
+ * Get the samples taken between from_s and to_s (inclusive, seconds of uptime), oldest first. At most size samples
+ * are copied; more is set if there were more samples in the range. Returns the count of samples copied. Thread safe.
+ *
+ * Samples are stored in time order, so both ends of the range are found with a binary search and the samples between
+ * are copied in one go. Ranges starting before the oldest sample in the ring are read from the long term history.
+*/
+int tps_get_range(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size, bool* more)
+{
+    if (more != NULL)
+    {
+        *more = false;
+    }
+
+    if (samples == NULL || size == 0 || from_s > to_s)
+    {
+        return 0;
+    }
+
+    // Lock data while reading.
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return 0;
+    }
+
+    if (rbuf_count(&s_history) == 0 || from_s < hist_at(0)->time_s)
+    {
+        size_t deep_count = deep_get_range(from_s, to_s, samples, size, more);
+
+        // Must free lock!
+        xSemaphoreGive(s_value_mutex);
+
+        return (int)deep_count;
+    }
+
+    // to_s + 1 can't overflow here: a range ending at UINT32_MAX ends past the newest sample anyway.
+    size_t start = hist_lower_bound(from_s);
+    size_t end = to_s < UINT32_MAX ? hist_lower_bound(to_s + 1) : rbuf_count(&s_history);
+
+    if (end - start > size && more != NULL)
+    {
+        *more = true;
+    }
+
+    size_t count = rbuf_copy_oldest_first(&s_history, start, samples, end - start < size ? end - start : size);
+
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
+
+    return (int)count;
+}
+
+/**
+ * Get the samples taken between from_s and to_s (inclusive, seconds of uptime) reduced to at most size samples (at
+ * least 2), oldest first. The range is split into size / 2 equal spans of time and each span is reduced to its lowest
+ * and highest sample, so spikes and dips are kept. Returns the count of samples copied. Thread safe.
+ *
+ * The samples are read once, in order, keeping only the current span's low and high, so any range is served with the
+ * same memory and at most size samples. Like tps_get_range, ranges starting before the oldest sample in the ring are
+ * read from the long term history.
+*/
+int tps_get_downsampled(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size)
+{
+    if (samples == NULL || size < DSM_MAX_OUT || from_s > to_s)
+    {
+        return 0;
+    }
+
+    // Lock data while reading.
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
     {
-        // Stop once an invalid value is found. This is for the "just started up" case where there is not enough
-        // history.
-        if (s_history_values[idx] == TPS_NO_VALUE)
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t hist_count = rbuf_count(&s_history);
+
+    if (hist_count > 0)
+    {
+        // Spans are laid over the samples there are, so an open ended range isn't spread over time yet to come.
+        uint32_t newest_s = hist_at(hist_count - 1)->time_s;
+        uint32_t end_s = to_s < newest_s ? to_s : newest_s;
+
+        if (from_s < hist_at(0)->time_s)
         {
-            break;
+            count = deep_downsample(from_s, end_s, samples, size);
         }
+        else
+        {
+            count = hist_downsample(from_s, end_s, samples, size);
+        }
+    }
+
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
 
-        *p = s_history_values[idx];
+    return (int)count;
+}
 
-        ++p;
-        idx = CA_PREV_IDX(idx, TPS_HIST_READ_SIZE);
+/**
+ * Seconds since boot. This is the time base of the history samples.
+*/
+uint32_t tps_uptime_s()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+/**
+ * Set the wall clock (Unix time in seconds). Stored as an offset from uptime, so sample times don't change.
+*/
+void tps_set_wall_time(int64_t unix_time_s)
+{
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return;
+    }
+
+    s_wall_offset_s = unix_time_s - (int64_t)tps_uptime_s();
+    s_wall_offset_set = true;
 
-    } while (idx != start_idx && p < pend);
-    
     // Must free lock!
     xSemaphoreGive(s_value_mutex);
+}
+
+/**
+ * Get the wall clock offset (Unix time minus uptime). Returns false if no client has set the wall clock.
+*/
+bool tps_get_wall_offset(int64_t* offset_s)
+{
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return false;
+    }
+
+    bool is_set = s_wall_offset_set;
+    *offset_s = s_wall_offset_s;
+
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
+
+    return is_set;
+}
+
+/**
+ * Get the estimated percentiles of the readings over a window. Returns false if there are no readings yet. Thread
+ * safe.
+*/
+bool tps_get_quantiles(tps_window window, tps_quantiles* quantiles)
+{
+    if (window < 0 || window >= TPS_WINDOW_COUNT || quantiles == NULL)
+    {
+        return false;
+    }
+
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return false;
+    }
+
+    int32_t values[3];
+    uint32_t span_s = 0;
+    uint32_t count = qnt_window_get(&s_quantiles[window], tps_uptime_s(), values, &span_s);
+
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    quantiles->count = count;
+    quantiles->span_s = span_s;
+    quantiles->p5 = values[0];
+    quantiles->p50 = values[1];
+    quantiles->p95 = values[2];
+
+    return true;
+}
+
+/**
+ * Get the trend of the readings. Returns false until there are two readings at different times. Thread safe.
+*/
+bool tps_get_trend(tps_trend* trend)
+{
+    if (trend == NULL)
+    {
+        return false;
+    }
+
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return false;
+    }
+
+    bool has_trend = trd_fit_slope(&s_trend_fit, &trend->slope_per_hour, &trend->r2_permille);
+    trend->count = (uint16_t)s_trend_fit.n;
+    has_trend = has_trend && trd_holt_forecast(&s_holt, TPS_FORECAST_S, &trend->forecast);
+    trend->forecast_s = TPS_FORECAST_S;
+
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
+
+    if (!has_trend)
+    {
+        return false;
+    }
+
+    // A line through few readings, or one that leaves most of the variation unexplained, says little.
+    if (trend->count >= 10 && trend->r2_permille >= 800)
+    {
+        trend->confidence = TPS_CONFIDENCE_HIGH;
+    }
+    else if (trend->count >= 5 && trend->r2_permille >= 500)
+    {
+        trend->confidence = TPS_CONFIDENCE_MEDIUM;
+    }
+    else
+    {
+        trend->confidence = TPS_CONFIDENCE_LOW;
+    }
+
+    return true;
+}
+
+/**
+ * Subscribe a function to readings. It is called on the sensor task for every poll, failed reads included, and must
+ * not block. Subscribers can't be removed. Returns TPS_FAIL if the bus is full.
+*/
+int tps_subscribe(const char* name, tps_reading_fn fn, void* ctx)
+{
+    if (fn == NULL)
+    {
+        return TPS_FAIL;
+    }
+
+    bus_subscriber subscriber = { .name = name, .fn = fn, .ctx = ctx };
+    return bus_add(&subscriber);
+}
+
+/**
+ * Subscribe a queue of tps_reading to readings, for consumers that work on their own task. The sensor task never
+ * waits on the queue; when it is full, the policy says which reading is lost. Returns TPS_FAIL if the bus is full.
+*/
+int tps_subscribe_queue(const char* name, QueueHandle_t queue, tps_drop_policy policy)
+{
+    if (queue == NULL)
+    {
+        return TPS_FAIL;
+    }
+
+    bus_subscriber subscriber = { .name = name, .queue = queue, .policy = policy };
+    return bus_add(&subscriber);
+}
+
+/**
+ * Get the subscriber counts, in subscription order, and how many readings were published. Returns the number of
+ * subscribers copied.
+*/
+size_t tps_get_bus_stats(tps_subscriber_stats* stats, size_t max, uint32_t* published)
+{
+    size_t count = s_bus_count < max ? s_bus_count : max;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        stats[i].name = s_bus[i].name;
+        stats[i].delivered = s_bus[i].delivered;
+        stats[i].dropped = s_bus[i].dropped;
+    }
+
+    if (published != NULL)
+    {
+        *published = s_bus_published;
+    }
 
-    // return the count of items copied.
-    ssize_t count = (ssize_t)(p - hist_array);
     return count;
 }
 
+/**
+ * Get the sensor read counts.
+*/
+void tps_get_i2c_stats(tps_i2c_stats* stats)
+{
+    *stats = s_i2c_stats;
+}
+
+/**
+ * Get the data generation. Changes every time the last value or history is updated. Thread safe.
+*/
+uint32_t tps_get_generation()
+{
+    return s_generation;
+}
+
+static int bus_add(const bus_subscriber* subscriber)
+{
+    int rc = TPS_FAIL;
+
+    portENTER_CRITICAL(&s_bus_mux);
+    if (s_bus_count < TPS_BUS_SUBSCRIBERS)
+    {
+        s_bus[s_bus_count] = *subscriber;
+        ++s_bus_count;
+        rc = TPS_OK;
+    }
+    portEXIT_CRITICAL(&s_bus_mux);
+
+    if (rc != TPS_OK)
+    {
+        ESP_LOGE(LOG_TAG, "No room on the reading bus for %s, raise TPS_BUS_SUBSCRIBERS", subscriber->name);
+    }
+
+    return rc;
+}
+
+/**
+ * Hand a reading to every subscriber. Only called from the sensor task.
+*/
+static void bus_publish(uint32_t time_s, temper_t value, uint8_t error)
+{
+    tps_reading reading = { .seq = ++s_bus_published, .time_s = time_s, .value = value, .error = error };
+    size_t count = s_bus_count;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        bus_subscriber* subscriber = &s_bus[i];
+
+        if (subscriber->fn != NULL)
+        {
+            subscriber->fn(&reading, subscriber->ctx);
+            ++subscriber->delivered;
+        }
+        else
+        {
+            bus_deliver_queue(subscriber, &reading);
+        }
+    }
+}
+
+static void bus_deliver_queue(bus_subscriber* subscriber, const tps_reading* reading)
+{
+    if (xQueueSend(subscriber->queue, reading, 0) == pdTRUE)
+    {
+        ++subscriber->delivered;
+        return;
+    }
+
+    ++subscriber->dropped;
+
+    if (subscriber->policy == TPS_DROP_OLDEST)
+    {
+        // The consumer may have made room in the meantime, so the receive is allowed to find nothing.
+        tps_reading oldest;
+        xQueueReceive(subscriber->queue, &oldest, 0);
+        if (xQueueSend(subscriber->queue, reading, 0) == pdTRUE)
+        {
+            ++subscriber->delivered;
+        }
+    }
+}
+
+/**
+ * Read the sensor within a bounded time: up to TPS_READ_ATTEMPTS attempts of TPS_READ_ATTEMPT_MS each, with a doubling
+ * backoff between them. A timeout or missing driver gets one bus recovery per poll, which also reinstalls the driver.
+ * Returns TPS_TEMP_OK or the last attempt's error.
+*/
+static uint8_t read_sensor(int16_t* value)
+{
+    uint8_t error = TPS_TEMP_FAIL;
+    uint32_t backoff_ms = TPS_READ_BACKOFF_MS;
+    bool recovered = false;
+
+    for (int attempt = 0; attempt < TPS_READ_ATTEMPTS; ++attempt)
+    {
+        if (attempt > 0)
+        {
+            ++s_i2c_stats.retries;
+            vTaskDelay(backoff_ms / portTICK_PERIOD_MS);
+            backoff_ms *= 2;
+        }
+
+        error = temp_error(hw_mcp9808_read_temp(value, TPS_READ_ATTEMPT_MS));
+        ++s_i2c_stats.attempts[error];
+
+        if (error == TPS_TEMP_OK)
+        {
+            break;
+        }
+
+        // Retrying won't help while the sensor holds SDA, or without a driver.
+        if (!recovered && (error == TPS_TEMP_TIMEOUT || error == TPS_TEMP_NO_DRIVER))
+        {
+            recovered = true;
+            ++s_i2c_stats.recoveries;
+
+            uint8_t recover_error = temp_error(hw_mcp9808_recover_bus());
+            if (recover_error == TPS_TEMP_BUS_STUCK)
+            {
+                // No point trying again this poll; the next one recovers again.
+                ++s_i2c_stats.attempts[TPS_TEMP_BUS_STUCK];
+                error = TPS_TEMP_BUS_STUCK;
+                break;
+            }
+        }
+    }
+
+    return error;
+}
+
+static uint8_t temp_error(int hw_rc)
+{
+    switch (hw_rc)
+    {
+    case HW_MCP9808_OK:
+        return TPS_TEMP_OK;
+    case HW_MCP9808_BUSY:
+        return TPS_TEMP_BUSY;
+    case HW_MCP9808_TIMEOUT:
+        return TPS_TEMP_TIMEOUT;
+    case HW_MCP9808_NACK:
+        return TPS_TEMP_NACK;
+    case HW_MCP9808_NO_DRIVER:
+        return TPS_TEMP_NO_DRIVER;
+    case HW_MCP9808_STUCK:
+        return TPS_TEMP_BUS_STUCK;
+    default:
+        return TPS_TEMP_FAIL;
+    }
+}
+
 /**
  * Update last temperature reading values. Thread safe.
 */
@@ -159,15 +709,29 @@ static void update_values(int32_t faren_temp, uint8_t error)
         return;
     }
 
+    tps_sample sample = { .time_s = tps_uptime_s(), .value = faren_temp };
+    bool is_reading = error == 0 && faren_temp != TPS_NO_VALUE;
+
     if (error == 0)
     {
         s_last_error = 0;
         s_last_value = faren_temp;
 
-        // Set historical. The s_on_deck_hist_idx will point to the index we want to update.
-        s_history_values[s_on_deck_hist_idx] = s_last_value;
-        // Increment the index, wrapping to the front to create a circular array.
-        s_on_deck_hist_idx = CA_NEXT_IDX(s_on_deck_hist_idx, TPS_HIST_READ_SIZE);
+        // Set historical. A failed read is not a reading, so it is not kept. Nor is a second reading in the same second
+        // (fast benchmark polls, or a retried read running into the next poll), which would break paging by time.
+        if (is_reading && sample.time_s >= s_next_sample_s)
+        {
+            s_next_sample_s = sample.time_s + 1;
+            history_push(&sample);
+            trd_holt_add(&s_holt, sample.time_s, faren_temp);
+
+            tsr_append(&s_deep_history, sample.time_s, faren_temp);
+
+            for (int i = 0; i < TPS_WINDOW_COUNT; ++i)
+            {
+                qnt_window_add(&s_quantiles[i], sample.time_s, faren_temp);
+            }
+        }
     }
     else
     {
@@ -175,6 +739,273 @@ static void update_values(int32_t faren_temp, uint8_t error)
         s_last_value = TPS_NO_VALUE;
     }
 
+    ++s_generation;
+
     // Must free lock!
     xSemaphoreGive(s_value_mutex);
+
+    // Published after the lock is given back, so subscribers don't hold up readers and can use the getters.
+    // A read without a value is a failed reading, even with no error from the bus.
+    uint8_t bus_error = is_reading ? TPS_TEMP_OK : (error != TPS_TEMP_OK ? error : TPS_TEMP_FAIL);
+    bus_publish(sample.time_s, is_reading ? faren_temp : TPS_NO_VALUE, bus_error);
+}
+
+/**
+ * Apply settings that changed since the last poll. Only called from the sensor task, which owns the poll loop, the
+ * I2C clock and the sensor's alert limits.
+*/
+static void apply_config()
+{
+    // Read the generation first. A change made while applying is picked up on the next poll.
+    s_applied_cfg_generation = cfg_get_generation();
+
+    resize_history(cfg_get_u32(CFG_HIST_SIZE));
+
+    uint32_t i2c_freq_hz = cfg_get_u32(CFG_I2C_FREQ_HZ);
+    if (i2c_freq_hz != s_applied_i2c_freq_hz)
+    {
+        hw_mcp9808_bus_init(i2c_freq_hz);
+        s_applied_i2c_freq_hz = i2c_freq_hz;
+    }
+
+    s_alert_limits_pending = true;
+}
+
+/**
+ * Copy the high and low alert thresholds into the sensor's alert limit registers, so its alert pin follows the same
+ * limits without the firmware polling. Done here rather than by the alerts module, whose reading callback must not
+ * touch the bus. Only called from the sensor task.
+*/
+static int mirror_alert_limits()
+{
+#if ALT_HW_ALERT_MIRROR
+    hw_mcp9808_alert alert = {
+        .upper = cfg_get_i32(CFG_ALERT_HIGH),
+        .lower = cfg_get_i32(CFG_ALERT_LOW),
+        .upper_on = cfg_get_u32(CFG_ALERT_HIGH_ON) != 0,
+        .lower_on = cfg_get_u32(CFG_ALERT_LOW_ON) != 0,
+        .hysteresis = (int32_t)cfg_get_u32(CFG_ALERT_HYST)
+    };
+
+    if (hw_mcp9808_set_alert(&alert) != HW_MCP9808_OK)
+    {
+        ESP_LOGI(LOG_TAG, "Failed to set sensor alert limits");
+        return TPS_FAIL;
+    }
+#endif
+    return TPS_OK;
+}
+
+/**
+ * Change how much of the history arena is used, keeping the newest readings that still fit. Thread safe.
+ *
+ * The ring always spans the whole arena, so this only changes the limit; nothing is moved.
+*/
+static void resize_history(size_t new_size)
+{
+    if (new_size == 0 || new_size > TPS_HIST_ARENA_SIZE)
+    {
+        return;
+    }
+
+    // Must lock data to write.
+    BaseType_t take_success = xSemaphoreTake(s_value_mutex, SEMI_WAIT_TIME);
+    if (take_success == pdFALSE)
+    {
+        return;
+    }
+
+    size_t old_size = rbuf_limit(&s_history);
+    if (new_size != old_size)
+    {
+        rbuf_set_limit(&s_history, new_size);
+        refit_trend();
+        ++s_generation;
+
+        ESP_LOGI(LOG_TAG, "History resized from %u to %u", old_size, new_size);
+    }
+
+    // Must free lock!
+    xSemaphoreGive(s_value_mutex);
+}
+
+/**
+ * Add a sample to the history ring, keeping the trend line over the same samples. Constant time: the sample the ring
+ * drops is taken out of the line's sums. Must hold the lock.
+*/
+static void history_push(const tps_sample* sample)
+{
+    if (rbuf_count(&s_history) == 0)
+    {
+        trd_fit_clear(&s_trend_fit, sample->time_s);
+    }
+    else if (rbuf_count(&s_history) == rbuf_limit(&s_history))
+    {
+        const tps_sample* dropped = hist_at(0);
+        trd_fit_remove(&s_trend_fit, dropped->time_s, dropped->value);
+    }
+
+    rbuf_push(&s_history, sample);
+    trd_fit_add(&s_trend_fit, sample->time_s, sample->value);
+
+    // Times are kept relative to the oldest sample, so the sums stay small.
+    trd_fit_rebase(&s_trend_fit, hist_at(0)->time_s);
+}
+
+/**
+ * Rebuild the trend line from the history ring, after its size changed. Must hold the lock.
+*/
+static void refit_trend()
+{
+    size_t count = rbuf_count(&s_history);
+
+    trd_fit_clear(&s_trend_fit, count > 0 ? hist_at(0)->time_s : 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        trd_fit_add(&s_trend_fit, hist_at(i)->time_s, hist_at(i)->value);
+    }
+}
+
+/**
+ * Copy samples from the long term history, like tps_get_range. Must hold the lock.
+*/
+static size_t deep_get_range(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size, bool* more)
+{
+    size_t count = 0;
+    tsr_iter it;
+
+    if (!tsr_seek(&s_deep_history, from_s, &it))
+    {
+        return 0;
+    }
+
+    do
+    {
+        if (it.point.time > to_s)
+        {
+            break;
+        }
+
+        if (count == size)
+        {
+            if (more != NULL)
+            {
+                *more = true;
+            }
+            break;
+        }
+
+        samples[count].time_s = it.point.time;
+        samples[count].value = it.point.value;
+        ++count;
+    } while (tsr_next(&it));
+
+    return count;
+}
+
+/**
+ * Downsample a range of the ring. Must hold the lock.
+*/
+static size_t hist_downsample(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size)
+{
+    size_t start = hist_lower_bound(from_s);
+    size_t end = to_s < UINT32_MAX ? hist_lower_bound(to_s + 1) : rbuf_count(&s_history);
+    if (start >= end)
+    {
+        return 0;
+    }
+
+    dsm_minmax dsm;
+    dsm_point points[DSM_MAX_OUT];
+    size_t count = 0;
+
+    dsm_init(&dsm, hist_at(start)->time_s, to_s, size);
+
+    for (size_t i = start; i < end; ++i)
+    {
+        const tps_sample* sample = hist_at(i);
+        count = store_points(samples, size, count, points, dsm_add(&dsm, sample->time_s, sample->value, points));
+    }
+
+    return store_points(samples, size, count, points, dsm_finish(&dsm, points));
+}
+
+/**
+ * Downsample a range of the long term history, decoding each point once. Must hold the lock.
+*/
+static size_t deep_downsample(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size)
+{
+    tsr_iter it;
+    if (!tsr_seek(&s_deep_history, from_s, &it) || it.point.time > to_s)
+    {
+        return 0;
+    }
+
+    dsm_minmax dsm;
+    dsm_point points[DSM_MAX_OUT];
+    size_t count = 0;
+
+    dsm_init(&dsm, it.point.time, to_s, size);
+
+    do
+    {
+        if (it.point.time > to_s)
+        {
+            break;
+        }
+
+        count = store_points(samples, size, count, points, dsm_add(&dsm, it.point.time, it.point.value, points));
+    } while (tsr_next(&it));
+
+    return store_points(samples, size, count, points, dsm_finish(&dsm, points));
+}
+
+/**
+ * Copy finished downsampled points after the count already stored, up to size. Returns the new count. The spans are
+ * sized so they always fit, but a point that doesn't is dropped rather than written past the end.
+*/
+static size_t store_points(tps_sample* samples, size_t size, size_t count, const dsm_point* points,
+    size_t point_count)
+{
+    for (size_t i = 0; i < point_count && count < size; ++i)
+    {
+        samples[count].time_s = points[i].time;
+        samples[count].value = points[i].value;
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * Get a history sample by index, where 0 is the oldest. Must hold the lock.
+*/
+static const tps_sample* hist_at(size_t idx)
+{
+    return (const tps_sample*)rbuf_at(&s_history, idx);
+}
+
+/**
+ * Find the index of the first sample taken at or after time_s. Returns the sample count if there is none. Must hold
+ * the lock.
+*/
+static size_t hist_lower_bound(uint32_t time_s)
+{
+    size_t low = 0;
+    size_t high = rbuf_count(&s_history);
+
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (hist_at(mid)->time_s < time_s)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
 }
@@ -2,14 +2,71 @@
 #define _WA_TEMP_SENSOR_H_INCLUDE_GUARD
 
 #include <inttypes.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "tempr_sensor_types.h"
 
+/**
+ * Called on the sensor task for every reading. Must not block: no waiting on locks and no bus transfers. Work that
+ * must wait belongs on a queue subscriber's task.
+*/
+typedef void (*tps_reading_fn)(const tps_reading* reading, void* ctx);
+
+/**
+ * What a queue subscriber loses when its queue is full: the new reading, or the oldest queued one to make room.
+*/
+typedef enum tps_drop_policy
+{
+    TPS_DROP_NEWEST,
+    TPS_DROP_OLDEST
+} tps_drop_policy;
+
+/**
+ * Per subscriber counts. delivered counts readings handed over (called with or queued); dropped counts readings the
+ * subscriber lost to a full queue, whether new or already queued.
+*/
+typedef struct tps_subscriber_stats
+{
+    const char* name;
+    uint32_t delivered;
+    uint32_t dropped;
+} tps_subscriber_stats;
+
 int tps_init();
 
+size_t tps_static_size();
+
 void tps_task(void* params);
 
 int tps_get_last(int32_t* last_value, uint8_t* last_error);
 
-int tps_get_hist_values(int32_t* hist_array, ssize_t size);
+int tps_get_hist_values(tps_sample* hist_array, ssize_t size);
+
+int tps_get_range(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size, bool* more);
+
+int tps_get_downsampled(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size);
+
+uint32_t tps_get_generation();
+
+uint32_t tps_uptime_s();
+
+void tps_set_wall_time(int64_t unix_time_s);
+
+bool tps_get_wall_offset(int64_t* offset_s);
+
+bool tps_get_quantiles(tps_window window, tps_quantiles* quantiles);
+
+bool tps_get_trend(tps_trend* trend);
+
+void tps_get_i2c_stats(tps_i2c_stats* stats);
+
+int tps_subscribe(const char* name, tps_reading_fn fn, void* ctx);
+
+int tps_subscribe_queue(const char* name, QueueHandle_t queue, tps_drop_policy policy);
+
+size_t tps_get_bus_stats(tps_subscriber_stats* stats, size_t max, uint32_t* published);
 
 #endif // _WA_TEMP_SENSOR_H_INCLUDE_GUARD
@@ -9,10 +9,102 @@
 #define TPS_OK 0
 #define TPS_FAIL 1
 
+// Why the last poll has no reading. The bus codes are also counted per read attempt (tps_i2c_stats).
 #define TPS_TEMP_OK 0
+// Anything not below.
 #define TPS_TEMP_FAIL 1
+// The I2C bus lock wasn't free within the attempt's budget (a web handler or a driver reinstall had it).
+#define TPS_TEMP_BUSY 2
+// The transfer ran out of time; usually SDA held low by the sensor.
+#define TPS_TEMP_TIMEOUT 3
+// The sensor didn't acknowledge: not connected, or not powered.
+#define TPS_TEMP_NACK 4
+// The I2C driver isn't installed, e.g. a reinstall at a new clock rate failed.
+#define TPS_TEMP_NO_DRIVER 5
+// Bus recovery couldn't get the sensor to let go of SDA.
+#define TPS_TEMP_BUS_STUCK 6
+// The values were locked too long to read (from tps_get_last, not the bus).
+#define TPS_TEMP_LOCKED 7
+#define TPS_TEMP_ERROR_COUNT 8
 
 // Hole temperature in hundredths of degrees fahrenheit.
 typedef int32_t temper_t;
 
+/**
+ * A reading with the time it was taken, in seconds of uptime. Add the wall clock offset (if a client set one) to get
+ * Unix time.
+*/
+typedef struct tps_sample
+{
+    uint32_t time_s;
+    temper_t value;
+} tps_sample;
+
+/**
+ * One poll of the sensor, as published on the reading bus. value is TPS_NO_VALUE if the read failed, and error says why
+ * (a TPS_TEMP_ code). seq counts polls from 1, so a subscriber can tell if it missed any.
+*/
+typedef struct tps_reading
+{
+    uint32_t seq;
+    uint32_t time_s;
+    temper_t value;
+    uint8_t error;
+} tps_reading;
+
+/**
+ * Sensor read counts since boot. attempts counts each read attempt by its TPS_TEMP_ code, so attempts[TPS_TEMP_OK] is
+ * good reads, plus bus recoveries that failed under TPS_TEMP_BUS_STUCK. A poll retries failed attempts and frees a
+ * stuck bus (recoveries) before giving up (failed_polls).
+*/
+typedef struct tps_i2c_stats
+{
+    uint32_t attempts[TPS_TEMP_ERROR_COUNT];
+    uint32_t retries;
+    uint32_t recoveries;
+    uint32_t failed_polls;
+} tps_i2c_stats;
+
+typedef enum tps_window
+{
+    TPS_WINDOW_HOUR,
+    TPS_WINDOW_DAY,
+    TPS_WINDOW_COUNT
+} tps_window;
+
+/**
+ * Estimated 5th, 50th and 95th percentiles of the readings over a window. span_s is how far back the estimate reaches
+ * (between half and all of the window) and count how many readings it is based on.
+*/
+typedef struct tps_quantiles
+{
+    uint32_t count;
+    uint32_t span_s;
+    temper_t p5;
+    temper_t p50;
+    temper_t p95;
+} tps_quantiles;
+
+typedef enum tps_confidence
+{
+    TPS_CONFIDENCE_LOW,
+    TPS_CONFIDENCE_MEDIUM,
+    TPS_CONFIDENCE_HIGH
+} tps_confidence;
+
+/**
+ * Trend of the readings in the history. slope_per_hour is the least-squares slope in hundredths of degrees per hour;
+ * r2_permille and count say how well a straight line explains the history (confidence sums them up). forecast is the
+ * Holt forecast forecast_s seconds after the last reading.
+*/
+typedef struct tps_trend
+{
+    int32_t slope_per_hour;
+    uint16_t r2_permille;
+    uint16_t count;
+    tps_confidence confidence;
+    temper_t forecast;
+    uint32_t forecast_s;
+} tps_trend;
+
 #endif // _WA_TEMP_SENSOR_TYPES_H_INCLUDE_GUARD
@@ -0,0 +1,826 @@
+#include <esp_chip_info.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string_builder.h>
+#include <seg_builder.h>
+#include <tempr_format.h>
+
+#include "web_pages.h"
+#include "temp_sensor.h"
+#include "hw_mcp9808.h"
+#include "config_store.h"
+#include "alerts.h"
+#include "boot_timeline.h"
+#include "prj_config.h"
+
+// Longest history sample in JSON: ",[4294967295,-2147483648]".
+#define SAMPLE_JSON_MAX 25
+
+// Longest alert event in JSON, with "unknown" as the rule and the longest numbers.
+#define ALERT_JSON_MAX 89
+
+// Space reserved for each part of the stats response, as in the comments above each reserve.
+#define TIME_FIELDS_JSON_MAX 54
+#define QUANTILES_JSON_MAX 96
+#define TREND_JSON_MAX 116
+#define ADMISSION_JSON_MAX 84
+#define I2C_HEAD_JSON_MAX 101
+#define I2C_ERROR_JSON_MAX 24
+#define I2C_JSON_MAX (I2C_HEAD_JSON_MAX + (TPS_TEMP_BUS_STUCK - TPS_TEMP_FAIL + 1) * I2C_ERROR_JSON_MAX + 2)
+#define GZIP_JSON_MAX 126
+#define STATS_JSON_MAX (sizeof("{,\"hour\":,\"day\":,\"trend\":,\"admission\":,\"i2c\":,\"gzip\":}") - 1 + \
+    TIME_FIELDS_JSON_MAX + 2 * QUANTILES_JSON_MAX + TREND_JSON_MAX + ADMISSION_JSON_MAX + I2C_JSON_MAX + GZIP_JSON_MAX)
+
+// The home page's average is taken from the charted readings.
+static_assert(WEBS_CHART_POINTS >= TPS_HIST_READ_SIZE, "Chart must hold the averaged readings");
+
+// A part that doesn't fit is written as null, so the stats buffer must hold every part at its longest.
+static_assert(WEBS_STATS_JSON_SIZE > STATS_JSON_MAX, "Stats buffer must hold the longest stats response");
+
+static const char* chip_model_str(esp_chip_model_t model);
+static void append_escaped(strbld_t* sb, const char* value);
+static int32_t calc_average(const tps_sample* samples, int size);
+static void append_time_fields(strbld_t* sb);
+static void add_temper(sgb_t* sgb, int32_t value);
+static void add_u32(sgb_t* sgb, uint32_t value);
+static void add_quantiles(sgb_t* sgb, tps_window window);
+static void append_quantiles_json(strbld_t* sb, tps_window window);
+static void add_trend(sgb_t* sgb);
+static void append_trend_json(strbld_t* sb);
+static const char* confidence_str(tps_confidence confidence);
+static void append_admission_json(strbld_t* sb, const wpg_admission_stats* admission);
+static void append_i2c_json(strbld_t* sb);
+static void append_gzip_json(strbld_t* sb, const wpg_gzip_stats* gzip);
+static const char* temp_error_str(uint8_t error);
+static void add_boot_phase(sgb_t* sgb, btl_phase phase);
+static void add_ms(sgb_t* sgb, int64_t us);
+static void add_chart(sgb_t* sgb, const tps_sample* newest_first, int count);
+
+/**
+ * Build the home page, which displays temperature readings. The markup is referenced in place; only the readings are
+ * formatted into scratch.
+*/
+void wpg_home_page(sgb_t* sgb)
+{
+    // Get the last temperature read by the sensor.
+    int32_t last_temp;
+    uint8_t last_err;
+    tps_get_last(&last_temp, &last_err);
+
+    sgb_add_static(sgb, SGB_LIT(
+        "<html><head><title>Scottz0r RTOS Web Temp</title></head><body>"
+        "<h2>Temperature: "));
+    add_temper(sgb, last_temp);
+    if (last_err != TPS_TEMP_OK)
+    {
+        sgb_add_static(sgb, SGB_LIT(" (sensor "));
+        sgb_add_str(sgb, temp_error_str(last_err));
+        sgb_add_static(sgb, SGB_LIT(")"));
+    }
+    sgb_add_static(sgb, SGB_LIT("</h2>"));
+
+    tps_sample hist_array[WEBS_CHART_POINTS];
+    int hist_count = tps_get_hist_values(hist_array, WEBS_CHART_POINTS);
+
+    // Display average temperature of the newest readings.
+    sgb_add_static(sgb, SGB_LIT("<p>Average Temperature: "));
+    add_temper(sgb, calc_average(hist_array, hist_count < TPS_HIST_READ_SIZE ? hist_count : TPS_HIST_READ_SIZE));
+    sgb_add_static(sgb, SGB_LIT("</p>"));
+
+    // Percentiles show the spikes the average hides.
+    sgb_add_static(sgb, SGB_LIT("<p>Last hour (5% / median / 95%): "));
+    add_quantiles(sgb, TPS_WINDOW_HOUR);
+    sgb_add_static(sgb, SGB_LIT("</p><p>Last day (5% / median / 95%): "));
+    add_quantiles(sgb, TPS_WINDOW_DAY);
+    sgb_add_static(sgb, SGB_LIT("</p><p>Trend: "));
+    add_trend(sgb);
+    sgb_add_static(sgb, SGB_LIT("</p>"));
+
+    // Chart the history of values.
+    sgb_add_static(sgb, SGB_LIT("<h3>Most recent values</h3>"));
+    add_chart(sgb, hist_array, hist_count);
+
+    // Links
+    sgb_add_static(sgb, SGB_LIT(
+        "<p>[<a href=\"/info\">device info</a>] [<a href=\"/config\">settings</a>]</p>"
+        "</body></html>"));
+}
+
+/**
+ * Build the info page, which displays chip and sensor information.
+*/
+void wpg_info_page(sgb_t* sgb)
+{
+    hw_mcp9808_dinfo info;
+    hw_mcp9808_read_device_info(&info);
+
+    esp_chip_info_t chip_info;
+    esp_chip_info(&chip_info);
+
+    sgb_add_static(sgb, SGB_LIT(
+        "<html><head><title>Scottz0r RTOS Web Temp ~ Info</title></head><body>"
+        "<h1>Device Info</h1>"
+        "<p>Chip Model: "));
+    sgb_add_str(sgb, chip_model_str(chip_info.model));
+
+    sgb_add_static(sgb, SGB_LIT("</p><p>Chip Revision (M.XX): "));
+    add_u32(sgb, chip_info.revision);
+
+    sgb_add_static(sgb, SGB_LIT("</p><p>Cores: "));
+    add_u32(sgb, chip_info.cores);
+
+    sgb_add_static(sgb, SGB_LIT("</p><h2>MCP9808 Info</h2><p>Device Id: "));
+    add_u32(sgb, info.device_id);
+
+    sgb_add_static(sgb, SGB_LIT("</p><p>Device Revision: "));
+    add_u32(sgb, info.device_revision);
+
+    sgb_add_static(sgb, SGB_LIT("</p><p>Manufacturer Id: "));
+    add_u32(sgb, info.manufacturer_id);
+
+    // Boot timeline, in ms since the timer started.
+    sgb_add_static(sgb, SGB_LIT(
+        "</p><h2>Boot Timeline</h2><table><tr><th>Phase</th><th>Start (ms)</th><th>Duration (ms)</th></tr>"));
+
+    for (int i = 0; i < BTL_COUNT; ++i)
+    {
+        add_boot_phase(sgb, (btl_phase)i);
+    }
+
+    // Links
+    sgb_add_static(sgb, SGB_LIT("</table><p>"));
+    sgb_add_static(sgb, SGB_LIT("[<a href=\"/\">home</a>]</p></body></html>"));
+}
+
+/**
+ * Build the settings page. The message, if not NULL, is shown above the form (e.g. the result of a save).
+*/
+size_t wpg_config_page(char* buffer, size_t buffer_size, const char* message)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, buffer_size);
+
+    char value[CFG_STR_MAX_SIZE];
+
+    strbld_append_n(&sb, STRBLD_LIT("<html>"));
+    strbld_append_n(&sb, STRBLD_LIT("<head>"));
+    strbld_append_html(&sb, "Scottz0r RTOS Web Temp ~ Settings", "title");
+    strbld_append_n(&sb, STRBLD_LIT("</head>"));
+    strbld_append_n(&sb, STRBLD_LIT("<body>"));
+
+    strbld_append_html(&sb, "Settings", "h1");
+
+    if (message != NULL)
+    {
+        strbld_append_n(&sb, STRBLD_LIT("<p>"));
+        append_escaped(&sb, message);
+        strbld_append_n(&sb, STRBLD_LIT("</p>"));
+    }
+
+    strbld_append_n(&sb, STRBLD_LIT("<form method=\"post\" action=\"/config\">"));
+
+    for (int i = 0; i < CFG_KEY_COUNT; ++i)
+    {
+        cfg_key key = (cfg_key)i;
+
+        if (cfg_get_type(key) == CFG_TYPE_U32)
+        {
+            sprintf(value, "%u", (unsigned)cfg_get_u32(key));
+        }
+        else if (cfg_get_type(key) == CFG_TYPE_I32)
+        {
+            sprintf(value, "%d", (int)cfg_get_i32(key));
+        }
+        else if (cfg_is_secret(key))
+        {
+            // Secrets are never sent back. Leaving the field empty keeps the current value.
+            value[0] = 0;
+        }
+        else
+        {
+            cfg_get_str(key, value, sizeof(value));
+        }
+
+        strbld_append_n(&sb, STRBLD_LIT("<p>"));
+        strbld_append(&sb, cfg_name(key));
+        strbld_append_n(&sb, STRBLD_LIT(": <input name=\""));
+        strbld_append(&sb, cfg_name(key));
+        strbld_append(&sb, cfg_is_secret(key) ? "\" type=\"password\" value=\"" : "\" value=\"");
+        append_escaped(&sb, value);
+        strbld_append_n(&sb, STRBLD_LIT("\"></p>"));
+    }
+
+    strbld_append_n(&sb, STRBLD_LIT("<p><input type=\"submit\" value=\"Save\"></p>"));
+    strbld_append_n(&sb, STRBLD_LIT("</form>"));
+
+    // Links
+    strbld_append_n(&sb, STRBLD_LIT("<p>[<a href=\"/\">home</a>]</p>"));
+
+    strbld_append_n(&sb, STRBLD_LIT("</body></html>"));
+
+    size_t slen = 0;
+    strbld_get(&sb, &slen);
+
+    return slen;
+}
+
+/**
+ * Build the history API response: the samples taken between from_s and to_s (seconds of uptime, inclusive), oldest
+ * first, as [time, value] pairs. There is at most one sample per second, so times are unique. At most
+ * WEBS_API_MAX_SAMPLES are returned; if "more" is true the client continues from the last time plus one. Values are
+ * hundredths of degrees fahrenheit.
+ *
+ * If points is not 0, the whole range is downsampled to at most that many samples (2 to WEBS_API_MAX_SAMPLES) instead,
+ * keeping the low and high of each span of time, and "more" is false.
+*/
+size_t wpg_history_json(char* buffer, size_t buffer_size, uint32_t from_s, uint32_t to_s, uint32_t points)
+{
+    tps_sample samples[WEBS_API_MAX_SAMPLES];
+    bool more = false;
+    int count;
+
+    if (points == 0)
+    {
+        count = tps_get_range(from_s, to_s, samples, WEBS_API_MAX_SAMPLES, &more);
+    }
+    else
+    {
+        points = points < 2 ? 2 : points;
+        points = points > WEBS_API_MAX_SAMPLES ? WEBS_API_MAX_SAMPLES : points;
+        count = tps_get_downsampled(from_s, to_s, samples, points);
+    }
+
+    strbld_t sb;
+    strbld_init(&sb, buffer, buffer_size);
+
+    strbld_append_char(&sb, '{');
+    append_time_fields(&sb);
+    strbld_append_n(&sb, STRBLD_LIT(",\"samples\":["));
+
+    // Format each sample in place. A sample that doesn't fit is left out whole rather than cut.
+    for (int i = 0; i < count; ++i)
+    {
+        char* p = strbld_reserve(&sb, SAMPLE_JSON_MAX);
+        if (p == NULL)
+        {
+            break;
+        }
+
+        int len = snprintf(p, SAMPLE_JSON_MAX + 1, "%s[%" PRIu32 ",%" PRId32 "]", i > 0 ? "," : "",
+            samples[i].time_s, samples[i].value);
+        strbld_commit(&sb, (size_t)len);
+    }
+
+    strbld_append(&sb, more ? "],\"more\":true}" : "],\"more\":false}");
+
+    size_t slen = 0;
+    strbld_get(&sb, &slen);
+
+    return slen;
+}
+
+/**
+ * Build the time API response: the uptime and the wall clock offset (null until a client sets the time).
+*/
+size_t wpg_time_json(char* buffer, size_t buffer_size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, buffer_size);
+
+    strbld_append_char(&sb, '{');
+    append_time_fields(&sb);
+    strbld_append_char(&sb, '}');
+
+    size_t slen = 0;
+    strbld_get(&sb, &slen);
+
+    return slen;
+}
+
+/**
+ * Build the stats API response: estimated 5th, 50th and 95th percentiles over the last hour and day, and the trend.
+ * Each window has "span" (seconds the estimate reaches back) and "count" (readings), or is null before the first
+ * reading. The trend has "slope" (per hour) over the history, "r2" (thousandths) and "count" for the fit, a
+ * "confidence" of low, medium or high, and "forecast", "forecast_s" seconds ahead; it is null until there are two
+ * readings. Values are hundredths of degrees fahrenheit. "i2c" counts sensor reads since boot: good "reads", "retries",
+ * bus "recoveries", "failed_polls", and failed attempts by cause in "errors". "gzip" counts compressed "responses",
+ * their bytes "in" and "out", the "ratio" of out to in (thousandths, null before the first) and the "cpu_us" spent
+ * compressing.
+*/
+size_t wpg_stats_json(char* buffer, size_t buffer_size, const wpg_admission_stats* admission,
+    const wpg_gzip_stats* gzip)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, buffer_size);
+
+    strbld_append_char(&sb, '{');
+    append_time_fields(&sb);
+    strbld_append_n(&sb, STRBLD_LIT(",\"hour\":"));
+    append_quantiles_json(&sb, TPS_WINDOW_HOUR);
+    strbld_append_n(&sb, STRBLD_LIT(",\"day\":"));
+    append_quantiles_json(&sb, TPS_WINDOW_DAY);
+    strbld_append_n(&sb, STRBLD_LIT(",\"trend\":"));
+    append_trend_json(&sb);
+    strbld_append_n(&sb, STRBLD_LIT(",\"admission\":"));
+    append_admission_json(&sb, admission);
+    strbld_append_n(&sb, STRBLD_LIT(",\"i2c\":"));
+    append_i2c_json(&sb);
+    strbld_append_n(&sb, STRBLD_LIT(",\"gzip\":"));
+    append_gzip_json(&sb, gzip);
+    strbld_append_char(&sb, '}');
+
+    size_t slen = 0;
+    strbld_get(&sb, &slen);
+
+    return slen;
+}
+
+/**
+ * Build the alerts API response: the alert events after after_seq, oldest first. "last" is the newest sequence number
+ * returned (or the newest queued if none, which is lower than after_seq after a restart); clients pass it back as after
+ * on the next poll. A gap in the sequence numbers means events were dropped from the queue before the client saw them.
+ * Values are hundredths of degrees fahrenheit, or hundredths per minute for the rate rule.
+*/
+size_t wpg_alerts_json(char* buffer, size_t buffer_size, uint32_t after_seq)
+{
+    alt_event events[WEBS_ALERT_MAX_EVENTS];
+    uint32_t last;
+    size_t count = alt_get_events(after_seq, events, WEBS_ALERT_MAX_EVENTS, &last);
+    if (count > 0)
+    {
+        last = events[count - 1].seq;
+    }
+
+    strbld_t sb;
+    strbld_init(&sb, buffer, buffer_size);
+
+    strbld_append_char(&sb, '{');
+    append_time_fields(&sb);
+
+    char* p = strbld_reserve(&sb, 32);
+    if (p != NULL)
+    {
+        int len = snprintf(p, 33, ",\"last\":%" PRIu32 ",\"events\":[", last);
+        strbld_commit(&sb, (size_t)len);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const alr_event* e = &events[i].event;
+
+        p = strbld_reserve(&sb, ALERT_JSON_MAX);
+        if (p == NULL)
+        {
+            break;
+        }
+
+        int len = snprintf(p, ALERT_JSON_MAX + 1,
+            "%s{\"seq\":%" PRIu32 ",\"time\":%" PRIu32 ",\"rule\":\"%s\",\"raised\":%s,\"value\":%" PRId32 "}",
+            i > 0 ? "," : "", events[i].seq, e->time_s, alt_rule_name(e->rule), e->raised ? "true" : "false", e->value);
+        strbld_commit(&sb, (size_t)len);
+    }
+
+    strbld_append_n(&sb, STRBLD_LIT("]}"));
+
+    size_t slen = 0;
+    strbld_get(&sb, &slen);
+
+    return slen;
+}
+
+/**
+ * Append the "uptime" and "wall_offset" JSON fields. Sample time plus wall_offset is Unix time.
+*/
+static void append_time_fields(strbld_t* sb)
+{
+    // "uptime":4294967295,"wall_offset":-9223372036854775808
+    char fmt_buff[48];
+
+    sprintf(fmt_buff, "\"uptime\":%" PRIu32 ",\"wall_offset\":", tps_uptime_s());
+    strbld_append(sb, fmt_buff);
+
+    int64_t offset_s;
+    if (tps_get_wall_offset(&offset_s))
+    {
+        sprintf(fmt_buff, "%" PRId64, offset_s);
+        strbld_append(sb, fmt_buff);
+    }
+    else
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+    }
+}
+
+/**
+ * Add a temperature, formatted into scratch.
+*/
+static void add_temper(sgb_t* sgb, int32_t value)
+{
+    char* p = sgb_reserve(sgb, TEMPER_FORMAT_SIZE);
+    if (p != NULL)
+    {
+        tempr_format(value, p);
+        sgb_commit(sgb, strlen(p));
+    }
+}
+
+/**
+ * Add a number, formatted into scratch.
+*/
+static void add_u32(sgb_t* sgb, uint32_t value)
+{
+    // Ten digits and the terminator snprintf writes.
+    char* p = sgb_reserve(sgb, 11);
+    if (p != NULL)
+    {
+        int len = snprintf(p, 11, "%" PRIu32, value);
+        sgb_commit(sgb, (size_t)len);
+    }
+}
+
+/**
+ * Add a boot timeline row. Milestones have no duration, and phases not reached or still running leave theirs empty.
+*/
+static void add_boot_phase(sgb_t* sgb, btl_phase phase)
+{
+    btl_span span;
+    bool begun = btl_get(phase, &span);
+
+    const char* name = btl_name(phase);
+    sgb_add_static(sgb, SGB_LIT("<tr><td>"));
+    sgb_add_static(sgb, name, strlen(name));
+    sgb_add_static(sgb, SGB_LIT("</td><td>"));
+
+    // The times and the cell break between them all go to scratch, so they share one segment.
+    if (begun)
+    {
+        add_ms(sgb, span.begin_us);
+    }
+    else
+    {
+        sgb_add_copy(sgb, SGB_LIT("-"));
+    }
+
+    sgb_add_copy(sgb, SGB_LIT("</td><td>"));
+
+    if (begun && span.ended && phase < BTL_FIRST_READING)
+    {
+        add_ms(sgb, span.end_us - span.begin_us);
+    }
+
+    sgb_add_static(sgb, SGB_LIT("</td></tr>"));
+}
+
+/**
+ * Add a time in milliseconds with one decimal, formatted into scratch.
+*/
+static void add_ms(sgb_t* sgb, int64_t us)
+{
+    // Up to 19 digits, the point and the terminator snprintf writes.
+    char* p = sgb_reserve(sgb, 21);
+    if (p != NULL)
+    {
+        int len = snprintf(p, 21, "%" PRId64 ".%" PRId64, us / 1000, (us / 100) % 10);
+        sgb_commit(sgb, (size_t)len);
+    }
+}
+
+/**
+ * Add a sparkline of the readings as an SVG polyline, oldest on the left, with the low and high below. Points are
+ * evenly spaced by reading rather than by time, and the vertical scale is fit to the low and high.
+ *
+ * The points are written in one pass, each straight into scratch, so they form a single segment. Coordinates are
+ * integer pixels; the chart's size only depends on the number of readings, which the caller bounds.
+*/
+static void add_chart(sgb_t* sgb, const tps_sample* newest_first, int count)
+{
+    if (count < 2)
+    {
+        sgb_add_static(sgb, SGB_LIT("<p>not enough readings yet</p>"));
+        return;
+    }
+
+    int32_t low = newest_first[0].value;
+    int32_t high = low;
+    for (int i = 1; i < count; ++i)
+    {
+        if (newest_first[i].value < low)
+        {
+            low = newest_first[i].value;
+        }
+        if (newest_first[i].value > high)
+        {
+            high = newest_first[i].value;
+        }
+    }
+
+    // One pixel of margin top and bottom so the stroke isn't clipped. A flat line is drawn across the middle.
+    const int64_t range = (int64_t)high - low;
+    const int64_t plot_height = WEBS_CHART_HEIGHT - 3;
+
+    sgb_add_static(sgb, SGB_LIT("<svg width=\""));
+    add_u32(sgb, WEBS_CHART_WIDTH);
+    sgb_add_static(sgb, SGB_LIT("\" height=\""));
+    add_u32(sgb, WEBS_CHART_HEIGHT);
+    sgb_add_static(sgb, SGB_LIT("\"><polyline fill=\"none\" stroke=\"#c33\" stroke-width=\"2\" points=\""));
+
+    for (int i = count - 1; i >= 0; --i)
+    {
+        int x = (count - 1 - i) * (WEBS_CHART_WIDTH - 1) / (count - 1);
+        int y = range == 0 ? WEBS_CHART_HEIGHT / 2
+            : 1 + (int)(((int64_t)high - newest_first[i].value) * plot_height / range);
+
+        // Two coordinates up to 9999, the comma, the space and the terminator snprintf writes.
+        char* p = sgb_reserve(sgb, 12);
+        if (p == NULL)
+        {
+            break;
+        }
+
+        int len = snprintf(p, 12, "%d,%d ", x, y);
+        sgb_commit(sgb, (size_t)len);
+    }
+
+    sgb_add_static(sgb, SGB_LIT("\"/></svg><p>Low "));
+    add_temper(sgb, low);
+    sgb_add_static(sgb, SGB_LIT(" / High "));
+    add_temper(sgb, high);
+    sgb_add_static(sgb, SGB_LIT("</p>"));
+}
+
+/**
+ * Add a window's percentiles as "p5 / p50 / p95".
+*/
+static void add_quantiles(sgb_t* sgb, tps_window window)
+{
+    tps_quantiles q;
+    if (!tps_get_quantiles(window, &q))
+    {
+        sgb_add_static(sgb, SGB_LIT("no readings yet"));
+        return;
+    }
+
+    add_temper(sgb, q.p5);
+    sgb_add_static(sgb, SGB_LIT(" / "));
+    add_temper(sgb, q.p50);
+    sgb_add_static(sgb, SGB_LIT(" / "));
+    add_temper(sgb, q.p95);
+}
+
+static void append_quantiles_json(strbld_t* sb, tps_window window)
+{
+    tps_quantiles q;
+    if (!tps_get_quantiles(window, &q))
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+        return;
+    }
+
+    // {"span":4294967295,"count":4294967295,"p5":-2147483648,"p50":-2147483648,"p95":-2147483648}
+    char* p = strbld_reserve(sb, QUANTILES_JSON_MAX);
+    if (p == NULL)
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+    }
+    else
+    {
+        int len = snprintf(p, QUANTILES_JSON_MAX + 1, "{\"span\":%" PRIu32 ",\"count\":%" PRIu32 ",\"p5\":%" PRId32
+            ",\"p50\":%" PRId32 ",\"p95\":%" PRId32 "}", q.span_s, q.count, q.p5, q.p50, q.p95);
+        strbld_commit(sb, (size_t)len);
+    }
+}
+
+/**
+ * Add the trend as "+0.50 per hour (high confidence), 71.00 in 1 hour".
+*/
+static void add_trend(sgb_t* sgb)
+{
+    tps_trend trend;
+    if (!tps_get_trend(&trend))
+    {
+        sgb_add_static(sgb, SGB_LIT("not enough readings yet"));
+        return;
+    }
+
+    if (trend.slope_per_hour >= 0)
+    {
+        sgb_add_static(sgb, SGB_LIT("+"));
+    }
+    add_temper(sgb, trend.slope_per_hour);
+    sgb_add_static(sgb, SGB_LIT(" per hour ("));
+    sgb_add_str(sgb, confidence_str(trend.confidence));
+    sgb_add_static(sgb, SGB_LIT(" confidence), forecast "));
+    add_temper(sgb, trend.forecast);
+    sgb_add_static(sgb, SGB_LIT(" in "));
+    add_u32(sgb, trend.forecast_s / 60);
+    sgb_add_static(sgb, SGB_LIT(" minutes"));
+}
+
+static void append_trend_json(strbld_t* sb)
+{
+    tps_trend trend;
+    if (!tps_get_trend(&trend))
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+        return;
+    }
+
+    // {"slope":-2147483648,"r2":1000,"count":65535,"confidence":"medium",
+    //  "forecast":-2147483648,"forecast_s":4294967295}
+    char* p = strbld_reserve(sb, TREND_JSON_MAX);
+    if (p == NULL)
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+    }
+    else
+    {
+        int len = snprintf(p, TREND_JSON_MAX + 1, "{\"slope\":%" PRId32 ",\"r2\":%u,\"count\":%u,\"confidence\":\"%s\""
+            ",\"forecast\":%" PRId32 ",\"forecast_s\":%" PRIu32 "}", trend.slope_per_hour, (unsigned)trend.r2_permille,
+            (unsigned)trend.count, confidence_str(trend.confidence), trend.forecast, trend.forecast_s);
+        strbld_commit(sb, (size_t)len);
+    }
+}
+
+static void append_admission_json(strbld_t* sb, const wpg_admission_stats* admission)
+{
+    // {"admitted":4294967295,"limited":4294967295,"busy":4294967295,"low_heap":4294967295}
+    char* p = strbld_reserve(sb, ADMISSION_JSON_MAX);
+    if (p == NULL)
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+    }
+    else
+    {
+        int len = snprintf(p, ADMISSION_JSON_MAX + 1, "{\"admitted\":%" PRIu32 ",\"limited\":%" PRIu32 ",\"busy\":%"
+            PRIu32 ",\"low_heap\":%" PRIu32 "}", admission->admitted, admission->limited, admission->busy,
+            admission->low_heap);
+        strbld_commit(sb, (size_t)len);
+    }
+}
+
+static void append_i2c_json(strbld_t* sb)
+{
+    // The object is written in parts, so all of it must fit before the first, or it would be left open.
+    if (strbld_reserve(sb, I2C_JSON_MAX) == NULL)
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+        return;
+    }
+
+    tps_i2c_stats i2c;
+    tps_get_i2c_stats(&i2c);
+
+    // {"reads":4294967295,"retries":4294967295,"recoveries":4294967295,"failed_polls":4294967295,"errors":{
+    char* p = strbld_reserve(sb, I2C_HEAD_JSON_MAX);
+    if (p != NULL)
+    {
+        int len = snprintf(p, I2C_HEAD_JSON_MAX + 1, "{\"reads\":%" PRIu32 ",\"retries\":%" PRIu32 ",\"recoveries\":%"
+            PRIu32 ",\"failed_polls\":%" PRIu32 ",\"errors\":{", i2c.attempts[TPS_TEMP_OK], i2c.retries,
+            i2c.recoveries, i2c.failed_polls);
+        strbld_commit(sb, (size_t)len);
+    }
+
+    // Every bus cause, "fail" to "stuck". TPS_TEMP_LOCKED is never a read attempt.
+    for (uint8_t error = TPS_TEMP_FAIL; error <= TPS_TEMP_BUS_STUCK; ++error)
+    {
+        // ,"no_driver":4294967295
+        p = strbld_reserve(sb, I2C_ERROR_JSON_MAX);
+        if (p != NULL)
+        {
+            int len = snprintf(p, I2C_ERROR_JSON_MAX + 1, "%s\"%s\":%" PRIu32, error == TPS_TEMP_FAIL ? "" : ",",
+                temp_error_str(error), i2c.attempts[error]);
+            strbld_commit(sb, (size_t)len);
+        }
+    }
+
+    strbld_append_n(sb, STRBLD_LIT("}}"));
+}
+
+static void append_gzip_json(strbld_t* sb, const wpg_gzip_stats* gzip)
+{
+    // {"responses":4294967295,"in":<20 digits>,"out":<20 digits>,"ratio":4294967295,"cpu_us":<20 digits>}
+    char* p = strbld_reserve(sb, GZIP_JSON_MAX);
+    if (p == NULL)
+    {
+        strbld_append_n(sb, STRBLD_LIT("null"));
+        return;
+    }
+
+    char ratio[11] = "null";
+    if (gzip->bytes_in > 0)
+    {
+        snprintf(ratio, sizeof(ratio), "%" PRIu32, (uint32_t)(gzip->bytes_out * 1000 / gzip->bytes_in));
+    }
+
+    int len = snprintf(p, GZIP_JSON_MAX + 1, "{\"responses\":%" PRIu32 ",\"in\":%" PRIu64 ",\"out\":%" PRIu64
+        ",\"ratio\":%s,\"cpu_us\":%" PRIu64 "}", gzip->responses, gzip->bytes_in, gzip->bytes_out, ratio, gzip->cpu_us);
+    strbld_commit(sb, (size_t)len);
+}
+
+static const char* temp_error_str(uint8_t error)
+{
+    switch (error)
+    {
+    case TPS_TEMP_OK:
+        return "ok";
+    case TPS_TEMP_BUSY:
+        return "busy";
+    case TPS_TEMP_TIMEOUT:
+        return "timeout";
+    case TPS_TEMP_NACK:
+        return "nack";
+    case TPS_TEMP_NO_DRIVER:
+        return "no_driver";
+    case TPS_TEMP_BUS_STUCK:
+        return "stuck";
+    case TPS_TEMP_LOCKED:
+        return "locked";
+    default:
+        return "fail";
+    }
+}
+
+static const char* confidence_str(tps_confidence confidence)
+{
+    switch (confidence)
+    {
+    case TPS_CONFIDENCE_HIGH:
+        return "high";
+    case TPS_CONFIDENCE_MEDIUM:
+        return "medium";
+    default:
+        return "low";
+    }
+}
+
+/**
+ * Append text that may contain HTML special characters (e.g. a user set SSID).
+*/
+static void append_escaped(strbld_t* sb, const char* value)
+{
+    for (const char* p = value; *p != 0; ++p)
+    {
+        switch (*p)
+        {
+        case '&':
+            strbld_append_n(sb, STRBLD_LIT("&amp;"));
+            break;
+        case '<':
+            strbld_append_n(sb, STRBLD_LIT("&lt;"));
+            break;
+        case '>':
+            strbld_append_n(sb, STRBLD_LIT("&gt;"));
+            break;
+        case '"':
+            strbld_append_n(sb, STRBLD_LIT("&quot;"));
+            break;
+        default:
+            strbld_append_char(sb, *p);
+            break;
+        }
+    }
+}
+
+static const char* chip_model_str(esp_chip_model_t model)
+{
+    switch(model)
+    {
+    case CHIP_ESP32:
+        return "ESP32";
+    case CHIP_ESP32S2:
+        return "ESP32S2";
+    case CHIP_ESP32S3:
+        return "ESP32S3";
+    case CHIP_ESP32C3:
+        return "ESP32C3";
+    case CHIP_ESP32C2:
+        return "ESP32C2";
+    case CHIP_ESP32C6:
+        return "ESP32C6";
+    case CHIP_ESP32H2:
+        return "ESP32H2";
+    case CHIP_POSIX_LINUX:
+        return "POSIX_LINUX";
+    default:
+        return "Unknown";
+    }
+}
+
+static int32_t calc_average(const tps_sample* samples, int size)
+{
+    if (size <= 0)
+    {
+        return TPS_NO_VALUE;
+    }
+
+    int32_t sum = 0;
+
+    for(int i = 0; i < size; ++i)
+    {
+        sum += samples[i].value;
+    }
+
+    return sum / size;
+}
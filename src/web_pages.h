@@ -0,0 +1,51 @@
+/**
+ * Builders for the web server's pages. Kept free of HTTP server code so they can also be built on a host.
+*/
+#ifndef _WA_WEB_PAGES_H_INCLUDE_GUARD
+#define _WA_WEB_PAGES_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <seg_builder.h>
+
+void wpg_home_page(sgb_t* sgb);
+
+void wpg_info_page(sgb_t* sgb);
+
+size_t wpg_config_page(char* buffer, size_t buffer_size, const char* message);
+
+size_t wpg_history_json(char* buffer, size_t buffer_size, uint32_t from_s, uint32_t to_s, uint32_t points);
+
+size_t wpg_time_json(char* buffer, size_t buffer_size);
+
+/**
+ * Web server admission counters, shown in /api/stats.
+*/
+typedef struct wpg_admission_stats
+{
+    uint32_t admitted;
+    // Refused with 429: the client was over its own budget.
+    uint32_t limited;
+    // Refused with 503: over the global budget, or low on heap.
+    uint32_t busy;
+    uint32_t low_heap;
+} wpg_admission_stats;
+
+/**
+ * Response compression counters, shown in /api/stats. cpu_us is the time spent compressing, not sending.
+*/
+typedef struct wpg_gzip_stats
+{
+    uint32_t responses;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t cpu_us;
+} wpg_gzip_stats;
+
+size_t wpg_stats_json(char* buffer, size_t buffer_size, const wpg_admission_stats* admission,
+    const wpg_gzip_stats* gzip);
+
+size_t wpg_alerts_json(char* buffer, size_t buffer_size, uint32_t after_seq);
+
+#endif // _WA_WEB_PAGES_H_INCLUDE_GUARD
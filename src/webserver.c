@@ -1,42 +1,269 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <esp_log.h>
 #include <esp_system.h>
-#include <esp_chip_info.h>
 #include <esp_wifi.h>
 #include <esp_event.h>
 #include <nvs_flash.h>
 #include <esp_mac.h>
 #include <esp_http_server.h>
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+#include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
 
 #include <string_builder.h>
-#include <tempr_format.h>
+#include <seg_builder.h>
+#include <rate_limit.h>
+#include <gzip_stream.h>
 
 #include "webserver.h"
+#include "web_pages.h"
 #include "prj_config.h"
+#include "task_layout.h"
+#include "hardware_ui.h"
 #include "temp_sensor.h"
-#include "hw_mcp9808.h"
+#include "config_store.h"
+#include "alerts.h"
+#include "boot_timeline.h"
+#include "deferred_log.h"
+#include "reading_log.h"
 
 #define LOG_TAG "wbs"
+#define DLG_LEVEL DLG_LEVEL_WEBS
+
+#define RENDER_WAIT_TIME (WEBS_RENDER_WAIT_MS / portTICK_PERIOD_MS)
+#define ALERT_WAIT_TIME (WEBS_ALERT_WAIT_MS / portTICK_PERIOD_MS)
+
+// Waiting alert polls are checked for their deadline at least this often, and on every new event.
+#define ALERT_CHECK_TIME (1000 / portTICK_PERIOD_MS)
+
+// Fits the time fields and WEBS_ALERT_MAX_EVENTS events.
+#define ALERT_JSON_SIZE 1024
+
+// Every CSV export line is the same length ("0000000001,0000012345,+072.50\n"), so a byte offset maps to a record.
+#define EXPORT_CSV_HEADER "boot,uptime_s,temp_f\n"
+#define EXPORT_CSV_LINE_SIZE 30
+
+typedef void (*page_builder_fn)(sgb_t* sgb);
+typedef uint32_t (*page_generation_fn)();
+
+/**
+ * A rendered page shared by all requests for the same data generation (single flight). A request takes the lock,
+ * renders only if the data changed since the last render, then sends the rendered output. Requests that arrive during
+ * a render wait on the lock and are served from that render, so there is at most one render per data update no matter
+ * how many clients poll.
+ *
+ * The render is a segment list: markup stays in flash and only the formatted values are kept in the scratch.
+*/
+typedef struct page_cache
+{
+    page_builder_fn build;
+    page_generation_fn generation_fn;
+
+    SemaphoreHandle_t lock;
+#if PRJ_STATIC_ALLOC
+    StaticSemaphore_t lock_buffer;
+#endif
+
+    bool valid;
+    uint32_t generation;
+    sgb_t sgb;
+    sgb_segment segs[WEBS_PAGE_SEGMENTS];
+    char scratch[WEBS_PAGE_SCRATCH_SIZE];
+} page_cache;
+
+/**
+ * An /alerts request waiting for a new event. The request is detached from the httpd task (async handler), so waiting
+ * does not hold up other requests; the alerts task answers it.
+*/
+typedef struct alert_waiter
+{
+    // NULL when the slot is free.
+    httpd_req_t* req;
+    uint32_t after_seq;
+    TickType_t deadline;
+} alert_waiter;
+
+/**
+ * A handler and what a request to it costs in rate limit tokens. Every URI is registered with admit_handler and its
+ * route as the user context, so admission is checked before any handler runs.
+*/
+typedef struct route
+{
+    esp_err_t (*handler)(httpd_req_t *req);
+    uint32_t cost;
+} route;
+
+/**
+ * Reading log export formats: the log as stored, or one CSV line per record.
+*/
+typedef enum export_format
+{
+    EXPORT_RAW,
+    EXPORT_CSV
+} export_format;
+
+/**
+ * What the Range header asks for.
+*/
+typedef enum export_range
+{
+    // No Range, or one not served (several ranges, bad syntax, an If-Range for other contents): send everything.
+    EXPORT_RANGE_NONE,
+    EXPORT_RANGE_PARTIAL,
+    EXPORT_RANGE_UNSATISFIABLE
+} export_range;
+
+/**
+ * Admission control state: a token bucket per client address, one shared by all clients, and what was refused.
+*/
+typedef struct admission
+{
+    rlm_table clients;
+    rlm_bucket client_buckets[WEBS_CLIENT_BUCKETS];
+    rlm_bucket global;
+    wpg_admission_stats stats;
+} admission;
+
+/**
+ * Response compression. The httpd task and the alerts task both send responses, so the compressor is taken with the
+ * lock; a response that finds it in use goes out uncompressed rather than wait.
+*/
+typedef struct gzip_state
+{
+    SemaphoreHandle_t lock;
+#if PRJ_STATIC_ALLOC
+    StaticSemaphore_t lock_buffer;
+#endif
+
+    gzs_t stream;
+    // The response being compressed, when it started, and the part of the time since spent sending.
+    httpd_req_t* req;
+    int64_t begin_us;
+    int64_t send_us;
+    wpg_gzip_stats stats;
+} gzip_state;
+
+// Number of stations connected to the SoftAP. Only touched by the event loop task.
+static int s_station_count = 0;
+
+#if PRJ_STATIC_ALLOC
+// Handlers run on the single httpd task, so one page buffer is shared by all of them.
+static char s_page_buffer[WEBS_PAGE_BUFFER_SIZE];
+#endif
+
+static page_cache s_home_cache = { .build = wpg_home_page, .generation_fn = tps_get_generation };
+
+// Only touched by the httpd task.
+static admission s_admission;
+static const rlm_rate s_client_rate = { .per_s = WEBS_CLIENT_RATE_PER_S, .burst = WEBS_CLIENT_BURST };
+static const rlm_rate s_global_rate = { .per_s = WEBS_GLOBAL_RATE_PER_S, .burst = WEBS_GLOBAL_BURST };
+
+static gzip_state s_gzip;
+
+static portMUX_TYPE s_alert_waiter_mux = portMUX_INITIALIZER_UNLOCKED;
+static alert_waiter s_alert_waiters[WEBS_ALERT_WAITERS];
+static TaskHandle_t s_alert_task = NULL;
+#if PRJ_STATIC_ALLOC
+static StackType_t s_alert_task_stack[TASK_ALERTS_STACK];
+static StaticTask_t s_alert_task_tcb;
+#endif
 
 static void wifi_init_softap();
+static void wifi_fill_ap_config(wifi_config_t* wifi_config);
+static void wifi_apply_config();
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static httpd_handle_t start_webserver();
+static esp_err_t admit_handler(httpd_req_t *req);
+static bool admit(httpd_req_t *req, uint32_t cost);
+static uint32_t client_address(httpd_req_t *req);
+static void send_refusal(httpd_req_t *req, const char* status, uint32_t retry_ms);
 static esp_err_t home_get_handler(httpd_req_t *req);
 static esp_err_t info_get_handler(httpd_req_t *req);
-static size_t create_home_page(char* buffer, size_t buffer_size);
-static size_t create_info_page(char* buffer, size_t buffer_size);
-static const char* chip_model_str(esp_chip_model_t model);
-static int32_t calc_average(int32_t* values, int size);
+static esp_err_t config_get_handler(httpd_req_t *req);
+static esp_err_t config_post_handler(httpd_req_t *req);
+static esp_err_t send_config_page(httpd_req_t *req, const char* message);
+static esp_err_t history_get_handler(httpd_req_t *req);
+static esp_err_t time_get_handler(httpd_req_t *req);
+static esp_err_t time_post_handler(httpd_req_t *req);
+static esp_err_t send_time_json(httpd_req_t *req);
+static esp_err_t stats_get_handler(httpd_req_t *req);
+static esp_err_t alerts_get_handler(httpd_req_t *req);
+static esp_err_t export_get_handler(httpd_req_t *req);
+static size_t export_size(const rlg_view* view, export_format format);
+static export_range export_get_range(httpd_req_t *req, const char* etag, size_t total, size_t* start, size_t* end);
+static esp_err_t export_send_raw(httpd_req_t *req, const rlg_view* view, size_t start, size_t end);
+static esp_err_t export_send_csv(httpd_req_t *req, const rlg_view* view, size_t start, size_t end);
+static void export_csv_line(char* line, uint32_t boot, const rlg_record* record);
+static esp_err_t send_alerts_json(httpd_req_t *req, uint32_t after_seq, char* buffer);
+static bool alert_waiter_add(httpd_req_t *req, uint32_t after_seq);
+static void alert_task(void* params);
+static void alerts_changed();
+static void start_alert_task();
+static bool query_get_u32(httpd_req_t *req, const char* key, uint32_t* value);
+static bool query_get_i64(httpd_req_t *req, const char* key, int64_t* value);
+static bool query_get_str(httpd_req_t *req, const char* key, char* value, size_t size);
+static void url_decode(char* value);
+static char* page_buffer_acquire();
+static void page_buffer_release(char* buffer);
+static void page_cache_init(page_cache* cache);
+static esp_err_t page_cache_send(page_cache* cache, httpd_req_t* req);
+static esp_err_t send_body(httpd_req_t* req, const char* buffer, size_t len);
+static void gzip_init();
+static bool gzip_begin(httpd_req_t* req, size_t len);
+static esp_err_t gzip_end(httpd_req_t* req);
+static int gzip_write_sink(void* ctx, const char* data, size_t len);
+static int gzip_chunk_sink(void* ctx, const char* data, size_t len);
+static void gzip_get_stats(wpg_gzip_stats* stats);
+static bool accepts_gzip(httpd_req_t* req);
+static bool q_is_zero(const char* params);
+static esp_err_t send_segments(httpd_req_t* req, const sgb_t* sgb);
+static int chunk_sink(void* ctx, const char* data, size_t len);
 
+/**
+ * Start the HTTP server and the alerts task. The network stack must be initialized; the SoftAP can come up later.
+*/
 void wbs_init()
 {
-    // Wifi and HTTP initialization
-    wifi_init_softap();
+    page_cache_init(&s_home_cache);
+    gzip_init();
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    rlm_table_init(&s_admission.clients, s_admission.client_buckets, WEBS_CLIENT_BUCKETS, &s_client_rate);
+    rlm_bucket_init(&s_admission.global, &s_global_rate, now_ms);
+
+    start_alert_task();
+    alt_set_listener(alerts_changed);
+
     start_webserver();
 }
 
+/**
+ * Bring up the SoftAP. Blocks until the Wi-Fi driver is started.
+*/
+void wbs_start_wifi()
+{
+    wifi_init_softap();
+}
+
+/**
+ * Get the number of bytes of RAM this module reserves statically.
+*/
+size_t wbs_static_size()
+{
+    size_t size = sizeof(s_home_cache) + sizeof(s_alert_waiters) + sizeof(s_admission) + sizeof(s_gzip);
+#if PRJ_STATIC_ALLOC
+    size += sizeof(s_page_buffer) + sizeof(s_alert_task_stack) + sizeof(s_alert_task_tcb);
+#endif
+    return size;
+}
+
 static void wifi_init_softap()
 {
     esp_netif_create_default_wifi_ap();
@@ -52,13 +279,7 @@ static void wifi_init_softap()
         NULL));
 
     wifi_config_t wifi_config = {};
-
-    wifi_config.ap.channel = 1;
-    wifi_config.ap.max_connection = 4;
-    wifi_config.ap.authmode = WIFI_AUTH_WPA_WPA2_PSK;
-
-    strcpy((char *)wifi_config.ap.ssid, WEBS_AP_SSID);
-    strcpy((char *)wifi_config.ap.password, WEBS_AP_PWD);
+    wifi_fill_ap_config(&wifi_config);
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
@@ -67,17 +288,51 @@ static void wifi_init_softap()
     ESP_LOGI(LOG_TAG, "wifi_init_softap finished.");   
 }
 
+/**
+ * Fill the SoftAP configuration from the runtime settings.
+*/
+static void wifi_fill_ap_config(wifi_config_t* wifi_config)
+{
+    wifi_config->ap.channel = 1;
+    wifi_config->ap.max_connection = WEBS_AP_MAX_STATIONS;
+    wifi_config->ap.authmode = WIFI_AUTH_WPA_WPA2_PSK;
+
+    cfg_get_str(CFG_AP_SSID, (char *)wifi_config->ap.ssid, sizeof(wifi_config->ap.ssid));
+    cfg_get_str(CFG_AP_PWD, (char *)wifi_config->ap.password, sizeof(wifi_config->ap.password));
+}
+
+/**
+ * Apply changed SoftAP settings. Connected stations are dropped and must reconnect with the new settings.
+*/
+static void wifi_apply_config()
+{
+    wifi_config_t wifi_config = {};
+    wifi_fill_ap_config(&wifi_config);
+
+    esp_err_t rc = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
+    ESP_LOGI(LOG_TAG, "SoftAP settings applied, rc: %d", rc);
+}
+
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     if (event_id == WIFI_EVENT_AP_STACONNECTED)
     {
         wifi_event_ap_staconnected_t *event = (wifi_event_ap_staconnected_t*)event_data;
         ESP_LOGI(LOG_TAG, "station " MACSTR " join, AID=%d", MAC2STR(event->mac), event->aid);
+
+        ++s_station_count;
+        hui_set_pattern(HUI_PATTERN_CLIENT_CONNECTED, true);
     }
     else if (event_id == WIFI_EVENT_AP_STADISCONNECTED)
     {
         wifi_event_ap_stadisconnected_t *event = (wifi_event_ap_stadisconnected_t*)event_data;
         ESP_LOGI(LOG_TAG, "station " MACSTR " leave, AID=%d", MAC2STR(event->mac), event->aid);
+
+        if (s_station_count > 0)
+        {
+            --s_station_count;
+        }
+        hui_set_pattern(HUI_PATTERN_CLIENT_CONNECTED, s_station_count > 0);
     }
 }
 
@@ -85,24 +340,40 @@ static esp_err_t home_get_handler(httpd_req_t *req)
 {
     // TODO: Debugging memory allocations.
     size_t dft_free_size = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
-    ESP_LOGI(LOG_TAG, "Heap free size: %u", dft_free_size);
+    DLG_LOGI(LOG_TAG, "Heap free size: %u", dft_free_size);
+    hui_set_pattern(HUI_PATTERN_OVERLOAD, dft_free_size < WEBS_LOW_HEAP_BYTES);
 
-    // TODO - Pooled static memory would be much better.
-    const size_t buff_size = 2048;
-    char* buffer = (char*)heap_caps_malloc(buff_size, MALLOC_CAP_DEFAULT);
-    if (buffer == NULL)
+    esp_err_t rc = page_cache_send(&s_home_cache, req);
+
+    if (rc != ESP_OK)
     {
-        ESP_LOGE(LOG_TAG, "Buffer malloc failed!");
-        httpd_resp_set_status(req, "500");
-        httpd_resp_send(req, "Internal error", HTTPD_RESP_USE_STRLEN);
-        return ESP_FAIL;
+        ESP_LOGE(LOG_TAG, "Failed to send response!");
+    }
+    else
+    {
+        btl_mark(BTL_FIRST_RESPONSE);
     }
 
-    size_t home_slen = create_home_page(buffer, buff_size);
-    esp_err_t rc = httpd_resp_send(req, buffer, home_slen);
+    return rc;
+}
+
+static esp_err_t info_get_handler(httpd_req_t *req)
+{
+    // req->uri may be gone by the time the record is printed, and only /info comes here.
+    DLG_LOGI(LOG_TAG, "URI: /info");
+
+    // Only the values are copied, so the segment list and scratch fit on the stack.
+    sgb_segment segs[WEBS_INFO_SEGMENTS];
+    char scratch[WEBS_INFO_SCRATCH_SIZE];
+    sgb_t sgb;
+    sgb_init(&sgb, segs, WEBS_INFO_SEGMENTS, scratch, sizeof(scratch));
 
-    // Must free memory!
-    heap_caps_free(buffer);
+    wpg_info_page(&sgb);
+    if (sgb_status(&sgb) != SGB_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Page truncated, raise WEBS_INFO_SEGMENTS or WEBS_INFO_SCRATCH_SIZE");
+    }
+    esp_err_t rc = send_segments(req, &sgb);
 
     if (rc != ESP_OK)
     {
@@ -112,234 +383,1209 @@ static esp_err_t home_get_handler(httpd_req_t *req)
     return rc;
 }
 
-static esp_err_t info_get_handler(httpd_req_t *req)
+static esp_err_t config_get_handler(httpd_req_t *req)
+{
+    return send_config_page(req, NULL);
+}
+
+/**
+ * Apply the settings posted from the config page form. Values are checked against their limits; values that fail are
+ * reported and left unchanged.
+*/
+static esp_err_t config_post_handler(httpd_req_t *req)
 {
-    // TODO - is this URI what I registered?
-    ESP_LOGI(LOG_TAG, "URI: %s", req->uri);
+    char body[WEBS_CONFIG_BODY_MAX];
+
+    if (req->content_len >= sizeof(body))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Form too large");
+        return ESP_FAIL;
+    }
+
+    size_t received = 0;
+    while (received < req->content_len)
+    {
+        int rc = httpd_req_recv(req, body + received, req->content_len - received);
+        if (rc == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            continue;
+        }
+        if (rc <= 0)
+        {
+            return ESP_FAIL;
+        }
+        received += rc;
+    }
+    body[received] = 0;
+
+    // Form values are URL encoded, so can be up to three times longer than the decoded value.
+    char value[CFG_STR_MAX_SIZE * 3];
+    char message[128];
+    strbld_t msg;
+    strbld_init(&msg, message, sizeof(message));
+
+    bool wifi_changed = false;
+    bool any_rejected = false;
+
+    for (int i = 0; i < CFG_KEY_COUNT; ++i)
+    {
+        cfg_key key = (cfg_key)i;
+
+        if (httpd_query_key_value(body, cfg_name(key), value, sizeof(value)) != ESP_OK)
+        {
+            continue;
+        }
+
+        url_decode(value);
+
+        // The password field is never filled in, so empty means keep the current one.
+        if (cfg_is_secret(key) && value[0] == 0)
+        {
+            continue;
+        }
+
+        uint32_t generation = cfg_get_generation();
+        if (cfg_set_from_string(key, value) != CFG_OK)
+        {
+            strbld_append(&msg, any_rejected ? ", " : "Rejected (out of range): ");
+            strbld_append(&msg, cfg_name(key));
+            any_rejected = true;
+        }
+        else if (cfg_get_generation() != generation && (key == CFG_AP_SSID || key == CFG_AP_PWD))
+        {
+            wifi_changed = true;
+        }
+    }
+
+    if (!any_rejected)
+    {
+        strbld_append(&msg, "Saved.");
+    }
+
+    esp_err_t rc = send_config_page(req, message);
+
+    // Applied after the response is sent, because the client is most likely connected through the SoftAP.
+    if (wifi_changed)
+    {
+        wifi_apply_config();
+    }
+
+    return rc;
+}
 
-    // TODO - Pooled static memory would be much better.
-    const size_t buff_size = 2048;
-    char* buffer = (char*)heap_caps_malloc(buff_size, MALLOC_CAP_DEFAULT);
+static esp_err_t send_config_page(httpd_req_t *req, const char* message)
+{
+    char* buffer = page_buffer_acquire();
     if (buffer == NULL)
     {
         ESP_LOGE(LOG_TAG, "Buffer malloc failed!");
+        hui_set_pattern(HUI_PATTERN_OVERLOAD, true);
         httpd_resp_set_status(req, "500");
         httpd_resp_send(req, "Internal error", HTTPD_RESP_USE_STRLEN);
         return ESP_FAIL;
     }
 
-    size_t home_slen = create_info_page(buffer, buff_size);
-    esp_err_t rc = httpd_resp_send(req, buffer, home_slen);
+    size_t slen = wpg_config_page(buffer, WEBS_PAGE_BUFFER_SIZE, message);
+    esp_err_t rc = send_body(req, buffer, slen);
 
     // Must free memory!
-    heap_caps_free(buffer);
+    page_buffer_release(buffer);
 
-    if (rc != ESP_OK)
+    return rc;
+}
+
+/**
+ * Send the samples in a time range as JSON. Query: since and until, in seconds of uptime (both optional, inclusive).
+ * Samples are at most one per second, so pollers pass the last time they received plus one as since to get only new
+ * samples. Charts pass points, the most samples wanted, to get the whole range downsampled in one response.
+*/
+static esp_err_t history_get_handler(httpd_req_t *req)
+{
+    uint32_t since = 0;
+    uint32_t until = UINT32_MAX;
+    uint32_t points = 0;
+    query_get_u32(req, "since", &since);
+    query_get_u32(req, "until", &until);
+    query_get_u32(req, "points", &points);
+
+    char* buffer = page_buffer_acquire();
+    if (buffer == NULL)
     {
-        ESP_LOGE(LOG_TAG, "Failed to send response!");
+        ESP_LOGE(LOG_TAG, "Buffer malloc failed!");
+        hui_set_pattern(HUI_PATTERN_OVERLOAD, true);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Internal error");
+        return ESP_FAIL;
     }
 
+    size_t slen = wpg_history_json(buffer, WEBS_PAGE_BUFFER_SIZE, since, until, points);
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t rc = send_body(req, buffer, slen);
+
+    // Must free memory!
+    page_buffer_release(buffer);
+
     return rc;
 }
 
-const httpd_uri_t home =
+static esp_err_t time_get_handler(httpd_req_t *req)
 {
-    .uri = "/",
-    .method = HTTP_GET,
-    .handler = home_get_handler,
-    .user_ctx = NULL
-};
+    return send_time_json(req);
+}
 
-const httpd_uri_t info =
+/**
+ * Set the wall clock. Query: now, the current Unix time in seconds.
+*/
+static esp_err_t time_post_handler(httpd_req_t *req)
 {
-    .uri = "/info",
-    .method = HTTP_GET,
-    .handler = info_get_handler,
-    .user_ctx = NULL
-};
+    int64_t now;
+    if (!query_get_i64(req, "now", &now) || now < 0)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected now=<unix seconds>");
+        return ESP_FAIL;
+    }
 
-static httpd_handle_t start_webserver()
+    tps_set_wall_time(now);
+    ESP_LOGI(LOG_TAG, "Wall clock set: %" PRId64, now);
+
+    return send_time_json(req);
+}
+
+static esp_err_t send_time_json(httpd_req_t *req)
 {
-    httpd_handle_t server;
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.lru_purge_enable = true;
+    char buffer[96];
+    size_t slen = wpg_time_json(buffer, sizeof(buffer));
 
-    ESP_LOGI(LOG_TAG, "Starting server on port: '%d'", config.server_port);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buffer, slen);
+}
 
-    if (httpd_start(&server, &config) == ESP_OK)
+static esp_err_t stats_get_handler(httpd_req_t *req)
+{
+    wpg_gzip_stats gzip;
+    gzip_get_stats(&gzip);
+
+    char buffer[WEBS_STATS_JSON_SIZE];
+    size_t slen = wpg_stats_json(buffer, sizeof(buffer), &s_admission.stats, &gzip);
+
+    httpd_resp_set_type(req, "application/json");
+    return send_body(req, buffer, slen);
+}
+
+/**
+ * Long poll for alert events. Query: after, the "last" value of the previous response (0 or missing for all queued
+ * events). Answers right away if there are events after it, otherwise when the next event happens or after
+ * WEBS_ALERT_WAIT_MS with no events.
+*/
+static esp_err_t alerts_get_handler(httpd_req_t *req)
+{
+    uint32_t after_seq = 0;
+    query_get_u32(req, "after", &after_seq);
+
+    // Nothing new: park the request. If all waiter slots are taken, answer now and the client polls again.
+    if (alt_last_seq() == after_seq && alert_waiter_add(req, after_seq))
     {
-        httpd_register_uri_handler(server, &home);
-        httpd_register_uri_handler(server, &info);
-        return server;
+        return ESP_OK;
     }
 
-    ESP_LOGE(LOG_TAG, "Error starting server!");
-    return (httpd_handle_t)NULL;
+    char buffer[ALERT_JSON_SIZE];
+    return send_alerts_json(req, after_seq, buffer);
 }
 
 /**
- * Build the home page, which displays temperature readings.
+ * Export the reading log. Query: format, csv (the default) or raw. raw is the log's sectors as stored in flash, oldest
+ * first, each cut after its last record (layout in reading_log.h); it is sent straight from the mapped partition. csv
+ * has the columns boot, uptime_s and temp_f, in fixed width lines.
+ *
+ * Both formats keep every byte at its offset until the oldest sector is erased, so a download can be resumed with a
+ * single byte range (Range: bytes=N-, N-M or -N). The ETag is the oldest sector's sequence number: it only changes
+ * when that sector goes, and a resume with If-Range and an older tag gets the whole log again. Under the same tag the
+ * log only grows at the end.
 */
-static size_t create_home_page(char* buffer, size_t buffer_size)
+static esp_err_t export_get_handler(httpd_req_t *req)
 {
-    // Get the last temperature read by the sensor.
-    int32_t last_temp;
-    uint8_t last_err;
-    tps_get_last(&last_temp, &last_err);
+    char format_name[8] = "csv";
+    query_get_str(req, "format", format_name, sizeof(format_name));
 
-    char temper_buff[16];
-    tempr_format(last_temp, temper_buff);
+    export_format format;
+    if (strcmp(format_name, "csv") == 0)
+    {
+        format = EXPORT_CSV;
+    }
+    else if (strcmp(format_name, "raw") == 0)
+    {
+        format = EXPORT_RAW;
+    }
+    else
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected format=csv or format=raw");
+        return ESP_FAIL;
+    }
 
-    strbld_t sb;
-    strbld_init(&sb, buffer, buffer_size);
+    rlg_view view;
+    if (!rlg_get_view(&view))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No reading log");
+        return ESP_FAIL;
+    }
 
-    strbld_append(&sb, "<html>");
-    strbld_append(&sb, "<head>");
-    strbld_append_html(&sb, "Scottz0r RTOS Web Temp", "title");
-    strbld_append(&sb, "</head>");
-    strbld_append(&sb, "<body>");
+    // Header values must stay valid until the response is sent.
+    char etag[16];
+    char content_range[48];
+    snprintf(etag, sizeof(etag), "\"%" PRIu32 "\"", view.first_seq);
 
-    // Current temperature.
-    strbld_append(&sb, "<h2>Temperature: ");
-    strbld_append(&sb, temper_buff);
-    strbld_append(&sb, "</h2>");
+    size_t total = export_size(&view, format);
+    size_t start = 0;
+    size_t end = total;
+    export_range range = export_get_range(req, etag, total, &start, &end);
 
-    int32_t hist_array[TPS_HIST_READ_SIZE];
-    int hist_count = tps_get_hist_values(hist_array, TPS_HIST_READ_SIZE);
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+    httpd_resp_set_hdr(req, "ETag", etag);
 
-    // Display average temperature.
-    int32_t avg_temp = calc_average(hist_array, hist_count);
-    tempr_format(avg_temp, temper_buff);
+    if (range == EXPORT_RANGE_UNSATISFIABLE)
+    {
+        snprintf(content_range, sizeof(content_range), "bytes */%u", (unsigned)total);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        return httpd_resp_send(req, NULL, 0);
+    }
 
-    strbld_append(&sb, "<p>Average Temperature: ");
-    strbld_append(&sb, temper_buff);
-    strbld_append(&sb, "</p>");
+    if (range == EXPORT_RANGE_PARTIAL)
+    {
+        snprintf(content_range, sizeof(content_range), "bytes %u-%u/%u", (unsigned)start, (unsigned)(end - 1),
+            (unsigned)total);
+        httpd_resp_set_status(req, "206 Partial Content");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+    }
 
-    // Display the history of values.
-    strbld_append(&sb, "<h3>Most recent values</h3><ul>");
+    httpd_resp_set_type(req, format == EXPORT_CSV ? "text/csv" : "application/octet-stream");
 
-    for (int i = 0; i < hist_count; ++i)
+    esp_err_t rc = format == EXPORT_CSV ? export_send_csv(req, &view, start, end) :
+        export_send_raw(req, &view, start, end);
+    if (rc != ESP_OK)
     {
-        tempr_format(hist_array[i], temper_buff);
-        strbld_append_html(&sb, temper_buff, "li");
+        ESP_LOGW(LOG_TAG, "Export cut short, the log moved on or the client left");
     }
-    strbld_append(&sb, "</ul>");
 
-    // Links
-    strbld_append(&sb, "<p>[<a href=\"/info\">device info</a>]</p>");
+    return rc;
+}
 
-    strbld_append(&sb, "</body></html>");
+/**
+ * Get the size of a whole export of the view.
+*/
+static size_t export_size(const rlg_view* view, export_format format)
+{
+    size_t size = format == EXPORT_CSV ? strlen(EXPORT_CSV_HEADER) : 0;
 
-    size_t slen = 0;
-    strbld_get(&sb, &slen);
+    for (uint32_t i = 0; i < view->sector_count; ++i)
+    {
+        size_t records = rlg_view_records(view, i);
+        size += format == EXPORT_CSV ? records * EXPORT_CSV_LINE_SIZE :
+            sizeof(rlg_sector_header) + records * sizeof(rlg_record);
+    }
 
-    return slen;
+    return size;
 }
 
-static size_t create_info_page(char* ibuffer, size_t buffer_size)
+/**
+ * Read the Range header against a body of total bytes. For a partial range, [start, end) is set.
+*/
+static export_range export_get_range(httpd_req_t *req, const char* etag, size_t total, size_t* start, size_t* end)
 {
-    strbld_t sb;
-    strbld_init(&sb, ibuffer, buffer_size);
+    char value[48];
+    if (httpd_req_get_hdr_value_str(req, "Range", value, sizeof(value)) != ESP_OK ||
+        strncmp(value, "bytes=", 6) != 0 || strchr(value, ',') != NULL)
+    {
+        return EXPORT_RANGE_NONE;
+    }
+
+    // Ranges of other contents are no use to the client.
+    char if_range[24];
+    if (httpd_req_get_hdr_value_str(req, "If-Range", if_range, sizeof(if_range)) == ESP_OK &&
+        strcmp(if_range, etag) != 0)
+    {
+        return EXPORT_RANGE_NONE;
+    }
 
-    hw_mcp9808_dinfo info;
-    hw_mcp9808_read_device_info(&info);
+    const char* spec = value + 6;
+    char* parse_end;
 
-    char fmt_buff[32];
+    // -N: the last N bytes.
+    if (*spec == '-')
+    {
+        unsigned long long suffix = strtoull(spec + 1, &parse_end, 10);
+        if (parse_end == spec + 1 || *parse_end != 0)
+        {
+            return EXPORT_RANGE_NONE;
+        }
+        if (suffix == 0 || total == 0)
+        {
+            return EXPORT_RANGE_UNSATISFIABLE;
+        }
+
+        *start = suffix < total ? total - (size_t)suffix : 0;
+        *end = total;
+        return EXPORT_RANGE_PARTIAL;
+    }
+
+    // N- or N-M, M inclusive.
+    unsigned long long first = strtoull(spec, &parse_end, 10);
+    if (parse_end == spec || *parse_end != '-')
+    {
+        return EXPORT_RANGE_NONE;
+    }
+
+    unsigned long long last = ULLONG_MAX;
+    const char* last_text = parse_end + 1;
+    if (*last_text != 0)
+    {
+        last = strtoull(last_text, &parse_end, 10);
+        if (parse_end == last_text || *parse_end != 0 || last < first)
+        {
+            return EXPORT_RANGE_NONE;
+        }
+    }
 
-    strbld_append(&sb, "<html>");
-    strbld_append(&sb, "<head>");
-    strbld_append_html(&sb, "Scottz0r RTOS Web Temp ~ Info", "title");
-    strbld_append(&sb, "</head>");
-    strbld_append(&sb, "<body>");
+    if (first >= total)
+    {
+        return EXPORT_RANGE_UNSATISFIABLE;
+    }
 
-    strbld_append_html(&sb, "Device Info", "h1");
+    *start = (size_t)first;
+    *end = last < total - 1 ? (size_t)last + 1 : total;
+    return EXPORT_RANGE_PARTIAL;
+}
 
-    esp_chip_info_t chip_info;
-    esp_chip_info(&chip_info);
-    const char* model_str = chip_model_str(chip_info.model);
+/**
+ * Send [start, end) of the raw export. The chunks point into the mapped partition, so nothing is copied on the way to
+ * the socket. A sector erased while it is sent ends the response with an error: its bytes are gone.
+*/
+static esp_err_t export_send_raw(httpd_req_t *req, const rlg_view* view, size_t start, size_t end)
+{
+    size_t pos = 0;
 
-    strbld_append(&sb, "<p>");
-    strbld_append(&sb, "Chip Model: ");
-    sprintf(fmt_buff, "%s", model_str);
-    strbld_append(&sb, fmt_buff);
-    strbld_append(&sb, "</p>");
+    for (uint32_t i = 0; i < view->sector_count && pos < end; ++i)
+    {
+        if (!rlg_view_current(view, i))
+        {
+            return ESP_FAIL;
+        }
+
+        size_t len = sizeof(rlg_sector_header) + rlg_view_records(view, i) * sizeof(rlg_record);
+        const char* sector = (const char*)rlg_view_sector(view, i);
+        size_t from = start > pos ? start - pos : 0;
+        size_t to = end - pos < len ? end - pos : len;
+
+        while (from < to)
+        {
+            size_t n = to - from < WEBS_EXPORT_CHUNK_SIZE ? to - from : WEBS_EXPORT_CHUNK_SIZE;
+            if (httpd_resp_send_chunk(req, sector + from, n) != ESP_OK)
+            {
+                return ESP_FAIL;
+            }
+
+            // The chunk was read from flash during the send, so it is only good if the sector is still there after.
+            if (!rlg_view_current(view, i))
+            {
+                return ESP_FAIL;
+            }
+            from += n;
+        }
+
+        pos += len;
+    }
 
-    strbld_append(&sb, "<p>");
-    strbld_append(&sb, "Chip Revision (M.XX): ");
-    sprintf(fmt_buff, "%u", chip_info.revision);
-    strbld_append(&sb, fmt_buff);
-    strbld_append(&sb, "</p>");
+    // Zero length chunk ends the response.
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
 
-    strbld_append(&sb, "<p>");
-    strbld_append(&sb, "Cores: ");
-    sprintf(fmt_buff, "%u", chip_info.cores);
-    strbld_append(&sb, fmt_buff);
-    strbld_append(&sb, "</p>");
+/**
+ * Send [start, end) of the CSV export. Lines are formatted into a stage, and only the lines in the range are
+ * formatted: a range's first line is found by division.
+*/
+static esp_err_t export_send_csv(httpd_req_t *req, const rlg_view* view, size_t start, size_t end)
+{
+    char stage[WEBS_EXPORT_CHUNK_SIZE];
+    char line[EXPORT_CSV_LINE_SIZE + 1];
+    size_t staged = 0;
 
-    strbld_append_html(&sb, "MCP9808 Info", "h2");
+    size_t pos = strlen(EXPORT_CSV_HEADER);
+    if (start < pos)
+    {
+        staged = (end < pos ? end : pos) - start;
+        memcpy(stage, EXPORT_CSV_HEADER + start, staged);
+    }
 
-    strbld_append(&sb, "<p>");
-    strbld_append(&sb, "Device Id: ");
-    sprintf(fmt_buff, "%u", info.device_id);
-    strbld_append(&sb, fmt_buff);
-    strbld_append(&sb, "</p>");
+    for (uint32_t i = 0; i < view->sector_count && pos < end; ++i)
+    {
+        if (!rlg_view_current(view, i))
+        {
+            return ESP_FAIL;
+        }
+
+        const rlg_sector_header* header = rlg_view_sector(view, i);
+        const rlg_record* records = (const rlg_record*)(header + 1);
+        size_t count = rlg_view_records(view, i);
+        size_t first = start > pos ? (start - pos) / EXPORT_CSV_LINE_SIZE : 0;
+
+        for (size_t r = first; r < count && pos + r * EXPORT_CSV_LINE_SIZE < end; ++r)
+        {
+            size_t line_pos = pos + r * EXPORT_CSV_LINE_SIZE;
+            size_t from = start > line_pos ? start - line_pos : 0;
+            size_t to = end - line_pos < EXPORT_CSV_LINE_SIZE ? end - line_pos : EXPORT_CSV_LINE_SIZE;
+
+            if (staged + (to - from) > sizeof(stage))
+            {
+                // The staged lines came from flash, so are only good if the sector is still there.
+                if (!rlg_view_current(view, i) || httpd_resp_send_chunk(req, stage, staged) != ESP_OK)
+                {
+                    return ESP_FAIL;
+                }
+                staged = 0;
+            }
+
+            export_csv_line(line, header->boot, &records[r]);
+            memcpy(stage + staged, line + from, to - from);
+            staged += to - from;
+        }
+
+        if (!rlg_view_current(view, i))
+        {
+            return ESP_FAIL;
+        }
+        pos += count * EXPORT_CSV_LINE_SIZE;
+    }
 
-    strbld_append(&sb, "<p>");
-    strbld_append(&sb, "Device Revision: ");
-    sprintf(fmt_buff, "%u", info.device_revision);
-    strbld_append(&sb, fmt_buff);
-    strbld_append(&sb, "</p>");
+    if (staged > 0 && httpd_resp_send_chunk(req, stage, staged) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
 
-    strbld_append(&sb, "<p>");
-    strbld_append(&sb, "Manufacturer Id: ");
-    sprintf(fmt_buff, "%u", info.manufacturer_id);
-    strbld_append(&sb, fmt_buff);
-    strbld_append(&sb, "</p>");
+    // Zero length chunk ends the response.
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
 
-    // Links
-    strbld_append(&sb, "<p>[<a href=\"/\">home</a>]</p>");
+/**
+ * Format a record as a CSV line of exactly EXPORT_CSV_LINE_SIZE characters, plus the terminator.
+*/
+static void export_csv_line(char* line, uint32_t boot, const rlg_record* record)
+{
+    // Keeps the line width, far outside what the sensor can read anyway.
+    int32_t value = record->value;
+    value = value > 99999 ? 99999 : (value < -99999 ? -99999 : value);
+    int32_t magnitude = value < 0 ? -value : value;
 
-    strbld_append(&sb, "</body></html>");
+    snprintf(line, EXPORT_CSV_LINE_SIZE + 1, "%010" PRIu32 ",%010" PRIu32 ",%c%03" PRId32 ".%02" PRId32 "\n",
+        boot, record->time_s, value < 0 ? '-' : '+', magnitude / 100, magnitude % 100);
+}
 
-    size_t slen = 0;
-    strbld_get(&sb, &slen);
+static esp_err_t send_alerts_json(httpd_req_t *req, uint32_t after_seq, char* buffer)
+{
+    size_t slen = wpg_alerts_json(buffer, ALERT_JSON_SIZE, after_seq);
 
-    return slen;
+    httpd_resp_set_type(req, "application/json");
+    return send_body(req, buffer, slen);
 }
 
-static const char* chip_model_str(esp_chip_model_t model)
+/**
+ * Detach a request and hand it to the alerts task. Returns false if there is no free slot.
+*/
+static bool alert_waiter_add(httpd_req_t *req, uint32_t after_seq)
 {
-    switch(model)
+    if (s_alert_task == NULL)
+    {
+        return false;
+    }
+
+    httpd_req_t* async_req;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK)
+    {
+        return false;
+    }
+
+    bool added = false;
+
+    portENTER_CRITICAL(&s_alert_waiter_mux);
+    for (int i = 0; i < WEBS_ALERT_WAITERS && !added; ++i)
+    {
+        if (s_alert_waiters[i].req == NULL)
+        {
+            s_alert_waiters[i].req = async_req;
+            s_alert_waiters[i].after_seq = after_seq;
+            s_alert_waiters[i].deadline = xTaskGetTickCount() + ALERT_WAIT_TIME;
+            added = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_alert_waiter_mux);
+
+    if (!added)
     {
-    case CHIP_ESP32:
-        return "ESP32";
-    case CHIP_ESP32S2:
-        return "ESP32S2";
-    case CHIP_ESP32S3:
-        return "ESP32S3";
-    case CHIP_ESP32C3:
-        return "ESP32C3";
-    case CHIP_ESP32C2:
-        return "ESP32C2";
-    case CHIP_ESP32C6:
-        return "ESP32C6";
-    case CHIP_ESP32H2:
-        return "ESP32H2";
-    case CHIP_POSIX_LINUX:
-        return "POSIX_LINUX";
-    default:
-        return "Unknown";
+        httpd_req_async_handler_complete(async_req);
+        return false;
     }
+
+    // An event may have been queued between the check and the add; the task checks again.
+    xTaskNotifyGive(s_alert_task);
+    return true;
 }
 
-static int32_t calc_average(int32_t* values, int size)
+/**
+ * Answers waiting alert polls when there is a new event or their wait is over.
+*/
+static void alert_task(void* params)
 {
-    int32_t sum = 0;
+    // Only this task builds alert responses, so the buffer is on its stack.
+    char buffer[ALERT_JSON_SIZE];
 
-    for(int i = 0; i < size; ++i)
+    for (;;)
     {
-        sum += values[i];
+        ulTaskNotifyTake(pdTRUE, ALERT_CHECK_TIME);
+
+        uint32_t last_seq = alt_last_seq();
+        TickType_t now = xTaskGetTickCount();
+
+        for (int i = 0; i < WEBS_ALERT_WAITERS; ++i)
+        {
+            httpd_req_t* req = NULL;
+            uint32_t after_seq = 0;
+
+            portENTER_CRITICAL(&s_alert_waiter_mux);
+            alert_waiter* waiter = &s_alert_waiters[i];
+            if (waiter->req != NULL && (waiter->after_seq != last_seq || (int32_t)(now - waiter->deadline) >= 0))
+            {
+                req = waiter->req;
+                after_seq = waiter->after_seq;
+                waiter->req = NULL;
+            }
+            portEXIT_CRITICAL(&s_alert_waiter_mux);
+
+            if (req != NULL)
+            {
+                send_alerts_json(req, after_seq, buffer);
+
+                // Must complete the detached request!
+                httpd_req_async_handler_complete(req);
+            }
+        }
     }
+}
+
+/**
+ * Alert listener. Runs on the sensor task.
+*/
+static void alerts_changed()
+{
+    if (s_alert_task != NULL)
+    {
+        xTaskNotifyGive(s_alert_task);
+    }
+}
 
-    return sum / size;
+static void start_alert_task()
+{
+    const tl_placement* p = tl_get(TL_TASK_ALERTS);
+
+#if PRJ_STATIC_ALLOC
+    s_alert_task = xTaskCreateStaticPinnedToCore(alert_task, p->name, p->stack_size, NULL, p->priority,
+        s_alert_task_stack, &s_alert_task_tcb, p->core);
+#else
+    xTaskCreatePinnedToCore(alert_task, p->name, p->stack_size, NULL, p->priority, &s_alert_task, p->core);
+#endif
+
+    if (s_alert_task == NULL)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to start alerts task, /alerts will not wait");
+    }
+}
+
+/**
+ * Read an unsigned number from the URL query. Returns false (value unchanged) if missing or not a number.
+*/
+static bool query_get_u32(httpd_req_t *req, const char* key, uint32_t* value)
+{
+    int64_t parsed;
+    if (!query_get_i64(req, key, &parsed) || parsed < 0 || parsed > UINT32_MAX)
+    {
+        return false;
+    }
+
+    *value = (uint32_t)parsed;
+    return true;
+}
+
+/**
+ * Read a number from the URL query. Returns false (value unchanged) if missing or not a number.
+*/
+static bool query_get_i64(httpd_req_t *req, const char* key, int64_t* value)
+{
+    char text[24];
+
+    if (!query_get_str(req, key, text, sizeof(text)))
+    {
+        return false;
+    }
+
+    char* end;
+    long long parsed = strtoll(text, &end, 10);
+    if (end == text || *end != 0)
+    {
+        return false;
+    }
+
+    *value = (int64_t)parsed;
+    return true;
+}
+
+/**
+ * Read a value from the URL query, as sent (not decoded). Returns false if missing or longer than size - 1.
+*/
+static bool query_get_str(httpd_req_t *req, const char* key, char* value, size_t size)
+{
+    char query[64];
+
+    return httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, key, value, size) == ESP_OK;
+}
+
+/**
+ * Decode a URL encoded form value in place ('+' is a space, %XX is a byte).
+*/
+static void url_decode(char* value)
+{
+    char* out = value;
+
+    for (const char* in = value; *in != 0; ++in)
+    {
+        if (*in == '+')
+        {
+            *(out++) = ' ';
+        }
+        else if (*in == '%' && isxdigit((unsigned char)in[1]) && isxdigit((unsigned char)in[2]))
+        {
+            char hex[3] = { in[1], in[2], 0 };
+            *(out++) = (char)strtol(hex, NULL, 16);
+            in += 2;
+        }
+        else
+        {
+            *(out++) = *in;
+        }
+    }
+
+    *out = 0;
+}
+
+/**
+ * Get a buffer of WEBS_PAGE_BUFFER_SIZE bytes to build a page in. Returns NULL if no buffer is available.
+*/
+static char* page_buffer_acquire()
+{
+#if PRJ_STATIC_ALLOC
+    return s_page_buffer;
+#else
+    return (char*)heap_caps_malloc(WEBS_PAGE_BUFFER_SIZE, MALLOC_CAP_DEFAULT);
+#endif
+}
+
+/**
+ * Give back a buffer from page_buffer_acquire.
+*/
+static void page_buffer_release(char* buffer)
+{
+#if !PRJ_STATIC_ALLOC
+    heap_caps_free(buffer);
+#endif
+}
+
+static void page_cache_init(page_cache* cache)
+{
+#if PRJ_STATIC_ALLOC
+    cache->lock = xSemaphoreCreateMutexStatic(&cache->lock_buffer);
+#else
+    cache->lock = xSemaphoreCreateMutex();
+#endif
+
+    if (cache->lock == NULL)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create page cache mutex");
+    }
+
+    sgb_init(&cache->sgb, cache->segs, WEBS_PAGE_SEGMENTS, cache->scratch, sizeof(cache->scratch));
+    cache->valid = false;
+}
+
+/**
+ * Send a page, rendering it first only if the data generation changed since the last render.
+*/
+static esp_err_t page_cache_send(page_cache* cache, httpd_req_t* req)
+{
+    // Waits here while another request renders the page.
+    if (cache->lock == NULL || xSemaphoreTake(cache->lock, RENDER_WAIT_TIME) == pdFALSE)
+    {
+        httpd_resp_set_status(req, "503");
+        httpd_resp_send(req, "Busy", HTTPD_RESP_USE_STRLEN);
+        return ESP_FAIL;
+    }
+
+    // Read the generation before rendering. If the data changes during the render, the page is stamped with the older
+    // generation and the next request renders again.
+    uint32_t generation = cache->generation_fn();
+
+    if (!cache->valid || cache->generation != generation)
+    {
+        sgb_clear(&cache->sgb);
+        cache->build(&cache->sgb);
+        cache->generation = generation;
+        cache->valid = true;
+
+        if (sgb_status(&cache->sgb) != SGB_OK)
+        {
+            ESP_LOGE(LOG_TAG, "Page truncated, raise WEBS_PAGE_SEGMENTS or WEBS_PAGE_SCRATCH_SIZE");
+        }
+    }
+
+    // The lock is held while sending so the output can't be re-rendered under the send. Sends are serialized on the
+    // httpd task anyway.
+    esp_err_t rc = send_segments(req, &cache->sgb);
+
+    // Must give back lock!
+    xSemaphoreGive(cache->lock);
+
+    return rc;
+}
+
+/**
+ * Send a segment list as a chunked response. Small segments are gathered so each chunk is a reasonable size.
+*/
+static esp_err_t send_segments(httpd_req_t* req, const sgb_t* sgb)
+{
+    char stage[WEBS_SEND_STAGE_SIZE];
+
+    // The staged output is compressed on its way to the chunks.
+    if (gzip_begin(req, sgb_total_len(sgb)))
+    {
+        sgb_flush(sgb, stage, sizeof(stage), gzip_write_sink, &s_gzip.stream);
+        return gzip_end(req);
+    }
+
+    if (sgb_flush(sgb, stage, sizeof(stage), chunk_sink, req) != SGB_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    // Zero length chunk ends the response.
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static int chunk_sink(void* ctx, const char* data, size_t len)
+{
+    httpd_req_t* req = (httpd_req_t*)ctx;
+    return httpd_resp_send_chunk(req, data, len) == ESP_OK ? SGB_OK : SGB_FAIL;
+}
+
+/**
+ * Send a body built in a buffer, compressed if the client accepts it and it is large enough.
+*/
+static esp_err_t send_body(httpd_req_t* req, const char* buffer, size_t len)
+{
+    if (gzip_begin(req, len))
+    {
+        gzs_write(&s_gzip.stream, buffer, len);
+        return gzip_end(req);
+    }
+
+    return httpd_resp_send(req, buffer, len);
+}
+
+static void gzip_init()
+{
+#if PRJ_STATIC_ALLOC
+    s_gzip.lock = xSemaphoreCreateMutexStatic(&s_gzip.lock_buffer);
+#else
+    s_gzip.lock = xSemaphoreCreateMutex();
+#endif
+
+    if (s_gzip.lock == NULL)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create gzip mutex");
+    }
+}
+
+/**
+ * Start a gzip response if the body is at least WEBS_GZIP_MIN_BYTES and the client accepts gzip. If this returns
+ * true, the compressor is held: write the body to s_gzip.stream, then call gzip_end, which gives it back.
+*/
+static bool gzip_begin(httpd_req_t* req, size_t len)
+{
+    if (len < WEBS_GZIP_MIN_BYTES)
+    {
+        return false;
+    }
+
+    // Caches between the client and the device must keep the encodings apart.
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    if (!accepts_gzip(req) || s_gzip.lock == NULL || xSemaphoreTake(s_gzip.lock, 0) == pdFALSE)
+    {
+        return false;
+    }
+
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+
+    s_gzip.req = req;
+    s_gzip.begin_us = esp_timer_get_time();
+    s_gzip.send_us = 0;
+    gzs_init(&s_gzip.stream, gzip_chunk_sink, &s_gzip);
+
+    return true;
+}
+
+/**
+ * Finish the compressed body, end the response and give back the compressor.
+*/
+static esp_err_t gzip_end(httpd_req_t* req)
+{
+    int rc = gzs_finish(&s_gzip.stream);
+
+    wpg_gzip_stats* stats = &s_gzip.stats;
+    ++stats->responses;
+    stats->bytes_in += s_gzip.stream.total_in;
+    stats->bytes_out += s_gzip.stream.total_out;
+    stats->cpu_us += (uint64_t)(esp_timer_get_time() - s_gzip.begin_us - s_gzip.send_us);
+    s_gzip.req = NULL;
+
+    // Must give back lock!
+    xSemaphoreGive(s_gzip.lock);
+
+    if (rc != GZS_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    // Zero length chunk ends the response.
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * Builder sink that feeds the compressor.
+*/
+static int gzip_write_sink(void* ctx, const char* data, size_t len)
+{
+    return gzs_write((gzs_t*)ctx, data, len) == GZS_OK ? SGB_OK : SGB_FAIL;
+}
+
+/**
+ * Compressor sink that sends its output as chunks. Time spent here is sending, so it doesn't count as compressing.
+*/
+static int gzip_chunk_sink(void* ctx, const char* data, size_t len)
+{
+    gzip_state* gzip = (gzip_state*)ctx;
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t rc = httpd_resp_send_chunk(gzip->req, data, len);
+    gzip->send_us += esp_timer_get_time() - start_us;
+
+    return rc == ESP_OK ? GZS_OK : GZS_FAIL;
+}
+
+static void gzip_get_stats(wpg_gzip_stats* stats)
+{
+    memset(stats, 0, sizeof(wpg_gzip_stats));
+
+    if (s_gzip.lock != NULL && xSemaphoreTake(s_gzip.lock, RENDER_WAIT_TIME) == pdTRUE)
+    {
+        *stats = s_gzip.stats;
+
+        // Must give back lock!
+        xSemaphoreGive(s_gzip.lock);
+    }
+}
+
+/**
+ * Whether the request's Accept-Encoding lists gzip or *, and not with q=0.
+*/
+static bool accepts_gzip(httpd_req_t* req)
+{
+    char value[WEBS_ACCEPT_ENCODING_MAX];
+    esp_err_t rc = httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value));
+    if (rc != ESP_OK && rc != ESP_ERR_HTTPD_RESULT_TRUNC)
+    {
+        return false;
+    }
+
+    char* save = NULL;
+    for (char* coding = strtok_r(value, ",", &save); coding != NULL; coding = strtok_r(NULL, ",", &save))
+    {
+        while (*coding == ' ' || *coding == '\t')
+        {
+            ++coding;
+        }
+
+        size_t name_len = strcspn(coding, " \t;");
+        bool named = (name_len == 4 && strncasecmp(coding, "gzip", 4) == 0) || (name_len == 1 && *coding == '*');
+
+        if (named)
+        {
+            return !q_is_zero(coding + name_len);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Whether a coding's parameters (";q=0.5") set its weight to zero, which means "not acceptable".
+*/
+static bool q_is_zero(const char* params)
+{
+    const char* q = strstr(params, "q=");
+    if (q == NULL)
+    {
+        return false;
+    }
+
+    // 0, 0. or 0.000: only zeros after the point.
+    q += 2;
+    if (*q++ != '0')
+    {
+        return false;
+    }
+    if (*q == '.')
+    {
+        ++q;
+    }
+    while (*q == '0')
+    {
+        ++q;
+    }
+
+    return *q == 0 || *q == ' ' || *q == '\t' || *q == ';';
+}
+
+/**
+ * Handler for every URI: runs the route's handler if the request is admitted. A refused request has already been
+ * answered, so it is not an error.
+*/
+static esp_err_t admit_handler(httpd_req_t *req)
+{
+    const route* r = (const route*)req->user_ctx;
+
+    if (!admit(req, r->cost))
+    {
+        return ESP_OK;
+    }
+
+    return r->handler(req);
+}
+
+/**
+ * Check the request against the heap floor, the client's budget and the global budget, in that order, and answer it
+ * with 503 or 429 if it is refused. A client over its own budget is refused before it can use up the global one.
+ * Requests from the device itself (the benchmark's clients) are not limited.
+*/
+static bool admit(httpd_req_t *req, uint32_t cost)
+{
+    uint32_t address = client_address(req);
+    if ((ntohl(address) >> 24) == 127)
+    {
+        ++s_admission.stats.admitted;
+        return true;
+    }
+
+    if (heap_caps_get_free_size(MALLOC_CAP_DEFAULT) < WEBS_ADMIT_MIN_HEAP_BYTES)
+    {
+        ++s_admission.stats.low_heap;
+        send_refusal(req, "503 Service Unavailable", 1000);
+        return false;
+    }
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t retry_ms = 0;
+
+    if (!rlm_table_take(&s_admission.clients, address, cost, now_ms, &retry_ms))
+    {
+        ++s_admission.stats.limited;
+        send_refusal(req, "429 Too Many Requests", retry_ms);
+        return false;
+    }
+
+    if (!rlm_bucket_take(&s_admission.global, &s_global_rate, cost, now_ms, &retry_ms))
+    {
+        ++s_admission.stats.busy;
+        send_refusal(req, "503 Service Unavailable", retry_ms);
+        return false;
+    }
+
+    ++s_admission.stats.admitted;
+    return true;
+}
+
+/**
+ * Get the client's IPv4 address (network byte order), or 0 if it can't be read. The server listens on IPv6 when lwIP
+ * has it, so IPv4 clients show up as mapped addresses.
+*/
+static uint32_t client_address(httpd_req_t *req)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    uint32_t address = 0;
+
+    int sockfd = httpd_req_to_sockfd(req);
+    if (sockfd < 0 || getpeername(sockfd, (struct sockaddr*)&addr, &addr_len) != 0)
+    {
+        return 0;
+    }
+
+    if (addr.ss_family == AF_INET)
+    {
+        address = ((struct sockaddr_in*)&addr)->sin_addr.s_addr;
+    }
+#if CONFIG_LWIP_IPV6
+    else if (addr.ss_family == AF_INET6)
+    {
+        // The last four bytes of ::ffff:a.b.c.d.
+        memcpy(&address, &((struct sockaddr_in6*)&addr)->sin6_addr.s6_addr[12], sizeof(address));
+    }
+#endif
+
+    return address;
+}
+
+/**
+ * Answer a refused request with an empty body. Retry-After is in whole seconds, rounded up.
+*/
+static void send_refusal(httpd_req_t *req, const char* status, uint32_t retry_ms)
+{
+    char retry_after[11];
+    snprintf(retry_after, sizeof(retry_after), "%" PRIu32, retry_ms / 1000 + (retry_ms % 1000 != 0 ? 1 : 0));
+
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_hdr(req, "Retry-After", retry_after);
+    httpd_resp_send(req, NULL, 0);
+}
+
+// Reading the sensor's device info takes the I2C bus from the sensor task.
+static const route s_home_route = { home_get_handler, WEBS_COST_DEFAULT };
+static const route s_info_route = { info_get_handler, WEBS_COST_I2C };
+static const route s_config_get_route = { config_get_handler, WEBS_COST_DEFAULT };
+static const route s_config_post_route = { config_post_handler, WEBS_COST_DEFAULT };
+static const route s_history_get_route = { history_get_handler, WEBS_COST_DEFAULT };
+static const route s_time_get_route = { time_get_handler, WEBS_COST_DEFAULT };
+static const route s_time_post_route = { time_post_handler, WEBS_COST_DEFAULT };
+static const route s_stats_get_route = { stats_get_handler, WEBS_COST_DEFAULT };
+static const route s_alerts_get_route = { alerts_get_handler, WEBS_COST_DEFAULT };
+// An export holds the httpd task for as long as the whole log takes to send.
+static const route s_export_get_route = { export_get_handler, WEBS_COST_EXPORT };
+
+const httpd_uri_t home =
+{
+    .uri = "/",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_home_route
+};
+
+const httpd_uri_t info =
+{
+    .uri = "/info",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_info_route
+};
+
+const httpd_uri_t config_get =
+{
+    .uri = "/config",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_config_get_route
+};
+
+const httpd_uri_t config_post =
+{
+    .uri = "/config",
+    .method = HTTP_POST,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_config_post_route
+};
+
+const httpd_uri_t history_get =
+{
+    .uri = "/api/history",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_history_get_route
+};
+
+const httpd_uri_t time_get =
+{
+    .uri = "/api/time",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_time_get_route
+};
+
+const httpd_uri_t time_post =
+{
+    .uri = "/api/time",
+    .method = HTTP_POST,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_time_post_route
+};
+
+const httpd_uri_t stats_get =
+{
+    .uri = "/api/stats",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_stats_get_route
+};
+
+const httpd_uri_t alerts_get =
+{
+    .uri = "/alerts",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_alerts_get_route
+};
+
+const httpd_uri_t export_get =
+{
+    .uri = "/api/export",
+    .method = HTTP_GET,
+    .handler = admit_handler,
+    .user_ctx = (void*)&s_export_get_route
+};
+
+static httpd_handle_t start_webserver()
+{
+    httpd_handle_t server;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.lru_purge_enable = true;
+    config.max_open_sockets = WEBS_MAX_OPEN_SOCKETS;
+    config.max_uri_handlers = 12;
+
+    const tl_placement* placement = tl_get(TL_TASK_HTTPD);
+    config.stack_size = placement->stack_size;
+    config.task_priority = placement->priority;
+    config.core_id = placement->core;
+
+    ESP_LOGI(LOG_TAG, "Starting server on port: '%d'", config.server_port);
+
+    if (httpd_start(&server, &config) == ESP_OK)
+    {
+        httpd_register_uri_handler(server, &home);
+        httpd_register_uri_handler(server, &info);
+        httpd_register_uri_handler(server, &config_get);
+        httpd_register_uri_handler(server, &config_post);
+        httpd_register_uri_handler(server, &history_get);
+        httpd_register_uri_handler(server, &time_get);
+        httpd_register_uri_handler(server, &time_post);
+        httpd_register_uri_handler(server, &stats_get);
+        httpd_register_uri_handler(server, &alerts_get);
+        httpd_register_uri_handler(server, &export_get);
+        return server;
+    }
+
+    ESP_LOGE(LOG_TAG, "Error starting server!");
+    return (httpd_handle_t)NULL;
 }
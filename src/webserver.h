@@ -1,6 +1,12 @@
 #ifndef _WA_WEBSERVER_H_INCLUDE_GUARD
 #define _WA_WEBSERVER_H_INCLUDE_GUARD
 
+#include <stddef.h>
+
 void wbs_init();
 
+void wbs_start_wifi();
+
+size_t wbs_static_size();
+
 #endif // _WA_WEBSERVER_H_INCLUDE_GUARD
@@ -0,0 +1,149 @@
+#include <string.h>
+#include <unity.h>
+#include <alert_rules.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_above_hysteresis()
+{
+    alr_rule rule = { .kind = ALR_ABOVE, .enabled = true, .threshold = 9000, .hysteresis = 100 };
+    alr_state state;
+    alr_engine engine;
+    alr_event ev;
+
+    TEST_ASSERT_EQUAL_INT(ALR_OK, alr_init(&engine, &rule, &state, 1));
+
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 0, 8999, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 1, 9000, &ev, 1));
+    TEST_ASSERT_TRUE(ev.raised);
+    TEST_ASSERT_EQUAL_INT(9000, ev.value);
+    TEST_ASSERT_EQUAL_UINT(0, ev.rule);
+    TEST_ASSERT_TRUE(alr_any_active(&engine));
+
+    // Inside the hysteresis band nothing changes, in either direction.
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 2, 8950, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 3, 9100, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 4, 8900, &ev, 1));
+
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 5, 8899, &ev, 1));
+    TEST_ASSERT_FALSE(ev.raised);
+    TEST_ASSERT_FALSE(alr_is_active(&engine, 0));
+}
+
+void test_below_min_duration()
+{
+    alr_rule rule = { .kind = ALR_BELOW, .enabled = true, .threshold = 3200, .hysteresis = 50, .min_duration_s = 120 };
+    alr_state state;
+    alr_engine engine;
+    alr_event ev;
+
+    alr_init(&engine, &rule, &state, 1);
+
+    // A dip shorter than the minimum duration does not fire.
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 0, 3100, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 60, 3150, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 90, 3300, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 150, 3100, &ev, 1));
+
+    // The timer restarted at 150.
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 240, 3100, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 270, 3000, &ev, 1));
+    TEST_ASSERT_TRUE(ev.raised);
+    TEST_ASSERT_EQUAL_UINT(270, ev.time_s);
+
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 280, 3250, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 290, 3251, &ev, 1));
+    TEST_ASSERT_FALSE(ev.raised);
+}
+
+void test_rate_windows()
+{
+    alr_rule rule = { .kind = ALR_RATE, .enabled = true, .threshold = 200, .hysteresis = 50 };
+    alr_state state;
+    alr_engine engine;
+    alr_event ev;
+
+    alr_init(&engine, &rule, &state, 1);
+
+    // Fast polls: a big jump inside one window is only judged at the window end.
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 0, 7000, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 1, 7500, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 59, 7100, &ev, 1));
+
+    // 7000 -> 7100 over 60 s is 100 per minute.
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 60, 7100, &ev, 1));
+
+    // Falling 300 over 90 s is 200 per minute.
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 150, 6800, &ev, 1));
+    TEST_ASSERT_TRUE(ev.raised);
+    TEST_ASSERT_EQUAL_INT(-200, ev.value);
+
+    // 160 per minute is in the band, 100 clears.
+    TEST_ASSERT_EQUAL_UINT(0, alr_evaluate(&engine, 210, 6640, &ev, 1));
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 270, 6540, &ev, 1));
+    TEST_ASSERT_FALSE(ev.raised);
+}
+
+void test_multiple_rules_reset()
+{
+    alr_rule rules[3] = {
+        { .kind = ALR_ABOVE, .enabled = true, .threshold = 8000 },
+        { .kind = ALR_BELOW, .enabled = false, .threshold = 9000 },
+        { .kind = ALR_ABOVE, .enabled = true, .threshold = 8500 },
+    };
+    alr_state states[3];
+    alr_engine engine;
+    alr_event ev[3];
+
+    alr_init(&engine, rules, states, 3);
+
+    // The disabled rule never fires.
+    TEST_ASSERT_EQUAL_UINT(2, alr_evaluate(&engine, 0, 8600, ev, 3));
+    TEST_ASSERT_EQUAL_UINT(0, ev[0].rule);
+    TEST_ASSERT_EQUAL_UINT(2, ev[1].rule);
+
+    // Events beyond max are dropped, state still changes.
+    TEST_ASSERT_EQUAL_UINT(1, alr_evaluate(&engine, 1, 7000, ev, 1));
+    TEST_ASSERT_FALSE(alr_any_active(&engine));
+
+    alr_evaluate(&engine, 2, 8100, ev, 3);
+    TEST_ASSERT_TRUE(alr_is_active(&engine, 0));
+    TEST_ASSERT_EQUAL_UINT(1, alr_reset(&engine, 3, ev, 3));
+    TEST_ASSERT_FALSE(ev[0].raised);
+    TEST_ASSERT_FALSE(alr_any_active(&engine));
+
+    TEST_ASSERT_EQUAL_INT(ALR_FAIL, alr_init(&engine, NULL, states, 1));
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_above_hysteresis);
+    RUN_TEST(test_below_min_duration);
+    RUN_TEST(test_rate_windows);
+    RUN_TEST(test_multiple_rules_reset);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
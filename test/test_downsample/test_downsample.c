@@ -0,0 +1,153 @@
+#include <string.h>
+#include <unity.h>
+#include <downsample.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+/**
+ * Feed points and collect everything handed back, finish included. Returns the count handed back, which is more than
+ * out_size if it overflowed.
+*/
+static size_t run(dsm_minmax* dsm, const uint32_t* times, const int32_t* values, size_t count, dsm_point* out,
+    size_t out_size)
+{
+    size_t n = 0;
+    dsm_point points[DSM_MAX_OUT];
+
+    for (size_t i = 0; i <= count; ++i)
+    {
+        size_t added = i < count ? dsm_add(dsm, times[i], values[i], points) : dsm_finish(dsm, points);
+        for (size_t j = 0; j < added; ++j)
+        {
+            if (n < out_size)
+            {
+                out[n] = points[j];
+            }
+            ++n;
+        }
+    }
+
+    return n;
+}
+
+void test_buckets_keep_low_and_high()
+{
+    // Two buckets of 5 seconds. The first has its high before its low, the second a single point.
+    const uint32_t times[] = { 0, 1, 2, 3, 4, 7 };
+    const int32_t values[] = { 10, 30, 20, 5, 15, 40 };
+    dsm_point out[8];
+    dsm_minmax dsm;
+
+    dsm_init(&dsm, 0, 9, 4);
+    size_t n = run(&dsm, times, values, 6, out, 8);
+
+    TEST_ASSERT_EQUAL_UINT(3, n);
+    TEST_ASSERT_EQUAL_UINT32(1, out[0].time);
+    TEST_ASSERT_EQUAL_INT32(30, out[0].value);
+    TEST_ASSERT_EQUAL_UINT32(3, out[1].time);
+    TEST_ASSERT_EQUAL_INT32(5, out[1].value);
+    TEST_ASSERT_EQUAL_UINT32(7, out[2].time);
+    TEST_ASSERT_EQUAL_INT32(40, out[2].value);
+}
+
+void test_empty_and_out_of_range()
+{
+    dsm_point out[DSM_MAX_OUT];
+    dsm_minmax dsm;
+
+    dsm_init(&dsm, 100, 200, 10);
+    TEST_ASSERT_EQUAL_UINT(0, dsm_finish(&dsm, out));
+
+    // Before the range: ignored.
+    TEST_ASSERT_EQUAL_UINT(0, dsm_add(&dsm, 50, 1, out));
+    TEST_ASSERT_EQUAL_UINT(0, dsm_finish(&dsm, out));
+
+    // After the range: ignored too, so it can't add a bucket past max_points.
+    TEST_ASSERT_EQUAL_UINT(0, dsm_add(&dsm, 201, 1, out));
+    TEST_ASSERT_EQUAL_UINT(0, dsm_add(&dsm, 5000, 1, out));
+    TEST_ASSERT_EQUAL_UINT(0, dsm_finish(&dsm, out));
+
+    // A flat bucket is one point.
+    TEST_ASSERT_EQUAL_UINT(0, dsm_add(&dsm, 100, 7, out));
+    TEST_ASSERT_EQUAL_UINT(0, dsm_add(&dsm, 101, 7, out));
+    TEST_ASSERT_EQUAL_UINT(1, dsm_finish(&dsm, out));
+    TEST_ASSERT_EQUAL_UINT32(100, out[0].time);
+}
+
+/**
+ * A long series with one spike and one dip, over the whole 32 bit time range: the output stays within the bound, in
+ * order, and keeps both extremes.
+*/
+void test_bound_and_extremes()
+{
+    enum { COUNT = 5000, MAX_POINTS = 64 };
+    static uint32_t times[COUNT];
+    static int32_t values[COUNT];
+    dsm_point out[MAX_POINTS];
+    dsm_minmax dsm;
+
+    for (int i = 0; i < COUNT; ++i)
+    {
+        times[i] = (uint32_t)i * 60;
+        values[i] = 7000 + (i % 100);
+    }
+    values[1234] = 9000;
+    values[4321] = 5000;
+
+    dsm_init(&dsm, 0, UINT32_MAX, MAX_POINTS);
+    size_t n = run(&dsm, times, values, COUNT, out, MAX_POINTS);
+    // The whole range is one bucket's worth of these times, so the spike and the dip are all that's left.
+    TEST_ASSERT_EQUAL_UINT(2, n);
+    TEST_ASSERT_EQUAL_INT32(9000, out[0].value);
+    TEST_ASSERT_EQUAL_INT32(5000, out[1].value);
+
+    // Fit to the series: every bucket is used.
+    dsm_init(&dsm, 0, times[COUNT - 1], MAX_POINTS);
+    n = run(&dsm, times, values, COUNT, out, MAX_POINTS);
+    TEST_ASSERT_TRUE(n <= MAX_POINTS);
+
+    bool spike = false;
+    bool dip = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        TEST_ASSERT_TRUE(i == 0 || out[i].time > out[i - 1].time);
+        spike = spike || (out[i].time == times[1234] && out[i].value == 9000);
+        dip = dip || (out[i].time == times[4321] && out[i].value == 5000);
+    }
+
+    TEST_ASSERT_TRUE(n > MAX_POINTS / 2);
+    TEST_ASSERT_TRUE(spike);
+    TEST_ASSERT_TRUE(dip);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_buckets_keep_low_and_high);
+    RUN_TEST(test_empty_and_out_of_range);
+    RUN_TEST(test_bound_and_extremes);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
@@ -0,0 +1,313 @@
+#include <string.h>
+#include <unity.h>
+#include <gzip_stream.h>
+
+#define OUT_MAX 16384
+#define TEXT_MAX 8192
+
+typedef struct output
+{
+    uint8_t data[OUT_MAX];
+    size_t len;
+    size_t calls;
+    // Fail the call with this number (from 1), 0 for never.
+    size_t fail_at;
+} output;
+
+/**
+ * Reads the stream back. The compressor only writes one fixed Huffman block, so that's all this decodes.
+*/
+typedef struct reader
+{
+    const uint8_t* data;
+    size_t len;
+    size_t pos;
+    unsigned bit;
+} reader;
+
+static output s_out;
+static uint8_t s_text[TEXT_MAX];
+static uint8_t s_decoded[TEXT_MAX];
+
+void setUp(void)
+{
+    memset(&s_out, 0, sizeof(s_out));
+}
+
+void tearDown(void)
+{
+
+}
+
+static int sink(void* ctx, const char* data, size_t len)
+{
+    output* out = (output*)ctx;
+
+    ++out->calls;
+    if (out->calls == out->fail_at || out->len + len > OUT_MAX)
+    {
+        return GZS_FAIL;
+    }
+
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    return GZS_OK;
+}
+
+static uint32_t read_bits(reader* r, unsigned count)
+{
+    uint32_t value = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        uint32_t b = r->pos < r->len ? (r->data[r->pos] >> r->bit) & 1 : 0;
+        value |= b << i;
+        if (++r->bit == 8)
+        {
+            r->bit = 0;
+            ++r->pos;
+        }
+    }
+    return value;
+}
+
+static uint32_t read_code(reader* r, unsigned count)
+{
+    uint32_t code = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        code = (code << 1) | read_bits(r, 1);
+    }
+    return code;
+}
+
+/**
+ * Fixed literal/length code: 7 bits for 256 to 279, 8 bits for 0 to 143 and 280 to 287, 9 bits for 144 to 255.
+*/
+static unsigned read_symbol(reader* r)
+{
+    uint32_t code = read_code(r, 7);
+    if (code <= 0x17)
+    {
+        return 256 + code;
+    }
+
+    code = (code << 1) | read_bits(r, 1);
+    if (code >= 0x30 && code <= 0xBF)
+    {
+        return code - 0x30;
+    }
+    if (code >= 0xC0 && code <= 0xC7)
+    {
+        return 280 + code - 0xC0;
+    }
+
+    code = (code << 1) | read_bits(r, 1);
+    return 144 + code - 0x190;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Check the gzip framing and decode the output into s_decoded, setting the decoded length.
+*/
+static void gunzip(const output* out, size_t* decoded_len)
+{
+    static const uint16_t length_base[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227,
+        258
+    };
+    static const uint8_t length_extra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    static const uint16_t dist_base[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+        6145, 8193, 12289, 16385, 24577
+    };
+    static const uint8_t dist_extra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+
+    TEST_ASSERT_TRUE(out->len >= 20);
+    TEST_ASSERT_EQUAL_UINT8(0x1F, out->data[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x8B, out->data[1]);
+    TEST_ASSERT_EQUAL_UINT8(8, out->data[2]);
+    TEST_ASSERT_EQUAL_UINT8(0, out->data[3]);
+
+    reader r = { .data = out->data + 10, .len = out->len - 18 };
+
+    // Final block, fixed codes.
+    TEST_ASSERT_EQUAL_UINT32(1, read_bits(&r, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, read_bits(&r, 2));
+
+    size_t len = 0;
+    for (;;)
+    {
+        unsigned symbol = read_symbol(&r);
+        if (symbol < 256)
+        {
+            TEST_ASSERT_TRUE(len < TEXT_MAX);
+            s_decoded[len++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 256)
+        {
+            break;
+        }
+
+        unsigned code = symbol - 257;
+        TEST_ASSERT_TRUE(code < 29);
+        size_t length = length_base[code] + read_bits(&r, length_extra[code]);
+
+        code = read_code(&r, 5);
+        TEST_ASSERT_TRUE(code < 30);
+        size_t distance = dist_base[code] + read_bits(&r, dist_extra[code]);
+
+        TEST_ASSERT_TRUE(distance <= len && distance <= GZS_WINDOW_SIZE);
+        TEST_ASSERT_TRUE(len + length <= TEXT_MAX);
+        for (size_t i = 0; i < length; ++i, ++len)
+        {
+            s_decoded[len] = s_decoded[len - distance];
+        }
+    }
+
+    // The block ends in the last byte before the trailer.
+    TEST_ASSERT_EQUAL_size_t(r.len, r.pos + (r.bit > 0 ? 1 : 0));
+
+    const uint8_t* trailer = out->data + out->len - 8;
+    TEST_ASSERT_EQUAL_UINT32(crc32(s_decoded, len), le32(trailer));
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)len, le32(trailer + 4));
+
+    *decoded_len = len;
+}
+
+/**
+ * Markup-like text several windows long, written in uneven pieces, comes back the same and smaller.
+*/
+void test_round_trip_text()
+{
+    size_t len = 0;
+    for (int i = 0; len + 64 < TEXT_MAX; ++i)
+    {
+        static const char* items[] = { "<li>70.42</li>", "<li>69.87</li>", "<p>Average Temperature: ", "</p>" };
+        const char* item = items[(i * 7 + i / 3) % 4];
+        memcpy(s_text + len, item, strlen(item));
+        len += strlen(item);
+        s_text[len++] = (uint8_t)('0' + i % 10);
+    }
+
+    gzs_t gz;
+    TEST_ASSERT_EQUAL_INT(GZS_OK, gzs_init(&gz, sink, &s_out));
+
+    size_t written = 0;
+    for (size_t piece = 1; written < len; piece = piece * 3 % 1000 + 1)
+    {
+        size_t n = len - written < piece ? len - written : piece;
+        TEST_ASSERT_EQUAL_INT(GZS_OK, gzs_write(&gz, s_text + written, n));
+        written += n;
+    }
+    TEST_ASSERT_EQUAL_INT(GZS_OK, gzs_finish(&gz));
+
+    size_t decoded_len = 0;
+    gunzip(&s_out, &decoded_len);
+    TEST_ASSERT_EQUAL_size_t(len, decoded_len);
+    TEST_ASSERT_EQUAL_MEMORY(s_text, s_decoded, len);
+    TEST_ASSERT_EQUAL_UINT32(len, gz.total_in);
+    TEST_ASSERT_EQUAL_UINT32(s_out.len, gz.total_out);
+    TEST_ASSERT_TRUE(s_out.len < len / 4);
+}
+
+/**
+ * Every byte value, including those with 9 bit codes, and no repeats to match.
+*/
+void test_round_trip_binary()
+{
+    uint32_t state = 1;
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        state = state * 1103515245 + 12345;
+        s_text[i] = i < 256 ? (uint8_t)i : (uint8_t)(state >> 16);
+    }
+
+    gzs_t gz;
+    gzs_init(&gz, sink, &s_out);
+    gzs_write(&gz, s_text, 3000);
+    TEST_ASSERT_EQUAL_INT(GZS_OK, gzs_finish(&gz));
+
+    size_t decoded_len = 0;
+    gunzip(&s_out, &decoded_len);
+    TEST_ASSERT_EQUAL_size_t(3000, decoded_len);
+    TEST_ASSERT_EQUAL_MEMORY(s_text, s_decoded, 3000);
+}
+
+void test_empty()
+{
+    gzs_t gz;
+    gzs_init(&gz, sink, &s_out);
+    TEST_ASSERT_EQUAL_INT(GZS_OK, gzs_finish(&gz));
+
+    size_t decoded_len = 1;
+    gunzip(&s_out, &decoded_len);
+    TEST_ASSERT_EQUAL_size_t(0, decoded_len);
+    TEST_ASSERT_EQUAL_size_t(20, s_out.len);
+}
+
+/**
+ * Once the sink fails, the stream reports it and the sink isn't called again.
+*/
+void test_sink_failure()
+{
+    memset(s_text, 'a', TEXT_MAX);
+    for (size_t i = 0; i < TEXT_MAX; i += 3)
+    {
+        s_text[i] = (uint8_t)(0x80 | i);
+    }
+    s_out.fail_at = 1;
+
+    gzs_t gz;
+    gzs_init(&gz, sink, &s_out);
+    TEST_ASSERT_EQUAL_INT(GZS_FAIL, gzs_write(&gz, s_text, TEXT_MAX));
+    TEST_ASSERT_EQUAL_INT(GZS_FAIL, gzs_finish(&gz));
+    TEST_ASSERT_EQUAL_size_t(1, s_out.calls);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip_text);
+    RUN_TEST(test_round_trip_binary);
+    RUN_TEST(test_empty);
+    RUN_TEST(test_sink_failure);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
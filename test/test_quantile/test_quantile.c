@@ -0,0 +1,151 @@
+#include <string.h>
+#include <unity.h>
+#include <quantile.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+// Deterministic shuffle of 0..9999 (an LCG with full period over a power of two, filtered to the range).
+static int32_t next_value(uint32_t* state)
+{
+    do
+    {
+        *state = *state * 1664525u + 1013904223u;
+    } while ((*state >> 18) >= 10000);
+
+    return (int32_t)(*state >> 18);
+}
+
+void test_few_values_exact()
+{
+    qnt_p2 est;
+    int32_t value;
+
+    qnt_p2_init(&est, 500);
+    TEST_ASSERT_FALSE(qnt_p2_get(&est, &value));
+
+    qnt_p2_add(&est, 30);
+    qnt_p2_add(&est, 10);
+    qnt_p2_add(&est, 20);
+    TEST_ASSERT_TRUE(qnt_p2_get(&est, &value));
+    TEST_ASSERT_EQUAL_INT(20, value);
+
+    TEST_ASSERT_EQUAL_INT(QNT_FAIL, qnt_p2_init(&est, 1001));
+}
+
+void test_uniform_distribution()
+{
+    const uint16_t permilles[] = { 50, 500, 950 };
+    const int32_t expected[] = { 500, 5000, 9500 };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        qnt_p2 est;
+        uint32_t state = 12345;
+        int32_t value;
+
+        qnt_p2_init(&est, permilles[i]);
+        for (int n = 0; n < 20000; ++n)
+        {
+            qnt_p2_add(&est, next_value(&state));
+        }
+
+        TEST_ASSERT_TRUE(qnt_p2_get(&est, &value));
+        TEST_ASSERT_INT_WITHIN(150, expected[i], value);
+    }
+}
+
+void test_spike_tail()
+{
+    qnt_p2 est;
+    int32_t value;
+
+    // A steady 70.00 with 10% of readings at 90.00: the 95th percentile sees the spikes, the median does not.
+    qnt_p2_init(&est, 950);
+    for (int n = 0; n < 5000; ++n)
+    {
+        qnt_p2_add(&est, n % 10 == 0 ? 9000 : 7000);
+    }
+    TEST_ASSERT_TRUE(qnt_p2_get(&est, &value));
+    TEST_ASSERT_INT_WITHIN(100, 9000, value);
+
+    qnt_p2_init(&est, 500);
+    for (int n = 0; n < 5000; ++n)
+    {
+        qnt_p2_add(&est, n % 10 == 0 ? 9000 : 7000);
+    }
+    TEST_ASSERT_TRUE(qnt_p2_get(&est, &value));
+    TEST_ASSERT_INT_WITHIN(100, 7000, value);
+}
+
+void test_window_staggered()
+{
+    const uint16_t permilles[] = { 50, 500, 950 };
+    qnt_window win;
+    int32_t values[3];
+    uint32_t span;
+
+    TEST_ASSERT_EQUAL_INT(QNT_OK, qnt_window_init(&win, 100, permilles, 3));
+    TEST_ASSERT_EQUAL_UINT(0, qnt_window_get(&win, 0, values, &span));
+
+    // One value per second: 1000 for the first 100 s, then 2000.
+    for (uint32_t t = 0; t < 100; ++t)
+    {
+        qnt_window_add(&win, t, 1000);
+    }
+    TEST_ASSERT_EQUAL_UINT(100, qnt_window_get(&win, 99, values, &span));
+    TEST_ASSERT_EQUAL_UINT(99, span);
+    TEST_ASSERT_EQUAL_INT(1000, values[1]);
+
+    for (uint32_t t = 100; t < 120; ++t)
+    {
+        qnt_window_add(&win, t, 2000);
+    }
+
+    // The first set restarted at 100, so the second (started at 50) is read: 50 old and 20 new values.
+    TEST_ASSERT_EQUAL_UINT(70, qnt_window_get(&win, 119, values, &span));
+    TEST_ASSERT_EQUAL_UINT(69, span);
+    TEST_ASSERT_INT_WITHIN(20, 1000, values[0]);
+    TEST_ASSERT_INT_WITHIN(20, 2000, values[2]);
+
+    // Once the second set restarts at 150 the first is read again, and the old values are gone.
+    for (uint32_t t = 120; t < 160; ++t)
+    {
+        qnt_window_add(&win, t, 2000);
+    }
+    TEST_ASSERT_EQUAL_UINT(60, qnt_window_get(&win, 159, values, &span));
+    TEST_ASSERT_EQUAL_UINT(59, span);
+    TEST_ASSERT_EQUAL_INT(2000, values[0]);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_few_values_exact);
+    RUN_TEST(test_uniform_distribution);
+    RUN_TEST(test_spike_tail);
+    RUN_TEST(test_window_staggered);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
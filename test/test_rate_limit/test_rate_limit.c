@@ -0,0 +1,109 @@
+#include <string.h>
+#include <unity.h>
+#include <rate_limit.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_bucket_burst_and_refill()
+{
+    const rlm_rate rate = { .per_s = 2, .burst = 4 };
+    rlm_bucket bucket;
+    uint32_t retry = 0;
+
+    rlm_bucket_init(&bucket, &rate, 1000);
+
+    // The whole burst at once, then nothing.
+    for (int i = 0; i < 4; ++i)
+    {
+        TEST_ASSERT_TRUE(rlm_bucket_take(&bucket, &rate, 1, 1000, &retry));
+    }
+    TEST_ASSERT_FALSE(rlm_bucket_take(&bucket, &rate, 1, 1000, &retry));
+    TEST_ASSERT_EQUAL_UINT32(500, retry);
+
+    // Half a token is not enough; a whole one is.
+    TEST_ASSERT_FALSE(rlm_bucket_take(&bucket, &rate, 1, 1250, &retry));
+    TEST_ASSERT_EQUAL_UINT32(250, retry);
+    TEST_ASSERT_TRUE(rlm_bucket_take(&bucket, &rate, 1, 1500, &retry));
+
+    // A long idle time refills to the burst, not past it.
+    TEST_ASSERT_TRUE(rlm_bucket_take(&bucket, &rate, 4, 100000, &retry));
+    TEST_ASSERT_FALSE(rlm_bucket_take(&bucket, &rate, 1, 100000, &retry));
+
+    // A cost above the burst never fits.
+    TEST_ASSERT_FALSE(rlm_bucket_take(&bucket, &rate, 5, 200000, &retry));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, retry);
+}
+
+void test_bucket_clock_wrap()
+{
+    const rlm_rate rate = { .per_s = 1, .burst = 1 };
+    rlm_bucket bucket;
+
+    rlm_bucket_init(&bucket, &rate, UINT32_MAX - 200);
+    TEST_ASSERT_TRUE(rlm_bucket_take(&bucket, &rate, 1, UINT32_MAX - 200, NULL));
+
+    // 1000 ms later, across the wrap.
+    TEST_ASSERT_FALSE(rlm_bucket_take(&bucket, &rate, 1, 700, NULL));
+    TEST_ASSERT_TRUE(rlm_bucket_take(&bucket, &rate, 1, 799, NULL));
+}
+
+void test_table_keys_and_eviction()
+{
+    const rlm_rate rate = { .per_s = 1, .burst = 2 };
+    rlm_bucket buckets[2];
+    rlm_table table;
+    uint32_t retry = 0;
+
+    TEST_ASSERT_EQUAL_INT(RLM_FAIL, rlm_table_init(&table, buckets, 0, &rate));
+    TEST_ASSERT_EQUAL_INT(RLM_OK, rlm_table_init(&table, buckets, 2, &rate));
+
+    // Keys have their own buckets.
+    TEST_ASSERT_TRUE(rlm_table_take(&table, 10, 2, 0, &retry));
+    TEST_ASSERT_FALSE(rlm_table_take(&table, 10, 1, 0, &retry));
+    TEST_ASSERT_TRUE(rlm_table_take(&table, 20, 2, 100, &retry));
+    TEST_ASSERT_EQUAL_UINT(2, table.count);
+
+    // A third key takes over key 10's bucket, which was used longest ago.
+    TEST_ASSERT_TRUE(rlm_table_take(&table, 30, 1, 200, &retry));
+    TEST_ASSERT_EQUAL_UINT(2, table.count);
+    TEST_ASSERT_FALSE(rlm_table_take(&table, 20, 1, 200, &retry));
+    TEST_ASSERT_EQUAL_UINT32(900, retry);
+
+    // Key 10 comes back with a full bucket, taking over key 20's. Key 30 keeps its nearly empty one.
+    TEST_ASSERT_TRUE(rlm_table_take(&table, 30, 1, 250, &retry));
+    TEST_ASSERT_TRUE(rlm_table_take(&table, 10, 2, 300, &retry));
+    TEST_ASSERT_FALSE(rlm_table_take(&table, 30, 1, 300, &retry));
+    TEST_ASSERT_EQUAL_UINT32(900, retry);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_bucket_burst_and_refill);
+    RUN_TEST(test_bucket_clock_wrap);
+    RUN_TEST(test_table_keys_and_eviction);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
@@ -0,0 +1,358 @@
+#include <unity.h>
+#include <ring_buffer.h>
+
+#ifndef ESP_PLATFORM
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#define CAPACITY 8
+
+static int32_t s_storage[CAPACITY];
+static rbuf s_ring;
+
+void setUp(void)
+{
+    rbuf_init(&s_ring, s_storage, sizeof(int32_t), CAPACITY);
+}
+
+void tearDown(void)
+{
+
+}
+
+static void push_range(int32_t first, int32_t last)
+{
+    for (int32_t v = first; v <= last; ++v)
+    {
+        rbuf_push(&s_ring, &v);
+    }
+}
+
+void test_init()
+{
+    rbuf ring;
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_init(&ring, s_storage, sizeof(int32_t), 6));
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_init(&ring, s_storage, sizeof(int32_t), 0));
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_init(&ring, NULL, sizeof(int32_t), CAPACITY));
+    TEST_ASSERT_EQUAL_INT(RBUF_OK, rbuf_init(&ring, s_storage, sizeof(int32_t), CAPACITY));
+
+    TEST_ASSERT_EQUAL_UINT(0, rbuf_count(&ring));
+    TEST_ASSERT_EQUAL_UINT(CAPACITY, rbuf_capacity(&ring));
+    TEST_ASSERT_EQUAL_UINT(CAPACITY, rbuf_limit(&ring));
+    TEST_ASSERT_NULL(rbuf_at(&ring, 0));
+}
+
+void test_push_and_wrap()
+{
+    push_range(1, 5);
+    TEST_ASSERT_EQUAL_UINT(5, rbuf_count(&s_ring));
+    TEST_ASSERT_EQUAL_INT32(1, *(int32_t*)rbuf_at(&s_ring, 0));
+    TEST_ASSERT_EQUAL_INT32(5, *(int32_t*)rbuf_at(&s_ring, 4));
+    TEST_ASSERT_NULL(rbuf_at(&s_ring, 5));
+
+    // Overwrites the oldest once full. Stored values are never mistaken for empty slots.
+    push_range(6, 20);
+    TEST_ASSERT_EQUAL_UINT(CAPACITY, rbuf_count(&s_ring));
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT32(13 + (int32_t)i, *(int32_t*)rbuf_at(&s_ring, i));
+    }
+}
+
+void test_copy_oldest_first()
+{
+    int32_t out[CAPACITY];
+
+    // 11..18 wraps the storage, so the copy takes two segments.
+    push_range(1, 18);
+    TEST_ASSERT_EQUAL_UINT(CAPACITY, rbuf_copy_oldest_first(&s_ring, 0, out, CAPACITY));
+    for (int i = 0; i < CAPACITY; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT32(11 + i, out[i]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT(3, rbuf_copy_oldest_first(&s_ring, 5, out, CAPACITY));
+    TEST_ASSERT_EQUAL_INT32(16, out[0]);
+    TEST_ASSERT_EQUAL_INT32(18, out[2]);
+
+    TEST_ASSERT_EQUAL_UINT(2, rbuf_copy_oldest_first(&s_ring, 1, out, 2));
+    TEST_ASSERT_EQUAL_INT32(12, out[0]);
+    TEST_ASSERT_EQUAL_INT32(13, out[1]);
+
+    TEST_ASSERT_EQUAL_UINT(0, rbuf_copy_oldest_first(&s_ring, CAPACITY, out, CAPACITY));
+}
+
+void test_copy_newest_first()
+{
+    int32_t out[CAPACITY];
+
+    TEST_ASSERT_EQUAL_UINT(0, rbuf_copy_newest_first(&s_ring, out, CAPACITY));
+
+    push_range(1, 3);
+    TEST_ASSERT_EQUAL_UINT(3, rbuf_copy_newest_first(&s_ring, out, CAPACITY));
+    TEST_ASSERT_EQUAL_INT32(3, out[0]);
+    TEST_ASSERT_EQUAL_INT32(1, out[2]);
+
+    push_range(4, 13);
+    TEST_ASSERT_EQUAL_UINT(5, rbuf_copy_newest_first(&s_ring, out, 5));
+    for (int i = 0; i < 5; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT32(13 - i, out[i]);
+    }
+}
+
+void test_limit()
+{
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_set_limit(&s_ring, 0));
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_set_limit(&s_ring, CAPACITY + 1));
+
+    // Any limit works, not only powers of two.
+    TEST_ASSERT_EQUAL_INT(RBUF_OK, rbuf_set_limit(&s_ring, 3));
+    push_range(1, 10);
+    TEST_ASSERT_EQUAL_UINT(3, rbuf_count(&s_ring));
+    TEST_ASSERT_EQUAL_INT32(8, *(int32_t*)rbuf_at(&s_ring, 0));
+
+    // Growing keeps what is there; shrinking drops the oldest.
+    rbuf_set_limit(&s_ring, 6);
+    push_range(11, 12);
+    TEST_ASSERT_EQUAL_UINT(5, rbuf_count(&s_ring));
+    TEST_ASSERT_EQUAL_INT32(8, *(int32_t*)rbuf_at(&s_ring, 0));
+
+    rbuf_set_limit(&s_ring, 2);
+    TEST_ASSERT_EQUAL_UINT(2, rbuf_count(&s_ring));
+    TEST_ASSERT_EQUAL_INT32(11, *(int32_t*)rbuf_at(&s_ring, 0));
+    TEST_ASSERT_EQUAL_INT32(12, *(int32_t*)rbuf_at(&s_ring, 1));
+}
+
+void test_spsc_basic()
+{
+    rbuf_spsc q;
+    int32_t in[CAPACITY + 2];
+    int32_t out[CAPACITY + 2];
+
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_spsc_init(&q, s_storage, sizeof(int32_t), 5));
+    TEST_ASSERT_EQUAL_INT(RBUF_OK, rbuf_spsc_init(&q, s_storage, sizeof(int32_t), CAPACITY));
+
+    int32_t v;
+    TEST_ASSERT_FALSE(rbuf_spsc_pop(&q, &v));
+
+    for (int i = 0; i < CAPACITY + 2; ++i)
+    {
+        in[i] = 100 + i;
+    }
+
+    // A full queue refuses instead of overwriting.
+    TEST_ASSERT_EQUAL_UINT(CAPACITY, rbuf_spsc_push_n(&q, in, CAPACITY + 2));
+    TEST_ASSERT_FALSE(rbuf_spsc_push(&q, &in[0]));
+    TEST_ASSERT_EQUAL_UINT(CAPACITY, rbuf_spsc_count(&q));
+
+    TEST_ASSERT_EQUAL_UINT(3, rbuf_spsc_pop_n(&q, out, 3));
+    TEST_ASSERT_EQUAL_INT32(100, out[0]);
+    TEST_ASSERT_EQUAL_INT32(102, out[2]);
+
+    // Wraps the storage.
+    TEST_ASSERT_EQUAL_UINT(2, rbuf_spsc_push_n(&q, in + 8, 2));
+    TEST_ASSERT_EQUAL_UINT(7, rbuf_spsc_pop_n(&q, out, CAPACITY + 2));
+    TEST_ASSERT_EQUAL_INT32(103, out[0]);
+    TEST_ASSERT_EQUAL_INT32(107, out[4]);
+    TEST_ASSERT_EQUAL_INT32(108, out[5]);
+    TEST_ASSERT_EQUAL_INT32(109, out[6]);
+    TEST_ASSERT_EQUAL_UINT(0, rbuf_spsc_count(&q));
+}
+
+void test_mpsc_basic()
+{
+    rbuf_mpsc q;
+    atomic_size_t seqs[CAPACITY];
+
+    TEST_ASSERT_EQUAL_INT(RBUF_FAIL, rbuf_mpsc_init(&q, s_storage, seqs, sizeof(int32_t), 6));
+    TEST_ASSERT_EQUAL_INT(RBUF_OK, rbuf_mpsc_init(&q, s_storage, seqs, sizeof(int32_t), CAPACITY));
+
+    int32_t v;
+    TEST_ASSERT_FALSE(rbuf_mpsc_pop(&q, &v));
+
+    // A full queue refuses instead of overwriting.
+    for (int32_t i = 0; i < CAPACITY; ++i)
+    {
+        int32_t in = 100 + i;
+        TEST_ASSERT_TRUE(rbuf_mpsc_push(&q, &in));
+    }
+    TEST_ASSERT_FALSE(rbuf_mpsc_push(&q, &v));
+
+    TEST_ASSERT_TRUE(rbuf_mpsc_pop(&q, &v));
+    TEST_ASSERT_EQUAL_INT32(100, v);
+    TEST_ASSERT_TRUE(rbuf_mpsc_pop(&q, &v));
+    TEST_ASSERT_EQUAL_INT32(101, v);
+
+    // Wraps the storage.
+    int32_t in = 108;
+    TEST_ASSERT_TRUE(rbuf_mpsc_push(&q, &in));
+    in = 109;
+    TEST_ASSERT_TRUE(rbuf_mpsc_push(&q, &in));
+    TEST_ASSERT_FALSE(rbuf_mpsc_push(&q, &in));
+
+    for (int32_t expected = 102; expected <= 109; ++expected)
+    {
+        TEST_ASSERT_TRUE(rbuf_mpsc_pop(&q, &v));
+        TEST_ASSERT_EQUAL_INT32(expected, v);
+    }
+    TEST_ASSERT_FALSE(rbuf_mpsc_pop(&q, &v));
+}
+
+#ifndef ESP_PLATFORM
+#define SPSC_ITEMS 100000
+
+static rbuf_spsc s_queue;
+static uint32_t s_queue_storage[64];
+
+static void* spsc_producer(void* arg)
+{
+    (void)arg;
+    uint32_t batch[5];
+    uint32_t next = 0;
+
+    while (next < SPSC_ITEMS)
+    {
+        size_t n = 0;
+        while (n < 5 && next + n < SPSC_ITEMS)
+        {
+            batch[n] = next + n;
+            ++n;
+        }
+        next += rbuf_spsc_push_n(&s_queue, batch, n);
+    }
+
+    return NULL;
+}
+
+/**
+ * One thread pushes a counting sequence in small batches while this one pops. Every value arrives once, in order.
+*/
+void test_spsc_threads()
+{
+    rbuf_spsc_init(&s_queue, s_queue_storage, sizeof(uint32_t), 64);
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, spsc_producer, NULL);
+
+    uint32_t expected = 0;
+    uint32_t out[7];
+    bool in_order = true;
+    while (expected < SPSC_ITEMS)
+    {
+        size_t n = rbuf_spsc_pop_n(&s_queue, out, 7);
+        for (size_t i = 0; i < n; ++i)
+        {
+            in_order = in_order && out[i] == expected;
+            ++expected;
+        }
+    }
+
+    pthread_join(producer, NULL);
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_EQUAL_UINT(0, rbuf_spsc_count(&s_queue));
+}
+
+#define MPSC_PRODUCERS 4
+#define MPSC_ITEMS 20000
+
+static rbuf_mpsc s_mpsc;
+static uint32_t s_mpsc_storage[32];
+static atomic_size_t s_mpsc_seqs[32];
+
+// Each producer pushes its id in the top byte and a count below it, retrying while the queue is full.
+static void* mpsc_producer(void* arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < MPSC_ITEMS; ++i)
+    {
+        uint32_t value = id << 24 | i;
+        while (!rbuf_mpsc_push(&s_mpsc, &value))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Several threads push counting sequences while this one pops. Every value arrives once, and each producer's values
+ * arrive in order.
+*/
+void test_mpsc_threads()
+{
+    rbuf_mpsc_init(&s_mpsc, s_mpsc_storage, s_mpsc_seqs, sizeof(uint32_t), 32);
+
+    pthread_t producers[MPSC_PRODUCERS];
+    for (uintptr_t i = 0; i < MPSC_PRODUCERS; ++i)
+    {
+        pthread_create(&producers[i], NULL, mpsc_producer, (void*)i);
+    }
+
+    uint32_t expected[MPSC_PRODUCERS] = { 0 };
+    uint32_t received = 0;
+    bool in_order = true;
+    while (received < MPSC_PRODUCERS * MPSC_ITEMS)
+    {
+        uint32_t value;
+        if (rbuf_mpsc_pop(&s_mpsc, &value))
+        {
+            uint32_t id = value >> 24;
+            in_order = in_order && id < MPSC_PRODUCERS && (value & 0xFFFFFF) == expected[id];
+            if (id < MPSC_PRODUCERS)
+            {
+                ++expected[id];
+            }
+            ++received;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    for (int i = 0; i < MPSC_PRODUCERS; ++i)
+    {
+        pthread_join(producers[i], NULL);
+    }
+
+    uint32_t value;
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_FALSE(rbuf_mpsc_pop(&s_mpsc, &value));
+}
+#endif
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_init);
+    RUN_TEST(test_push_and_wrap);
+    RUN_TEST(test_copy_oldest_first);
+    RUN_TEST(test_copy_newest_first);
+    RUN_TEST(test_limit);
+    RUN_TEST(test_spsc_basic);
+    RUN_TEST(test_mpsc_basic);
+#ifndef ESP_PLATFORM
+    RUN_TEST(test_spsc_threads);
+    RUN_TEST(test_mpsc_threads);
+#endif
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
@@ -0,0 +1,178 @@
+#include <string.h>
+#include <stdio.h>
+#include <unity.h>
+#include <seg_builder.h>
+
+typedef struct mem_sink
+{
+    char data[128];
+    size_t len;
+    int writes;
+    int fail_after;
+} mem_sink;
+
+static int mem_sink_write(void* ctx, const char* data, size_t len);
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_static_is_referenced()
+{
+    static const char text[] = "<p>static</p>";
+    sgb_segment segs[4];
+    sgb_t sgb;
+
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_init(&sgb, segs, 4, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_add_static(&sgb, SGB_LIT(text)));
+
+    // Nothing copied: the segment points at the literal.
+    TEST_ASSERT_EQUAL_UINT(1, sgb.seg_count);
+    TEST_ASSERT_TRUE(segs[0].ptr == text);
+    TEST_ASSERT_EQUAL_UINT(sizeof(text) - 1, sgb_total_len(&sgb));
+
+    // No scratch, so copies do not fit.
+    TEST_ASSERT_EQUAL_INT(SGB_TRUNCATED, sgb_add_str(&sgb, "x"));
+    TEST_ASSERT_EQUAL_INT(SGB_TRUNCATED, sgb_status(&sgb));
+}
+
+void test_copies_share_segment()
+{
+    sgb_segment segs[4];
+    char scratch[16];
+    char out[32];
+    sgb_t sgb;
+
+    sgb_init(&sgb, segs, 4, scratch, sizeof(scratch));
+    sgb_add_static(&sgb, SGB_LIT("t="));
+    sgb_add_str(&sgb, "70");
+    sgb_add_copy(&sgb, ".42", 3);
+
+    char* p = sgb_reserve(&sgb, 4);
+    TEST_ASSERT_NOT_NULL(p);
+    int n = snprintf(p, 4, "%s", "F;");
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_commit(&sgb, (size_t)n));
+
+    // Consecutive scratch writes merge into one segment.
+    TEST_ASSERT_EQUAL_UINT(2, sgb.seg_count);
+    TEST_ASSERT_EQUAL_UINT(9, sgb_copy_to(&sgb, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("t=70.42F;", out);
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_status(&sgb));
+}
+
+void test_truncation()
+{
+    sgb_segment segs[2];
+    char scratch[4];
+    char out[16];
+    sgb_t sgb;
+
+    sgb_init(&sgb, segs, 2, scratch, sizeof(scratch));
+
+    // All or nothing in the scratch.
+    TEST_ASSERT_EQUAL_INT(SGB_TRUNCATED, sgb_add_str(&sgb, "12345"));
+    TEST_ASSERT_EQUAL_UINT(0, sgb_total_len(&sgb));
+    TEST_ASSERT_EQUAL_INT(SGB_TRUNCATED, sgb_status(&sgb));
+    TEST_ASSERT_EQUAL_INT(SGB_FAIL, sgb_commit(&sgb, 5));
+
+    sgb_clear(&sgb);
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_status(&sgb));
+    sgb_add_static(&sgb, SGB_LIT("ab"));
+    sgb_add_static(&sgb, SGB_LIT("cd"));
+    TEST_ASSERT_EQUAL_INT(SGB_TRUNCATED, sgb_add_static(&sgb, SGB_LIT("ef")));
+    TEST_ASSERT_EQUAL_UINT(4, sgb_copy_to(&sgb, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("abcd", out);
+
+    // Flat copy stops at the buffer size.
+    TEST_ASSERT_EQUAL_UINT(2, sgb_copy_to(&sgb, out, 3));
+    TEST_ASSERT_EQUAL_STRING("ab", out);
+}
+
+void test_flush_gathers()
+{
+    static const char big[] = "0123456789abcdef";
+    sgb_segment segs[8];
+    char scratch[8];
+    char stage[8];
+    sgb_t sgb;
+    mem_sink sink = { .fail_after = -1 };
+
+    sgb_init(&sgb, segs, 8, scratch, sizeof(scratch));
+    sgb_add_static(&sgb, SGB_LIT("<a>"));
+    sgb_add_str(&sgb, "1");
+    sgb_add_static(&sgb, SGB_LIT("</a>"));
+    sgb_add_static(&sgb, SGB_LIT(big));
+    sgb_add_static(&sgb, SGB_LIT("<b>"));
+
+    // "<a>1" + "</a>" staged together, the big segment direct, then "<b>".
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_flush(&sgb, stage, sizeof(stage), mem_sink_write, &sink));
+    TEST_ASSERT_EQUAL_INT(3, sink.writes);
+    TEST_ASSERT_EQUAL_UINT(sgb_total_len(&sgb), sink.len);
+    TEST_ASSERT_EQUAL_STRING("<a>1</a>0123456789abcdef<b>", sink.data);
+
+    // Without a stage every segment is its own write.
+    memset(&sink, 0, sizeof(sink));
+    sink.fail_after = -1;
+    TEST_ASSERT_EQUAL_INT(SGB_OK, sgb_flush(&sgb, NULL, 0, mem_sink_write, &sink));
+    TEST_ASSERT_EQUAL_INT(5, sink.writes);
+    TEST_ASSERT_EQUAL_STRING("<a>1</a>0123456789abcdef<b>", sink.data);
+
+    // A failing sink stops the flush.
+    memset(&sink, 0, sizeof(sink));
+    sink.fail_after = 1;
+    TEST_ASSERT_EQUAL_INT(SGB_FAIL, sgb_flush(&sgb, stage, sizeof(stage), mem_sink_write, &sink));
+    TEST_ASSERT_EQUAL_INT(1, sink.writes);
+}
+
+static int mem_sink_write(void* ctx, const char* data, size_t len)
+{
+    mem_sink* sink = (mem_sink*)ctx;
+
+    if (sink->fail_after >= 0 && sink->writes >= sink->fail_after)
+    {
+        return SGB_FAIL;
+    }
+
+    if (len > sizeof(sink->data) - 1 - sink->len)
+    {
+        return SGB_FAIL;
+    }
+
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    sink->data[sink->len] = 0;
+    ++sink->writes;
+
+    return SGB_OK;
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_static_is_referenced);
+    RUN_TEST(test_copies_share_segment);
+    RUN_TEST(test_truncation);
+    RUN_TEST(test_flush_gathers);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
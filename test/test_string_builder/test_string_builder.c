@@ -0,0 +1,159 @@
+#include <string.h>
+#include <stdio.h>
+#include <unity.h>
+#include <string_builder.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_append()
+{
+    char buffer[16];
+    strbld_t sb;
+    size_t len;
+
+    strbld_init(&sb, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append(&sb, "Hello"));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append(&sb, ""));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append(&sb, ", world"));
+    TEST_ASSERT_EQUAL_STRING("Hello, world", strbld_get(&sb, &len));
+    TEST_ASSERT_EQUAL_UINT(12, len);
+
+    // Exactly fills the buffer, then truncates.
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append(&sb, "!!!"));
+    TEST_ASSERT_EQUAL_INT(STRBLD_TRUNCATED, strbld_append(&sb, "?"));
+    TEST_ASSERT_EQUAL_STRING("Hello, world!!!", strbld_get(&sb, &len));
+    TEST_ASSERT_EQUAL_UINT(15, len);
+
+    TEST_ASSERT_EQUAL_INT(STRBLD_FAIL, strbld_append(&sb, NULL));
+}
+
+/**
+ * The word at a time scan must give the same result as a byte loop for every alignment, length and space left.
+*/
+void test_append_alignments()
+{
+    char source[64];
+    char buffer[48];
+    char expected[48];
+    strbld_t sb;
+
+    for (size_t offset = 0; offset < 8; ++offset)
+    {
+        for (size_t value_len = 0; value_len < 40; ++value_len)
+        {
+            char* value = source + offset;
+            for (size_t i = 0; i < value_len; ++i)
+            {
+                value[i] = (char)('a' + (i % 26));
+            }
+            value[value_len] = 0;
+
+            for (size_t size = 1; size < sizeof(buffer); ++size)
+            {
+                strbld_init(&sb, buffer, size);
+                int rc = strbld_append(&sb, value);
+
+                size_t fits = value_len < size - 1 ? value_len : size - 1;
+                memcpy(expected, value, fits);
+                expected[fits] = 0;
+
+                size_t len;
+                TEST_ASSERT_EQUAL_STRING(expected, strbld_get(&sb, &len));
+                TEST_ASSERT_EQUAL_UINT(fits, len);
+                TEST_ASSERT_EQUAL_INT(fits == value_len ? STRBLD_OK : STRBLD_TRUNCATED, rc);
+            }
+        }
+    }
+}
+
+void test_append_n()
+{
+    char buffer[8];
+    strbld_t sb;
+    size_t len;
+
+    strbld_init(&sb, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append_n(&sb, STRBLD_LIT("<p>")));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append_n(&sb, "abcdef", 2));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append_n(&sb, NULL, 0));
+    TEST_ASSERT_EQUAL_STRING("<p>ab", strbld_get(&sb, &len));
+
+    TEST_ASSERT_EQUAL_INT(STRBLD_TRUNCATED, strbld_append_n(&sb, STRBLD_LIT("</p>")));
+    TEST_ASSERT_EQUAL_STRING("<p>ab</", strbld_get(&sb, &len));
+    TEST_ASSERT_EQUAL_UINT(7, len);
+
+    TEST_ASSERT_EQUAL_INT(STRBLD_FAIL, strbld_append_n(&sb, NULL, 1));
+}
+
+void test_reserve_commit()
+{
+    char buffer[12];
+    strbld_t sb;
+    size_t len;
+
+    strbld_init(&sb, buffer, sizeof(buffer));
+    strbld_append(&sb, "t=");
+
+    char* p = strbld_reserve(&sb, 9);
+    TEST_ASSERT_NOT_NULL(p);
+    int n = snprintf(p, 10, "%d", 12345);
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_commit(&sb, (size_t)n));
+    TEST_ASSERT_EQUAL_STRING("t=12345", strbld_get(&sb, &len));
+    TEST_ASSERT_EQUAL_UINT(7, len);
+
+    // Four bytes left; asking for more writes nothing.
+    TEST_ASSERT_NULL(strbld_reserve(&sb, 5));
+    TEST_ASSERT_NOT_NULL(strbld_reserve(&sb, 4));
+    TEST_ASSERT_EQUAL_INT(STRBLD_FAIL, strbld_commit(&sb, 5));
+    TEST_ASSERT_EQUAL_STRING("t=12345", strbld_get(&sb, &len));
+}
+
+void test_append_html()
+{
+    char buffer[16];
+    strbld_t sb;
+    size_t len;
+
+    strbld_init(&sb, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT(STRBLD_OK, strbld_append_html(&sb, "70.42", "li"));
+    TEST_ASSERT_EQUAL_STRING("<li>70.42</li>", strbld_get(&sb, &len));
+    TEST_ASSERT_EQUAL_UINT(14, len);
+
+    // Doesn't fit: as much as fits is written, like separate appends.
+    TEST_ASSERT_EQUAL_INT(STRBLD_TRUNCATED, strbld_append_html(&sb, "x", "b"));
+    TEST_ASSERT_EQUAL_STRING("<li>70.42</li><", strbld_get(&sb, &len));
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_append);
+    RUN_TEST(test_append_alignments);
+    RUN_TEST(test_append_n);
+    RUN_TEST(test_reserve_commit);
+    RUN_TEST(test_append_html);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
@@ -0,0 +1,97 @@
+#include <string.h>
+#include <unity.h>
+#include <telemetry_packet.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_round_trip()
+{
+    tlp_packet packet = { .seq = 123456, .time_s = 86400, .sensor_id = 0xA1B2C3D4, .value = -4012, .error = 0 };
+    uint8_t data[TLP_SIZE];
+    tlp_encode(&packet, data);
+
+    tlp_packet decoded;
+    TEST_ASSERT_EQUAL_INT(TLP_OK, tlp_decode(data, sizeof(data), &decoded));
+    TEST_ASSERT_EQUAL_UINT32(packet.seq, decoded.seq);
+    TEST_ASSERT_EQUAL_UINT32(packet.time_s, decoded.time_s);
+    TEST_ASSERT_EQUAL_UINT32(packet.sensor_id, decoded.sensor_id);
+    TEST_ASSERT_EQUAL_INT32(packet.value, decoded.value);
+    TEST_ASSERT_EQUAL_UINT8(packet.error, decoded.error);
+
+    // A failed read keeps its error and the no value marker.
+    packet.value = INT32_MIN;
+    packet.error = 3;
+    tlp_encode(&packet, data);
+    TEST_ASSERT_EQUAL_INT(TLP_OK, tlp_decode(data, sizeof(data), &decoded));
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, decoded.value);
+    TEST_ASSERT_EQUAL_UINT8(3, decoded.error);
+}
+
+void test_network_byte_order()
+{
+    tlp_packet packet = { .seq = 0x01020304, .time_s = 0x05060708, .sensor_id = 0x090A0B0C, .value = -2, .error = 7 };
+    uint8_t data[TLP_SIZE];
+    tlp_encode(&packet, data);
+
+    const uint8_t expected[TLP_SIZE] = {
+        'W', 'T', TLP_VERSION, 7,
+        0x01, 0x02, 0x03, 0x04,
+        0x05, 0x06, 0x07, 0x08,
+        0x09, 0x0A, 0x0B, 0x0C,
+        0xFF, 0xFF, 0xFF, 0xFE
+    };
+    TEST_ASSERT_EQUAL_MEMORY(expected, data, TLP_SIZE);
+}
+
+void test_rejects_other_datagrams()
+{
+    tlp_packet packet = { .seq = 1, .time_s = 2, .sensor_id = 3, .value = 4, .error = 0 };
+    uint8_t data[TLP_SIZE + 1];
+    tlp_encode(&packet, data);
+
+    tlp_packet decoded = { .seq = 99 };
+    TEST_ASSERT_EQUAL_INT(TLP_FAIL, tlp_decode(data, TLP_SIZE - 1, &decoded));
+    TEST_ASSERT_EQUAL_INT(TLP_FAIL, tlp_decode(data, TLP_SIZE + 1, &decoded));
+
+    data[2] = TLP_VERSION + 1;
+    TEST_ASSERT_EQUAL_INT(TLP_FAIL, tlp_decode(data, TLP_SIZE, &decoded));
+
+    data[2] = TLP_VERSION;
+    data[0] = 'X';
+    TEST_ASSERT_EQUAL_INT(TLP_FAIL, tlp_decode(data, TLP_SIZE, &decoded));
+
+    // Left alone on failure.
+    TEST_ASSERT_EQUAL_UINT32(99, decoded.seq);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_network_byte_order);
+    RUN_TEST(test_rejects_other_datagrams);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
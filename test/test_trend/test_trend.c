@@ -0,0 +1,144 @@
+#include <string.h>
+#include <unity.h>
+#include <trend.h>
+
+void setUp(void)
+{
+
+}
+
+void tearDown(void)
+{
+
+}
+
+void test_fit_line()
+{
+    trd_fit fit;
+    int32_t slope;
+    uint16_t r2;
+
+    trd_fit_clear(&fit, 1000);
+    TEST_ASSERT_FALSE(trd_fit_slope(&fit, &slope, &r2));
+
+    // 0.50 degrees per hour, one sample a minute.
+    for (uint32_t i = 0; i < 60; ++i)
+    {
+        trd_fit_add(&fit, 1000 + i * 60, 7000 + (int32_t)i * 50 / 60);
+    }
+
+    TEST_ASSERT_TRUE(trd_fit_slope(&fit, &slope, &r2));
+    TEST_ASSERT_INT_WITHIN(2, 50, slope);
+    TEST_ASSERT_TRUE(r2 > 950);
+
+    // Same times, all the same value: flat and a perfect fit.
+    trd_fit_clear(&fit, 0);
+    trd_fit_add(&fit, 0, 7000);
+    trd_fit_add(&fit, 60, 7000);
+    TEST_ASSERT_TRUE(trd_fit_slope(&fit, &slope, &r2));
+    TEST_ASSERT_EQUAL_INT(0, slope);
+    TEST_ASSERT_EQUAL_UINT(1000, r2);
+
+    // Two samples at the same time have no slope.
+    trd_fit_clear(&fit, 0);
+    trd_fit_add(&fit, 5, 7000);
+    trd_fit_add(&fit, 5, 7100);
+    TEST_ASSERT_FALSE(trd_fit_slope(&fit, &slope, &r2));
+}
+
+/**
+ * A sliding window kept with add, remove and rebase must match a fit built from scratch.
+*/
+void test_fit_sliding_rebase()
+{
+    trd_fit sliding;
+    trd_fit fresh;
+    uint32_t times[200];
+    int32_t values[200];
+    const int window = 32;
+
+    uint32_t state = 7;
+    for (int i = 0; i < 200; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        times[i] = 500000 + (uint32_t)i * 60;
+        values[i] = 7000 + (int32_t)(state >> 24) + i * 3;
+    }
+
+    trd_fit_clear(&sliding, times[0]);
+    for (int i = 0; i < 200; ++i)
+    {
+        if (i >= window)
+        {
+            trd_fit_remove(&sliding, times[i - window], values[i - window]);
+        }
+        trd_fit_add(&sliding, times[i], values[i]);
+        trd_fit_rebase(&sliding, times[i >= window - 1 ? i - window + 1 : 0]);
+    }
+
+    trd_fit_clear(&fresh, times[200 - window]);
+    for (int i = 200 - window; i < 200; ++i)
+    {
+        trd_fit_add(&fresh, times[i], values[i]);
+    }
+
+    TEST_ASSERT_TRUE(memcmp(&sliding, &fresh, sizeof(trd_fit)) == 0);
+
+    int32_t slope;
+    uint16_t r2;
+    TEST_ASSERT_TRUE(trd_fit_slope(&fresh, &slope, &r2));
+    TEST_ASSERT_INT_WITHIN(60, 180, slope);
+    TEST_ASSERT_TRUE(r2 < 1000);
+}
+
+void test_holt_forecast()
+{
+    trd_holt holt;
+    int32_t forecast;
+
+    trd_holt_init(&holt, 300, 200);
+    TEST_ASSERT_FALSE(trd_holt_forecast(&holt, 3600, &forecast));
+
+    // Rising 1.00 degree per hour, sampled every minute for three hours.
+    for (uint32_t i = 0; i <= 180; ++i)
+    {
+        trd_holt_add(&holt, i * 60, 7000 + (int32_t)(i * 100 / 60));
+    }
+
+    TEST_ASSERT_TRUE(trd_holt_forecast(&holt, 0, &forecast));
+    TEST_ASSERT_INT_WITHIN(10, 7300, forecast);
+    TEST_ASSERT_TRUE(trd_holt_forecast(&holt, 3600, &forecast));
+    TEST_ASSERT_INT_WITHIN(15, 7400, forecast);
+
+    // Then flat: the trend decays toward zero.
+    for (uint32_t i = 181; i <= 600; ++i)
+    {
+        trd_holt_add(&holt, i * 60, 7300);
+    }
+    TEST_ASSERT_TRUE(trd_holt_forecast(&holt, 3600, &forecast));
+    TEST_ASSERT_INT_WITHIN(5, 7300, forecast);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fit_line);
+    RUN_TEST(test_fit_sliding_rebase);
+    RUN_TEST(test_holt_forecast);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
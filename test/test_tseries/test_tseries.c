@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <tseries.h>
+
+#define BLOCK_COUNT 4
+#define MAX_POINTS 2048
+
+static tsr_block s_blocks[BLOCK_COUNT];
+static tsr_series s_series;
+static tsr_point s_points[MAX_POINTS];
+
+void setUp(void)
+{
+    tsr_init(&s_series, s_blocks, BLOCK_COUNT);
+}
+
+void tearDown(void)
+{
+
+}
+
+/**
+ * Fill the series with a slow random walk sampled every 60 seconds, with some jitter and a few big steps.
+*/
+static void fill(size_t count)
+{
+    uint32_t seed = 12345;
+    uint32_t time = 1000;
+    int32_t value = 7000;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        time += 60 + ((seed >> 16) % 7 == 0 ? 1 : 0);
+        value += (int32_t)((seed >> 20) % 13) - 6;
+        if (i % 97 == 0)
+        {
+            value = -value;
+        }
+
+        s_points[i].time = time;
+        s_points[i].value = value;
+        TEST_ASSERT_EQUAL_INT(TSR_OK, tsr_append(&s_series, time, value));
+    }
+}
+
+void test_empty()
+{
+    tsr_iter it;
+    TEST_ASSERT_EQUAL_UINT(0, tsr_count(&s_series));
+    TEST_ASSERT_FALSE(tsr_first(&s_series, &it));
+    TEST_ASSERT_FALSE(tsr_last(&s_series, &it));
+    TEST_ASSERT_FALSE(tsr_seek(&s_series, 0, &it));
+}
+
+void test_forward_and_backward()
+{
+    size_t count = 200;
+    fill(count);
+    size_t kept = tsr_count(&s_series);
+    TEST_ASSERT_TRUE(kept > 0 && kept <= count);
+
+    // Only the newest points are kept once the blocks are full.
+    tsr_iter it;
+    size_t i = count - kept;
+    TEST_ASSERT_TRUE(tsr_first(&s_series, &it));
+    do
+    {
+        TEST_ASSERT_EQUAL_UINT32(s_points[i].time, it.point.time);
+        TEST_ASSERT_EQUAL_INT32(s_points[i].value, it.point.value);
+        ++i;
+    } while (tsr_next(&it));
+    TEST_ASSERT_EQUAL_UINT(count, i);
+
+    TEST_ASSERT_TRUE(tsr_last(&s_series, &it));
+    do
+    {
+        --i;
+        TEST_ASSERT_EQUAL_UINT32(s_points[i].time, it.point.time);
+        TEST_ASSERT_EQUAL_INT32(s_points[i].value, it.point.value);
+    } while (tsr_prev(&it));
+    TEST_ASSERT_EQUAL_UINT(count - kept, i);
+}
+
+void test_change_direction()
+{
+    fill(100);
+
+    tsr_iter it;
+    TEST_ASSERT_TRUE(tsr_first(&s_series, &it));
+    for (int i = 0; i < 30; ++i)
+    {
+        tsr_next(&it);
+    }
+    tsr_point at = it.point;
+
+    tsr_next(&it);
+    tsr_prev(&it);
+    TEST_ASSERT_EQUAL_UINT32(at.time, it.point.time);
+    TEST_ASSERT_EQUAL_INT32(at.value, it.point.value);
+}
+
+void test_seek()
+{
+    size_t count = 300;
+    fill(count);
+    size_t oldest = count - tsr_count(&s_series);
+
+    tsr_iter it;
+    TEST_ASSERT_TRUE(tsr_seek(&s_series, 0, &it));
+    TEST_ASSERT_EQUAL_UINT32(s_points[oldest].time, it.point.time);
+
+    for (size_t i = oldest; i < count; i += 7)
+    {
+        TEST_ASSERT_TRUE(tsr_seek(&s_series, s_points[i].time, &it));
+        TEST_ASSERT_EQUAL_UINT32(s_points[i].time, it.point.time);
+
+        // Between two points finds the later one.
+        if (i + 1 < count)
+        {
+            TEST_ASSERT_TRUE(tsr_seek(&s_series, s_points[i].time + 1, &it));
+            TEST_ASSERT_EQUAL_UINT32(s_points[i + 1].time, it.point.time);
+        }
+    }
+
+    TEST_ASSERT_FALSE(tsr_seek(&s_series, s_points[count - 1].time + 1, &it));
+}
+
+void test_extremes()
+{
+    TEST_ASSERT_EQUAL_INT(TSR_OK, tsr_append(&s_series, 0, INT32_MIN));
+    TEST_ASSERT_EQUAL_INT(TSR_OK, tsr_append(&s_series, UINT32_MAX, INT32_MAX));
+    TEST_ASSERT_EQUAL_INT(TSR_OK, tsr_append(&s_series, UINT32_MAX, INT32_MIN));
+    TEST_ASSERT_EQUAL_INT(TSR_FAIL, tsr_append(&s_series, 5, 0));
+
+    tsr_iter it;
+    TEST_ASSERT_TRUE(tsr_last(&s_series, &it));
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, it.point.value);
+    TEST_ASSERT_TRUE(tsr_prev(&it));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, it.point.time);
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, it.point.value);
+    TEST_ASSERT_TRUE(tsr_prev(&it));
+    TEST_ASSERT_EQUAL_UINT32(0, it.point.time);
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, it.point.value);
+    TEST_ASSERT_FALSE(tsr_prev(&it));
+}
+
+void test_steady_series_is_small()
+{
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        tsr_append(&s_series, i * 60, 7000 + (int32_t)(i % 5));
+    }
+
+    // One byte per point after the first, plus two bytes for the sample period on the second point.
+    TEST_ASSERT_EQUAL_UINT(1, s_series.used_blocks);
+    TEST_ASSERT_EQUAL_UINT16(101, s_blocks[0].used);
+}
+
+static void run_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty);
+    RUN_TEST(test_forward_and_backward);
+    RUN_TEST(test_change_direction);
+    RUN_TEST(test_seek);
+    RUN_TEST(test_extremes);
+    RUN_TEST(test_steady_series_is_small);
+
+    UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+void app_main()
+{
+    run_tests();
+}
+#else
+int main()
+{
+    run_tests();
+    return 0;
+}
+#endif
@@ -0,0 +1,948 @@
+/**
+ * Whole firmware simulation on Linux.
+ *
+ * Runs the real app_main, sensor task, status LED timer, alerts task and web handlers on a simulated FreeRTOS with a
+ * virtual clock (see sim/sim.h), against a register model of the MCP9808 that replays a temperature trace. A simulated
+ * client joins the SoftAP and fetches the pages every few minutes. Days of polling take seconds, so this is the soak
+ * test for memory growth, history rollover and task scheduling.
+ *
+ * Halfway through, the sensor hangs the I2C bus as a glitch mid-read would, and telemetry switches from broadcast to
+ * multicast.
+ *
+ * At the end the run is checked: no errors logged, every response 200, no heap growth after startup, one poll per
+ * poll period, the hung bus freed without losing a reading, the history holding the newest readings in order, with
+ * the newest matching the trace, and the first reading coming before Wi-Fi is up, and every reading reaching the
+ * reading bus subscribers in order, with a slow queue subscriber losing only the oldest. Every other round asks for
+ * gzip, and only those rounds may get it. The reading log must hold every good reading, and its export must match
+ * itself whole and in byte ranges. Every reading sent once the SoftAP is up must arrive as a telemetry datagram, in
+ * order, at the address of the mode. Then a second client floods the info page; it must be rate limited without the
+ * first client being refused. The exit code is 0 if all checks pass, 1 if any fails, 2 if the simulation stopped
+ * (deadlock, ESP_ERROR_CHECK).
+ *
+ * Usage: fwsim [-d days] [-t trace [-L]] [-r seconds] [-s key=value]... [-v]
+ *   -d   Virtual time to simulate, in days. Default 3.
+ *   -t   Temperature trace to replay (format in sim/sim_mcp9808.c). Default: a daily swing around 21 C.
+ *   -L   Loop the trace instead of holding its last temperature.
+ *   -r   Seconds between client rounds. Default 300.
+ *   -s   Saved setting, as if set on the config page before boot, e.g. -s hist_size=256 -s poll_ms=60000.
+ *        Telemetry starts in broadcast mode (tlm_mode=1) unless set.
+ *   -v   Print the firmware's info logs (with the virtual time).
+*/
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <esp_http_server.h>
+#include <lwip/sockets.h>
+
+#include "prj_config.h"
+#include "temp_sensor.h"
+#include "config_store.h"
+#include "alerts.h"
+#include "boot_timeline.h"
+#include "reading_log.h"
+#include "telemetry.h"
+#include "telemetry_packet.h"
+#include "sim/sim.h"
+
+#define CLIENT_PRIORITY 1
+#define REQUEST_TIMEOUT_US (60 * 1000000LL)
+
+// Pages that change less often are fetched every this many rounds, along with an alert long poll.
+#define SLOW_ROUND_EVERY 12
+
+// At the end, a second client asks for the info page this many times back to back. It must be rate limited without
+// the first client being refused.
+#define FLOOD_REQUESTS 40
+#define CLIENT_ADDRESS 0xC0A80402
+#define FLOOD_ADDRESS 0xC0A80403
+
+// The client drains its reading bus queue once a round, so a short queue overflows and must keep the newest.
+#define BUS_QUEUE_LENGTH 4
+
+#define MAX_TASK_STATS 16
+#define URI_SIZE 64
+
+// Every other round accepts gzip; the others refuse it with q=0.
+#define GZIP_ACCEPT "gzip, deflate"
+#define GZIP_REFUSE "gzip;q=0, identity"
+
+// An export costs WEBS_COST_EXPORT rate limit tokens, so the export checks wait this long before each request.
+#define EXPORT_SPACING_US (3 * 1000000LL)
+// Where the export checks resume a download from, and a piece of the raw export across the first sector's end.
+#define EXPORT_RESUME_AT 1000
+#define EXPORT_RAW_RANGE "bytes=20-4200"
+#define EXPORT_RAW_RANGE_FROM 20
+#define EXPORT_RAW_RANGE_TO 4200
+
+typedef struct uri_stats
+{
+    const char* path;
+    uint32_t count;
+    uint32_t failures;
+    size_t max_bytes;
+    uint64_t total_bytes;
+} uri_stats;
+
+static uri_stats s_uris[] = {
+    { "/" },
+    { "/info" },
+    { "/config" },
+    { "/api/history" },
+    { "/api/time" },
+    { "/api/stats" },
+    { "/alerts" },
+};
+
+#define URI_COUNT (sizeof(s_uris) / sizeof(s_uris[0]))
+
+static int64_t s_end_us = 0;
+static int64_t s_round_us = 0;
+static int s_failed_checks = 0;
+
+// Responses to the flooding client, and the status the first client got right after.
+static uint32_t s_flood_ok = 0;
+static uint32_t s_flood_limited = 0;
+static uint32_t s_flood_other = 0;
+static int s_after_flood_status = 0;
+
+static bool s_gzip_wanted = false;
+static uint32_t s_gzip_responses = 0;
+// Compressed when refused, or not a gzip stream.
+static uint32_t s_gzip_bad = 0;
+
+// Readings taken off the bus queue, and whether they came in order with the newest kept.
+static QueueHandle_t s_bus_queue = NULL;
+static uint32_t s_bus_received = 0;
+static uint32_t s_bus_last_seq = 0;
+static bool s_bus_in_order = true;
+static bool s_bus_newest_kept = true;
+static tps_reading s_bus_last = { 0 };
+
+// Telemetry datagrams received, by destination, and whether they came in order to the address of the mode.
+static uint32_t s_tlm_broadcast = 0;
+static uint32_t s_tlm_multicast = 0;
+static uint32_t s_tlm_rejected = 0;
+static uint32_t s_tlm_first_seq = 0;
+static bool s_tlm_consecutive = true;
+static bool s_tlm_addressed = true;
+static tlp_packet s_tlm_last = { 0 };
+
+void app_main();
+
+static void client_task(void* params);
+static void client_round(uint32_t round, uint32_t* since_s);
+static void fetch(int method, const char* uri);
+static void flood();
+static void drain_bus();
+static void on_datagram(const uint8_t* data, size_t len, uint32_t ipv4, uint16_t port);
+static void report(double wall_s, size_t heap_baseline);
+static void check(bool passed, const char* format, ...);
+static void check_history();
+static void check_downsampled();
+static void check_boot();
+static void check_bus();
+static void check_i2c();
+static void check_gzip();
+static void check_export();
+static void check_telemetry();
+static void fetch_export(const char* uri, const char* range, const char* if_range, sim_response* resp);
+static uint32_t parse_raw_export(const sim_response* resp, uint32_t* sectors, rlg_record* newest);
+static bool same_bytes(const sim_response* part, const sim_response* whole, size_t from);
+static double now_s();
+
+int main(int argc, char** argv)
+{
+    double days = 3;
+    double round_s = 300;
+    const char* trace = NULL;
+    bool loop = false;
+    int opt;
+
+    // Before the options, so -s can change it.
+    sim_nvs_preset("tlm_mode", "1");
+
+    while ((opt = getopt(argc, argv, "d:t:Lr:s:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            days = atof(optarg);
+            break;
+        case 't':
+            trace = optarg;
+            break;
+        case 'L':
+            loop = true;
+            break;
+        case 'r':
+            round_s = atof(optarg);
+            break;
+        case 's':
+        {
+            char* eq = strchr(optarg, '=');
+            if (eq == NULL)
+            {
+                fprintf(stderr, "-s expects key=value\n");
+                return 1;
+            }
+            *eq = 0;
+            if (sim_nvs_preset(optarg, eq + 1) != SIM_OK)
+            {
+                fprintf(stderr, "can't preset %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'v':
+            sim_log_set_level(ESP_LOG_INFO);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d days] [-t trace [-L]] [-r seconds] [-s key=value]... [-v]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (days <= 0 || round_s <= 0)
+    {
+        fprintf(stderr, "days and round seconds must be positive\n");
+        return 1;
+    }
+
+    if (trace != NULL && sim_mcp9808_load_trace(trace, loop) != SIM_OK)
+    {
+        return 1;
+    }
+
+    s_end_us = (int64_t)(days * 86400e6);
+    s_round_us = (int64_t)(round_s * 1e6);
+
+    if (sim_mcp9808_add_stuck(s_end_us / 2) != SIM_OK)
+    {
+        return 1;
+    }
+
+    // Never returns; the client task ends the run.
+    sim_run(client_task, "sim_client", CLIENT_PRIORITY);
+    return 0;
+}
+
+/**
+ * Boots the firmware, then acts as a browser on the SoftAP until the end time, then checks and reports.
+*/
+static void client_task(void* params)
+{
+    double wall_start = now_s();
+
+    // Subscribed before boot, so the first reading is on the queue too.
+    s_bus_queue = xQueueCreate(BUS_QUEUE_LENGTH, sizeof(tps_reading));
+    if (s_bus_queue == NULL || tps_subscribe_queue("fwsim", s_bus_queue, TPS_DROP_OLDEST) != TPS_OK)
+    {
+        check(false, "subscribed to the reading bus");
+    }
+    sim_udp_set_listener(on_datagram);
+
+    app_main();
+    sim_wifi_station(true);
+
+    uint32_t since_s = 0;
+    size_t heap_baseline = 0;
+    bool multicast = false;
+
+    for (uint32_t round = 0; sim_now_us() < s_end_us; ++round)
+    {
+        if (!multicast && sim_now_us() >= s_end_us / 2)
+        {
+            cfg_set_u32(CFG_TLM_MODE, TLM_MODE_MULTICAST);
+            multicast = true;
+        }
+
+        client_round(round, &since_s);
+
+        // Startup is done once every page has been served.
+        if (round == 0)
+        {
+            sim_heap_stats heap;
+            sim_get_heap_stats(&heap);
+            heap_baseline = heap.in_use;
+        }
+
+        int64_t next = (int64_t)(round + 1) * s_round_us;
+        sim_sleep_us((next < s_end_us ? next : s_end_us) - sim_now_us());
+    }
+
+    drain_bus();
+    flood();
+    sim_wifi_station(false);
+
+    report(now_s() - wall_start, heap_baseline);
+    fflush(stdout);
+    exit(s_failed_checks == 0 ? 0 : 1);
+}
+
+static void client_round(uint32_t round, uint32_t* since_s)
+{
+    char uri[URI_SIZE];
+
+    s_gzip_wanted = round % 2 == 0;
+    sim_http_set_header("Accept-Encoding", s_gzip_wanted ? GZIP_ACCEPT : GZIP_REFUSE);
+
+    drain_bus();
+    fetch(HTTP_GET, "/");
+    fetch(HTTP_GET, "/api/stats");
+    fetch(HTTP_GET, "/api/time");
+
+    // Only samples since the last round, as a chart would poll.
+    snprintf(uri, sizeof(uri), "/api/history?since=%" PRIu32, *since_s);
+    fetch(HTTP_GET, uri);
+    *since_s = tps_uptime_s() + 1;
+
+    // The whole history at chart resolution.
+    snprintf(uri, sizeof(uri), "/api/history?points=%d", WEBS_API_MAX_SAMPLES);
+    fetch(HTTP_GET, uri);
+
+    if (round % SLOW_ROUND_EVERY == 0)
+    {
+        fetch(HTTP_GET, "/info");
+        fetch(HTTP_GET, "/config");
+
+        // Waits for the next event, or answers empty after the long poll timeout.
+        snprintf(uri, sizeof(uri), "/alerts?after=%" PRIu32, alt_last_seq());
+        fetch(HTTP_GET, uri);
+    }
+}
+
+static void fetch(int method, const char* uri)
+{
+    uri_stats* stats = NULL;
+    size_t path_len = strcspn(uri, "?");
+    for (size_t i = 0; i < URI_COUNT && stats == NULL; ++i)
+    {
+        if (strlen(s_uris[i].path) == path_len && strncmp(s_uris[i].path, uri, path_len) == 0)
+        {
+            stats = &s_uris[i];
+        }
+    }
+
+    sim_response resp;
+    int rc = sim_http_request(method, uri, NULL, REQUEST_TIMEOUT_US, &resp);
+
+    ++stats->count;
+    if (rc != SIM_OK || resp.status != 200 || resp.handler_failed)
+    {
+        ++stats->failures;
+        fprintf(stderr, "%.3f: %s answered %d%s\n", sim_now_us() / 1e6, uri, resp.status,
+            resp.handler_failed ? " and failed" : "");
+    }
+
+    if (strcmp(resp.content_encoding, "gzip") == 0)
+    {
+        // Magic and deflate, then at least the empty block, the CRC and the size.
+        bool magic = resp.body_len >= 20 && (uint8_t)resp.body[0] == 0x1F && (uint8_t)resp.body[1] == 0x8B &&
+            resp.body[2] == 8;
+        ++s_gzip_responses;
+        if (!s_gzip_wanted || !magic)
+        {
+            ++s_gzip_bad;
+        }
+    }
+
+    stats->total_bytes += resp.body_len;
+    if (resp.body_len > stats->max_bytes)
+    {
+        stats->max_bytes = resp.body_len;
+    }
+
+    sim_response_free(&resp);
+}
+
+/**
+ * Ask for the info page back to back from a second client, then once from the first.
+*/
+static void flood()
+{
+    sim_response resp;
+
+    sim_wifi_station(true);
+    sim_http_set_client(FLOOD_ADDRESS);
+
+    for (int i = 0; i < FLOOD_REQUESTS; ++i)
+    {
+        sim_http_request(HTTP_GET, "/info", NULL, REQUEST_TIMEOUT_US, &resp);
+        if (resp.status == 200)
+        {
+            ++s_flood_ok;
+        }
+        else if (resp.status == 429 && resp.retry_after[0] != 0)
+        {
+            ++s_flood_limited;
+        }
+        else
+        {
+            ++s_flood_other;
+        }
+        sim_response_free(&resp);
+    }
+
+    sim_wifi_station(false);
+    sim_http_set_client(CLIENT_ADDRESS);
+
+    sim_http_request(HTTP_GET, "/", NULL, REQUEST_TIMEOUT_US, &resp);
+    s_after_flood_status = resp.status;
+    sim_response_free(&resp);
+}
+
+/**
+ * Take everything off the bus queue. With the oldest dropped on overflow, the last one taken must be the newest
+ * published.
+*/
+static void drain_bus()
+{
+    tps_reading reading;
+    bool any = false;
+
+    while (s_bus_queue != NULL && xQueueReceive(s_bus_queue, &reading, 0) == pdTRUE)
+    {
+        s_bus_in_order = s_bus_in_order && reading.seq > s_bus_last_seq;
+        s_bus_last_seq = reading.seq;
+        s_bus_last = reading;
+        ++s_bus_received;
+        any = true;
+    }
+
+    uint32_t published;
+    tps_get_bus_stats(NULL, 0, &published);
+    s_bus_newest_kept = s_bus_newest_kept && (!any || s_bus_last_seq == published);
+}
+
+/**
+ * A listener on the SoftAP network. Sent from the telemetry task as it reads the mode, so the mode is still the one
+ * the datagram was sent for.
+*/
+static void on_datagram(const uint8_t* data, size_t len, uint32_t ipv4, uint16_t port)
+{
+    tlp_packet packet;
+    if (tlp_decode(data, len, &packet) != TLP_OK || port != cfg_get_u32(CFG_TLM_PORT))
+    {
+        ++s_tlm_rejected;
+        return;
+    }
+
+    bool multicast = cfg_get_u32(CFG_TLM_MODE) == TLM_MODE_MULTICAST;
+    uint32_t expected = multicast ? ntohl(inet_addr(TLM_MULTICAST_GROUP)) : INADDR_BROADCAST;
+    s_tlm_addressed = s_tlm_addressed && ipv4 == expected;
+    if (multicast)
+    {
+        ++s_tlm_multicast;
+    }
+    else
+    {
+        ++s_tlm_broadcast;
+    }
+
+    if (s_tlm_first_seq == 0)
+    {
+        s_tlm_first_seq = packet.seq;
+    }
+    else
+    {
+        s_tlm_consecutive = s_tlm_consecutive && packet.seq == s_tlm_last.seq + 1 &&
+            packet.sensor_id == s_tlm_last.sensor_id;
+    }
+    s_tlm_last = packet;
+}
+
+static void report(double wall_s, size_t heap_baseline)
+{
+    double sim_s = sim_now_us() / 1e6;
+    printf("%.2f days simulated in %.2f s (%.0fx), %" PRIu64 " task switches\n", sim_s / 86400, wall_s,
+        wall_s > 0 ? sim_s / wall_s : 0, sim_switch_count());
+
+    sim_task_stats tasks[MAX_TASK_STATS];
+    size_t task_count = sim_get_task_stats(tasks, MAX_TASK_STATS);
+    printf("\n%-16s %8s %12s\n", "task", "priority", "runs");
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        printf("%-16s %8u %12" PRIu64 "\n", tasks[i].name, tasks[i].priority, tasks[i].runs);
+    }
+
+    sim_mcp9808_stats sensor;
+    sim_mcp9808_get_stats(&sensor);
+    printf("\nsensor: %" PRIu64 " transfers, %" PRIu64 " temperature reads, %" PRIu64 " NACKs, %" PRIu64 " timeouts, "
+        "bus hung %" PRIu32 " times, alert pin asserted %" PRIu32 " times for %.0f s\n", sensor.transfers,
+        sensor.temp_reads, sensor.nacks, sensor.timeouts, sensor.stuck, sensor.alert_asserts, sensor.alert_us / 1e6);
+    printf("led: %" PRIu32 " changes\n", sim_gpio_changes(HW_PIN_BLINKY));
+
+    sim_heap_stats heap;
+    sim_get_heap_stats(&heap);
+    printf("heap: %zu bytes in use after startup, %zu at the end, peak %zu; %" PRIu64 " allocations, %" PRIu64
+        " frees\n", heap_baseline, heap.in_use, heap.peak, heap.allocs, heap.frees);
+    printf("log: %" PRIu32 " errors, %" PRIu32 " warnings, %" PRIu32 " info\n", sim_log_count(ESP_LOG_ERROR),
+        sim_log_count(ESP_LOG_WARN), sim_log_count(ESP_LOG_INFO));
+
+    printf("\n%-14s %8s %8s %10s %12s\n", "uri", "requests", "failed", "max bytes", "total bytes");
+    uint32_t failures = 0;
+    uint32_t requests = 0;
+    for (size_t i = 0; i < URI_COUNT; ++i)
+    {
+        const uri_stats* u = &s_uris[i];
+        printf("%-14s %8" PRIu32 " %8" PRIu32 " %10zu %12" PRIu64 "\n", u->path, u->count, u->failures, u->max_bytes,
+            u->total_bytes);
+        failures += u->failures;
+        requests += u->count;
+    }
+
+    printf("\nchecks:\n");
+    check(sim_log_count(ESP_LOG_ERROR) == 0, "no errors logged");
+    check(failures == 0, "%" PRIu32 " of %" PRIu32 " requests answered 200", requests - failures, requests);
+    check(heap.in_use <= heap_baseline, "heap did not grow after startup (%zu -> %zu bytes)", heap_baseline,
+        heap.in_use);
+
+    // The sensor task polls once at boot and then once per period, retries included. Every poll is published.
+    uint32_t poll_ms = cfg_get_u32(CFG_POLL_RATE_MS);
+    uint64_t expected = (uint64_t)(sim_now_us() / 1000 / poll_ms) + 1;
+    uint32_t published;
+    tps_get_bus_stats(NULL, 0, &published);
+    uint64_t polls = published;
+    check(polls + 1 >= expected && polls <= expected + 1, "%" PRIu64 " polls at %" PRIu32 " ms (expected %" PRIu64 ")",
+        polls, poll_ms, expected);
+
+    check_i2c();
+    check_gzip();
+    check_history();
+    check_boot();
+    check_bus();
+    check_telemetry();
+
+    // Waits between its requests, so must come after the checks of the end state.
+    check_export();
+
+    check(s_flood_limited > 0 && s_flood_other == 0 && s_after_flood_status == 200, "flooding client: %" PRIu32
+        " of %d answered, %" PRIu32 " refused with 429, other client then answered %d", s_flood_ok, FLOOD_REQUESTS,
+        s_flood_limited, s_after_flood_status);
+}
+
+/**
+ * Responses were compressed only when asked for, and the device's counts cover them and show a saving.
+*/
+static void check_gzip()
+{
+    sim_response resp;
+    sim_http_set_header("Accept-Encoding", NULL);
+    sim_http_request(HTTP_GET, "/api/stats", NULL, REQUEST_TIMEOUT_US, &resp);
+
+    // The flood's requests may have been compressed too, so the device can count more. cpu_us is always 0 here, as
+    // compressing takes no virtual time.
+    unsigned responses = 0;
+    uint64_t in = 0;
+    uint64_t out = 0;
+    const char* gzip = resp.body != NULL ? strstr(resp.body, "\"gzip\":") : NULL;
+    if (gzip != NULL)
+    {
+        sscanf(gzip, "\"gzip\":{\"responses\":%u,\"in\":%" SCNu64 ",\"out\":%" SCNu64, &responses, &in, &out);
+    }
+    sim_response_free(&resp);
+
+    check(s_gzip_responses > 0 && s_gzip_bad == 0 && responses >= s_gzip_responses && out < in, "%" PRIu32
+        " responses gzip compressed to %.0f%%, %" PRIu32 " compressed when refused or malformed", s_gzip_responses,
+        in > 0 ? 100.0 * out / in : 0, s_gzip_bad);
+}
+
+/**
+ * The raw export must hold every good reading the log task was handed (so none lost to a full queue either), in
+ * consecutive sectors, with the newest as in the history, and the CSV export a line for each. Ranges must be the same
+ * bytes as that part of the whole export, and a stale If-Range must get the whole export.
+*/
+static void check_export()
+{
+    // The log task runs at the client's priority; let it write what is still queued.
+    sim_sleep_us(EXPORT_SPACING_US);
+    sim_http_set_header("Accept-Encoding", NULL);
+
+    sim_response raw;
+    fetch_export("/api/export?format=raw", NULL, NULL, &raw);
+    uint32_t sectors = 0;
+    rlg_record newest = { 0 };
+    uint32_t records = parse_raw_export(&raw, &sectors, &newest);
+
+    tps_subscriber_stats subscribers[TPS_BUS_SUBSCRIBERS];
+    uint32_t published;
+    size_t count = tps_get_bus_stats(subscribers, TPS_BUS_SUBSCRIBERS, &published);
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        dropped += strcmp(subscribers[i].name, "rlog") == 0 ? subscribers[i].dropped : 0;
+    }
+
+    // The log wraps around, so once it has it holds whole sectors' worth less than everything.
+    tps_i2c_stats i2c;
+    tps_get_i2c_stats(&i2c);
+    uint32_t good = published - i2c.failed_polls - dropped;
+    bool wrapped = raw.etag[0] != 0 && strcmp(raw.etag, "\"1\"") != 0;
+    bool all_kept = wrapped ? records < good && good - records < sectors * RLG_RECORDS_PER_SECTOR : records == good;
+
+    tps_sample hist[1];
+    bool newest_ok = tps_get_hist_values(hist, 1) == 1 && hist[0].time_s == newest.time_s &&
+        hist[0].value == newest.value;
+
+    sim_flash_stats flash;
+    sim_flash_get_stats(&flash);
+    printf("\nreading log: %" PRIu32 " records in %" PRIu32 " sectors, ETag %s; flash: %" PRIu64 " writes, %" PRIu64
+        " bytes, %" PRIu64 " sectors erased\n", records, sectors, raw.etag, flash.writes, flash.bytes_written,
+        flash.erases);
+
+    check(raw.status == 200 && all_kept && newest_ok && flash.overwrites == 0, "reading log holds %" PRIu32 " of %"
+        PRIu32 " good readings%s, newest as in the history, no flash written twice", records, good,
+        wrapped ? " (wrapped)" : "");
+
+    // Fast polling can log more readings while the export spacing passes, so the CSV may hold more than the raw one.
+    sim_response csv;
+    fetch_export("/api/export", NULL, NULL, &csv);
+    size_t header_len = strlen("boot,uptime_s,temp_f\n");
+    bool csv_ok = csv.status == 200 && csv.body_len >= header_len + (size_t)records * 30 &&
+        (csv.body_len - header_len) % 30 == 0 && tps_get_hist_values(hist, 1) == 1;
+    if (csv_ok && csv.body_len > header_len)
+    {
+        unsigned boot;
+        unsigned time_s;
+        double temp_f;
+        csv_ok = sscanf(csv.body + csv.body_len - 30, "%u,%u,%lf", &boot, &time_s, &temp_f) == 3 &&
+            time_s == hist[0].time_s && (int32_t)(temp_f * 100 + (temp_f < 0 ? -0.5 : 0.5)) == hist[0].value;
+    }
+    check(csv_ok, "CSV export of %zu bytes has a line per record, newest last", csv.body_len);
+
+    // The same bytes at the same offsets, under the same ETag.
+    char range[48];
+    sim_response tail;
+    snprintf(range, sizeof(range), "bytes=%zu-%zu", csv.body_len - 30, csv.body_len - 1);
+    fetch_export("/api/export", range, csv.etag, &tail);
+
+    sim_response resumed;
+    snprintf(range, sizeof(range), "bytes=%d-", EXPORT_RESUME_AT);
+    fetch_export("/api/export", range, csv.etag, &resumed);
+
+    sim_response raw_part;
+    fetch_export("/api/export?format=raw", EXPORT_RAW_RANGE, raw.etag, &raw_part);
+
+    sim_response stale;
+    fetch_export("/api/export", range, "\"0\"", &stale);
+
+    sim_response past_end;
+    snprintf(range, sizeof(range), "bytes=%zu-", csv.body_len + 1000000);
+    fetch_export("/api/export", range, NULL, &past_end);
+
+    // A short log ends inside the raw range, which is then answered up to its end.
+    size_t raw_part_end = raw.body_len > EXPORT_RAW_RANGE_TO ? EXPORT_RAW_RANGE_TO + 1 : raw.body_len;
+    bool ranges_ok = tail.status == 206 && tail.body_len == 30 && same_bytes(&tail, &csv, csv.body_len - 30) &&
+        resumed.status == 206 && resumed.body_len + EXPORT_RESUME_AT >= csv.body_len &&
+        same_bytes(&resumed, &csv, EXPORT_RESUME_AT) &&
+        raw_part.status == 206 && raw_part.body_len + EXPORT_RAW_RANGE_FROM >= raw_part_end &&
+        raw_part.body_len <= EXPORT_RAW_RANGE_TO - EXPORT_RAW_RANGE_FROM + 1 &&
+        same_bytes(&raw_part, &raw, EXPORT_RAW_RANGE_FROM) &&
+        stale.status == 200 && stale.body_len >= csv.body_len && past_end.status == 416;
+    check(ranges_ok, "export ranges match the whole export (%s), stale If-Range got it all, past the end got %d",
+        resumed.content_range, past_end.status);
+
+    sim_response_free(&raw);
+    sim_response_free(&csv);
+    sim_response_free(&tail);
+    sim_response_free(&resumed);
+    sim_response_free(&raw_part);
+    sim_response_free(&stale);
+    sim_response_free(&past_end);
+}
+
+static void fetch_export(const char* uri, const char* range, const char* if_range, sim_response* resp)
+{
+    sim_sleep_us(EXPORT_SPACING_US);
+
+    sim_http_set_header("Range", range);
+    sim_http_set_header("If-Range", if_range);
+    sim_http_request(HTTP_GET, uri, NULL, REQUEST_TIMEOUT_US, resp);
+    sim_http_set_header("Range", NULL);
+    sim_http_set_header("If-Range", NULL);
+}
+
+/**
+ * Walk the raw export: sectors must have the magic and consecutive sequence numbers from the ETag's. A sector's
+ * records run to the next header, as no uptime is as large as the magic. Returns the record count, 0 if malformed.
+*/
+static uint32_t parse_raw_export(const sim_response* resp, uint32_t* sectors, rlg_record* newest)
+{
+    uint32_t seq = (uint32_t)strtoul(resp->etag + 1, NULL, 10);
+    uint32_t records = 0;
+    size_t pos = 0;
+
+    while (pos < resp->body_len)
+    {
+        rlg_sector_header header;
+        if (resp->body_len - pos < sizeof(header))
+        {
+            return 0;
+        }
+
+        memcpy(&header, resp->body + pos, sizeof(header));
+        if (header.magic != RLG_SECTOR_MAGIC || header.seq != seq)
+        {
+            return 0;
+        }
+        pos += sizeof(header);
+        ++seq;
+        ++*sectors;
+
+        uint32_t magic = 0;
+        while (resp->body_len - pos >= sizeof(rlg_record) &&
+            (memcpy(&magic, resp->body + pos, sizeof(magic)), magic != RLG_SECTOR_MAGIC))
+        {
+            memcpy(newest, resp->body + pos, sizeof(rlg_record));
+            pos += sizeof(rlg_record);
+            ++records;
+        }
+    }
+
+    return records;
+}
+
+/**
+ * Whether a partial response is the same bytes as the whole one from an offset, as far as both go.
+*/
+static bool same_bytes(const sim_response* part, const sim_response* whole, size_t from)
+{
+    if (part->body == NULL || whole->body == NULL || from > whole->body_len)
+    {
+        return false;
+    }
+
+    size_t len = part->body_len < whole->body_len - from ? part->body_len : whole->body_len - from;
+    return memcmp(part->body, whole->body + from, len) == 0;
+}
+
+/**
+ * Print the boot timeline. Sensor sampling must not wait for Wi-Fi.
+*/
+static void check_boot()
+{
+    printf("\nboot:\n");
+    for (int i = 0; i < BTL_COUNT; ++i)
+    {
+        btl_span span;
+        if (!btl_get((btl_phase)i, &span))
+        {
+            printf("  %-18s not reached\n", btl_name((btl_phase)i));
+        }
+        else if (i < BTL_FIRST_READING && span.ended)
+        {
+            printf("  %-18s at %8.1f ms, took %8.1f ms\n", btl_name((btl_phase)i), span.begin_us / 1e3,
+                (span.end_us - span.begin_us) / 1e3);
+        }
+        else
+        {
+            printf("  %-18s at %8.1f ms\n", btl_name((btl_phase)i), span.begin_us / 1e3);
+        }
+    }
+
+    btl_span reading;
+    btl_span wifi;
+    if (!btl_get(BTL_FIRST_READING, &reading) || !btl_get(BTL_WIFI, &wifi) || !wifi.ended)
+    {
+        check(false, "boot reached the first reading and brought up Wi-Fi");
+        return;
+    }
+
+    check(reading.begin_us < wifi.end_us, "first reading at %.1f ms, before Wi-Fi was up at %.1f ms",
+        reading.begin_us / 1e3, wifi.end_us / 1e3);
+}
+
+/**
+ * Print the sensor read counts. Each time the bus hung, recovery must have freed it within the poll, so no poll failed
+ * for it.
+*/
+static void check_i2c()
+{
+    tps_i2c_stats i2c;
+    tps_get_i2c_stats(&i2c);
+
+    printf("\ni2c: %" PRIu32 " good reads, %" PRIu32 " retries, %" PRIu32 " recoveries, %" PRIu32 " failed polls\n",
+        i2c.attempts[TPS_TEMP_OK], i2c.retries, i2c.recoveries, i2c.failed_polls);
+    printf("  busy %" PRIu32 ", timeout %" PRIu32 ", nack %" PRIu32 ", no driver %" PRIu32 ", stuck %" PRIu32 "\n",
+        i2c.attempts[TPS_TEMP_BUSY], i2c.attempts[TPS_TEMP_TIMEOUT], i2c.attempts[TPS_TEMP_NACK],
+        i2c.attempts[TPS_TEMP_NO_DRIVER], i2c.attempts[TPS_TEMP_BUS_STUCK]);
+
+    sim_mcp9808_stats sensor;
+    sim_mcp9808_get_stats(&sensor);
+
+    // Only NACKs (from the trace) lose a poll.
+    uint32_t lost = i2c.failed_polls - i2c.attempts[TPS_TEMP_NACK] / TPS_READ_ATTEMPTS;
+    check(sensor.released == sensor.stuck && i2c.recoveries >= sensor.stuck && lost == 0, "bus hung %" PRIu32
+        " times, freed %" PRIu32 " times, %" PRIu32 " polls lost to it", sensor.stuck, sensor.released, lost);
+}
+
+/**
+ * Print the reading bus subscribers. Every subscriber must have been handed every reading, and the client must have
+ * received all that were not dropped for it.
+*/
+static void check_bus()
+{
+    tps_subscriber_stats subscribers[TPS_BUS_SUBSCRIBERS];
+    uint32_t published;
+    size_t count = tps_get_bus_stats(subscribers, TPS_BUS_SUBSCRIBERS, &published);
+
+    printf("\nreading bus: %" PRIu32 " published\n", published);
+    bool all_handed = count > 0;
+    const tps_subscriber_stats* client = NULL;
+    for (size_t i = 0; i < count; ++i)
+    {
+        printf("  %-12s %10" PRIu32 " delivered %10" PRIu32 " dropped\n", subscribers[i].name,
+            subscribers[i].delivered, subscribers[i].dropped);
+
+        // A queue that drops the oldest still takes every new reading.
+        all_handed = all_handed && subscribers[i].delivered == published;
+        if (strcmp(subscribers[i].name, "fwsim") == 0)
+        {
+            client = &subscribers[i];
+        }
+    }
+
+    check(all_handed, "every subscriber was handed all %" PRIu32 " readings", published);
+    check(client != NULL && s_bus_in_order && s_bus_newest_kept && s_bus_received == client->delivered -
+        client->dropped, "bus queue gave %" PRIu32 " readings in order, newest kept, none lost beyond %" PRIu32
+        " dropped", s_bus_received, client != NULL ? client->dropped : 0);
+}
+
+/**
+ * Every reading is sent or fails to send, and only those before the SoftAP was up fail. What was sent arrived whole,
+ * consecutively from the first, and the last is the newest reading.
+*/
+static void check_telemetry()
+{
+    tlm_stats stats;
+    tlm_get_stats(&stats);
+    sim_udp_stats udp;
+    sim_udp_get_stats(&udp);
+    uint32_t published;
+    tps_get_bus_stats(NULL, 0, &published);
+    uint32_t received = s_tlm_broadcast + s_tlm_multicast;
+
+    printf("\ntelemetry: sensor %08" PRIx32 ", %" PRIu32 " sent (%" PRIu32 " broadcast, %" PRIu32 " multicast), %"
+        PRIu32 " failed, %" PRIu64 " bytes\n", stats.sensor_id, stats.sent, s_tlm_broadcast, s_tlm_multicast,
+        stats.failed, udp.bytes);
+
+    bool last_ok = received > 0 && s_tlm_last.seq == s_bus_last.seq && s_tlm_last.time_s == s_bus_last.time_s &&
+        s_tlm_last.value == s_bus_last.value && s_tlm_last.error == s_bus_last.error;
+    check(s_tlm_rejected == 0 && s_tlm_consecutive && s_tlm_addressed && received == stats.sent &&
+        stats.sent + stats.failed == published && stats.failed == udp.unreachable &&
+        s_tlm_first_seq == stats.failed + 1 && last_ok, "telemetry sent %" PRIu32 " of %" PRIu32
+        " readings in order to the mode's address, newest last, %" PRIu32 " before Wi-Fi failed", received,
+        published, stats.failed);
+}
+
+/**
+ * The ring must hold the newest readings, newest first, as many as the history size allows, and the newest must be
+ * what the trace says.
+*/
+static void check_history()
+{
+    static tps_sample samples[TPS_HIST_ARENA_SIZE];
+    int count = tps_get_hist_values(samples, TPS_HIST_ARENA_SIZE);
+
+    sim_mcp9808_stats sensor;
+    sim_mcp9808_get_stats(&sensor);
+    uint32_t hist_size = cfg_get_u32(CFG_HIST_SIZE);
+    uint64_t expected = sensor.temp_reads < hist_size ? sensor.temp_reads : hist_size;
+
+    bool in_order = true;
+    for (int i = 1; i < count; ++i)
+    {
+        in_order = in_order && samples[i].time_s < samples[i - 1].time_s;
+    }
+
+    check((uint64_t)count == expected && in_order, "history holds the newest %d readings in order (expected %" PRIu64
+        ", size %" PRIu32 ")", count, expected, hist_size);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    bool fail;
+    int32_t milli_c = sim_mcp9808_trace_milli_c((int64_t)samples[0].time_s * 1000000, &fail);
+    int32_t expected_f = milli_c * 9 / 50 + 3200;
+    int32_t diff = samples[0].value - expected_f;
+
+    // The sensor resolves 1/16 C, about 0.11 F.
+    check(fail || (diff >= -25 && diff <= 25), "newest reading %.2f F matches the trace (%.2f F)",
+        samples[0].value / 100.0, expected_f / 100.0);
+
+    check_downsampled();
+}
+
+/**
+ * The whole history downsampled must fit, be in time order, and keep the lowest and highest readings, which are found
+ * by paging through every sample.
+*/
+static void check_downsampled()
+{
+    static tps_sample samples[TPS_HIST_ARENA_SIZE];
+    int32_t low = INT32_MAX;
+    int32_t high = INT32_MIN;
+    uint32_t total = 0;
+    uint32_t from_s = 0;
+    bool more = true;
+
+    while (more)
+    {
+        int count = tps_get_range(from_s, UINT32_MAX, samples, TPS_HIST_ARENA_SIZE, &more);
+        for (int i = 0; i < count; ++i)
+        {
+            low = samples[i].value < low ? samples[i].value : low;
+            high = samples[i].value > high ? samples[i].value : high;
+        }
+        total += (uint32_t)count;
+        from_s = count > 0 ? samples[count - 1].time_s + 1 : UINT32_MAX;
+        more = more && count > 0;
+    }
+
+    int count = tps_get_downsampled(0, UINT32_MAX, samples, WEBS_API_MAX_SAMPLES);
+
+    int32_t ds_low = INT32_MAX;
+    int32_t ds_high = INT32_MIN;
+    bool in_order = true;
+    for (int i = 0; i < count; ++i)
+    {
+        ds_low = samples[i].value < ds_low ? samples[i].value : ds_low;
+        ds_high = samples[i].value > ds_high ? samples[i].value : ds_high;
+        in_order = in_order && (i == 0 || samples[i].time_s > samples[i - 1].time_s);
+    }
+
+    check(count <= WEBS_API_MAX_SAMPLES && in_order && ds_low == low && ds_high == high, "history of %" PRIu32
+        " samples downsampled to %d in order, low %.2f and high %.2f kept", total, count, ds_low / 100.0,
+        ds_high / 100.0);
+}
+
+static void check(bool passed, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    printf("  %s  ", passed ? "PASS" : "FAIL");
+    vprintf(format, args);
+    putchar('\n');
+
+    va_end(args);
+
+    if (!passed)
+    {
+        ++s_failed_checks;
+    }
+}
+
+static double now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,247 @@
+/**
+ * Host stand-ins for the sensor and chip functions the page builders call. Readings are synthetic but taken under a
+ * mutex, like the real temp_sensor module.
+*/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_chip_info.h>
+
+#include "temp_sensor.h"
+#include "hw_mcp9808.h"
+#include "config_store.h"
+#include "alerts.h"
+#include "boot_timeline.h"
+#include "prj_config.h"
+
+static pthread_mutex_t s_value_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Most recent first, like tps_get_hist_values.
+static const int32_t s_history_values[TPS_HIST_READ_SIZE] = {
+    7042, 7036, 7031, 7031, 7025, 7019, 7013, 7013, 7006, 7000
+};
+
+int tps_get_last(int32_t* last_value, uint8_t* last_error)
+{
+    pthread_mutex_lock(&s_value_mutex);
+    *last_value = s_history_values[0];
+    *last_error = 0;
+    pthread_mutex_unlock(&s_value_mutex);
+
+    return TPS_OK;
+}
+
+// Synthetic samples are one poll period apart, oldest at time 0.
+static uint32_t sample_time(int newest_first_idx)
+{
+    const uint32_t period_s = TPS_POLL_RATE_MS / 1000 > 0 ? TPS_POLL_RATE_MS / 1000 : 1;
+    return (uint32_t)(TPS_HIST_READ_SIZE - 1 - newest_first_idx) * period_s;
+}
+
+int tps_get_hist_values(tps_sample* hist_array, ssize_t size)
+{
+    if (hist_array == NULL || size <= 0)
+    {
+        return 0;
+    }
+
+    ssize_t count = size < TPS_HIST_READ_SIZE ? size : TPS_HIST_READ_SIZE;
+
+    pthread_mutex_lock(&s_value_mutex);
+    for (ssize_t i = 0; i < count; ++i)
+    {
+        hist_array[i].time_s = sample_time((int)i);
+        hist_array[i].value = s_history_values[i];
+    }
+    pthread_mutex_unlock(&s_value_mutex);
+
+    return (int)count;
+}
+
+int tps_get_range(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size, bool* more)
+{
+    size_t count = 0;
+
+    *more = false;
+
+    pthread_mutex_lock(&s_value_mutex);
+    for (int i = TPS_HIST_READ_SIZE - 1; i >= 0; --i)
+    {
+        uint32_t time_s = sample_time(i);
+        if (time_s < from_s || time_s > to_s)
+        {
+            continue;
+        }
+
+        if (count == size)
+        {
+            *more = true;
+            break;
+        }
+
+        samples[count].time_s = time_s;
+        samples[count].value = s_history_values[i];
+        ++count;
+    }
+    pthread_mutex_unlock(&s_value_mutex);
+
+    return (int)count;
+}
+
+// The synthetic history is only a few samples, so it isn't downsampled: the oldest are returned, like tps_get_range.
+int tps_get_downsampled(uint32_t from_s, uint32_t to_s, tps_sample* samples, size_t size)
+{
+    bool more;
+    return size < 2 ? 0 : tps_get_range(from_s, to_s, samples, size, &more);
+}
+
+// Percentiles of the synthetic history, for every window.
+bool tps_get_quantiles(tps_window window, tps_quantiles* quantiles)
+{
+    (void)window;
+
+    quantiles->count = TPS_HIST_READ_SIZE;
+    quantiles->span_s = sample_time(0);
+    quantiles->p5 = s_history_values[TPS_HIST_READ_SIZE - 1];
+    quantiles->p50 = s_history_values[TPS_HIST_READ_SIZE / 2];
+    quantiles->p95 = s_history_values[0];
+
+    return true;
+}
+
+// The synthetic history rises over the nine polls it spans.
+bool tps_get_trend(tps_trend* trend)
+{
+    trend->count = TPS_HIST_READ_SIZE;
+    trend->slope_per_hour = (s_history_values[0] - s_history_values[TPS_HIST_READ_SIZE - 1]) * 3600 /
+        (int32_t)(sample_time(0) > 0 ? sample_time(0) : 1);
+    trend->r2_permille = 980;
+    trend->confidence = TPS_CONFIDENCE_HIGH;
+    trend->forecast = s_history_values[0] + trend->slope_per_hour;
+    trend->forecast_s = 3600;
+
+    return true;
+}
+
+// A sensor that has answered every poll.
+void tps_get_i2c_stats(tps_i2c_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->attempts[TPS_TEMP_OK] = TPS_HIST_READ_SIZE;
+}
+
+uint32_t tps_uptime_s()
+{
+    return (uint32_t)(TPS_HIST_READ_SIZE * (TPS_POLL_RATE_MS / 1000));
+}
+
+bool tps_get_wall_offset(int64_t* offset_s)
+{
+    *offset_s = 0;
+    return false;
+}
+
+int hw_mcp9808_read_device_info(hw_mcp9808_dinfo* info)
+{
+    if (!info)
+    {
+        return HW_MCP9808_FAIL;
+    }
+
+    info->manufacturer_id = 0x0054;
+    info->device_id = 0x04;
+    info->device_revision = 0x00;
+
+    return HW_MCP9808_OK;
+}
+
+// Settings are fixed at their defaults on the host.
+static const char* s_cfg_names[CFG_KEY_COUNT] = {
+    "poll_ms", "hist_size", "i2c_hz", "ap_ssid", "ap_pwd",
+    "alert_high", "alert_high_on", "alert_low", "alert_low_on", "alert_hyst", "alert_min_s", "alert_rate", "tlm_mode",
+    "tlm_port"
+};
+static const uint32_t s_cfg_u32[CFG_KEY_COUNT] = {
+    TPS_POLL_RATE_MS, TPS_HIST_DEFAULT_SIZE, I2C_MASTER_FREQ_HZ, 0, 0,
+    0, 0, 0, 0, ALT_HYST_DEFAULT, 0, 0, TLM_MODE_OFF, TLM_DEFAULT_PORT
+};
+static const char* s_cfg_str[CFG_KEY_COUNT] = { NULL, NULL, NULL, WEBS_AP_SSID, WEBS_AP_PWD };
+
+const char* cfg_name(cfg_key key)
+{
+    return s_cfg_names[key];
+}
+
+cfg_type cfg_get_type(cfg_key key)
+{
+    if (key == CFG_ALERT_HIGH || key == CFG_ALERT_LOW)
+    {
+        return CFG_TYPE_I32;
+    }
+
+    return s_cfg_str[key] != NULL ? CFG_TYPE_STR : CFG_TYPE_U32;
+}
+
+bool cfg_is_secret(cfg_key key)
+{
+    return key == CFG_AP_PWD;
+}
+
+uint32_t cfg_get_u32(cfg_key key)
+{
+    return s_cfg_u32[key];
+}
+
+int32_t cfg_get_i32(cfg_key key)
+{
+    return (int32_t)s_cfg_u32[key];
+}
+
+void cfg_get_str(cfg_key key, char* buffer, size_t size)
+{
+    snprintf(buffer, size, "%s", s_cfg_str[key] != NULL ? s_cfg_str[key] : "");
+}
+
+// No alerts on the host: alert rules are off at the default settings.
+size_t alt_get_events(uint32_t after_seq, alt_event* events, size_t max, uint32_t* last_seq)
+{
+    (void)after_seq;
+    (void)events;
+    (void)max;
+
+    *last_seq = 0;
+    return 0;
+}
+
+const char* alt_rule_name(uint8_t rule)
+{
+    (void)rule;
+    return "unknown";
+}
+
+// A boot where every phase took a millisecond, one after the other.
+bool btl_get(btl_phase phase, btl_span* span)
+{
+    span->begin_us = 100000 + (int64_t)phase * 1000;
+    span->end_us = phase < BTL_FIRST_READING ? span->begin_us + 1000 : span->begin_us;
+    span->ended = true;
+
+    return true;
+}
+
+const char* btl_name(btl_phase phase)
+{
+    static const char* names[BTL_COUNT] = {
+        "Startup", "NVS and settings", "Status LED", "Network stack", "Wi-Fi SoftAP", "I2C bus", "Sensor and alerts",
+        "HTTP server", "First reading", "First response"
+    };
+    return phase >= 0 && phase < BTL_COUNT ? names[phase] : "unknown";
+}
+
+void esp_chip_info(esp_chip_info_t* out_info)
+{
+    memset(out_info, 0, sizeof(*out_info));
+    out_info->model = CHIP_POSIX_LINUX;
+    out_info->cores = 1;
+}
@@ -0,0 +1,656 @@
+/**
+ * Host load generator for the web server's pages.
+ *
+ * Runs the real page builders from src/web_pages.c behind a small single threaded HTTP server that works like the
+ * ESP-IDF httpd task (one request at a time, keep-alive connections), and drives it with concurrent clients. Reports
+ * throughput plus p50/p95/p99 latency and bytes per response for each URI.
+ *
+ * Usage: loadgen [-c clients] [-d seconds] [-p port] [-t host] [uri ...]
+ *   -c   Number of concurrent keep-alive clients. Default 4, the SoftAP station limit.
+ *   -d   Test duration in seconds. Default 5.
+ *   -p   Port to serve on, or to connect to with -t. Default 8080 (80 with -t).
+ *   -t   Load an external server, e.g. the device at 192.168.4.1, instead of starting the local one.
+ *   uri  URIs requested round robin by each client. Default "/" and "/info".
+*/
+// For strcasestr.
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "prj_config.h"
+#include "web_pages.h"
+
+#define MAX_URIS 16
+#define MAX_CLIENTS 64
+#define MAX_CONNECTIONS (MAX_CLIENTS + 1)
+#define REQUEST_BUFFER_SIZE 1024
+#define RESPONSE_HEADER_SIZE 256
+
+typedef size_t (*page_builder_fn)(char* buffer, size_t buffer_size);
+
+typedef struct route
+{
+    const char* uri;
+    page_builder_fn build;
+} route;
+
+// Same pages the firmware registers in webserver.c. Add new endpoints here to load test them.
+static size_t home_page(char* buffer, size_t buffer_size);
+static size_t info_page(char* buffer, size_t buffer_size);
+static size_t config_page(char* buffer, size_t buffer_size);
+static size_t history_json(char* buffer, size_t buffer_size);
+static size_t stats_json(char* buffer, size_t buffer_size);
+
+static const route s_routes[] = {
+    { "/", home_page },
+    { "/info", info_page },
+    { "/config", config_page },
+    { "/api/history", history_json },
+    { "/api/stats", stats_json },
+};
+
+#define ROUTE_COUNT (sizeof(s_routes) / sizeof(s_routes[0]))
+
+typedef struct connection
+{
+    int fd;
+    char request[REQUEST_BUFFER_SIZE];
+    size_t request_len;
+} connection;
+
+typedef struct uri_stats
+{
+    uint32_t* latencies_us;
+    size_t count;
+    size_t capacity;
+    uint64_t bytes;
+    uint32_t errors;
+} uri_stats;
+
+typedef struct client_ctx
+{
+    int id;
+    pthread_t thread;
+    uri_stats stats[MAX_URIS];
+} client_ctx;
+
+static const char* s_target_host = "127.0.0.1";
+static int s_port = 8080;
+static int s_duration_s = 5;
+static int s_client_count = 4;
+static const char* s_uris[MAX_URIS];
+static int s_uri_count = 0;
+
+static volatile bool s_server_stop = false;
+static int s_listen_fd = -1;
+
+static void* server_thread(void* arg);
+static void serve_request(connection* conn, char* page_buffer);
+static void* client_thread(void* arg);
+static int client_request(int fd, const char* uri, size_t* body_len);
+static int connect_to_target();
+static int send_all(int fd, const char* data, size_t len);
+static void record(uri_stats* stats, uint32_t latency_us, size_t bytes);
+static void report(client_ctx* clients, double elapsed_s);
+static int compare_u32(const void* a, const void* b);
+static double now_s();
+
+int main(int argc, char** argv)
+{
+    bool local_server = true;
+    bool port_set = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:d:p:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            s_client_count = atoi(optarg);
+            break;
+        case 'd':
+            s_duration_s = atoi(optarg);
+            break;
+        case 'p':
+            s_port = atoi(optarg);
+            port_set = true;
+            break;
+        case 't':
+            s_target_host = optarg;
+            local_server = false;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-c clients] [-d seconds] [-p port] [-t host] [uri ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!local_server && !port_set)
+    {
+        s_port = 80;
+    }
+
+    for (int i = optind; i < argc && s_uri_count < MAX_URIS; ++i)
+    {
+        s_uris[s_uri_count++] = argv[i];
+    }
+
+    if (s_uri_count == 0)
+    {
+        s_uris[s_uri_count++] = "/";
+        s_uris[s_uri_count++] = "/info";
+    }
+
+    if (s_client_count < 1 || s_client_count > MAX_CLIENTS || s_duration_s < 1)
+    {
+        fprintf(stderr, "clients must be 1-%d and duration at least 1 second\n", MAX_CLIENTS);
+        return 1;
+    }
+
+    pthread_t h_server;
+    if (local_server)
+    {
+        s_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(s_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        struct sockaddr_in addr = { 0 };
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(s_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(s_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s_listen_fd, MAX_CLIENTS) != 0)
+        {
+            perror("bind/listen");
+            return 1;
+        }
+
+        pthread_create(&h_server, NULL, server_thread, NULL);
+    }
+
+    printf("Target %s:%d, %d clients, %d s, %s server\n", s_target_host, s_port, s_client_count, s_duration_s,
+        local_server ? "local" : "external");
+
+    client_ctx* clients = calloc(s_client_count, sizeof(client_ctx));
+    double start = now_s();
+
+    for (int i = 0; i < s_client_count; ++i)
+    {
+        clients[i].id = i;
+        pthread_create(&clients[i].thread, NULL, client_thread, &clients[i]);
+    }
+
+    for (int i = 0; i < s_client_count; ++i)
+    {
+        pthread_join(clients[i].thread, NULL);
+    }
+
+    double elapsed = now_s() - start;
+
+    if (local_server)
+    {
+        s_server_stop = true;
+        pthread_join(h_server, NULL);
+        close(s_listen_fd);
+    }
+
+    report(clients, elapsed);
+
+    for (int i = 0; i < s_client_count; ++i)
+    {
+        for (int u = 0; u < s_uri_count; ++u)
+        {
+            free(clients[i].stats[u].latencies_us);
+        }
+    }
+    free(clients);
+
+    return 0;
+}
+
+/**
+ * Single threaded server. Like httpd, it polls all sockets and handles one complete request at a time.
+*/
+static void* server_thread(void* arg)
+{
+    (void)arg;
+
+    static connection conns[MAX_CONNECTIONS];
+    static char page_buffer[WEBS_PAGE_BUFFER_SIZE];
+    struct pollfd fds[MAX_CONNECTIONS + 1];
+
+    for (int i = 0; i < MAX_CONNECTIONS; ++i)
+    {
+        conns[i].fd = -1;
+    }
+
+    while (!s_server_stop)
+    {
+        fds[0].fd = s_listen_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < MAX_CONNECTIONS; ++i)
+        {
+            fds[i + 1].fd = conns[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+
+        int ready = poll(fds, MAX_CONNECTIONS + 1, 100);
+        if (ready <= 0)
+        {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(s_listen_fd, NULL, NULL);
+            int i = 0;
+            while (i < MAX_CONNECTIONS && conns[i].fd != -1)
+            {
+                ++i;
+            }
+
+            if (fd >= 0 && i < MAX_CONNECTIONS)
+            {
+                int nodelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+                conns[i].fd = fd;
+                conns[i].request_len = 0;
+            }
+            else if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        for (int i = 0; i < MAX_CONNECTIONS; ++i)
+        {
+            connection* conn = &conns[i];
+            if (conn->fd == -1 || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+
+            ssize_t n = recv(conn->fd, conn->request + conn->request_len,
+                sizeof(conn->request) - 1 - conn->request_len, 0);
+            if (n <= 0)
+            {
+                close(conn->fd);
+                conn->fd = -1;
+                continue;
+            }
+
+            conn->request_len += n;
+            conn->request[conn->request_len] = 0;
+
+            // Requests are GETs without a body, so the headers end the request.
+            if (strstr(conn->request, "\r\n\r\n") != NULL)
+            {
+                serve_request(conn, page_buffer);
+                conn->request_len = 0;
+            }
+            else if (conn->request_len == sizeof(conn->request) - 1)
+            {
+                close(conn->fd);
+                conn->fd = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_CONNECTIONS; ++i)
+    {
+        if (conns[i].fd != -1)
+        {
+            close(conns[i].fd);
+        }
+    }
+
+    return NULL;
+}
+
+static void serve_request(connection* conn, char* page_buffer)
+{
+    char uri[256];
+    char header[RESPONSE_HEADER_SIZE];
+
+    if (sscanf(conn->request, "GET %255s ", uri) != 1)
+    {
+        const char* bad = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        send_all(conn->fd, bad, strlen(bad));
+        return;
+    }
+
+    // Routes match on the path only.
+    char* query = strchr(uri, '?');
+    if (query != NULL)
+    {
+        *query = 0;
+    }
+
+    const route* rt = NULL;
+    for (size_t i = 0; i < ROUTE_COUNT; ++i)
+    {
+        if (strcmp(s_routes[i].uri, uri) == 0)
+        {
+            rt = &s_routes[i];
+            break;
+        }
+    }
+
+    if (rt == NULL)
+    {
+        const char* not_found = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        send_all(conn->fd, not_found, strlen(not_found));
+        return;
+    }
+
+    size_t body_len = rt->build(page_buffer, WEBS_PAGE_BUFFER_SIZE);
+    int header_len = snprintf(header, sizeof(header),
+        "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %zu\r\n\r\n", body_len);
+
+    if (send_all(conn->fd, header, header_len) == 0)
+    {
+        send_all(conn->fd, page_buffer, body_len);
+    }
+}
+
+/**
+ * One keep-alive client. Requests the URIs round robin until the test duration is up.
+*/
+static void* client_thread(void* arg)
+{
+    client_ctx* ctx = (client_ctx*)arg;
+    double end = now_s() + s_duration_s;
+    int fd = -1;
+    int uri_idx = ctx->id % s_uri_count;
+
+    while (now_s() < end)
+    {
+        if (fd == -1)
+        {
+            fd = connect_to_target();
+            if (fd == -1)
+            {
+                ++ctx->stats[uri_idx].errors;
+                usleep(100000);
+                continue;
+            }
+        }
+
+        size_t body_len = 0;
+        double start = now_s();
+        int rc = client_request(fd, s_uris[uri_idx], &body_len);
+        double elapsed = now_s() - start;
+
+        if (rc == 0)
+        {
+            record(&ctx->stats[uri_idx], (uint32_t)(elapsed * 1e6), body_len);
+        }
+        else
+        {
+            ++ctx->stats[uri_idx].errors;
+            close(fd);
+            fd = -1;
+        }
+
+        uri_idx = (uri_idx + 1) % s_uri_count;
+    }
+
+    if (fd != -1)
+    {
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * Send one GET and read the whole response. Returns 0 on a 200 response.
+*/
+static int client_request(int fd, const char* uri, size_t* body_len)
+{
+    char buffer[4096];
+    int request_len = snprintf(buffer, sizeof(buffer), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", uri, s_target_host);
+
+    if (send_all(fd, buffer, request_len) != 0)
+    {
+        return -1;
+    }
+
+    // Read until the end of the headers.
+    size_t len = 0;
+    char* header_end = NULL;
+    while (header_end == NULL)
+    {
+        ssize_t n = recv(fd, buffer + len, sizeof(buffer) - 1 - len, 0);
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        len += n;
+        buffer[len] = 0;
+        header_end = strstr(buffer, "\r\n\r\n");
+
+        if (header_end == NULL && len == sizeof(buffer) - 1)
+        {
+            return -1;
+        }
+    }
+
+    int status = 0;
+    sscanf(buffer, "HTTP/1.%*d %d", &status);
+
+    // Both servers send a Content-Length for these pages.
+    const char* cl = strcasestr(buffer, "Content-Length:");
+    if (cl == NULL || cl > header_end)
+    {
+        return -1;
+    }
+
+    size_t content_len = strtoul(cl + strlen("Content-Length:"), NULL, 10);
+    size_t received = len - (size_t)(header_end + 4 - buffer);
+
+    while (received < content_len)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        received += n;
+    }
+
+    *body_len = content_len;
+    return status == 200 ? 0 : -1;
+}
+
+static int connect_to_target()
+{
+    struct addrinfo hints = { 0 };
+    struct addrinfo* res = NULL;
+    char port[16];
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%d", s_port);
+
+    if (getaddrinfo(s_target_host, port, &hints, &res) != 0)
+    {
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd >= 0)
+    {
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    }
+
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int send_all(int fd, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static void record(uri_stats* stats, uint32_t latency_us, size_t bytes)
+{
+    if (stats->count == stats->capacity)
+    {
+        stats->capacity = stats->capacity ? stats->capacity * 2 : 1024;
+        stats->latencies_us = realloc(stats->latencies_us, stats->capacity * sizeof(uint32_t));
+    }
+
+    stats->latencies_us[stats->count++] = latency_us;
+    stats->bytes += bytes;
+}
+
+/**
+ * Merge the client stats per URI and print the table.
+*/
+static void report(client_ctx* clients, double elapsed_s)
+{
+    size_t total = 0;
+
+    printf("\n%-16s %9s %9s %8s %8s %8s %8s %10s\n", "uri", "requests", "req/s", "p50 us", "p95 us", "p99 us",
+        "errors", "bytes/resp");
+
+    for (int u = 0; u < s_uri_count; ++u)
+    {
+        size_t count = 0;
+        uint64_t bytes = 0;
+        uint32_t errors = 0;
+
+        for (int c = 0; c < s_client_count; ++c)
+        {
+            count += clients[c].stats[u].count;
+            bytes += clients[c].stats[u].bytes;
+            errors += clients[c].stats[u].errors;
+        }
+
+        if (count == 0)
+        {
+            printf("%-16s %9zu %9s %8s %8s %8s %8u %10s\n", s_uris[u], count, "-", "-", "-", "-", errors, "-");
+            continue;
+        }
+
+        uint32_t* merged = malloc(count * sizeof(uint32_t));
+        size_t m = 0;
+        for (int c = 0; c < s_client_count; ++c)
+        {
+            memcpy(merged + m, clients[c].stats[u].latencies_us, clients[c].stats[u].count * sizeof(uint32_t));
+            m += clients[c].stats[u].count;
+        }
+
+        qsort(merged, count, sizeof(uint32_t), compare_u32);
+
+        printf("%-16s %9zu %9.0f %8u %8u %8u %8u %10llu\n",
+            s_uris[u],
+            count,
+            count / elapsed_s,
+            merged[count * 50 / 100],
+            merged[count * 95 / 100],
+            merged[count * 99 / 100],
+            errors,
+            (unsigned long long)(bytes / count));
+
+        total += count;
+        free(merged);
+    }
+
+    printf("\nTotal: %zu requests in %.2f s, %.0f req/s\n", total, elapsed_s, total / elapsed_s);
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t va = *(const uint32_t*)a;
+    uint32_t vb = *(const uint32_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+/**
+ * Pages built as segments are flattened into the buffer, so this measures the segment build plus one copy.
+*/
+static size_t home_page(char* buffer, size_t buffer_size)
+{
+    sgb_segment segs[WEBS_PAGE_SEGMENTS];
+    char scratch[WEBS_PAGE_SCRATCH_SIZE];
+    sgb_t sgb;
+    sgb_init(&sgb, segs, WEBS_PAGE_SEGMENTS, scratch, sizeof(scratch));
+
+    wpg_home_page(&sgb);
+    if (sgb_status(&sgb) != SGB_OK)
+    {
+        fprintf(stderr, "home page truncated, raise WEBS_PAGE_SEGMENTS or WEBS_PAGE_SCRATCH_SIZE\n");
+    }
+    return sgb_copy_to(&sgb, buffer, buffer_size);
+}
+
+static size_t info_page(char* buffer, size_t buffer_size)
+{
+    sgb_segment segs[WEBS_PAGE_SEGMENTS];
+    char scratch[WEBS_PAGE_SCRATCH_SIZE];
+    sgb_t sgb;
+    sgb_init(&sgb, segs, WEBS_PAGE_SEGMENTS, scratch, sizeof(scratch));
+
+    wpg_info_page(&sgb);
+    return sgb_copy_to(&sgb, buffer, buffer_size);
+}
+
+static size_t config_page(char* buffer, size_t buffer_size)
+{
+    return wpg_config_page(buffer, buffer_size, NULL);
+}
+
+static size_t history_json(char* buffer, size_t buffer_size)
+{
+    return wpg_history_json(buffer, buffer_size, 0, UINT32_MAX, 0);
+}
+
+static size_t stats_json(char* buffer, size_t buffer_size)
+{
+    // Counts as large as they get, for the longest output.
+    static const wpg_admission_stats admission = { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX };
+    static const wpg_gzip_stats gzip = { UINT32_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX };
+    return wpg_stats_json(buffer, buffer_size, &admission, &gzip);
+}
+
+static double now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,356 @@
+/**
+ * Host benchmark of the string builder copy paths on page fragments like the ones web_pages.c builds.
+ *
+ * Builds the same pages three ways. The home page is many short fragments; the static page is a few long ones (like
+ * a style sheet or a script).
+ *
+ *   byte loop     the previous strbld_append/strbld_append_html (one byte and one bounds check per iteration)
+ *   append        strbld_append, which now scans a word at a time and copies with memcpy
+ *   append_n      strbld_append_n with STRBLD_LIT lengths, and the single bounds check strbld_append_html
+ *
+ * Usage: sbbench [-r rounds]
+ *   -r   Pages built per path and page. Default 200000.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "string_builder.h"
+
+#define PAGE_BUFFER_SIZE 2048
+#define HIST_COUNT 10
+
+static const char* s_temps[HIST_COUNT] = {
+    "70.42", "70.36", "70.31", "70.31", "70.25", "70.19", "70.13", "70.13", "70.06", "70.00"
+};
+
+// About 240 bytes, appended STATIC_REPEAT times.
+static const char s_static_block[] =
+    "body{font-family:sans-serif;margin:2em;color:#222;background:#fafafa}"
+    "h2{font-size:1.6em;margin:0 0 .5em 0}ul{list-style:none;padding:0}"
+    "li{display:inline-block;margin-right:1em;padding:.2em .4em;border:1px solid #ccc}"
+    "a{color:#06c}a:hover{text-decoration:underline}";
+#define STATIC_REPEAT 6
+
+typedef size_t (*page_fn)(char* buffer, size_t size);
+
+typedef struct bench_path
+{
+    const char* name;
+    page_fn build;
+} bench_path;
+
+static double now_s();
+static int run_paths(const char* page, const bench_path* paths, size_t count, long rounds);
+static size_t page_byte_loop(char* buffer, size_t size);
+static size_t page_append(char* buffer, size_t size);
+static size_t page_append_n(char* buffer, size_t size);
+static size_t static_byte_loop(char* buffer, size_t size);
+static size_t static_append(char* buffer, size_t size);
+static size_t static_append_n(char* buffer, size_t size);
+static int byte_loop_append(strbld_t* sb, const char* value);
+static int byte_loop_append_char(strbld_t* sb, char value);
+static int byte_loop_append_html(strbld_t* sb, const char* value, const char* html_tag);
+
+int main(int argc, char** argv)
+{
+    long rounds = 200000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            rounds = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-r rounds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "rounds must be positive\n");
+        return 1;
+    }
+
+    static const bench_path home_paths[] = {
+        { "byte loop", page_byte_loop },
+        { "append", page_append },
+        { "append_n", page_append_n },
+    };
+
+    static const bench_path static_paths[] = {
+        { "byte loop", static_byte_loop },
+        { "append", static_append },
+        { "append_n", static_append_n },
+    };
+
+    printf("%ld pages per path\n", rounds);
+
+    if (run_paths("home", home_paths, 3, rounds) != 0 || run_paths("static", static_paths, 3, rounds) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Time each path building the page. The first path is the baseline for the speedup column.
+*/
+static int run_paths(const char* page, const bench_path* paths, size_t count, long rounds)
+{
+    char reference[PAGE_BUFFER_SIZE];
+    char buffer[PAGE_BUFFER_SIZE];
+    size_t reference_len = paths[0].build(reference, sizeof(reference));
+
+    printf("\n%s page, %zu bytes\n", page, reference_len);
+    printf("%-12s %12s %12s %10s\n", "path", "ns/page", "MB/s", "speedup");
+
+    double base_ns = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // All paths must build the same page.
+        size_t len = paths[i].build(buffer, sizeof(buffer));
+        if (len != reference_len || memcmp(buffer, reference, len) != 0)
+        {
+            fprintf(stderr, "%s built a different %s page\n", paths[i].name, page);
+            return 1;
+        }
+
+        double start = now_s();
+        size_t total = 0;
+        for (long r = 0; r < rounds; ++r)
+        {
+            total += paths[i].build(buffer, sizeof(buffer));
+        }
+        double elapsed = now_s() - start;
+
+        double ns = elapsed * 1e9 / rounds;
+        if (i == 0)
+        {
+            base_ns = ns;
+        }
+        printf("%-12s %12.0f %12.1f %9.2fx\n", paths[i].name, ns, total / elapsed / 1e6, base_ns / ns);
+    }
+
+    return 0;
+}
+
+static size_t page_byte_loop(char* buffer, size_t size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, size);
+
+    byte_loop_append(&sb, "<html><head>");
+    byte_loop_append_html(&sb, "Scottz0r RTOS Web Temp", "title");
+    byte_loop_append(&sb, "</head><body>");
+    byte_loop_append(&sb, "<h2>Temperature: ");
+    byte_loop_append(&sb, s_temps[0]);
+    byte_loop_append(&sb, "</h2>");
+    byte_loop_append(&sb, "<p>Average Temperature: ");
+    byte_loop_append(&sb, s_temps[5]);
+    byte_loop_append(&sb, "</p>");
+    byte_loop_append(&sb, "<h3>Most recent values</h3><ul>");
+    for (int i = 0; i < HIST_COUNT; ++i)
+    {
+        byte_loop_append_html(&sb, s_temps[i], "li");
+    }
+    byte_loop_append(&sb, "</ul>");
+    byte_loop_append(&sb, "<p>[<a href=\"/info\">device info</a>] [<a href=\"/config\">settings</a>]</p>");
+    byte_loop_append(&sb, "</body></html>");
+
+    size_t len;
+    strbld_get(&sb, &len);
+    return len;
+}
+
+static size_t page_append(char* buffer, size_t size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, size);
+
+    strbld_append(&sb, "<html><head>");
+    strbld_append_html(&sb, "Scottz0r RTOS Web Temp", "title");
+    strbld_append(&sb, "</head><body>");
+    strbld_append(&sb, "<h2>Temperature: ");
+    strbld_append(&sb, s_temps[0]);
+    strbld_append(&sb, "</h2>");
+    strbld_append(&sb, "<p>Average Temperature: ");
+    strbld_append(&sb, s_temps[5]);
+    strbld_append(&sb, "</p>");
+    strbld_append(&sb, "<h3>Most recent values</h3><ul>");
+    for (int i = 0; i < HIST_COUNT; ++i)
+    {
+        strbld_append_html(&sb, s_temps[i], "li");
+    }
+    strbld_append(&sb, "</ul>");
+    strbld_append(&sb, "<p>[<a href=\"/info\">device info</a>] [<a href=\"/config\">settings</a>]</p>");
+    strbld_append(&sb, "</body></html>");
+
+    size_t len;
+    strbld_get(&sb, &len);
+    return len;
+}
+
+static size_t page_append_n(char* buffer, size_t size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, size);
+
+    strbld_append_n(&sb, STRBLD_LIT("<html><head>"));
+    strbld_append_html(&sb, "Scottz0r RTOS Web Temp", "title");
+    strbld_append_n(&sb, STRBLD_LIT("</head><body>"));
+    strbld_append_n(&sb, STRBLD_LIT("<h2>Temperature: "));
+    strbld_append(&sb, s_temps[0]);
+    strbld_append_n(&sb, STRBLD_LIT("</h2>"));
+    strbld_append_n(&sb, STRBLD_LIT("<p>Average Temperature: "));
+    strbld_append(&sb, s_temps[5]);
+    strbld_append_n(&sb, STRBLD_LIT("</p>"));
+    strbld_append_n(&sb, STRBLD_LIT("<h3>Most recent values</h3><ul>"));
+    for (int i = 0; i < HIST_COUNT; ++i)
+    {
+        strbld_append_html(&sb, s_temps[i], "li");
+    }
+    strbld_append_n(&sb, STRBLD_LIT("</ul>"));
+    strbld_append_n(&sb, STRBLD_LIT("<p>[<a href=\"/info\">device info</a>] [<a href=\"/config\">settings</a>]</p>"));
+    strbld_append_n(&sb, STRBLD_LIT("</body></html>"));
+
+    size_t len;
+    strbld_get(&sb, &len);
+    return len;
+}
+
+static size_t static_byte_loop(char* buffer, size_t size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, size);
+
+    for (int i = 0; i < STATIC_REPEAT; ++i)
+    {
+        byte_loop_append(&sb, s_static_block);
+    }
+
+    size_t len;
+    strbld_get(&sb, &len);
+    return len;
+}
+
+static size_t static_append(char* buffer, size_t size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, size);
+
+    for (int i = 0; i < STATIC_REPEAT; ++i)
+    {
+        strbld_append(&sb, s_static_block);
+    }
+
+    size_t len;
+    strbld_get(&sb, &len);
+    return len;
+}
+
+static size_t static_append_n(char* buffer, size_t size)
+{
+    strbld_t sb;
+    strbld_init(&sb, buffer, size);
+
+    for (int i = 0; i < STATIC_REPEAT; ++i)
+    {
+        strbld_append_n(&sb, STRBLD_LIT(s_static_block));
+    }
+
+    size_t len;
+    strbld_get(&sb, &len);
+    return len;
+}
+
+/**
+ * The previous strbld_append, kept here as the baseline.
+*/
+static int byte_loop_append(strbld_t* sb, const char* value)
+{
+    int retcode = STRBLD_OK;
+    const char* pv = value;
+    char* pbuff = sb->buffer + sb->size;
+    char* buff_end = sb->buffer + sb->capacity - 1;
+
+    while (*pv != 0 && pbuff < buff_end)
+    {
+        *(pbuff++) = *(pv++);
+    }
+
+    if (*pv != 0)
+    {
+        retcode = STRBLD_TRUNCATED;
+    }
+
+    sb->size = pbuff - sb->buffer;
+    sb->buffer[sb->size] = 0;
+
+    return retcode;
+}
+
+static int byte_loop_append_char(strbld_t* sb, char value)
+{
+    if (sb->size < sb->capacity - 1)
+    {
+        sb->buffer[sb->size] = value;
+        ++(sb->size);
+        sb->buffer[sb->size] = 0;
+        return STRBLD_OK;
+    }
+
+    return STRBLD_TRUNCATED;
+}
+
+/**
+ * The previous strbld_append_html: eight appends, each checking bounds and terminating.
+*/
+static int byte_loop_append_html(strbld_t* sb, const char* value, const char* html_tag)
+{
+    int rc = byte_loop_append_char(sb, '<');
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append(sb, html_tag);
+    }
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append_char(sb, '>');
+    }
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append(sb, value);
+    }
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append_char(sb, '<');
+    }
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append_char(sb, '/');
+    }
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append(sb, html_tag);
+    }
+    if (rc == STRBLD_OK)
+    {
+        rc = byte_loop_append_char(sb, '>');
+    }
+
+    return rc;
+}
+
+static double now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,49 @@
+/**
+ * Host stand-in for the ESP-IDF legacy I2C master driver, for the firmware simulation. Transfers go to the register
+ * model in sim/sim_mcp9808.c and take virtual time at the configured clock rate.
+*/
+#ifndef _WA_HOST_DRIVER_I2C_H_INCLUDE_GUARD
+#define _WA_HOST_DRIVER_I2C_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int i2c_port_t;
+
+typedef enum
+{
+    I2C_MODE_SLAVE,
+    I2C_MODE_MASTER
+} i2c_mode_t;
+
+typedef struct i2c_config_t
+{
+    i2c_mode_t mode;
+    int sda_io_num;
+    int scl_io_num;
+    gpio_pullup_t sda_pullup_en;
+    gpio_pullup_t scl_pullup_en;
+    struct
+    {
+        uint32_t clk_speed;
+    } master;
+    uint32_t clk_flags;
+} i2c_config_t;
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t* config);
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_buf_len, size_t tx_buf_len, int intr_flags);
+
+esp_err_t i2c_driver_delete(i2c_port_t port);
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t address, const uint8_t* write_buffer,
+    size_t write_size, uint8_t* read_buffer, size_t read_size, TickType_t ticks);
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t address, const uint8_t* write_buffer,
+    size_t write_size, TickType_t ticks);
+
+#endif // _WA_HOST_DRIVER_I2C_H_INCLUDE_GUARD
@@ -0,0 +1,10 @@
+/**
+ * Host stand-in for the ESP-IDF placement attributes, for the firmware simulation. Everything is ordinary memory.
+*/
+#ifndef _WA_HOST_ESP_ATTR_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_ATTR_H_INCLUDE_GUARD
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif // _WA_HOST_ESP_ATTR_H_INCLUDE_GUARD
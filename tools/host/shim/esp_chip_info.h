@@ -0,0 +1,31 @@
+/**
+ * Host stand-in for the ESP-IDF chip info header. Only what the page builders use.
+*/
+#ifndef _WA_HOST_ESP_CHIP_INFO_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_CHIP_INFO_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+typedef enum
+{
+    CHIP_ESP32 = 1,
+    CHIP_ESP32S2 = 2,
+    CHIP_ESP32S3 = 9,
+    CHIP_ESP32C3 = 5,
+    CHIP_ESP32C2 = 12,
+    CHIP_ESP32C6 = 13,
+    CHIP_ESP32H2 = 16,
+    CHIP_POSIX_LINUX = 999,
+} esp_chip_model_t;
+
+typedef struct
+{
+    esp_chip_model_t model;
+    uint32_t features;
+    uint16_t revision;
+    uint8_t cores;
+} esp_chip_info_t;
+
+void esp_chip_info(esp_chip_info_t* out_info);
+
+#endif // _WA_HOST_ESP_CHIP_INFO_H_INCLUDE_GUARD
@@ -0,0 +1,45 @@
+/**
+ * Host stand-in for the ESP-IDF error codes, for the firmware simulation.
+*/
+#ifndef _WA_HOST_ESP_ERR_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_ERR_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_TIMEOUT 0x107
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_TYPE_MISMATCH 0x1103
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+#define ESP_ERR_HTTPD_HANDLERS_FULL 0xb001
+#define ESP_ERR_HTTPD_RESULT_TRUNC 0xb004
+#define ESP_ERR_HTTPD_INVALID_REQ 0xb003
+
+const char* esp_err_to_name(esp_err_t code);
+
+void sim_error_check_failed(esp_err_t rc, const char* file, int line, const char* expression);
+
+// Aborts the simulation like the firmware would.
+#define ESP_ERROR_CHECK(x) do                                           \
+    {                                                                   \
+        esp_err_t _err_rc = (x);                                        \
+        if (_err_rc != ESP_OK)                                          \
+        {                                                               \
+            sim_error_check_failed(_err_rc, __FILE__, __LINE__, #x);    \
+        }                                                               \
+    } while (0)
+
+#endif // _WA_HOST_ESP_ERR_H_INCLUDE_GUARD
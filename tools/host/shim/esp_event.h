@@ -0,0 +1,23 @@
+/**
+ * Host stand-in for the ESP-IDF event loop, for the firmware simulation. Handlers are kept so the simulation can post
+ * Wi-Fi events (sim_wifi_station in sim/sim.h).
+*/
+#ifndef _WA_HOST_ESP_EVENT_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_EVENT_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef const char* esp_event_base_t;
+typedef void* esp_event_handler_instance_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
+
+#define ESP_EVENT_ANY_ID -1
+
+esp_err_t esp_event_loop_create_default(void);
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+    esp_event_handler_t handler, void* arg, esp_event_handler_instance_t* instance);
+
+#endif // _WA_HOST_ESP_EVENT_H_INCLUDE_GUARD
@@ -0,0 +1,22 @@
+/**
+ * Host stand-in for the ESP-IDF heap, for the firmware simulation. Allocations come from the host heap but are counted
+ * against a fixed size, so the firmware sees its free heap shrink and the simulation can report growth.
+*/
+#ifndef _WA_HOST_ESP_HEAP_CAPS_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_HEAP_CAPS_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+
+void heap_caps_free(void* ptr);
+
+size_t heap_caps_get_free_size(uint32_t caps);
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+#endif // _WA_HOST_ESP_HEAP_CAPS_H_INCLUDE_GUARD
@@ -0,0 +1,29 @@
+/**
+ * Host stand-in for the ESP-IDF HTTP client, for the firmware simulation. Only the benchmark client uses it, and the
+ * simulation is built without benchmark mode, so there is nothing behind these.
+*/
+#ifndef _WA_HOST_ESP_HTTP_CLIENT_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_HTTP_CLIENT_H_INCLUDE_GUARD
+
+#include "esp_err.h"
+
+typedef struct esp_http_client* esp_http_client_handle_t;
+
+typedef struct esp_http_client_config_t
+{
+    const char* url;
+    int timeout_ms;
+    int buffer_size;
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t* config);
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char* url);
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+#endif // _WA_HOST_ESP_HTTP_CLIENT_H_INCLUDE_GUARD
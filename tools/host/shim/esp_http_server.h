@@ -0,0 +1,111 @@
+/**
+ * Host stand-in for the ESP-IDF HTTP server, for the firmware simulation. There are no sockets: the simulation hands
+ * requests to a simulated httpd task, which runs the registered handlers and records what they send
+ * (sim_http_request in sim/sim.h).
+*/
+#ifndef _WA_HOST_ESP_HTTP_SERVER_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_HTTP_SERVER_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+#define HTTPD_MAX_URI_LEN 512
+
+#define HTTPD_RESP_USE_STRLEN -1
+
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+typedef void* httpd_handle_t;
+
+typedef enum
+{
+    HTTP_GET = 1,
+    HTTP_POST = 3
+} httpd_method_t;
+
+typedef enum
+{
+    HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND = 3,
+    HTTPD_408_REQ_TIMEOUT = 6
+} httpd_err_code_t;
+
+typedef struct httpd_req
+{
+    httpd_handle_t handle;
+    int method;
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    // The simulated exchange this request belongs to.
+    void* aux;
+    void* user_ctx;
+    void* sess_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri
+{
+    const char* uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t* req);
+    void* user_ctx;
+} httpd_uri_t;
+
+typedef struct httpd_config
+{
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    bool lru_purge_enable;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {        \
+        .task_priority = 5,             \
+        .stack_size = 4096,             \
+        .core_id = 0x7FFFFFFF,          \
+        .server_port = 80,              \
+        .max_open_sockets = 7,          \
+        .max_uri_handlers = 8,          \
+        .lru_purge_enable = false       \
+    }
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buf, ssize_t buf_len);
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buf, ssize_t buf_len);
+
+esp_err_t httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* message);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status);
+
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type);
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value);
+
+int httpd_req_to_sockfd(httpd_req_t* req);
+
+int httpd_req_recv(httpd_req_t* req, char* buf, size_t buf_len);
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buf, size_t buf_len);
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* req, const char* field, char* val, size_t val_size);
+
+esp_err_t httpd_query_key_value(const char* query, const char* key, char* value, size_t value_len);
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t* req, httpd_req_t** out);
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t* req);
+
+#endif // _WA_HOST_ESP_HTTP_SERVER_H_INCLUDE_GUARD
@@ -0,0 +1,32 @@
+/**
+ * Host stand-in for the ESP-IDF log, for the firmware simulation. Lines are stamped with the virtual time.
+ *
+ * The firmware's formats assume a 32 bit size_t, so they are not checked here.
+*/
+#ifndef _WA_HOST_ESP_LOG_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_LOG_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...);
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOG_LEVEL(level, tag, format, ...) esp_log_write(level, tag, format, ##__VA_ARGS__)
+
+#endif // _WA_HOST_ESP_LOG_H_INCLUDE_GUARD
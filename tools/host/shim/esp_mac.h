@@ -0,0 +1,24 @@
+/**
+ * Host stand-in for the ESP-IDF MAC helpers, for the firmware simulation.
+*/
+#ifndef _WA_HOST_ESP_MAC_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_MAC_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+typedef enum
+{
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+    ESP_MAC_BT,
+    ESP_MAC_ETH,
+} esp_mac_type_t;
+
+esp_err_t esp_read_mac(uint8_t* mac, esp_mac_type_t type);
+
+#endif // _WA_HOST_ESP_MAC_H_INCLUDE_GUARD
@@ -0,0 +1,15 @@
+/**
+ * Host stand-in for the ESP-IDF network interfaces, for the firmware simulation. There is no network.
+*/
+#ifndef _WA_HOST_ESP_NETIF_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_NETIF_H_INCLUDE_GUARD
+
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_err_t esp_netif_init(void);
+
+esp_netif_t* esp_netif_create_default_wifi_ap(void);
+
+#endif // _WA_HOST_ESP_NETIF_H_INCLUDE_GUARD
@@ -0,0 +1,14 @@
+/**
+ * Host stand-in for the ESP-IDF ROM functions, for the firmware simulation.
+*/
+#ifndef _WA_HOST_ESP_ROM_SYS_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_ROM_SYS_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+/**
+ * Busy waits on the chip; here it takes virtual time.
+*/
+void esp_rom_delay_us(uint32_t us);
+
+#endif // _WA_HOST_ESP_ROM_SYS_H_INCLUDE_GUARD
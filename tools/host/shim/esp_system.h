@@ -0,0 +1,26 @@
+/**
+ * Host stand-in for the ESP-IDF system API, for the firmware simulation.
+*/
+#ifndef _WA_HOST_ESP_SYSTEM_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_SYSTEM_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW
+} esp_reset_reason_t;
+
+void esp_restart(void);
+
+esp_reset_reason_t esp_reset_reason(void);
+
+uint32_t esp_get_free_heap_size(void);
+
+#endif // _WA_HOST_ESP_SYSTEM_H_INCLUDE_GUARD
@@ -0,0 +1,41 @@
+/**
+ * Host stand-in for the ESP-IDF high resolution timer, for the firmware simulation. Time is the virtual clock, and
+ * callbacks run on a simulated esp_timer task.
+*/
+#ifndef _WA_HOST_ESP_TIMER_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_TIMER_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+typedef struct esp_timer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR
+} esp_timer_dispatch_t;
+
+typedef struct esp_timer_create_args_t
+{
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle);
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+int64_t esp_timer_get_time(void);
+
+#endif // _WA_HOST_ESP_TIMER_H_INCLUDE_GUARD
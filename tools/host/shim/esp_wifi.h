@@ -0,0 +1,80 @@
+/**
+ * Host stand-in for the ESP-IDF Wi-Fi API, for the firmware simulation. The SoftAP settings are only recorded.
+*/
+#ifndef _WA_HOST_ESP_WIFI_H_INCLUDE_GUARD
+#define _WA_HOST_ESP_WIFI_H_INCLUDE_GUARD
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+
+typedef struct wifi_init_config_t
+{
+    int reserved;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() { 0 }
+
+typedef enum
+{
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WPA_WPA2_PSK = 4
+} wifi_auth_mode_t;
+
+typedef enum
+{
+    WIFI_MODE_AP = 2
+} wifi_mode_t;
+
+typedef enum
+{
+    WIFI_IF_AP = 1
+} wifi_interface_t;
+
+typedef struct wifi_ap_config_t
+{
+    uint8_t ssid[32];
+    uint8_t password[64];
+    uint8_t ssid_len;
+    uint8_t channel;
+    wifi_auth_mode_t authmode;
+    uint8_t max_connection;
+} wifi_ap_config_t;
+
+typedef union wifi_config_t
+{
+    wifi_ap_config_t ap;
+} wifi_config_t;
+
+extern esp_event_base_t const WIFI_EVENT;
+
+enum
+{
+    WIFI_EVENT_AP_START = 12,
+    WIFI_EVENT_AP_STACONNECTED = 14,
+    WIFI_EVENT_AP_STADISCONNECTED = 15
+};
+
+typedef struct wifi_event_ap_staconnected_t
+{
+    uint8_t mac[6];
+    uint8_t aid;
+} wifi_event_ap_staconnected_t;
+
+typedef struct wifi_event_ap_stadisconnected_t
+{
+    uint8_t mac[6];
+    uint8_t aid;
+} wifi_event_ap_stadisconnected_t;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config);
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config);
+
+esp_err_t esp_wifi_start(void);
+
+#endif // _WA_HOST_ESP_WIFI_H_INCLUDE_GUARD
@@ -0,0 +1,65 @@
+/**
+ * Host stand-in for the FreeRTOS header, for the firmware simulation (see sim/sim_rtos.c). Ticks are 10 ms like the
+ * ESP-IDF default. Simulated tasks run one at a time, so critical sections have nothing to do.
+*/
+#ifndef _WA_HOST_FREERTOS_H_INCLUDE_GUARD
+#define _WA_HOST_FREERTOS_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <limits.h>
+#include <sys/types.h>
+
+#define configTICK_RATE_HZ 100
+#define configMAX_PRIORITIES 25
+
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)((ms) / portTICK_PERIOD_MS))
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+// ESP-IDF stack sizes are in bytes.
+typedef uint8_t StackType_t;
+
+typedef void (*TaskFunction_t)(void* params);
+typedef struct sim_task* TaskHandle_t;
+typedef struct sim_sem* SemaphoreHandle_t;
+
+// Storage for statically allocated objects. Semaphores live in it; tasks only need it to have the right shape.
+typedef struct StaticTask_t
+{
+    void* reserved[16];
+} StaticTask_t;
+
+typedef struct StaticSemaphore_t
+{
+    void* reserved[8];
+} StaticSemaphore_t;
+
+typedef struct portMUX_TYPE
+{
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+#endif // _WA_HOST_FREERTOS_H_INCLUDE_GUARD
@@ -0,0 +1,29 @@
+/**
+ * Host stand-in for the FreeRTOS queue API, for the firmware simulation. Sends to a full queue can't block; they fail
+ * at once if the timeout is zero, and stop the simulation otherwise.
+*/
+#ifndef _WA_HOST_FREERTOS_QUEUE_H_INCLUDE_GUARD
+#define _WA_HOST_FREERTOS_QUEUE_H_INCLUDE_GUARD
+
+#include "freertos/FreeRTOS.h"
+
+#define errQUEUE_FULL ((BaseType_t)0)
+
+typedef struct sim_queue* QueueHandle_t;
+
+typedef struct StaticQueue_t
+{
+    void* reserved[8];
+} StaticQueue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* buffer);
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif // _WA_HOST_FREERTOS_QUEUE_H_INCLUDE_GUARD
@@ -0,0 +1,25 @@
+/**
+ * Host stand-in for the FreeRTOS semaphore API, for the firmware simulation. Mutexes have no priority inheritance.
+ *
+ * Includes the queue and task APIs, as the real header does.
+*/
+#ifndef _WA_HOST_FREERTOS_SEMPHR_H_INCLUDE_GUARD
+#define _WA_HOST_FREERTOS_SEMPHR_H_INCLUDE_GUARD
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer);
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif // _WA_HOST_FREERTOS_SEMPHR_H_INCLUDE_GUARD
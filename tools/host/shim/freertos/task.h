@@ -0,0 +1,33 @@
+/**
+ * Host stand-in for the FreeRTOS task API, for the firmware simulation. Only what the firmware uses.
+*/
+#ifndef _WA_HOST_FREERTOS_TASK_H_INCLUDE_GUARD
+#define _WA_HOST_FREERTOS_TASK_H_INCLUDE_GUARD
+
+#include "freertos/FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_fn, const char* name, uint32_t stack_size, void* params,
+    UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core_id);
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task_fn, const char* name, uint32_t stack_size, void* params,
+    UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb, BaseType_t core_id);
+
+#define xTaskCreate(task_fn, name, stack_size, params, priority, created_task) \
+    xTaskCreatePinnedToCore(task_fn, name, stack_size, params, priority, created_task, tskNO_AFFINITY)
+
+#define xTaskCreateStatic(task_fn, name, stack_size, params, priority, stack, tcb) \
+    xTaskCreateStaticPinnedToCore(task_fn, name, stack_size, params, priority, stack, tcb, tskNO_AFFINITY)
+
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+
+TickType_t xTaskGetTickCount(void);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+#endif // _WA_HOST_FREERTOS_TASK_H_INCLUDE_GUARD
@@ -0,0 +1,15 @@
+/**
+ * What ESP-IDF's newlib has that an older host C library may not. Force included in the firmware simulation build.
+*/
+#ifndef _WA_HOST_COMPAT_H_INCLUDE_GUARD
+#define _WA_HOST_COMPAT_H_INCLUDE_GUARD
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+#define HOST_NEEDS_STRLCPY 1
+size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+
+#endif // _WA_HOST_COMPAT_H_INCLUDE_GUARD
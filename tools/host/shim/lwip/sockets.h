@@ -0,0 +1,29 @@
+/**
+ * Host stand-in for the lwIP socket API, for the firmware simulation. The types are the host's; the calls are routed to
+ * the simulation as lwIP routes them to its lwip_ functions: getpeername to the simulated server, and UDP sockets to
+ * the simulated network (sim_idf.c).
+*/
+#ifndef _WA_HOST_LWIP_SOCKETS_H_INCLUDE_GUARD
+#define _WA_HOST_LWIP_SOCKETS_H_INCLUDE_GUARD
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+int lwip_getpeername(int s, struct sockaddr* name, socklen_t* namelen);
+
+int lwip_socket(int domain, int type, int protocol);
+
+int lwip_setsockopt(int s, int level, int optname, const void* optval, socklen_t optlen);
+
+ssize_t lwip_sendto(int s, const void* data, size_t size, int flags, const struct sockaddr* to, socklen_t tolen);
+
+int lwip_close(int s);
+
+#define getpeername(s, name, namelen) lwip_getpeername(s, name, namelen)
+#define socket(domain, type, protocol) lwip_socket(domain, type, protocol)
+#define setsockopt(s, level, optname, optval, optlen) lwip_setsockopt(s, level, optname, optval, optlen)
+#define sendto(s, data, size, flags, to, tolen) lwip_sendto(s, data, size, flags, to, tolen)
+#define closesocket(s) lwip_close(s)
+
+#endif // _WA_HOST_LWIP_SOCKETS_H_INCLUDE_GUARD
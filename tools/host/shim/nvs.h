@@ -0,0 +1,39 @@
+/**
+ * Host stand-in for the ESP-IDF NVS API, for the firmware simulation. Values are kept in memory for the run and can
+ * be preset from the command line (sim_nvs_preset in sim/sim.h).
+*/
+#ifndef _WA_HOST_NVS_H_INCLUDE_GUARD
+#define _WA_HOST_NVS_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle);
+
+void nvs_close(nvs_handle_t handle);
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value);
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value);
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value);
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value);
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length);
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+
+esp_err_t nvs_commit(nvs_handle_t handle);
+
+#endif // _WA_HOST_NVS_H_INCLUDE_GUARD
@@ -0,0 +1,13 @@
+/**
+ * Host stand-in for the ESP-IDF NVS partition API, for the firmware simulation.
+*/
+#ifndef _WA_HOST_NVS_FLASH_H_INCLUDE_GUARD
+#define _WA_HOST_NVS_FLASH_H_INCLUDE_GUARD
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+
+esp_err_t nvs_flash_erase(void);
+
+#endif // _WA_HOST_NVS_FLASH_H_INCLUDE_GUARD
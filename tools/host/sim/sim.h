@@ -0,0 +1,150 @@
+/**
+ * Firmware simulation on Linux. The real firmware sources run on a small FreeRTOS and ESP-IDF stand-in (the headers in
+ * ../shim) with a virtual clock, a register model of the MCP9808 and an httpd without sockets. UDP datagrams go to a
+ * listener instead of a network.
+ *
+ * Each simulated task is a thread, but only one runs at a time: the highest priority ready task, until it blocks. Time
+ * only moves when every task is blocked, and then jumps straight to the next wakeup, so days of polling take seconds
+ * and every run with the same inputs is the same.
+*/
+#ifndef _WA_SIM_H_INCLUDE_GUARD
+#define _WA_SIM_H_INCLUDE_GUARD
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+
+#define SIM_OK 0
+#define SIM_FAIL 1
+
+// Kernel (sim_rtos.c).
+
+typedef struct sim_task_stats
+{
+    const char* name;
+    UBaseType_t priority;
+    uint64_t runs;
+} sim_task_stats;
+
+void sim_run(TaskFunction_t main_fn, const char* name, UBaseType_t priority);
+
+int64_t sim_now_us();
+
+void sim_sleep_us(int64_t duration_us);
+
+uint64_t sim_switch_count();
+
+size_t sim_get_task_stats(sim_task_stats* stats, size_t max);
+
+// ESP-IDF services (sim_idf.c).
+
+typedef struct sim_heap_stats
+{
+    size_t in_use;
+    size_t peak;
+    uint64_t allocs;
+    uint64_t frees;
+} sim_heap_stats;
+
+void* sim_heap_alloc(size_t size);
+
+void sim_heap_free(void* ptr);
+
+void sim_get_heap_stats(sim_heap_stats* stats);
+
+void sim_log_set_level(esp_log_level_t level);
+
+uint32_t sim_log_count(esp_log_level_t level);
+
+int sim_nvs_preset(const char* key, const char* value);
+
+void sim_wifi_station(bool join);
+
+uint32_t sim_gpio_changes(int gpio_num);
+
+typedef struct sim_flash_stats
+{
+    uint64_t writes;
+    uint64_t bytes_written;
+    // Sectors erased.
+    uint64_t erases;
+    // Writes that tried to set a bit an earlier write had cleared.
+    uint64_t overwrites;
+} sim_flash_stats;
+
+void sim_flash_get_stats(sim_flash_stats* stats);
+
+typedef void (*sim_udp_listener_fn)(const uint8_t* data, size_t len, uint32_t ipv4, uint16_t port);
+
+typedef struct sim_udp_stats
+{
+    uint64_t sent;
+    uint64_t bytes;
+    // Sends that failed because the SoftAP wasn't up yet.
+    uint64_t unreachable;
+} sim_udp_stats;
+
+void sim_udp_set_listener(sim_udp_listener_fn listener);
+
+void sim_udp_get_stats(sim_udp_stats* stats);
+
+// MCP9808 register model (sim_mcp9808.c).
+
+typedef struct sim_mcp9808_stats
+{
+    uint64_t transfers;
+    uint64_t temp_reads;
+    uint64_t nacks;
+    uint64_t timeouts;
+    // Times the sensor hung the bus, and times clocking SCL freed it.
+    uint32_t stuck;
+    uint32_t released;
+    uint32_t alert_asserts;
+    int64_t alert_us;
+} sim_mcp9808_stats;
+
+int sim_mcp9808_load_trace(const char* path, bool loop);
+
+int32_t sim_mcp9808_trace_milli_c(int64_t time_us, bool* fail);
+
+void sim_mcp9808_get_stats(sim_mcp9808_stats* stats);
+
+int sim_mcp9808_add_stuck(int64_t time_us);
+
+void sim_mcp9808_gpio_changed(int gpio_num, int level);
+
+bool sim_mcp9808_pulls_low(int gpio_num);
+
+// HTTP server (sim_httpd.c).
+
+typedef struct sim_response
+{
+    // 0 if no response was sent.
+    int status;
+    char type[32];
+    char* body;
+    size_t body_len;
+    size_t chunks;
+    // The handler returned an error, which makes the real server close the connection.
+    bool handler_failed;
+    // Retry-After header, empty if not sent.
+    char retry_after[12];
+    // Content-Encoding header, empty if not sent.
+    char content_encoding[12];
+    // Content-Range and ETag headers, empty if not sent.
+    char content_range[48];
+    char etag[16];
+} sim_response;
+
+void sim_http_set_client(uint32_t ipv4);
+
+int sim_http_set_header(const char* field, const char* value);
+
+int sim_http_request(int method, const char* uri, const char* body, int64_t timeout_us, sim_response* resp);
+
+void sim_response_free(sim_response* resp);
+
+#endif // _WA_SIM_H_INCLUDE_GUARD
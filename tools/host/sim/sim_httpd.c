@@ -0,0 +1,518 @@
+/**
+ * Simulated ESP-IDF HTTP server. Requests come from sim_http_request instead of sockets, but are served the same way:
+ * one at a time on an httpd task with the configured priority, by the handler registered for the path and method.
+ * Whatever the handler sends is recorded in the caller's sim_response.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_http_server.h>
+#include <esp_log.h>
+#include <lwip/sockets.h>
+#include <host_compat.h>
+
+#include "sim.h"
+
+#define LOG_TAG "httpd"
+
+// How often a waiting client checks whether its response is done.
+#define SIM_HTTP_POLL_TICKS (100 / portTICK_PERIOD_MS)
+
+// Requests come from the first address the SoftAP hands out, unless set otherwise.
+#define SIM_HTTP_DEFAULT_CLIENT 0xC0A80402
+
+// The one connection requests are served on, as seen by httpd_req_to_sockfd.
+#define SIM_HTTP_SOCKFD 54
+
+// Request headers a client can set.
+#define SIM_HTTP_MAX_HEADERS 4
+
+typedef struct http_header
+{
+    const char* field;
+    const char* value;
+} http_header;
+
+typedef struct http_exchange
+{
+    int method;
+    const char* uri;
+    const char* body;
+    size_t body_len;
+    size_t body_read;
+    // Host byte order.
+    uint32_t client_ipv4;
+    // Request headers; unused entries have a NULL field.
+    http_header headers[SIM_HTTP_MAX_HEADERS];
+
+    sim_response* resp;
+    bool done;
+    TaskHandle_t client;
+} http_exchange;
+
+typedef struct http_server
+{
+    httpd_config_t config;
+    httpd_uri_t* handlers;
+    size_t handler_count;
+    TaskHandle_t task;
+
+    // The one request being handed over. Clients wait their turn.
+    http_exchange* pending;
+    // The request a handler is running for, if any.
+    http_exchange* serving;
+} http_server;
+
+static http_server s_server = { 0 };
+static uint32_t s_client_ipv4 = SIM_HTTP_DEFAULT_CLIENT;
+static http_header s_headers[SIM_HTTP_MAX_HEADERS];
+
+static void httpd_task(void* params);
+static void serve(http_exchange* exchange);
+static void finish(http_exchange* exchange);
+static esp_err_t append_body(httpd_req_t* req, const char* buf, ssize_t buf_len);
+static bool path_matches(const char* registered, const char* uri);
+
+/**
+ * Send a request and wait for the response, up to timeout_us of virtual time. Returns SIM_FAIL if there is no server
+ * or no response in time. Must be called from a simulated task.
+*/
+int sim_http_request(int method, const char* uri, const char* body, int64_t timeout_us, sim_response* resp)
+{
+    memset(resp, 0, sizeof(*resp));
+
+    if (s_server.task == NULL)
+    {
+        return SIM_FAIL;
+    }
+
+    http_exchange exchange = {
+        .method = method,
+        .uri = uri,
+        .body = body != NULL ? body : "",
+        .body_len = body != NULL ? strlen(body) : 0,
+        .client_ipv4 = s_client_ipv4,
+        .resp = resp,
+        .client = xTaskGetCurrentTaskHandle(),
+    };
+    memcpy(exchange.headers, s_headers, sizeof(s_headers));
+
+    int64_t deadline = sim_now_us() + timeout_us;
+
+    while (s_server.pending != NULL)
+    {
+        if (sim_now_us() >= deadline)
+        {
+            return SIM_FAIL;
+        }
+        vTaskDelay(SIM_HTTP_POLL_TICKS);
+    }
+
+    s_server.pending = &exchange;
+    xTaskNotifyGive(s_server.task);
+
+    while (!exchange.done)
+    {
+        if (sim_now_us() >= deadline)
+        {
+            // The exchange is on this stack, so it must not be touched after returning.
+            fprintf(stderr, "sim: no response to %s after %.1f s, stopping\n", uri, timeout_us / 1e6);
+            exit(2);
+        }
+        ulTaskNotifyTake(pdTRUE, SIM_HTTP_POLL_TICKS);
+    }
+
+    return SIM_OK;
+}
+
+/**
+ * Set the client address (host byte order) of the requests that follow.
+*/
+void sim_http_set_client(uint32_t ipv4)
+{
+    s_client_ipv4 = ipv4;
+}
+
+/**
+ * Set a header of the requests that follow, or NULL to stop sending it. Both strings must outlive the requests.
+ * Returns SIM_FAIL if SIM_HTTP_MAX_HEADERS different headers are already set.
+*/
+int sim_http_set_header(const char* field, const char* value)
+{
+    http_header* free_slot = NULL;
+
+    for (size_t i = 0; i < SIM_HTTP_MAX_HEADERS; ++i)
+    {
+        http_header* header = &s_headers[i];
+        if (header->field != NULL && strcasecmp(header->field, field) == 0)
+        {
+            header->field = value != NULL ? field : NULL;
+            header->value = value;
+            return SIM_OK;
+        }
+        if (header->field == NULL && free_slot == NULL)
+        {
+            free_slot = header;
+        }
+    }
+
+    if (value == NULL)
+    {
+        return SIM_OK;
+    }
+    if (free_slot == NULL)
+    {
+        return SIM_FAIL;
+    }
+
+    free_slot->field = field;
+    free_slot->value = value;
+    return SIM_OK;
+}
+
+void sim_response_free(sim_response* resp)
+{
+    free(resp->body);
+    resp->body = NULL;
+    resp->body_len = 0;
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config)
+{
+    if (s_server.task != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_server.config = *config;
+    s_server.handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    if (s_server.handlers == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreatePinnedToCore(httpd_task, "httpd", config->stack_size, NULL, config->task_priority,
+        &s_server.task, config->core_id) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    *handle = &s_server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler)
+{
+    for (size_t i = 0; i < s_server.handler_count; ++i)
+    {
+        if (strcmp(s_server.handlers[i].uri, uri_handler->uri) == 0 &&
+            s_server.handlers[i].method == uri_handler->method)
+        {
+            return ESP_FAIL;
+        }
+    }
+
+    if (s_server.handler_count == s_server.config.max_uri_handlers)
+    {
+        ESP_LOGW(LOG_TAG, "No slots left for registering handler");
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+
+    s_server.handlers[s_server.handler_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buf, ssize_t buf_len)
+{
+    return append_body(req, buf, buf_len);
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buf, ssize_t buf_len)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+    ++exchange->resp->chunks;
+
+    return append_body(req, buf, buf_len);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* message)
+{
+    switch (error)
+    {
+    case HTTPD_400_BAD_REQUEST:
+        httpd_resp_set_status(req, "400 Bad Request");
+        break;
+    case HTTPD_404_NOT_FOUND:
+        httpd_resp_set_status(req, "404 Not Found");
+        break;
+    case HTTPD_408_REQ_TIMEOUT:
+        httpd_resp_set_status(req, "408 Request Timeout");
+        break;
+    default:
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        break;
+    }
+
+    return append_body(req, message, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+    exchange->resp->status = atoi(status);
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+    strlcpy(exchange->resp->type, type, sizeof(exchange->resp->type));
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+    if (strcasecmp(field, "Retry-After") == 0)
+    {
+        strlcpy(exchange->resp->retry_after, value, sizeof(exchange->resp->retry_after));
+    }
+    else if (strcasecmp(field, "Content-Encoding") == 0)
+    {
+        strlcpy(exchange->resp->content_encoding, value, sizeof(exchange->resp->content_encoding));
+    }
+    else if (strcasecmp(field, "Content-Range") == 0)
+    {
+        strlcpy(exchange->resp->content_range, value, sizeof(exchange->resp->content_range));
+    }
+    else if (strcasecmp(field, "ETag") == 0)
+    {
+        strlcpy(exchange->resp->etag, value, sizeof(exchange->resp->etag));
+    }
+
+    return ESP_OK;
+}
+
+int httpd_req_to_sockfd(httpd_req_t* req)
+{
+    return req->aux != NULL ? SIM_HTTP_SOCKFD : -1;
+}
+
+/**
+ * The peer of the connection is the client of the request being served.
+*/
+int lwip_getpeername(int s, struct sockaddr* name, socklen_t* namelen)
+{
+    if (s != SIM_HTTP_SOCKFD || s_server.serving == NULL || *namelen < sizeof(struct sockaddr_in))
+    {
+        return -1;
+    }
+
+    struct sockaddr_in* addr = (struct sockaddr_in*)name;
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(49152);
+    addr->sin_addr.s_addr = htonl(s_server.serving->client_ipv4);
+    *namelen = sizeof(*addr);
+
+    return 0;
+}
+
+int httpd_req_recv(httpd_req_t* req, char* buf, size_t buf_len)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+
+    size_t left = exchange->body_len - exchange->body_read;
+    size_t n = buf_len < left ? buf_len : left;
+    memcpy(buf, exchange->body + exchange->body_read, n);
+    exchange->body_read += n;
+
+    return (int)n;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buf, size_t buf_len)
+{
+    const char* query = strchr(req->uri, '?');
+    if (query == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return strlcpy(buf, query + 1, buf_len) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* req, const char* field, char* val, size_t val_size)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+
+    for (size_t i = 0; i < SIM_HTTP_MAX_HEADERS; ++i)
+    {
+        const http_header* header = &exchange->headers[i];
+        if (header->field != NULL && strcasecmp(header->field, field) == 0)
+        {
+            size_t len = strlcpy(val, header->value, val_size);
+            return len < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_query_key_value(const char* query, const char* key, char* value, size_t value_len)
+{
+    size_t key_len = strlen(key);
+    const char* p = query;
+
+    while (p != NULL && *p != 0)
+    {
+        const char* end = strchr(p, '&');
+        size_t pair_len = end != NULL ? (size_t)(end - p) : strlen(p);
+
+        if (pair_len > key_len && strncmp(p, key, key_len) == 0 && p[key_len] == '=')
+        {
+            size_t len = pair_len - key_len - 1;
+            size_t n = len < value_len - 1 ? len : value_len - 1;
+            memcpy(value, p + key_len + 1, n);
+            value[n] = 0;
+
+            return n == len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+
+        p = end != NULL ? end + 1 : NULL;
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * Detach a request from the httpd task. The copy comes from the heap, as on the device, so a request that is never
+ * completed shows up as heap growth.
+*/
+esp_err_t httpd_req_async_handler_begin(httpd_req_t* req, httpd_req_t** out)
+{
+    httpd_req_t* copy = sim_heap_alloc(sizeof(httpd_req_t));
+    if (copy == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(copy, req, sizeof(httpd_req_t));
+    // Marks the original as handed off, so the httpd task doesn't finish it.
+    req->aux = NULL;
+
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t* req)
+{
+    finish((http_exchange*)req->aux);
+    sim_heap_free(req);
+
+    return ESP_OK;
+}
+
+static void httpd_task(void* params)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        http_exchange* exchange = s_server.pending;
+        if (exchange != NULL)
+        {
+            serve(exchange);
+            s_server.pending = NULL;
+        }
+    }
+}
+
+static void serve(http_exchange* exchange)
+{
+    httpd_req_t req = {
+        .handle = &s_server,
+        .method = exchange->method,
+        .content_len = exchange->body_len,
+        .aux = exchange,
+    };
+    strlcpy((char*)req.uri, exchange->uri, sizeof(req.uri));
+
+    const httpd_uri_t* handler = NULL;
+    for (size_t i = 0; i < s_server.handler_count && handler == NULL; ++i)
+    {
+        if ((int)s_server.handlers[i].method == exchange->method &&
+            path_matches(s_server.handlers[i].uri, exchange->uri))
+        {
+            handler = &s_server.handlers[i];
+        }
+    }
+
+    if (handler == NULL)
+    {
+        httpd_resp_send_err(&req, HTTPD_404_NOT_FOUND, "Nothing matches the given URI");
+        finish(exchange);
+        return;
+    }
+
+    req.user_ctx = handler->user_ctx;
+    s_server.serving = exchange;
+    esp_err_t rc = handler->handler(&req);
+    s_server.serving = NULL;
+
+    // A detached request is finished by httpd_req_async_handler_complete.
+    if (req.aux != NULL)
+    {
+        exchange->resp->handler_failed = rc != ESP_OK;
+        finish(exchange);
+    }
+}
+
+static void finish(http_exchange* exchange)
+{
+    if (exchange->resp->status == 0 && exchange->resp->body != NULL)
+    {
+        exchange->resp->status = 200;
+    }
+
+    exchange->done = true;
+    xTaskNotifyGive(exchange->client);
+}
+
+static esp_err_t append_body(httpd_req_t* req, const char* buf, ssize_t buf_len)
+{
+    http_exchange* exchange = (http_exchange*)req->aux;
+    sim_response* resp = exchange->resp;
+
+    size_t len = buf == NULL ? 0 : buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len;
+
+    char* body = realloc(resp->body, resp->body_len + len + 1);
+    if (body == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (len > 0)
+    {
+        memcpy(body + resp->body_len, buf, len);
+    }
+    resp->body = body;
+    resp->body_len += len;
+    resp->body[resp->body_len] = 0;
+
+    return ESP_OK;
+}
+
+/**
+ * Exact match on the path; the query is not part of it.
+*/
+static bool path_matches(const char* registered, const char* uri)
+{
+    size_t path_len = strcspn(uri, "?");
+    return strlen(registered) == path_len && strncmp(registered, uri, path_len) == 0;
+}
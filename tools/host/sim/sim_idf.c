@@ -0,0 +1,866 @@
+/**
+ * Simulated ESP-IDF services: log, heap accounting, NVS, the flash partition, Wi-Fi and events, UDP sockets, GPIO, and
+ * the system calls the firmware makes. They run on the calling simulated task, and only one task runs at a time, so
+ * there is no locking here.
+*/
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_chip_info.h>
+#include <esp_err.h>
+#include <esp_event.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_mac.h>
+#include <esp_netif.h>
+#include <esp_system.h>
+#include <esp_wifi.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <esp_partition.h>
+#include <driver/gpio.h>
+#include <esp_rom_sys.h>
+#include <lwip/sockets.h>
+#include <host_compat.h>
+
+#include "sim.h"
+
+// About what an ESP32 has free once Wi-Fi is up.
+#define SIM_HEAP_SIZE (160 * 1024)
+
+#define SIM_NVS_ENTRIES 32
+#define SIM_NVS_KEY_SIZE 16
+#define SIM_NVS_VALUE_SIZE 96
+#define SIM_EVENT_HANDLERS 8
+#define SIM_GPIO_COUNT 40
+
+// The reading log partition. Smaller than the device's, so a week of one minute readings wraps around it.
+#define SIM_FLASH_LABEL "readings"
+#define SIM_FLASH_SIZE (64 * 1024)
+
+// Blocking startup calls take about this long on an ESP32, so the boot timeline has something to show. Wi-Fi init
+// includes RF calibration.
+#define SIM_NVS_INIT_US 20000
+#define SIM_NETIF_INIT_US 5000
+#define SIM_WIFI_INIT_US 250000
+#define SIM_WIFI_START_US 60000
+
+// Typical SPI flash timings: a 4 KB sector erase, and programming a few bytes.
+#define SIM_FLASH_ERASE_US 45000
+#define SIM_FLASH_WRITE_US 100
+
+// UDP sockets, numbered after the server's connection so the two never mix.
+#define SIM_UDP_SOCKETS 4
+#define SIM_UDP_FIRST_FD 60
+
+typedef struct heap_header
+{
+    size_t size;
+    // Keeps the payload aligned like malloc's.
+    max_align_t align;
+} heap_header;
+
+typedef struct nvs_entry
+{
+    char key[SIM_NVS_KEY_SIZE];
+    char value[SIM_NVS_VALUE_SIZE];
+    bool is_u32;
+    uint32_t u32;
+    bool is_i32;
+    int32_t i32;
+} nvs_entry;
+
+typedef struct event_handler
+{
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void* arg;
+} event_handler;
+
+typedef struct udp_socket
+{
+    bool open;
+    bool broadcast;
+} udp_socket;
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+
+static sim_heap_stats s_heap = { 0 };
+static esp_log_level_t s_log_level = ESP_LOG_WARN;
+static uint32_t s_log_counts[ESP_LOG_VERBOSE + 1];
+
+static nvs_entry s_nvs[SIM_NVS_ENTRIES];
+static size_t s_nvs_count = 0;
+
+static event_handler s_event_handlers[SIM_EVENT_HANDLERS];
+static size_t s_event_handler_count = 0;
+static uint8_t s_next_station_aid = 1;
+static bool s_wifi_started = false;
+static const uint8_t s_ap_mac[6] = { 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x57 };
+
+static udp_socket s_udp_sockets[SIM_UDP_SOCKETS];
+static sim_udp_listener_fn s_udp_listener = NULL;
+static sim_udp_stats s_udp_stats = { 0 };
+
+static uint8_t s_flash[SIM_FLASH_SIZE];
+static bool s_flash_ready = false;
+static sim_flash_stats s_flash_stats = { 0 };
+static const esp_partition_t s_flash_partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = 0x40,
+    .address = 0x110000,
+    .size = SIM_FLASH_SIZE,
+    .erase_size = SPI_FLASH_SEC_SIZE,
+    .label = SIM_FLASH_LABEL,
+};
+
+static int s_gpio_levels[SIM_GPIO_COUNT];
+static uint32_t s_gpio_changes[SIM_GPIO_COUNT];
+
+static nvs_entry* nvs_find(const char* key);
+static nvs_entry* nvs_add(const char* key);
+static void post_event(esp_event_base_t base, int32_t id, void* data);
+static bool flash_range_ok(const esp_partition_t* partition, size_t offset, size_t size);
+static udp_socket* udp_find(int s);
+
+void* sim_heap_alloc(size_t size)
+{
+    if (size > SIM_HEAP_SIZE - s_heap.in_use)
+    {
+        return NULL;
+    }
+
+    heap_header* header = malloc(sizeof(heap_header) + size);
+    if (header == NULL)
+    {
+        return NULL;
+    }
+
+    header->size = size;
+    s_heap.in_use += size;
+    if (s_heap.in_use > s_heap.peak)
+    {
+        s_heap.peak = s_heap.in_use;
+    }
+    ++s_heap.allocs;
+
+    return header + 1;
+}
+
+void sim_heap_free(void* ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    heap_header* header = (heap_header*)ptr - 1;
+    s_heap.in_use -= header->size;
+    ++s_heap.frees;
+    free(header);
+}
+
+void sim_get_heap_stats(sim_heap_stats* stats)
+{
+    *stats = s_heap;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return sim_heap_alloc(size);
+}
+
+void heap_caps_free(void* ptr)
+{
+    sim_heap_free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return SIM_HEAP_SIZE - s_heap.in_use;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return SIM_HEAP_SIZE - s_heap.peak;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+/**
+ * Set the most detailed level printed. Every level is counted either way.
+*/
+void sim_log_set_level(esp_log_level_t level)
+{
+    s_log_level = level;
+}
+
+uint32_t sim_log_count(esp_log_level_t level)
+{
+    return level <= ESP_LOG_VERBOSE ? s_log_counts[level] : 0;
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+    if (level > ESP_LOG_VERBOSE)
+    {
+        return;
+    }
+
+    ++s_log_counts[level];
+    if (level > s_log_level)
+    {
+        return;
+    }
+
+    static const char s_letters[] = "NEWIDV";
+    printf("%c (%.3f) %s: ", s_letters[level], sim_now_us() / 1e6, tag);
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+
+    putchar('\n');
+}
+
+const char* esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void sim_error_check_failed(esp_err_t rc, const char* file, int line, const char* expression)
+{
+    fprintf(stderr, "sim: ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d: %s\n", esp_err_to_name(rc), rc, file, line,
+        expression);
+    exit(2);
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "sim: esp_restart at %.3f s\n", sim_now_us() / 1e6);
+    exit(3);
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+void esp_chip_info(esp_chip_info_t* out_info)
+{
+    out_info->model = CHIP_POSIX_LINUX;
+    out_info->features = 0;
+    out_info->revision = 0;
+    out_info->cores = 1;
+}
+
+/**
+ * Preset an NVS value before the firmware starts, as if it had been saved. Numbers are readable with nvs_get_str and
+ * with nvs_get_u32 or nvs_get_i32, whichever holds them.
+*/
+int sim_nvs_preset(const char* key, const char* value)
+{
+    if (strlen(key) >= SIM_NVS_KEY_SIZE || strlen(value) >= SIM_NVS_VALUE_SIZE)
+    {
+        return SIM_FAIL;
+    }
+
+    nvs_entry* entry = nvs_add(key);
+    if (entry == NULL)
+    {
+        return SIM_FAIL;
+    }
+
+    strlcpy(entry->value, value, sizeof(entry->value));
+
+    char* end;
+    unsigned long parsed = strtoul(value, &end, 10);
+    entry->is_u32 = end != value && *end == 0 && value[0] != '-' && parsed <= UINT32_MAX;
+    entry->u32 = (uint32_t)parsed;
+
+    long parsed_signed = strtol(value, &end, 10);
+    entry->is_i32 = end != value && *end == 0 && parsed_signed >= INT32_MIN && parsed_signed <= INT32_MAX;
+    entry->i32 = (int32_t)parsed_signed;
+
+    return SIM_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    sim_sleep_us(SIM_NVS_INIT_US);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    s_nvs_count = 0;
+    return ESP_OK;
+}
+
+/**
+ * There is only the one namespace the firmware uses.
+*/
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle)
+{
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value)
+{
+    nvs_entry* entry = nvs_find(key);
+    if (entry == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (!entry->is_u32)
+    {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+
+    *out_value = entry->u32;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value)
+{
+    char text[12];
+    snprintf(text, sizeof(text), "%" PRIu32, value);
+
+    return sim_nvs_preset(key, text) == SIM_OK ? ESP_OK : ESP_ERR_NVS_NO_FREE_PAGES;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value)
+{
+    nvs_entry* entry = nvs_find(key);
+    if (entry == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (!entry->is_i32)
+    {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+
+    *out_value = entry->i32;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value)
+{
+    char text[12];
+    snprintf(text, sizeof(text), "%" PRId32, value);
+
+    return sim_nvs_preset(key, text) == SIM_OK ? ESP_OK : ESP_ERR_NVS_NO_FREE_PAGES;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length)
+{
+    nvs_entry* entry = nvs_find(key);
+    if (entry == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    size_t needed = strlen(entry->value) + 1;
+    if (out_value == NULL)
+    {
+        *length = needed;
+        return ESP_OK;
+    }
+    if (*length < needed)
+    {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    memcpy(out_value, entry->value, needed);
+    *length = needed;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value)
+{
+    nvs_entry* entry = nvs_add(key);
+    if (entry == NULL || strlen(value) >= SIM_NVS_VALUE_SIZE)
+    {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+
+    strlcpy(entry->value, value, sizeof(entry->value));
+    entry->is_u32 = false;
+    entry->is_i32 = false;
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void sim_flash_get_stats(sim_flash_stats* stats)
+{
+    *stats = s_flash_stats;
+}
+
+/**
+ * The partition starts out erased, like a new device.
+*/
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+    const char* label)
+{
+    if (type != ESP_PARTITION_TYPE_DATA || label == NULL || strcmp(label, SIM_FLASH_LABEL) != 0)
+    {
+        return NULL;
+    }
+
+    if (!s_flash_ready)
+    {
+        memset(s_flash, 0xFF, sizeof(s_flash));
+        s_flash_ready = true;
+    }
+
+    return &s_flash_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size)
+{
+    if (!flash_range_ok(partition, src_offset, size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, s_flash + src_offset, size);
+    return ESP_OK;
+}
+
+/**
+ * Program bytes. Bits can only go from 1 to 0, so writing over data that wasn't erased gives the AND of both, as on
+ * real flash; such writes are counted.
+*/
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size)
+{
+    if (!flash_range_ok(partition, dst_offset, size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)src;
+    bool overwrote = false;
+    for (size_t i = 0; i < size; ++i)
+    {
+        overwrote |= (bytes[i] & ~s_flash[dst_offset + i]) != 0;
+        s_flash[dst_offset + i] &= bytes[i];
+    }
+
+    ++s_flash_stats.writes;
+    s_flash_stats.bytes_written += size;
+    if (overwrote)
+    {
+        ++s_flash_stats.overwrites;
+    }
+
+    sim_sleep_us(SIM_FLASH_WRITE_US);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size)
+{
+    if (!flash_range_ok(partition, offset, size) || offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(s_flash + offset, 0xFF, size);
+    s_flash_stats.erases += size / SPI_FLASH_SEC_SIZE;
+
+    sim_sleep_us(SIM_FLASH_ERASE_US * (int64_t)(size / SPI_FLASH_SEC_SIZE));
+    return ESP_OK;
+}
+
+/**
+ * The mapping is the partition's memory itself, so it shows writes and erases as soon as they are made, like the
+ * device's cache after a flash operation.
+*/
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+    esp_partition_mmap_memory_t memory, const void** out_ptr, esp_partition_mmap_handle_t* out_handle)
+{
+    if (!flash_range_ok(partition, offset, size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    *out_ptr = s_flash + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+}
+
+esp_err_t esp_netif_init(void)
+{
+    sim_sleep_us(SIM_NETIF_INIT_US);
+    return ESP_OK;
+}
+
+esp_netif_t* esp_netif_create_default_wifi_ap(void)
+{
+    // Never dereferenced.
+    static char s_netif;
+    return (esp_netif_t*)&s_netif;
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+    esp_event_handler_t handler, void* arg, esp_event_handler_instance_t* instance)
+{
+    if (s_event_handler_count == SIM_EVENT_HANDLERS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    event_handler* entry = &s_event_handlers[s_event_handler_count++];
+    entry->base = event_base;
+    entry->id = event_id;
+    entry->handler = handler;
+    entry->arg = arg;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config)
+{
+    sim_sleep_us(SIM_WIFI_INIT_US);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    sim_sleep_us(SIM_WIFI_START_US);
+    s_wifi_started = true;
+    post_event(WIFI_EVENT, WIFI_EVENT_AP_START, NULL);
+    return ESP_OK;
+}
+
+/**
+ * Post a station join or leave to the SoftAP's event handlers. Stations leave in the order they joined.
+*/
+void sim_wifi_station(bool join)
+{
+    if (join)
+    {
+        wifi_event_ap_staconnected_t event =
+            { .mac = { 0x02, 0, 0, 0, 0, s_next_station_aid }, .aid = s_next_station_aid };
+        ++s_next_station_aid;
+        post_event(WIFI_EVENT, WIFI_EVENT_AP_STACONNECTED, &event);
+    }
+    else
+    {
+        wifi_event_ap_stadisconnected_t event = { .mac = { 0x02, 0, 0, 0, 0, 1 }, .aid = 1 };
+        post_event(WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, &event);
+    }
+}
+
+/**
+ * The SoftAP's MAC is the station's plus one, as on the device.
+*/
+esp_err_t esp_read_mac(uint8_t* mac, esp_mac_type_t type)
+{
+    if (mac == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(mac, s_ap_mac, sizeof(s_ap_mac));
+    if (type == ESP_MAC_WIFI_STA)
+    {
+        --mac[5];
+    }
+
+    return ESP_OK;
+}
+
+int lwip_socket(int domain, int type, int protocol)
+{
+    if (domain != AF_INET || type != SOCK_DGRAM)
+    {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+
+    for (int i = 0; i < SIM_UDP_SOCKETS; ++i)
+    {
+        if (!s_udp_sockets[i].open)
+        {
+            s_udp_sockets[i] = (udp_socket){ .open = true };
+            return SIM_UDP_FIRST_FD + i;
+        }
+    }
+
+    errno = ENFILE;
+    return -1;
+}
+
+/**
+ * Only SO_BROADCAST changes anything; other options are accepted and ignored.
+*/
+int lwip_setsockopt(int s, int level, int optname, const void* optval, socklen_t optlen)
+{
+    udp_socket* sock = udp_find(s);
+    if (sock == NULL || optval == NULL)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (level == SOL_SOCKET && optname == SO_BROADCAST && optlen == sizeof(int))
+    {
+        sock->broadcast = *(const int*)optval != 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Deliver a datagram to the listener. Like lwIP, this fails before the SoftAP is up (no route), and for a broadcast
+ * address unless SO_BROADCAST is set.
+*/
+ssize_t lwip_sendto(int s, const void* data, size_t size, int flags, const struct sockaddr* to, socklen_t tolen)
+{
+    udp_socket* sock = udp_find(s);
+    if (sock == NULL || to == NULL || tolen < sizeof(struct sockaddr_in) || to->sa_family != AF_INET)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const struct sockaddr_in* dest = (const struct sockaddr_in*)to;
+    uint32_t ipv4 = ntohl(dest->sin_addr.s_addr);
+
+    if (!s_wifi_started)
+    {
+        ++s_udp_stats.unreachable;
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+
+    if (ipv4 == INADDR_BROADCAST && !sock->broadcast)
+    {
+        errno = EACCES;
+        return -1;
+    }
+
+    ++s_udp_stats.sent;
+    s_udp_stats.bytes += size;
+    if (s_udp_listener != NULL)
+    {
+        s_udp_listener(data, size, ipv4, ntohs(dest->sin_port));
+    }
+
+    return (ssize_t)size;
+}
+
+int lwip_close(int s)
+{
+    udp_socket* sock = udp_find(s);
+    if (sock == NULL)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    sock->open = false;
+    return 0;
+}
+
+/**
+ * Set the function that receives every datagram sent, with its destination address and port in host order. The
+ * listener runs on the sending task.
+*/
+void sim_udp_set_listener(sim_udp_listener_fn listener)
+{
+    s_udp_listener = listener;
+}
+
+void sim_udp_get_stats(sim_udp_stats* stats)
+{
+    *stats = s_udp_stats;
+}
+
+esp_err_t gpio_config(const gpio_config_t* config)
+{
+    return config != NULL && config->pin_bit_mask >> SIM_GPIO_COUNT == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= SIM_GPIO_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int new_level = level != 0;
+    if (s_gpio_levels[gpio_num] != new_level)
+    {
+        s_gpio_levels[gpio_num] = new_level;
+        ++s_gpio_changes[gpio_num];
+        sim_mcp9808_gpio_changed(gpio_num, new_level);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * The level an output was set to, unless the sensor is pulling the pin low (open drain).
+*/
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= SIM_GPIO_COUNT || sim_mcp9808_pulls_low(gpio_num))
+    {
+        return 0;
+    }
+
+    return s_gpio_levels[gpio_num];
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    sim_sleep_us(us);
+}
+
+/**
+ * Count the level changes of an output, e.g. LED blinks.
+*/
+uint32_t sim_gpio_changes(int gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < SIM_GPIO_COUNT ? s_gpio_changes[gpio_num] : 0;
+}
+
+#if HOST_NEEDS_STRLCPY
+size_t strlcpy(char* dst, const char* src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size > 0)
+    {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+
+    return len;
+}
+#endif
+
+static nvs_entry* nvs_find(const char* key)
+{
+    for (size_t i = 0; i < s_nvs_count; ++i)
+    {
+        if (strcmp(s_nvs[i].key, key) == 0)
+        {
+            return &s_nvs[i];
+        }
+    }
+
+    return NULL;
+}
+
+static nvs_entry* nvs_add(const char* key)
+{
+    nvs_entry* entry = nvs_find(key);
+    if (entry != NULL)
+    {
+        return entry;
+    }
+
+    if (s_nvs_count == SIM_NVS_ENTRIES || strlen(key) >= SIM_NVS_KEY_SIZE)
+    {
+        return NULL;
+    }
+
+    entry = &s_nvs[s_nvs_count++];
+    strlcpy(entry->key, key, sizeof(entry->key));
+    entry->value[0] = 0;
+    entry->is_u32 = false;
+    entry->is_i32 = false;
+
+    return entry;
+}
+
+static udp_socket* udp_find(int s)
+{
+    if (s < SIM_UDP_FIRST_FD || s >= SIM_UDP_FIRST_FD + SIM_UDP_SOCKETS || !s_udp_sockets[s - SIM_UDP_FIRST_FD].open)
+    {
+        return NULL;
+    }
+
+    return &s_udp_sockets[s - SIM_UDP_FIRST_FD];
+}
+
+static bool flash_range_ok(const esp_partition_t* partition, size_t offset, size_t size)
+{
+    return partition == &s_flash_partition && offset <= SIM_FLASH_SIZE && size <= SIM_FLASH_SIZE - offset;
+}
+
+/**
+ * Run the handlers for an event on the calling task. The device runs them on the event loop task.
+*/
+static void post_event(esp_event_base_t base, int32_t id, void* data)
+{
+    for (size_t i = 0; i < s_event_handler_count; ++i)
+    {
+        event_handler* entry = &s_event_handlers[i];
+        if (entry->base == base && (entry->id == ESP_EVENT_ANY_ID || entry->id == id))
+        {
+            entry->handler(entry->arg, base, id, data);
+        }
+    }
+}
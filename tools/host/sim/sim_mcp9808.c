@@ -0,0 +1,523 @@
+/**
+ * Simulated I2C master driver with a register model of the MCP9808 behind it.
+ *
+ * The ambient temperature comes from a trace: lines of "<seconds> <celsius>", with temperatures interpolated between
+ * points, or "<seconds> nack" for the sensor not answering until the next point. '#' starts a comment. After the last
+ * point the last temperature holds, or the trace starts over if looping. Without a trace the temperature swings
+ * 3 degrees around 21 C over a day.
+ *
+ * "<seconds> stuck" hangs the bus instead, as a glitch mid-read does: the first transfer from then on leaves the sensor
+ * holding SDA low, and every transfer times out until SCL is clocked by hand (with the driver removed) a few times.
+ * Stuck points don't interrupt the temperatures and aren't repeated when looping.
+ *
+ * Transfers take the time they would at the configured clock rate, blocking the calling task like the real driver.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <driver/i2c.h>
+
+#include "sim.h"
+
+#define MCP9808_ADDR 0x18
+
+#define REG_CONFIG 0x01
+#define REG_UPPER 0x02
+#define REG_LOWER 0x03
+#define REG_CRIT 0x04
+#define REG_TA 0x05
+#define REG_MANUFACTURER 0x06
+#define REG_DEVICE 0x07
+#define REG_RESOLUTION 0x08
+#define REG_COUNT 0x09
+
+#define CONFIG_WRITABLE 0x07FF
+#define CONFIG_ALERT_CRIT_ONLY 0x0004
+#define CONFIG_ALERT_ON 0x0008
+#define CONFIG_HYST_SHIFT 9
+#define LIMIT_WRITABLE 0x1FFC
+
+#define TA_FLAG_CRIT 0x8000
+#define TA_FLAG_UPPER 0x4000
+#define TA_FLAG_LOWER 0x2000
+
+// Clocks a stuck sensor needs to finish its byte and let go of SDA.
+#define STUCK_CLOCKS 5
+
+#define TRACE_LINE_SIZE 128
+#define DEFAULT_MILLI_C 21000
+#define DEFAULT_SWING_MILLI_C 3000
+#define DAY_S 86400
+
+typedef struct trace_point
+{
+    int64_t time_us;
+    int32_t milli_c;
+    bool nack;
+} trace_point;
+
+static trace_point* s_trace = NULL;
+static size_t s_trace_count = 0;
+static bool s_trace_loop = false;
+
+static bool s_driver_installed = false;
+static uint32_t s_clock_hz = 100000;
+static int s_sda_pin = -1;
+static int s_scl_pin = -1;
+
+// Times the bus hangs, in order, and the next one due.
+static int64_t* s_stuck_times = NULL;
+static size_t s_stuck_count = 0;
+static size_t s_stuck_next = 0;
+
+// While the sensor holds SDA, the SCL clocks it has seen.
+static bool s_holding_sda = false;
+static int s_stuck_clocks = 0;
+
+static uint8_t s_pointer = 0;
+static uint16_t s_registers[REG_COUNT] = {
+    [REG_MANUFACTURER] = 0x0054,
+    [REG_DEVICE] = 0x0400,
+    [REG_RESOLUTION] = 0x0003,
+};
+
+// Alert pin, brought up to date on every transfer.
+static bool s_alert_asserted = false;
+static int64_t s_alert_since_us = 0;
+
+static sim_mcp9808_stats s_stats = { 0 };
+
+static esp_err_t transfer(uint8_t address, size_t bytes, TickType_t ticks);
+static void write_register(const uint8_t* data, size_t size);
+static uint16_t ta_register(int32_t milli_c);
+static int16_t sign_extend_13(uint16_t value);
+static void update_alert(int16_t ta_16ths);
+
+/**
+ * Load a trace file. Points must be in time order.
+*/
+int sim_mcp9808_load_trace(const char* path, bool loop)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "can't open trace %s\n", path);
+        return SIM_FAIL;
+    }
+
+    size_t capacity = 0;
+    char line[TRACE_LINE_SIZE];
+    int line_no = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        ++line_no;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = 0;
+        }
+
+        double seconds;
+        char value[32];
+        int fields = sscanf(line, "%lf %31s", &seconds, value);
+        if (fields <= 0)
+        {
+            continue;
+        }
+
+        trace_point point = { .time_us = (int64_t)(seconds * 1e6) };
+        char* end = value;
+        if (fields == 2 && strcmp(value, "stuck") == 0)
+        {
+            if (sim_mcp9808_add_stuck(point.time_us) != SIM_OK)
+            {
+                fclose(file);
+                return SIM_FAIL;
+            }
+            continue;
+        }
+        else if (fields == 2 && strcmp(value, "nack") == 0)
+        {
+            point.nack = true;
+            end = value + strlen(value);
+        }
+        else if (fields == 2)
+        {
+            point.milli_c = (int32_t)lround(strtod(value, &end) * 1000);
+        }
+
+        if (fields != 2 || *end != 0 || (s_trace_count > 0 && point.time_us < s_trace[s_trace_count - 1].time_us))
+        {
+            fprintf(stderr, "%s:%d: expected \"<seconds> <celsius|nack|stuck>\" in time order\n", path, line_no);
+            fclose(file);
+            return SIM_FAIL;
+        }
+
+        if (s_trace_count == capacity)
+        {
+            capacity = capacity > 0 ? capacity * 2 : 64;
+            s_trace = realloc(s_trace, capacity * sizeof(trace_point));
+            if (s_trace == NULL)
+            {
+                fclose(file);
+                return SIM_FAIL;
+            }
+        }
+        s_trace[s_trace_count++] = point;
+    }
+
+    fclose(file);
+
+    if (s_trace_count == 0)
+    {
+        fprintf(stderr, "%s: no points\n", path);
+        return SIM_FAIL;
+    }
+
+    s_trace_loop = loop;
+    return SIM_OK;
+}
+
+/**
+ * Get the trace temperature at a time, in thousandths of degrees C. fail, when not NULL, is set if the sensor does not
+ * answer then.
+*/
+int32_t sim_mcp9808_trace_milli_c(int64_t time_us, bool* fail)
+{
+    bool nack = false;
+    if (fail == NULL)
+    {
+        fail = &nack;
+    }
+    *fail = false;
+
+    if (s_trace_count == 0)
+    {
+        return DEFAULT_MILLI_C + (int32_t)lround(DEFAULT_SWING_MILLI_C * sin(2 * M_PI * (time_us / 1e6) / DAY_S));
+    }
+
+    int64_t span_us = s_trace[s_trace_count - 1].time_us - s_trace[0].time_us;
+    if (s_trace_loop && span_us > 0 && time_us >= s_trace[0].time_us)
+    {
+        time_us = s_trace[0].time_us + (time_us - s_trace[0].time_us) % span_us;
+    }
+
+    // Last point at or before the time.
+    size_t lo = 0;
+    size_t hi = s_trace_count;
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s_trace[mid].time_us <= time_us)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    const trace_point* a = &s_trace[lo];
+    if (a->nack)
+    {
+        *fail = true;
+        return 0;
+    }
+
+    const trace_point* b = lo + 1 < s_trace_count ? &s_trace[lo + 1] : NULL;
+    if (b == NULL || b->nack || time_us <= a->time_us || b->time_us == a->time_us)
+    {
+        return a->milli_c;
+    }
+
+    return a->milli_c +
+        (int32_t)((int64_t)(b->milli_c - a->milli_c) * (time_us - a->time_us) / (b->time_us - a->time_us));
+}
+
+void sim_mcp9808_get_stats(sim_mcp9808_stats* stats)
+{
+    *stats = s_stats;
+
+    if (s_alert_asserted)
+    {
+        stats->alert_us += sim_now_us() - s_alert_since_us;
+    }
+}
+
+/**
+ * Hang the bus at a time.
+*/
+int sim_mcp9808_add_stuck(int64_t time_us)
+{
+    int64_t* times = realloc(s_stuck_times, (s_stuck_count + 1) * sizeof(int64_t));
+    if (times == NULL)
+    {
+        return SIM_FAIL;
+    }
+    s_stuck_times = times;
+
+    // Kept in order; there are only ever a few.
+    size_t i = s_stuck_count;
+    for (; i > s_stuck_next && s_stuck_times[i - 1] > time_us; --i)
+    {
+        s_stuck_times[i] = s_stuck_times[i - 1];
+    }
+    s_stuck_times[i] = time_us;
+    ++s_stuck_count;
+
+    return SIM_OK;
+}
+
+/**
+ * Called when firmware sets a GPIO. While the sensor holds SDA, each rising edge of SCL with the driver removed clocks
+ * out one more bit of the byte it is stuck in.
+*/
+void sim_mcp9808_gpio_changed(int gpio_num, int level)
+{
+    if (!s_holding_sda || s_driver_installed || gpio_num != s_scl_pin || level == 0)
+    {
+        return;
+    }
+
+    if (++s_stuck_clocks >= STUCK_CLOCKS)
+    {
+        s_holding_sda = false;
+        ++s_stats.released;
+    }
+}
+
+bool sim_mcp9808_pulls_low(int gpio_num)
+{
+    return s_holding_sda && gpio_num == s_sda_pin;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t* config)
+{
+    if (config == NULL || config->mode != I2C_MODE_MASTER || config->master.clk_speed == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_clock_hz = config->master.clk_speed;
+    s_sda_pin = config->sda_io_num;
+    s_scl_pin = config->scl_io_num;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_buf_len, size_t tx_buf_len, int intr_flags)
+{
+    if (s_driver_installed)
+    {
+        return ESP_FAIL;
+    }
+
+    s_driver_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t port)
+{
+    if (!s_driver_installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_driver_installed = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t address, const uint8_t* write_buffer,
+    size_t write_size, uint8_t* read_buffer, size_t read_size, TickType_t ticks)
+{
+    esp_err_t rc = transfer(address, write_size + read_size, ticks);
+    if (rc != ESP_OK)
+    {
+        return rc;
+    }
+
+    if (write_size > 0)
+    {
+        s_pointer = write_buffer[0] & 0x0F;
+    }
+
+    uint16_t value = s_pointer < REG_COUNT ? s_registers[s_pointer] : 0;
+    if (s_pointer == REG_TA)
+    {
+        value = ta_register(sim_mcp9808_trace_milli_c(sim_now_us(), NULL));
+        ++s_stats.temp_reads;
+    }
+
+    // Single byte registers repeat their byte; 16 bit registers are big endian.
+    for (size_t i = 0; i < read_size; ++i)
+    {
+        read_buffer[i] = s_pointer == REG_RESOLUTION ? (uint8_t)value : (uint8_t)(i % 2 == 0 ? value >> 8 : value);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t address, const uint8_t* write_buffer,
+    size_t write_size, TickType_t ticks)
+{
+    esp_err_t rc = transfer(address, write_size, ticks);
+    if (rc != ESP_OK)
+    {
+        return rc;
+    }
+
+    write_register(write_buffer, write_size);
+    return ESP_OK;
+}
+
+/**
+ * Take the bus time for a transfer of this many data bytes, and check the device answers. A hung bus takes the whole
+ * timeout.
+*/
+static esp_err_t transfer(uint8_t address, size_t bytes, TickType_t ticks)
+{
+    if (!s_driver_installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ++s_stats.transfers;
+
+    if (!s_holding_sda && s_stuck_next < s_stuck_count && s_stuck_times[s_stuck_next] <= sim_now_us())
+    {
+        ++s_stuck_next;
+        ++s_stats.stuck;
+        s_holding_sda = true;
+        s_stuck_clocks = 0;
+    }
+
+    if (s_holding_sda)
+    {
+        ++s_stats.timeouts;
+        sim_sleep_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    bool fail = false;
+    int32_t milli_c = sim_mcp9808_trace_milli_c(sim_now_us(), &fail);
+    bool answered = address == MCP9808_ADDR && !fail;
+
+    // Nine clocks per byte plus start, repeated start and stop. A missing device NACKs its address byte.
+    size_t clocks = answered ? 9 * (2 + bytes) + 3 : 9 + 2;
+    sim_sleep_us((int64_t)(clocks * 1000000ULL / s_clock_hz) + 1);
+
+    if (!answered)
+    {
+        ++s_stats.nacks;
+        return ESP_FAIL;
+    }
+
+    update_alert(sign_extend_13(ta_register(milli_c)));
+    return ESP_OK;
+}
+
+static void write_register(const uint8_t* data, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    s_pointer = data[0] & 0x0F;
+    if (size < 2)
+    {
+        return;
+    }
+
+    uint16_t value = size >= 3 ? (uint16_t)(data[1] << 8 | data[2]) : data[1];
+
+    switch (s_pointer)
+    {
+    case REG_CONFIG:
+        s_registers[REG_CONFIG] = value & CONFIG_WRITABLE;
+        break;
+    case REG_UPPER:
+    case REG_LOWER:
+    case REG_CRIT:
+        s_registers[s_pointer] = value & LIMIT_WRITABLE;
+        break;
+    case REG_RESOLUTION:
+        s_registers[REG_RESOLUTION] = data[1] & 0x03;
+        break;
+    default:
+        // Read only.
+        break;
+    }
+}
+
+/**
+ * Ambient temperature register: 1/16 C steps as 13 bit two's complement, the low bits cleared below the resolution,
+ * and the limit flags on top.
+*/
+static uint16_t ta_register(int32_t milli_c)
+{
+    int32_t sixteenths = (int32_t)floor(milli_c * 16 / 1000.0);
+    sixteenths &= ~((1 << (3 - (s_registers[REG_RESOLUTION] & 0x03))) - 1);
+
+    uint16_t value = (uint16_t)sixteenths & 0x1FFF;
+
+    if (sixteenths >= sign_extend_13(s_registers[REG_CRIT]))
+    {
+        value |= TA_FLAG_CRIT;
+    }
+    if (sixteenths > sign_extend_13(s_registers[REG_UPPER]))
+    {
+        value |= TA_FLAG_UPPER;
+    }
+    if (sixteenths < sign_extend_13(s_registers[REG_LOWER]))
+    {
+        value |= TA_FLAG_LOWER;
+    }
+
+    return value;
+}
+
+static int16_t sign_extend_13(uint16_t value)
+{
+    value &= 0x1FFF;
+    return (int16_t)(value & 0x1000 ? value | 0xE000 : value);
+}
+
+/**
+ * Comparator mode: the pin is asserted outside the window or at or above critical. The hysteresis applies when the
+ * temperature falls back from the upper or critical limit.
+*/
+static void update_alert(int16_t ta_16ths)
+{
+    uint16_t config = s_registers[REG_CONFIG];
+    static const int16_t s_hyst_16ths[4] = { 0, 24, 48, 96 };
+    int16_t hyst = s_hyst_16ths[(config >> CONFIG_HYST_SHIFT) & 0x03];
+
+    int16_t upper = sign_extend_13(s_registers[REG_UPPER]);
+    int16_t lower = sign_extend_13(s_registers[REG_LOWER]);
+    int16_t crit = sign_extend_13(s_registers[REG_CRIT]);
+
+    bool crit_only = (config & CONFIG_ALERT_CRIT_ONLY) != 0;
+    bool above_crit = ta_16ths >= (s_alert_asserted ? crit - hyst : crit);
+    bool above_upper = !crit_only && ta_16ths > (s_alert_asserted ? upper - hyst : upper);
+    bool below_lower = !crit_only && ta_16ths < lower;
+
+    bool asserted = (config & CONFIG_ALERT_ON) != 0 && (above_crit || above_upper || below_lower);
+    int64_t now = sim_now_us();
+
+    if (asserted && !s_alert_asserted)
+    {
+        ++s_stats.alert_asserts;
+        s_alert_since_us = now;
+    }
+    else if (!asserted && s_alert_asserted)
+    {
+        s_stats.alert_us += now - s_alert_since_us;
+    }
+
+    s_alert_asserted = asserted;
+}
@@ -0,0 +1,853 @@
+/**
+ * Simulated FreeRTOS kernel and esp_timer, driven by a virtual clock.
+ *
+ * Every task is a host thread that only runs while it is the current task. A task gives up the CPU when it blocks
+ * (delay, semaphore, notification) or when it wakes a task of higher priority, and the scheduler hands it to the
+ * highest priority ready task, oldest first. When no task is ready the clock jumps to the earliest wakeup. All kernel
+ * state is under one lock, which a task only holds inside these functions.
+*/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
+
+#include "sim.h"
+
+#define TICK_US (portTICK_PERIOD_MS * 1000LL)
+#define NO_WAKE -1
+
+// Host stack for each task thread. Firmware stack sizes are for the ESP32 and too small for the host C library.
+#define SIM_THREAD_STACK (512 * 1024)
+
+// Same as ESP-IDF's esp_timer task.
+#define SIM_TIMER_TASK_PRIORITY 22
+
+// Yields in a row without the clock moving before a task is reported as spinning.
+#define SIM_SPIN_LIMIT 1000000
+
+typedef enum sim_task_state
+{
+    SIM_TASK_READY,
+    SIM_TASK_RUNNING,
+    SIM_TASK_BLOCKED,
+    SIM_TASK_DELETED
+} sim_task_state;
+
+typedef struct sim_task
+{
+    char name[16];
+    UBaseType_t priority;
+    TaskFunction_t fn;
+    void* params;
+
+    pthread_t thread;
+    pthread_cond_t cond;
+
+    sim_task_state state;
+    // Orders ready tasks of the same priority, and blocked tasks waiting on the same semaphore.
+    uint64_t seq;
+    int64_t wake_us;
+    struct sim_sem* wait_sem;
+    bool wait_notify;
+    // Set when woken by a give or notify rather than by the timeout.
+    bool woken;
+
+    uint32_t notify_count;
+    uint64_t runs;
+
+    // Heap taken for the stack and TCB of a dynamically created task. NULL for static tasks.
+    void* reservation;
+
+    struct sim_task* next;
+} sim_task;
+
+typedef struct sim_sem
+{
+    UBaseType_t count;
+    UBaseType_t max;
+} sim_sem;
+
+static_assert(sizeof(sim_sem) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t must hold a sim_sem");
+
+/**
+ * A queue is a ring of items plus a counting semaphore of the items not yet claimed by a receiver, so receivers wait
+ * the same way semaphore takers do.
+*/
+typedef struct sim_queue
+{
+    sim_sem items;
+    uint8_t* storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t stored;
+} sim_queue;
+
+static_assert(sizeof(sim_queue) <= sizeof(StaticQueue_t), "StaticQueue_t must hold a sim_queue");
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void* arg;
+    int64_t due_us;
+    uint64_t period_us;
+    struct esp_timer* next;
+};
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_idle_cond = PTHREAD_COND_INITIALIZER;
+
+static sim_task* s_tasks = NULL;
+static sim_task* s_current = NULL;
+static int64_t s_now_us = 0;
+static uint64_t s_seq = 0;
+static uint64_t s_switches = 0;
+static uint64_t s_spins = 0;
+
+static struct esp_timer* s_timers = NULL;
+static sim_task* s_timer_task = NULL;
+
+static sim_task* create_task(TaskFunction_t fn, const char* name, void* params, UBaseType_t priority);
+static void* task_thread(void* arg);
+static void reschedule(sim_task* self);
+static sim_task* pick_ready();
+static bool advance_clock();
+static bool block_current(int64_t wake_us);
+static void make_ready(sim_task* task, bool woken);
+static void preempt_for(sim_task* task);
+static int64_t ticks_to_wake(TickType_t ticks);
+static sim_sem* create_sem(sim_sem* sem, UBaseType_t count, UBaseType_t max);
+static void timer_task(void* params);
+static void timer_task_kick();
+static void report_stuck(const char* reason);
+
+/**
+ * Start the simulation with one task, which runs main_fn (like app_main), and never return. The simulation ends when a
+ * task calls exit().
+*/
+void sim_run(TaskFunction_t main_fn, const char* name, UBaseType_t priority)
+{
+    pthread_mutex_lock(&s_lock);
+
+    s_timer_task = create_task(timer_task, "esp_timer", NULL, SIM_TIMER_TASK_PRIORITY);
+    create_task(main_fn, name, NULL, priority);
+
+    s_current = pick_ready();
+    s_current->state = SIM_TASK_RUNNING;
+    ++s_current->runs;
+    pthread_cond_signal(&s_current->cond);
+
+    for (;;)
+    {
+        pthread_cond_wait(&s_idle_cond, &s_lock);
+    }
+}
+
+int64_t sim_now_us()
+{
+    pthread_mutex_lock(&s_lock);
+    int64_t now = s_now_us;
+    pthread_mutex_unlock(&s_lock);
+
+    return now;
+}
+
+/**
+ * Block the current task for a span of virtual time, like a driver waiting for its hardware.
+*/
+void sim_sleep_us(int64_t duration_us)
+{
+    pthread_mutex_lock(&s_lock);
+    block_current(s_now_us + (duration_us > 0 ? duration_us : 0));
+    pthread_mutex_unlock(&s_lock);
+}
+
+uint64_t sim_switch_count()
+{
+    pthread_mutex_lock(&s_lock);
+    uint64_t switches = s_switches;
+    pthread_mutex_unlock(&s_lock);
+
+    return switches;
+}
+
+/**
+ * Copy how often each task was scheduled. Returns the number of tasks.
+*/
+size_t sim_get_task_stats(sim_task_stats* stats, size_t max)
+{
+    size_t count = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (sim_task* task = s_tasks; task != NULL; task = task->next)
+    {
+        if (count < max)
+        {
+            stats[count].name = task->name;
+            stats[count].priority = task->priority;
+            stats[count].runs = task->runs;
+        }
+        ++count;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return count < max ? count : max;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_fn, const char* name, uint32_t stack_size, void* params,
+    UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core_id)
+{
+    // The TCB and stack come from the heap, as on the device.
+    void* reservation = sim_heap_alloc(stack_size + sizeof(StaticTask_t));
+    if (reservation == NULL)
+    {
+        return pdFAIL;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    sim_task* task = create_task(task_fn, name, params, priority);
+    task->reservation = reservation;
+    if (created_task != NULL)
+    {
+        *created_task = task;
+    }
+    preempt_for(task);
+    pthread_mutex_unlock(&s_lock);
+
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task_fn, const char* name, uint32_t stack_size, void* params,
+    UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb, BaseType_t core_id)
+{
+    if (stack == NULL || tcb == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    sim_task* task = create_task(task_fn, name, params, priority);
+    preempt_for(task);
+    pthread_mutex_unlock(&s_lock);
+
+    return task;
+}
+
+/**
+ * Only deleting the current task is supported, which is all the firmware does.
+*/
+void vTaskDelete(TaskHandle_t task)
+{
+    pthread_mutex_lock(&s_lock);
+    sim_task* self = s_current;
+
+    if (task != NULL && task != self)
+    {
+        pthread_mutex_unlock(&s_lock);
+        report_stuck("vTaskDelete of another task is not simulated");
+        return;
+    }
+
+    // The idle task frees a deleted task's memory on the device; here it is freed right away.
+    sim_heap_free(self->reservation);
+    self->reservation = NULL;
+
+    self->state = SIM_TASK_DELETED;
+    reschedule(self);
+    pthread_mutex_unlock(&s_lock);
+
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    pthread_mutex_lock(&s_lock);
+
+    if (ticks == 0)
+    {
+        // A yield: same priority tasks that are ready go first.
+        make_ready(s_current, false);
+        if (++s_spins > SIM_SPIN_LIMIT)
+        {
+            pthread_mutex_unlock(&s_lock);
+            report_stuck("a task yields without ever blocking, so virtual time can't move");
+        }
+        reschedule(s_current);
+    }
+    else
+    {
+        block_current(ticks_to_wake(ticks));
+    }
+
+    pthread_mutex_unlock(&s_lock);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    pthread_mutex_lock(&s_lock);
+    TickType_t ticks = (TickType_t)(s_now_us / TICK_US);
+    pthread_mutex_unlock(&s_lock);
+
+    return ticks;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    pthread_mutex_lock(&s_lock);
+    sim_task* task = s_current;
+    pthread_mutex_unlock(&s_lock);
+
+    return task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&s_lock);
+
+    ++task->notify_count;
+    if (task->state == SIM_TASK_BLOCKED && task->wait_notify)
+    {
+        make_ready(task, true);
+        preempt_for(task);
+    }
+
+    pthread_mutex_unlock(&s_lock);
+
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    pthread_mutex_lock(&s_lock);
+    sim_task* self = s_current;
+
+    if (self->notify_count == 0 && ticks != 0)
+    {
+        self->wait_notify = true;
+        block_current(ticks_to_wake(ticks));
+    }
+
+    uint32_t value = self->notify_count;
+    if (value > 0)
+    {
+        self->notify_count = clear_on_exit ? 0 : value - 1;
+    }
+
+    pthread_mutex_unlock(&s_lock);
+
+    return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return create_sem(sim_heap_alloc(sizeof(sim_sem)), 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer)
+{
+    return create_sem((sim_sem*)buffer, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return create_sem(sim_heap_alloc(sizeof(sim_sem)), 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer)
+{
+    return create_sem((sim_sem*)buffer, 0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    BaseType_t rc = pdTRUE;
+
+    pthread_mutex_lock(&s_lock);
+
+    if (sem->count > 0)
+    {
+        --sem->count;
+    }
+    else if (ticks == 0)
+    {
+        rc = pdFALSE;
+    }
+    else
+    {
+        // A give hands the semaphore straight to the waiter, so waking by event means it is taken.
+        s_current->wait_sem = sem;
+        if (!block_current(ticks_to_wake(ticks)))
+        {
+            rc = pdFALSE;
+        }
+    }
+
+    pthread_mutex_unlock(&s_lock);
+
+    return rc;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    BaseType_t rc = pdTRUE;
+
+    pthread_mutex_lock(&s_lock);
+
+    sim_task* waiter = NULL;
+    for (sim_task* task = s_tasks; task != NULL; task = task->next)
+    {
+        if (task->state == SIM_TASK_BLOCKED && task->wait_sem == sem &&
+            (waiter == NULL || task->priority > waiter->priority ||
+            (task->priority == waiter->priority && task->seq < waiter->seq)))
+        {
+            waiter = task;
+        }
+    }
+
+    if (waiter != NULL)
+    {
+        make_ready(waiter, true);
+        preempt_for(waiter);
+    }
+    else if (sem->count < sem->max)
+    {
+        ++sem->count;
+    }
+    else
+    {
+        rc = pdFALSE;
+    }
+
+    pthread_mutex_unlock(&s_lock);
+
+    return rc;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    sim_queue* queue = sim_heap_alloc(sizeof(sim_queue) + (size_t)length * item_size);
+    if (queue == NULL)
+    {
+        return NULL;
+    }
+
+    return xQueueCreateStatic(length, item_size, (uint8_t*)(queue + 1), (StaticQueue_t*)queue);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* buffer)
+{
+    if (length == 0 || storage == NULL || buffer == NULL)
+    {
+        return NULL;
+    }
+
+    sim_queue* queue = (sim_queue*)buffer;
+    create_sem(&queue->items, 0, length);
+    queue->storage = storage;
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->head = 0;
+    queue->stored = 0;
+
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    pthread_mutex_lock(&s_lock);
+
+    if (queue->stored == queue->length)
+    {
+        pthread_mutex_unlock(&s_lock);
+        if (ticks != 0)
+        {
+            report_stuck("a send to a full queue would block, which is not simulated");
+        }
+        return errQUEUE_FULL;
+    }
+
+    UBaseType_t tail = (queue->head + queue->stored) % queue->length;
+    memcpy(queue->storage + (size_t)tail * queue->item_size, item, queue->item_size);
+    ++queue->stored;
+
+    pthread_mutex_unlock(&s_lock);
+
+    // Wakes a waiting receiver, which then takes the oldest item.
+    xSemaphoreGive(&queue->items);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks)
+{
+    if (xSemaphoreTake(&queue->items, ticks) != pdTRUE)
+    {
+        return pdFALSE;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    memcpy(buffer, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    --queue->stored;
+    pthread_mutex_unlock(&s_lock);
+
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->stored;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct esp_timer* timer = sim_heap_alloc(sizeof(struct esp_timer));
+    if (timer == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->due_us = NO_WAKE;
+    timer->period_us = 0;
+
+    pthread_mutex_lock(&s_lock);
+    timer->next = s_timers;
+    s_timers = timer;
+    pthread_mutex_unlock(&s_lock);
+
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    pthread_mutex_lock(&s_lock);
+    timer->due_us = s_now_us + (int64_t)timeout_us;
+    timer->period_us = 0;
+    timer_task_kick();
+    pthread_mutex_unlock(&s_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    pthread_mutex_lock(&s_lock);
+    timer->due_us = s_now_us + (int64_t)period_us;
+    timer->period_us = period_us;
+    timer_task_kick();
+    pthread_mutex_unlock(&s_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_lock);
+    esp_err_t rc = timer->due_us == NO_WAKE ? ESP_ERR_INVALID_STATE : ESP_OK;
+    timer->due_us = NO_WAKE;
+    pthread_mutex_unlock(&s_lock);
+
+    return rc;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return sim_now_us();
+}
+
+/**
+ * Add a ready task. Must hold the lock.
+*/
+static sim_task* create_task(TaskFunction_t fn, const char* name, void* params, UBaseType_t priority)
+{
+    sim_task* task = calloc(1, sizeof(sim_task));
+    if (task == NULL)
+    {
+        report_stuck("out of host memory");
+    }
+
+    snprintf(task->name, sizeof(task->name), "%s", name != NULL ? name : "");
+    task->priority = priority;
+    task->fn = fn;
+    task->params = params;
+    task->wake_us = NO_WAKE;
+    pthread_cond_init(&task->cond, NULL);
+
+    // Appended, so the stats list tasks in creation order.
+    sim_task** link = &s_tasks;
+    while (*link != NULL)
+    {
+        link = &(*link)->next;
+    }
+    *link = task;
+
+    make_ready(task, false);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SIM_THREAD_STACK);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&task->thread, &attr, task_thread, task) != 0)
+    {
+        report_stuck("can't create a host thread");
+    }
+    pthread_attr_destroy(&attr);
+
+    return task;
+}
+
+static void* task_thread(void* arg)
+{
+    sim_task* task = (sim_task*)arg;
+
+    pthread_mutex_lock(&s_lock);
+    while (s_current != task)
+    {
+        pthread_cond_wait(&task->cond, &s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    task->fn(task->params);
+
+    // Returning from a task function is an error on FreeRTOS; here the task just ends.
+    fprintf(stderr, "sim: task %s returned\n", task->name);
+    vTaskDelete(NULL);
+
+    return NULL;
+}
+
+/**
+ * Give the CPU to the highest priority ready task, which may be self if it is still ready, and wait until self is
+ * scheduled again. self's state must already be set. Must hold the lock.
+*/
+static void reschedule(sim_task* self)
+{
+    sim_task* next = pick_ready();
+    while (next == NULL)
+    {
+        if (!advance_clock())
+        {
+            pthread_mutex_unlock(&s_lock);
+            report_stuck("every task is blocked with no timeout");
+        }
+        next = pick_ready();
+    }
+
+    next->state = SIM_TASK_RUNNING;
+    if (next == self)
+    {
+        return;
+    }
+
+    ++s_switches;
+    ++next->runs;
+    s_current = next;
+    pthread_cond_signal(&next->cond);
+
+    if (self->state == SIM_TASK_DELETED)
+    {
+        return;
+    }
+
+    while (s_current != self)
+    {
+        pthread_cond_wait(&self->cond, &s_lock);
+    }
+}
+
+static sim_task* pick_ready()
+{
+    sim_task* best = NULL;
+
+    for (sim_task* task = s_tasks; task != NULL; task = task->next)
+    {
+        if (task->state == SIM_TASK_READY &&
+            (best == NULL || task->priority > best->priority ||
+                (task->priority == best->priority && task->seq < best->seq)))
+        {
+            best = task;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Move the clock to the earliest wakeup and make the tasks due then ready. Returns false if no task has a timeout.
+*/
+static bool advance_clock()
+{
+    int64_t earliest = NO_WAKE;
+    for (sim_task* task = s_tasks; task != NULL; task = task->next)
+    {
+        if (task->state == SIM_TASK_BLOCKED && task->wake_us != NO_WAKE &&
+            (earliest == NO_WAKE || task->wake_us < earliest))
+        {
+            earliest = task->wake_us;
+        }
+    }
+
+    if (earliest == NO_WAKE)
+    {
+        return false;
+    }
+
+    if (earliest > s_now_us)
+    {
+        s_now_us = earliest;
+        s_spins = 0;
+    }
+
+    for (sim_task* task = s_tasks; task != NULL; task = task->next)
+    {
+        if (task->state == SIM_TASK_BLOCKED && task->wake_us != NO_WAKE && task->wake_us <= s_now_us)
+        {
+            make_ready(task, false);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Block the current task until woken or until wake_us (NO_WAKE for no timeout). Returns true if it was woken by an
+ * event. Must hold the lock.
+*/
+static bool block_current(int64_t wake_us)
+{
+    sim_task* self = s_current;
+
+    self->state = SIM_TASK_BLOCKED;
+    self->wake_us = wake_us;
+    self->woken = false;
+    self->seq = ++s_seq;
+
+    reschedule(self);
+
+    return self->woken;
+}
+
+static void make_ready(sim_task* task, bool woken)
+{
+    task->state = SIM_TASK_READY;
+    task->wake_us = NO_WAKE;
+    task->wait_sem = NULL;
+    task->wait_notify = false;
+    task->woken = woken;
+    task->seq = ++s_seq;
+}
+
+/**
+ * Switch to a task that just became ready if it outranks the current one, as a preemptive kernel would. Must hold the
+ * lock.
+*/
+static void preempt_for(sim_task* task)
+{
+    sim_task* self = s_current;
+
+    if (self != NULL && task->priority > self->priority)
+    {
+        make_ready(self, false);
+        reschedule(self);
+    }
+}
+
+/**
+ * Wakeups are on tick boundaries, as on the device.
+*/
+static int64_t ticks_to_wake(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        return NO_WAKE;
+    }
+
+    return (s_now_us / TICK_US + (int64_t)ticks) * TICK_US;
+}
+
+static sim_sem* create_sem(sim_sem* sem, UBaseType_t count, UBaseType_t max)
+{
+    if (sem != NULL)
+    {
+        sem->count = count;
+        sem->max = max;
+    }
+
+    return sem;
+}
+
+/**
+ * Runs timer callbacks when they are due, like ESP-IDF's esp_timer task.
+*/
+static void timer_task(void* params)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&s_lock);
+        s_current->notify_count = 0;
+
+        struct esp_timer* due = NULL;
+        for (struct esp_timer* timer = s_timers; timer != NULL; timer = timer->next)
+        {
+            if (timer->due_us != NO_WAKE && (due == NULL || timer->due_us < due->due_us))
+            {
+                due = timer;
+            }
+        }
+
+        if (due == NULL || due->due_us > s_now_us)
+        {
+            // Sleep until the next timer is due, or until a timer is started.
+            s_current->wait_notify = true;
+            block_current(due != NULL ? due->due_us : NO_WAKE);
+            pthread_mutex_unlock(&s_lock);
+            continue;
+        }
+
+        due->due_us = due->period_us > 0 ? due->due_us + (int64_t)due->period_us : NO_WAKE;
+        pthread_mutex_unlock(&s_lock);
+
+        due->callback(due->arg);
+    }
+}
+
+/**
+ * Wake the timer task to look at the timers again. Must hold the lock.
+*/
+static void timer_task_kick()
+{
+    sim_task* task = s_timer_task;
+
+    ++task->notify_count;
+    if (task != s_current && task->state == SIM_TASK_BLOCKED && task->wait_notify)
+    {
+        make_ready(task, true);
+        preempt_for(task);
+    }
+}
+
+static void report_stuck(const char* reason)
+{
+    fprintf(stderr, "sim: stopped at %.3f s: %s\n", s_now_us / 1e6, reason);
+    for (sim_task* task = s_tasks; task != NULL; task = task->next)
+    {
+        static const char* const state_names[] = { "ready", "running", "blocked", "deleted" };
+        fprintf(stderr, "  %-16s priority %2u  %s%s\n", task->name, task->priority, state_names[task->state],
+            task->state == SIM_TASK_BLOCKED && task->wake_us == NO_WAKE ? " forever" : "");
+    }
+
+    exit(2);
+}
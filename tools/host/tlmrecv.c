@@ -0,0 +1,304 @@
+/**
+ * Telemetry receiver: listens for the device's reading datagrams (lib/utils/telemetry_packet.h) on a station of the
+ * SoftAP, or on any network the datagrams reach, and prints each reading as it comes. Many receivers can listen at
+ * once; the device sends the same datagram whatever their number.
+ *
+ * Each sender is tracked by sensor id, and a jump in its sequence numbers is reported as readings missed. At the end
+ * (after -n datagrams, or -w seconds without one) a summary is printed. The exit code is 0 if every datagram decoded
+ * and came in order, 1 if not, 2 if nothing was received.
+ *
+ * Usage: tlmrecv [-p port] [-m] [-g group] [-n count] [-w seconds] [-q]
+ *   -p   UDP port, as in the tlm_port setting. Default TLM_DEFAULT_PORT.
+ *   -m   Join the multicast group, for tlm_mode=2. Broadcasts (tlm_mode=1) are received either way.
+ *   -g   Multicast group to join instead of TLM_MULTICAST_GROUP. Implies -m.
+ *   -n   Stop after this many datagrams. Default: run until interrupted.
+ *   -w   Stop after this many seconds without a datagram. Default: wait forever.
+ *   -q   Only print the summary.
+*/
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "prj_config.h"
+#include "telemetry_packet.h"
+
+#define MAX_SENDERS 16
+
+typedef struct sender
+{
+    uint32_t sensor_id;
+    struct in_addr address;
+    uint32_t received;
+    uint32_t last_seq;
+    // Readings skipped over by a jump in sequence numbers, and datagrams that went backwards (a restart, or reordered).
+    uint32_t missed;
+    uint32_t backwards;
+} sender;
+
+static sender s_senders[MAX_SENDERS];
+static size_t s_sender_count = 0;
+static uint32_t s_rejected = 0;
+static uint32_t s_untracked = 0;
+static volatile sig_atomic_t s_stop = 0;
+
+static int open_socket(uint16_t port, const char* group);
+static void on_datagram(const uint8_t* data, size_t len, const struct sockaddr_in* from, bool quiet);
+static sender* find_sender(uint32_t sensor_id, const struct sockaddr_in* from);
+static int report();
+static void on_signal(int sig);
+
+int main(int argc, char** argv)
+{
+    uint16_t port = TLM_DEFAULT_PORT;
+    const char* group = NULL;
+    long count = 0;
+    int wait_s = 0;
+    bool quiet = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:mg:n:w:q")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            port = (uint16_t)atoi(optarg);
+            break;
+        case 'm':
+            group = group != NULL ? group : TLM_MULTICAST_GROUP;
+            break;
+        case 'g':
+            group = optarg;
+            break;
+        case 'n':
+            count = atol(optarg);
+            break;
+        case 'w':
+            wait_s = atoi(optarg);
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-p port] [-m] [-g group] [-n count] [-w seconds] [-q]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = open_socket(port, group);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    if (wait_s > 0)
+    {
+        struct timeval timeout = { .tv_sec = wait_s };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    // Interrupting ends the run with the summary. No SA_RESTART, so recvfrom returns.
+    struct sigaction action = { .sa_handler = on_signal };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (!quiet)
+    {
+        printf("listening on port %u%s%s\n", port, group != NULL ? ", group " : "", group != NULL ? group : "");
+    }
+
+    // Larger than a datagram, so a longer one is seen as such and rejected.
+    uint8_t buffer[TLP_SIZE * 4];
+    long received = 0;
+
+    while (!s_stop && (count == 0 || received < count))
+    {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr*)&from, &from_len);
+        if (len < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                fprintf(stderr, "nothing received for %d s\n", wait_s);
+                break;
+            }
+            if (errno != EINTR)
+            {
+                perror("recvfrom");
+            }
+            break;
+        }
+
+        on_datagram(buffer, (size_t)len, &from, quiet);
+        ++received;
+    }
+
+    close(fd);
+    return report();
+}
+
+/**
+ * Bind to the port on every address, so both broadcasts and the group's datagrams arrive, and join the group if any.
+*/
+static int open_socket(uint16_t port, const char* group)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    // Lets more than one receiver on this host listen on the port.
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    if (group != NULL)
+    {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1 ||
+            setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+        {
+            fprintf(stderr, "can't join group %s: %s\n", group, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+static void on_datagram(const uint8_t* data, size_t len, const struct sockaddr_in* from, bool quiet)
+{
+    tlp_packet packet;
+    if (tlp_decode(data, len, &packet) != TLP_OK)
+    {
+        ++s_rejected;
+        if (!quiet)
+        {
+            printf("%-15s rejected a %zu byte datagram\n", inet_ntoa(from->sin_addr), len);
+        }
+        return;
+    }
+
+    sender* s = find_sender(packet.sensor_id, from);
+    if (s == NULL)
+    {
+        ++s_untracked;
+    }
+    else
+    {
+        if (s->received > 0 && packet.seq > s->last_seq + 1)
+        {
+            s->missed += packet.seq - s->last_seq - 1;
+            if (!quiet)
+            {
+                printf("%-15s sensor %08" PRIx32 " missed %" PRIu32 " readings\n", inet_ntoa(from->sin_addr),
+                    packet.sensor_id, packet.seq - s->last_seq - 1);
+            }
+        }
+        else if (s->received > 0 && packet.seq <= s->last_seq)
+        {
+            ++s->backwards;
+        }
+        ++s->received;
+        s->last_seq = packet.seq;
+    }
+
+    if (quiet)
+    {
+        return;
+    }
+
+    printf("%-15s sensor %08" PRIx32 " seq %8" PRIu32 " uptime %8" PRIu32 " s  ", inet_ntoa(from->sin_addr),
+        packet.sensor_id, packet.seq, packet.time_s);
+    if (packet.value == INT32_MIN)
+    {
+        printf("read failed, error %u\n", packet.error);
+    }
+    else
+    {
+        printf("%7.2f F\n", packet.value / 100.0);
+    }
+    fflush(stdout);
+}
+
+static sender* find_sender(uint32_t sensor_id, const struct sockaddr_in* from)
+{
+    for (size_t i = 0; i < s_sender_count; ++i)
+    {
+        if (s_senders[i].sensor_id == sensor_id)
+        {
+            return &s_senders[i];
+        }
+    }
+
+    if (s_sender_count == MAX_SENDERS)
+    {
+        return NULL;
+    }
+
+    sender* s = &s_senders[s_sender_count++];
+    memset(s, 0, sizeof(*s));
+    s->sensor_id = sensor_id;
+    s->address = from->sin_addr;
+    return s;
+}
+
+static int report()
+{
+    uint32_t received = s_untracked;
+    bool in_order = true;
+
+    printf("\n%-8s %-15s %10s %10s %10s %10s\n", "sensor", "address", "received", "last seq", "missed", "backwards");
+    for (size_t i = 0; i < s_sender_count; ++i)
+    {
+        const sender* s = &s_senders[i];
+        printf("%08" PRIx32 " %-15s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n", s->sensor_id,
+            inet_ntoa(s->address), s->received, s->last_seq, s->missed, s->backwards);
+        received += s->received;
+        in_order = in_order && s->missed == 0 && s->backwards == 0;
+    }
+    printf("%" PRIu32 " readings, %" PRIu32 " datagrams rejected, %" PRIu32 " from untracked senders\n", received,
+        s_rejected, s_untracked);
+
+    if (received == 0)
+    {
+        return 2;
+    }
+    return in_order && s_rejected == 0 ? 0 : 1;
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    s_stop = 1;
+}
@@ -0,0 +1,183 @@
+/**
+ * Host benchmark of the compressed time series (lib/utils/tseries.c) against the plain sample array the sensor
+ * history uses.
+ *
+ * Fills both with the same synthetic readings (a slow random walk sampled every poll period, with occasional timing
+ * jitter) and reports bytes per sample and decode throughput walking forward and backward.
+ *
+ * Usage: tsbench [-n samples] [-r rounds]
+ *   -n   Number of samples. Default 100000.
+ *   -r   Times each walk is repeated. Default 20.
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tempr_sensor_types.h"
+#include "tseries.h"
+
+static double now_s();
+static void fill(tps_sample* samples, tsr_series* series, size_t count);
+static void report(const char* name, size_t bytes, size_t count, double seconds, int rounds);
+
+// Keeps the compiler from dropping the walks.
+static volatile int64_t s_sink;
+
+int main(int argc, char** argv)
+{
+    size_t count = 100000;
+    int rounds = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            count = (size_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples] [-r rounds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (count == 0 || rounds <= 0)
+    {
+        fprintf(stderr, "samples and rounds must be positive\n");
+        return 1;
+    }
+
+    // Worst case is a block per sample.
+    tps_sample* samples = malloc(count * sizeof(tps_sample));
+    tsr_block* blocks = malloc(count * sizeof(tsr_block));
+    if (samples == NULL || blocks == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    tsr_series series;
+    tsr_init(&series, blocks, count);
+    fill(samples, &series, count);
+
+    if (tsr_count(&series) != count)
+    {
+        fprintf(stderr, "series kept %zu of %zu samples\n", tsr_count(&series), count);
+        return 1;
+    }
+
+    printf("%zu samples, %d rounds, %zu byte blocks\n\n", count, rounds, sizeof(tsr_block));
+    printf("%-22s %10s %12s %14s\n", "store", "bytes", "bytes/sample", "Msamples/s");
+
+    // Plain array, oldest to newest.
+    double start = now_s();
+    for (int r = 0; r < rounds; ++r)
+    {
+        int64_t sum = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            sum += samples[i].value + samples[i].time_s;
+        }
+        s_sink = sum;
+    }
+    report("array forward", count * sizeof(tps_sample), count, now_s() - start, rounds);
+
+    start = now_s();
+    for (int r = 0; r < rounds; ++r)
+    {
+        int64_t sum = 0;
+        for (size_t i = count; i > 0; --i)
+        {
+            sum += samples[i - 1].value + samples[i - 1].time_s;
+        }
+        s_sink = sum;
+    }
+    report("array backward", count * sizeof(tps_sample), count, now_s() - start, rounds);
+
+    // Compressed series. Check the decoded values once, then time the walks.
+    tsr_iter it;
+    size_t i = 0;
+    tsr_first(&series, &it);
+    do
+    {
+        if (it.point.time != samples[i].time_s || it.point.value != samples[i].value)
+        {
+            fprintf(stderr, "mismatch at sample %zu\n", i);
+            return 1;
+        }
+        ++i;
+    } while (tsr_next(&it));
+
+    start = now_s();
+    for (int r = 0; r < rounds; ++r)
+    {
+        int64_t sum = 0;
+        tsr_first(&series, &it);
+        do
+        {
+            sum += it.point.value + it.point.time;
+        } while (tsr_next(&it));
+        s_sink = sum;
+    }
+    report("tseries forward", tsr_bytes_used(&series), count, now_s() - start, rounds);
+
+    start = now_s();
+    for (int r = 0; r < rounds; ++r)
+    {
+        int64_t sum = 0;
+        tsr_last(&series, &it);
+        do
+        {
+            sum += it.point.value + it.point.time;
+        } while (tsr_prev(&it));
+        s_sink = sum;
+    }
+    report("tseries backward", tsr_bytes_used(&series), count, now_s() - start, rounds);
+
+    printf("\n%.1fx more samples in the same RAM as the array\n",
+        (double)(count * sizeof(tps_sample)) / (double)tsr_bytes_used(&series));
+
+    free(blocks);
+    free(samples);
+    return 0;
+}
+
+/**
+ * Readings in hundredths of degrees fahrenheit, one per minute. About one sample in seven lands a second late.
+*/
+static void fill(tps_sample* samples, tsr_series* series, size_t count)
+{
+    uint32_t seed = 1;
+    uint32_t time = 0;
+    int32_t value = 7000;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        time += 60 + ((seed >> 16) % 7 == 0 ? 1 : 0);
+        value += (int32_t)((seed >> 20) % 7) - 3;
+
+        samples[i].time_s = time;
+        samples[i].value = value;
+        tsr_append(series, time, value);
+    }
+}
+
+static void report(const char* name, size_t bytes, size_t count, double seconds, int rounds)
+{
+    double rate = (double)count * rounds / seconds / 1e6;
+    printf("%-22s %10zu %12.2f %14.1f\n", name, bytes, (double)bytes / count, rate);
+}
+
+static double now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}